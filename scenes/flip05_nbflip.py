@@ -59,6 +59,9 @@ mesh      = s.create(Mesh)
 pindex = s.create(ParticleIndexSystem)
 gpi    = s.create(IntGrid)
 
+# Band cells for the narrow-band versions of the particle mapping and extrapolation
+band   = s.create(NarrowBand)
+
 # Geometry in world units (to be converted to grid space upon init)
 flags.initDomain(boundaryWidth=0)
 phi.initFromFlags(flags)
@@ -118,11 +121,13 @@ while s.frame < 200:
 	flags.updateFromLevelset(phi)
 
 	# Make sure we have velocities throught liquid region
+	extrapolationDist = int(maxVel*1.25 + 2.)
 	if narrowBand:
-		# Combine particles velocities with advected grid velocities
-		mapPartsToMAC(vel=velParts, flags=flags, velOld=velOld, parts=pp, partVel=pVel, weight=mapWeights)
-		extrapolateMACFromWeight( vel=velParts , distance=2, weight=mapWeights )
-		combineGridVel(vel=velParts, weight=mapWeights , combineVel=vel, phi=phi, narrowBand=combineBandWidth, thresh=0)
+		# Combine particles velocities with advected grid velocities, only in the band
+		band.update(phi=phi, inner=narrowBandWidth+2, outer=extrapolationDist+1)
+		mapPartsToMAC(vel=velParts, flags=flags, velOld=velOld, parts=pp, partVel=pVel, weight=mapWeights, band=band)
+		extrapolateMACFromWeight( vel=velParts , distance=2, weight=mapWeights, band=band )
+		combineGridVel(vel=velParts, weight=mapWeights , combineVel=vel, phi=phi, narrowBand=combineBandWidth, thresh=0, band=band)
 		velOld.copyFrom(vel)
 	else:
 		# Map particle velocities to grid
@@ -136,7 +141,7 @@ while s.frame < 200:
 	setWallBcs(flags=flags, vel=vel)
 
 	# Extrapolate velocities
-	extrapolateMACSimple( flags=flags, vel=vel, distance=(int(maxVel*1.25 + 2.)) )
+	extrapolateMACSimple( flags=flags, vel=vel, distance=extrapolationDist, band=(band if narrowBand else None) )
 	
 	# Update particle velocities
 	flipVelocityUpdate(vel=vel, velOld=velOld, flags=flags, parts=pp, partVel=pVel, flipRatio=0.95 )
@@ -0,0 +1,71 @@
+#
+# Simulation of a buoyant smoke with a fast, localized jet and local time-stepping:
+# instead of reducing the time step of the whole domain for the jet, only the blocks
+# with fast flow are advected with substeps, the pressure is solved once per step
+#
+
+from manta import *
+
+# solver params
+dim = 3
+res = 64
+gs = vec3(res,1.5*res,res)
+if (dim==2):
+	gs.z=1
+s = FluidSolver(name='main', gridSize = gs, dim=dim)
+
+# how many frames to calculate
+frames    = 100
+
+# one step per frame, the CFL condition is enforced per block during advection
+s.frameLength = 1.2
+s.timestep    = 1.2
+cfl           = 1.0
+
+# prepare grids
+flags = s.create(FlagGrid)
+vel = s.create(MACGrid)
+density = s.create(RealGrid)
+pressure = s.create(RealGrid)
+
+# noise field
+noise = s.create(NoiseField, loadFromFile=True)
+noise.posScale = vec3(45)
+noise.clamp = True
+noise.clampNeg = 0
+noise.clampPos = 1
+noise.valScale = 1
+noise.valOffset = 0.75
+noise.timeAnim = 0.2
+
+flags.initDomain()
+flags.fillGrid()
+timings = Timings()
+
+if (GUI):
+	gui = Gui()
+	gui.show( dim==2 )
+
+source = s.create(Cylinder, center=gs*vec3(0.5,0.1,0.5), radius=res*0.14, z=gs*vec3(0, 0.02, 0))
+jet    = s.create(Cylinder, center=gs*vec3(0.2,0.1,0.5), radius=res*0.04, z=gs*vec3(0, 0.02, 0))
+
+#main loop
+while s.frame < frames:
+
+	if s.timeTotal<50.:
+		densityInflow(flags=flags, density=density, noise=noise, shape=source, scale=1, sigma=0.5)
+		densityInflow(flags=flags, density=density, noise=noise, shape=jet, scale=1, sigma=0.5)
+		jet.applyToGrid(grid=vel, value=vec3(0,4,0))
+
+	substeps = advectSemiLagrangeLocal(flags=flags, vel=vel, grid=density, order=2, cfl=cfl)
+	advectSemiLagrangeLocal(flags=flags, vel=vel, grid=vel, order=2, cfl=cfl)
+	mantaMsg('\nFrame %i, %i substeps for the fastest blocks' % (s.frame, substeps))
+
+	setWallBcs(flags=flags, vel=vel)
+	addBuoyancy(density=density, vel=vel, gravity=vec3(0,-6e-3,0), flags=flags)
+
+	solvePressure( flags=flags, vel=vel, pressure=pressure )
+	setWallBcs(flags=flags, vel=vel)
+
+	#timings.display()
+	s.step()
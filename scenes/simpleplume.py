@@ -32,6 +32,10 @@ source = s.create(Cylinder, center=gs*vec3(0.5,0.1,0.5), radius=res*0.14, z=gs*v
 flags.initDomain()
 flags.fillGrid()
 
+# the flags don't change, compute the cell types and neighbor masks for the stencil kernels once
+cflags = s.create(CompactFlags)
+cflags.update(flags)
+
 if (GUI):
 	gui = Gui()
 	gui.show()
@@ -48,9 +52,9 @@ for t in range(250):
 	advectSemiLagrange(flags=flags, vel=vel, grid=density, order=2)    
 	advectSemiLagrange(flags=flags, vel=vel, grid=vel    , order=2, strength=1.0)
 	
-	setWallBcs(flags=flags, vel=vel)    
+	setWallBcs(flags=flags, vel=vel, cflags=cflags)
 	addBuoyancy(density=density, vel=vel, gravity=vec3(0,-6e-4,0), flags=flags)
 	
-	solvePressure( flags=flags, vel=vel, pressure=pressure )
+	solvePressure( flags=flags, vel=vel, pressure=pressure, cflags=cflags )
 	s.step()
 
@@ -30,6 +30,8 @@ temp=s.create(RealGrid)
 # noise field
 noise = s.create(NoiseField)
 noise.timeAnim = 0
+# optionally trade memory for speed, trilinear lookups in a precomputed curl tile
+#noise.cacheCurl()
 
 # turbulence particles
 turb = s.create(TurbulenceParticleSystem, noise=noise)
@@ -94,6 +96,9 @@ for t in range(10000):
 	
 	if enableDiffuse:
 		KEpsilonGradientDiffusion(k=k, eps=eps, vel=vel, nuT=nuT, sigmaU=10.0);
+	# the same model update in two fused passes, with a persistent workspace:
+	#kepsilon = s.create(KEpsilonModel) # (before the loop)
+	#kepsilon.step(flags=flags, vel=vel, k=k, eps=eps, prod=prod, nuT=nuT, intensity=intensity, nu=nu, strain=strain, pscale=prodMult, diffuse=enableDiffuse, sigmaU=10.0)
 
 	# base solver
 	advectSemiLagrange(flags=flags, vel=vel, grid=vel, order=2)
@@ -141,6 +141,8 @@ for t in range(200):
 	# manually weight and apply further octaves
 	applyNoiseVec3( flags=xl_flags, target=xl_vel, noise=wltnoise2, scale=wltStrength*0.6 , weight=xl_weight)
 	applyNoiseVec3( flags=xl_flags, target=xl_vel, noise=wltnoise3, scale=wltStrength*0.6*0.6 , weight=xl_weight)
+	# alternatively, all of the above in a single pass, optionally only where there is smoke:
+	#applyWaveletUpres( flags=xl_flags, target=xl_vel, source=vel, energy=energy, noises=[wltnoise,wltnoise2,wltnoise3], scale=wltStrength, octaveScale=0.6, density=density )
 	
 	for substep in range(upres): 
 		advectSemiLagrange(flags=xl_flags, vel=xl_vel, grid=xl_density, order=2)    
@@ -0,0 +1,65 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2011 Tobias Pfaff, Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Compact cell types and neighbor masks of a flag grid
+ *
+ ******************************************************************************/
+
+#include "compactflags.h"
+
+using namespace std;
+
+namespace Manta {
+
+//! bits of a neighbor with the given flags at a face
+inline static uint32_t faceBits(int flags, int face) {
+	uint32_t m = 0;
+	if(flags & FlagGrid::TypeFluid)    m |= 1u << (CompactFlags::NbFluid    + face);
+	if(flags & FlagGrid::TypeObstacle) m |= 1u << (CompactFlags::NbObstacle + face);
+	if(flags & FlagGrid::TypeEmpty)    m |= 1u << (CompactFlags::NbEmpty    + face);
+	if(flags & FlagGrid::TypeStick)    m |= 1u << (CompactFlags::NbStick    + face);
+	return m;
+}
+
+KERNEL()
+void knCompactFlags(const FlagGrid& flags, std::vector<uint32_t>& mask) {
+	const IndexInt idx = flags.index(i,j,k);
+	const IndexInt X = flags.getStrideX(), Y = flags.getStrideY(), Z = flags.getStrideZ();
+	const uint32_t t = flags[idx] & CompactFlags::TypeMask;
+	uint32_t m = t;
+	if(i > 0)                     m |= faceBits(flags[idx-X], CompactFlags::FaceXm);
+	if(i < flags.getSizeX()-1)    m |= faceBits(flags[idx+X], CompactFlags::FaceXp);
+	if(j > 0)                     m |= faceBits(flags[idx-Y], CompactFlags::FaceYm);
+	if(j < flags.getSizeY()-1)    m |= faceBits(flags[idx+Y], CompactFlags::FaceYp);
+	if(flags.is3D()) {
+		if(k > 0)                 m |= faceBits(flags[idx-Z], CompactFlags::FaceZm);
+		if(k < flags.getSizeZ()-1) m |= faceBits(flags[idx+Z], CompactFlags::FaceZp);
+	}
+	mask[idx] = m;
+}
+
+KERNEL(pts, reduce=+) returns(int cnt=0)
+int knCountCompactFlags(const std::vector<uint32_t>& mask, int flag) {
+	if(mask[idx] & 0xff & flag) cnt++;
+}
+
+CompactFlags::CompactFlags(FluidSolver* parent) : PbClass(parent), mSize(0) {}
+
+void CompactFlags::update(const FlagGrid& flags) {
+	mSize = flags.getSize();
+	const IndexInt n = (IndexInt)mSize.x * mSize.y * mSize.z;
+	mMask.resize(n);
+	knCompactFlags(flags, mMask);
+}
+
+int CompactFlags::countCells(int flag) const {
+	return knCountCompactFlags(mMask, flag);
+}
+
+} // namespace
@@ -0,0 +1,65 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2011 Tobias Pfaff, Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Compact cell types and neighbor masks of a flag grid
+ *
+ ******************************************************************************/
+
+#ifndef _COMPACTFLAGS_H
+#define _COMPACTFLAGS_H
+
+#include <stdint.h>
+#include "grid.h"
+
+namespace Manta {
+
+//! Compact copy of a flag grid for stencil kernels
+/*! Stores per cell a 32 bit mask with the own type (lowest byte) and the fluid, obstacle, empty and
+	stick faces, i.e. the types of the six neighbors. A stencil kernel
+	thus does a single load instead of seven flag lookups. Only the types up to TypeStick are kept, the
+	reserved and moving obstacle bits are dropped. Neighbors outside of the domain have no type.
+	The masks are not updated automatically, call update() after the flags changed. */
+PYTHON() class CompactFlags : public PbClass {
+public:
+	PYTHON() CompactFlags(FluidSolver* parent);
+
+	//! faces of a cell, bit offsets within a group of the neighbor mask
+	enum Face { FaceXm = 0, FaceXp = 1, FaceYm = 2, FaceYp = 3, FaceZm = 4, FaceZp = 5 };
+	//! first bits of the neighbor type groups in the mask
+	enum NbGroup { NbFluid = 8, NbObstacle = 14, NbEmpty = 20, NbStick = 26 };
+	//! cell types that are kept
+	static const int TypeMask = FlagGrid::TypeFluid | FlagGrid::TypeObstacle | FlagGrid::TypeEmpty |
+		FlagGrid::TypeInflow | FlagGrid::TypeOutflow | FlagGrid::TypeOpen | FlagGrid::TypeStick;
+
+	//! recompute types and masks from the flags
+	PYTHON() void update(const FlagGrid& flags);
+	//! count no. of cells matching flags via "AND", as FlagGrid::countCells
+	PYTHON() int countCells(int flag) const;
+
+	//! was computed for grids of this size
+	inline bool isValid(const GridBase& grid) const { return grid.getSize() == mSize; }
+	//! bit of the neighbor mask for a group and face
+	static inline uint32_t nb(NbGroup group, Face face) { return 1u << (group + face); }
+
+	inline int getType(IndexInt idx) const { return mMask[idx] & 0xff; }
+	inline uint32_t getMask(IndexInt idx) const { return mMask[idx]; }
+	inline bool isFluid(IndexInt idx) const    { return mMask[idx] & FlagGrid::TypeFluid; }
+	inline bool isObstacle(IndexInt idx) const { return mMask[idx] & FlagGrid::TypeObstacle; }
+	inline bool isEmpty(IndexInt idx) const    { return mMask[idx] & FlagGrid::TypeEmpty; }
+	inline bool isOutflow(IndexInt idx) const  { return mMask[idx] & FlagGrid::TypeOutflow; }
+	inline bool isStick(IndexInt idx) const    { return mMask[idx] & FlagGrid::TypeStick; }
+
+protected:
+	Vec3i mSize;
+	std::vector<uint32_t> mMask;
+};
+
+} // namespace
+
+#endif
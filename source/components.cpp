@@ -0,0 +1,366 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2011 Tobias Pfaff, Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Connected component labeling of grids and particles
+ *
+ ******************************************************************************/
+
+#include "components.h"
+#include <unordered_map>
+#include <algorithm>
+
+using namespace std;
+namespace Manta {
+
+//************************************************************************
+// Common parts of the labeling
+//
+// Elements (cells, or particles sorted by bin) of a slab are a consecutive range. Roots are the
+// smallest element of a component, so unions within a slab stay inside of it, and each element
+// points to a smaller one.
+
+//! consecutive element ranges of the slabs, and the layers (z slices, y rows in 2D) they consist of
+struct LabelSlabs {
+	//! split numLayers layers into slabs, layerStart gives the first element of each layer (numLayers+1 entries)
+	void init(const std::vector<IndexInt>& layerStart) {
+		const int numLayers = (int)layerStart.size()-1;
+		// enough work items for all threads, the merge step is serial per slab interface
+		const int maxSlabs = 64;
+		const int layersPerSlab = std::max(1, (numLayers + maxSlabs-1) / maxSlabs);
+		first.clear();
+		start.clear();
+		for(int l=0; l<numLayers; l+=layersPerSlab) {
+			first.push_back(l);
+			start.push_back(layerStart[l]);
+		}
+		first.push_back(numLayers);
+		start.push_back(layerStart[numLayers]);
+	}
+	//! number of slabs, also the number of work items of the slab kernels
+	inline IndexInt size() const { return (IndexInt)first.size()-1; }
+
+	std::vector<int> first;       //!< first layer of each slab
+	std::vector<IndexInt> start;  //!< first element of each slab
+};
+
+typedef std::unordered_map<int, ComponentInfo> ComponentMap;
+
+//! Kernel: flatten the slab-local trees, roots are smaller than their members, so a forward pass suffices
+KERNEL(pts)
+void knFlattenSlab(const LabelSlabs& slabs, std::vector<int>& parent) {
+	for(IndexInt x=slabs.start[idx], stop=slabs.start[idx+1]; x<stop; ++x) {
+		if(parent[x] >= 0) parent[x] = parent[parent[x]];
+	}
+}
+
+//! merge the slabs, the first layer of a slab can connect to the last layer of the previous one
+template<class CONNECT>
+static void mergeSlabs(const LabelSlabs& slabs, std::vector<int>& parent, const CONNECT& connect) {
+	for(int s=1; s<(int)slabs.size(); ++s) connect(slabs.first[s], parent);
+}
+
+//! number the roots in order, and collect the statistics; parent[root] is the component number afterwards
+static void finishComponents(std::vector<ComponentMap>& maps, std::vector<int>& parent, std::vector<ComponentInfo>& info) {
+	ComponentMap all;
+	for(size_t s=0; s<maps.size(); ++s) {
+		for(ComponentMap::const_iterator it=maps[s].begin(); it!=maps[s].end(); ++it) all[it->first].join(it->second);
+		maps[s].clear();
+	}
+	std::vector<int> roots;
+	roots.reserve(all.size());
+	for(ComponentMap::const_iterator it=all.begin(); it!=all.end(); ++it) roots.push_back(it->first);
+	std::sort(roots.begin(), roots.end());
+
+	info.resize(roots.size());
+	for(size_t c=0; c<roots.size(); ++c) {
+		info[c] = all[roots[c]];
+		parent[roots[c]] = (int)c+1;
+	}
+}
+
+//************************************************************************
+// Grids
+
+//! cells with any of the given flags
+struct FlagMember {
+	FlagMember(const FlagGrid& flags, int type) : flags(flags), type(type) {}
+	inline bool operator() (IndexInt x) const { return (flags[x] & type) != 0; }
+	const FlagGrid& flags;
+	int type;
+};
+
+//! cells below / above a threshold
+struct ThresholdMember {
+	ThresholdMember(const Grid<Real>& grid, Real threshold, bool below) : grid(grid), threshold(threshold), below(below) {}
+	inline bool operator() (IndexInt x) const { return below ? grid[x] < threshold : grid[x] > threshold; }
+	const Grid<Real>& grid;
+	Real threshold;
+	bool below;
+};
+
+//! Kernel: label the cells of one slab
+KERNEL(pts) template<class MEMBER>
+void knLabelCellSlab(const LabelSlabs& slabs, const GridBase& grid, const MEMBER& member, std::vector<int>& parent) {
+	const IndexInt start = slabs.start[idx], stop = slabs.start[idx+1];
+	const int sx = grid.getSizeX();
+	const IndexInt sxy = (IndexInt)sx * grid.getSizeY();
+	const IndexInt layer = grid.is3D() ? sxy : sx;
+	for(IndexInt x=start; x<stop; ++x) {
+		if(!member(x)) {
+			parent[x] = -1;
+			continue;
+		}
+		parent[x] = (int)x;
+		if(x % sx > 0 && parent[x-1] >= 0) UnionFind::unite(parent, (int)x-1, (int)x);
+		if(grid.is3D() && (x % sxy) >= sx && parent[x-sx] >= 0) UnionFind::unite(parent, (int)(x-sx), (int)x);
+		// previous layer, only within the slab
+		if(x-layer >= start && parent[x-layer] >= 0) UnionFind::unite(parent, (int)(x-layer), (int)x);
+	}
+}
+
+//! Kernel: resolve the component roots of the cells of a slab, and accumulate their statistics
+KERNEL(pts)
+void knResolveCellSlab(const LabelSlabs& slabs, std::vector<ComponentMap>& maps, const std::vector<int>& parent, Grid<int>& labels) {
+	ComponentMap& map = maps[idx];
+	ComponentInfo* cur = NULL;
+	int curRoot = -1;
+	const int sx = labels.getSizeX(), sy = labels.getSizeY();
+	const Vec3 extent(1.);
+	for(IndexInt x=slabs.start[idx], stop=slabs.start[idx+1]; x<stop; ++x) {
+		if(parent[x] < 0) {
+			labels[x] = -1;
+			continue;
+		}
+		const int root = UnionFind::find(parent, parent[x]);
+		labels[x] = root;
+		// neighboring cells mostly belong to the same component
+		if(root != curRoot) {
+			cur = &map[root];
+			curRoot = root;
+		}
+		cur->add(Vec3(x % sx, (x / sx) % sy, x / ((IndexInt)sx*sy)), extent);
+	}
+}
+
+//! Kernel: replace roots by component numbers
+KERNEL(idx)
+void knNumberCells(Grid<int>& labels, const std::vector<int>& number) {
+	labels[idx] = labels[idx] >= 0 ? number[labels[idx]] : 0;
+}
+
+template<class MEMBER>
+static void labelCells(Grid<int>& labels, const MEMBER& member, std::vector<ComponentInfo>& info) {
+	const IndexInt total = (IndexInt)labels.getSizeX() * labels.getSizeY() * labels.getSizeZ();
+	assertMsg(total < std::numeric_limits<int>::max(), "ConnectedComponents: grid too large");
+	const int numLayers = labels.is3D() ? labels.getSizeZ() : labels.getSizeY();
+	const IndexInt layer = total / numLayers;
+	std::vector<IndexInt> layerStart(numLayers+1);
+	for(int l=0; l<=numLayers; ++l) layerStart[l] = l * layer;
+	LabelSlabs slabs;
+	slabs.init(layerStart);
+
+	std::vector<int> parent(total);
+	std::vector<ComponentMap> maps(slabs.size());
+	knLabelCellSlab<MEMBER>(slabs, labels, member, parent);
+	knFlattenSlab(slabs, parent);
+	mergeSlabs(slabs, parent, [&](int l, std::vector<int>& p) {
+		for(IndexInt x=layerStart[l]; x<layerStart[l+1]; ++x) {
+			if(p[x] >= 0 && p[x-layer] >= 0) UnionFind::unite(p, (int)(x-layer), (int)x);
+		}
+	});
+	knResolveCellSlab(slabs, maps, parent, labels);
+	finishComponents(maps, parent, info);
+	knNumberCells(labels, parent);
+}
+
+//************************************************************************
+// Particles
+
+//! particles sorted into bins with the size of the connection radius
+struct ParticleBins {
+	ParticleBins(const BasicParticleSystem& parts, Vec3i gridSize, bool is3D, Real radius) {
+		const Real binSize = std::max(radius, Real(1e-4));
+		for(int c=0; c<3; ++c) res[c] = std::max(1, (int)std::ceil(gridSize[c] / binSize));
+		if(!is3D) res.z = 1;
+		invBinSize = 1. / binSize;
+
+		// counting sort of the active particles
+		std::vector<int> bin(parts.size(), -1);
+		std::vector<IndexInt> count((IndexInt)res.x*res.y*res.z + 1, 0);
+		for(IndexInt i=0; i<parts.size(); ++i) {
+			if(!parts.isActive(i)) continue;
+			bin[i] = (int)binIndex(parts.getPos(i));
+			count[bin[i]+1]++;
+		}
+		for(size_t b=1; b<count.size(); ++b) count[b] += count[b-1];
+		binStart = count;
+		order.resize(count.back());
+		for(IndexInt i=0; i<parts.size(); ++i) {
+			if(bin[i] >= 0) order[count[bin[i]]++] = (int)i;
+		}
+		pos.resize(order.size());
+		for(size_t s=0; s<order.size(); ++s) pos[s] = parts.getPos(order[s]);
+	}
+	inline IndexInt binIndex(const Vec3& p) const {
+		Vec3i b;
+		for(int c=0; c<3; ++c) b[c] = std::min(std::max((int)(p[c] * invBinSize), 0), res[c]-1);
+		return b.x + (IndexInt)res.x * (b.y + (IndexInt)res.y * b.z);
+	}
+	inline bool is3D() const { return res.z > 1; }
+	//! bins per layer of the slab decomposition
+	inline IndexInt layerBins() const { return is3D() ? (IndexInt)res.x*res.y : res.x; }
+
+	Vec3i res;
+	Real invBinSize;
+	std::vector<IndexInt> binStart; //!< first sorted particle of each bin
+	std::vector<int> order;         //!< particle index of each sorted particle
+	std::vector<Vec3> pos;          //!< positions of the sorted particles
+};
+
+//! connect particle s with the earlier particles of bin b
+static inline void connectBin(const ParticleBins& bins, std::vector<int>& parent, IndexInt b, int s, Real r2, IndexInt lowest) {
+	const IndexInt end = std::min(bins.binStart[b+1], (IndexInt)s);
+	for(IndexInt t=std::max(bins.binStart[b], lowest); t<end; ++t) {
+		if(normSquare(bins.pos[t] - bins.pos[s]) <= r2) UnionFind::unite(parent, (int)t, s);
+	}
+}
+
+//! connect all particles of bin (bx,by,bz) with the earlier particles of the neighbor bins,
+//! lowerLayer and sameLayer choose the neighbors in the previous and the same layer
+static void connectNeighbors(const ParticleBins& bins, std::vector<int>& parent, int bx, int by, int bz, Real r2,
+	bool lowerLayer, bool sameLayer, IndexInt lowest)
+{
+	const Vec3i& res = bins.res;
+	const IndexInt b = bx + (IndexInt)res.x * (by + (IndexInt)res.y * bz);
+	const int dzMin = bins.is3D() ? -1 : 0;
+	for(IndexInt s=bins.binStart[b]; s<bins.binStart[b+1]; ++s) {
+		for(int dz=dzMin; dz<=0; ++dz) for(int dy=-1; dy<=1; ++dy) for(int dx=-1; dx<=1; ++dx) {
+			// neighbors with smaller bin index only, the layer axis is z (y in 2D)
+			const int dl = bins.is3D() ? dz : dy;
+			if(dl < 0 ? !lowerLayer : !sameLayer) continue;
+			if(bins.is3D() ? (dz==0 && (dy>0 || (dy==0 && dx>0))) : (dy==0 && dx>0)) continue;
+			const int nx = bx+dx, ny = by+dy, nz = bz+dz;
+			if(nx<0 || ny<0 || nz<0 || nx>=res.x || ny>=res.y) continue;
+			connectBin(bins, parent, nx + (IndexInt)res.x * (ny + (IndexInt)res.y * nz), (int)s, r2, lowest);
+		}
+	}
+}
+
+//! Kernel: label the particles of one slab of bins
+KERNEL(pts)
+void knLabelParticleSlab(const LabelSlabs& slabs, const ParticleBins& bins, Real radius, std::vector<int>& parent) {
+	const IndexInt start = slabs.start[idx], stop = slabs.start[idx+1];
+	for(IndexInt s=start; s<stop; ++s) parent[s] = (int)s;
+	const int layerEnd = slabs.first[idx+1];
+	const Vec3i& res = bins.res;
+	for(int l=slabs.first[idx]; l<layerEnd; ++l) {
+		const int zMin = bins.is3D() ? l : 0, zMax = bins.is3D() ? l+1 : 1;
+		const int yMin = bins.is3D() ? 0 : l, yMax = bins.is3D() ? res.y : l+1;
+		for(int bz=zMin; bz<zMax; ++bz) for(int by=yMin; by<yMax; ++by) for(int bx=0; bx<res.x; ++bx) {
+			connectNeighbors(bins, parent, bx, by, bz, radius*radius, l > slabs.first[idx], true, start);
+		}
+	}
+}
+
+//! Kernel: resolve the component roots of the particles of a slab, and accumulate their statistics
+KERNEL(pts)
+void knResolveParticleSlab(const LabelSlabs& slabs, std::vector<ComponentMap>& maps, const ParticleBins& bins, const std::vector<int>& parent, std::vector<int>& roots) {
+	ComponentMap& map = maps[idx];
+	ComponentInfo* cur = NULL;
+	int curRoot = -1;
+	const Vec3 extent(0.);
+	for(IndexInt s=slabs.start[idx], stop=slabs.start[idx+1]; s<stop; ++s) {
+		const int root = UnionFind::find(parent, parent[s]);
+		roots[s] = root;
+		if(root != curRoot) {
+			cur = &map[root];
+			curRoot = root;
+		}
+		cur->add(bins.pos[s], extent);
+	}
+}
+
+//! Kernel: write component numbers of the sorted particles
+KERNEL(pts)
+void knNumberParticles(const std::vector<int>& roots, const std::vector<int>& number, const ParticleBins& bins, ParticleDataImpl<int>& labels) {
+	labels[bins.order[idx]] = number[roots[idx]];
+}
+
+static void labelParticleComponents(ParticleDataImpl<int>& labels, const BasicParticleSystem& parts, Vec3i gridSize, bool is3D,
+	Real radius, std::vector<ComponentInfo>& info)
+{
+	assertMsg(parts.size() < std::numeric_limits<int>::max(), "ConnectedComponents: too many particles");
+	const ParticleBins bins(parts, gridSize, is3D, radius);
+	const int numLayers = is3D ? bins.res.z : bins.res.y;
+	const IndexInt layerBins = bins.layerBins();
+	std::vector<IndexInt> layerStart(numLayers+1);
+	for(int l=0; l<=numLayers; ++l) layerStart[l] = bins.binStart[l*layerBins];
+	LabelSlabs slabs;
+	slabs.init(layerStart);
+
+	std::vector<int> parent(bins.order.size());
+	std::vector<ComponentMap> maps(slabs.size());
+	knLabelParticleSlab(slabs, bins, radius, parent);
+	knFlattenSlab(slabs, parent);
+	mergeSlabs(slabs, parent, [&](int l, std::vector<int>& p) {
+		const int zMin = is3D ? l : 0, zMax = is3D ? l+1 : 1;
+		const int yMin = is3D ? 0 : l, yMax = is3D ? bins.res.y : l+1;
+		for(int bz=zMin; bz<zMax; ++bz) for(int by=yMin; by<yMax; ++by) for(int bx=0; bx<bins.res.x; ++bx) {
+			connectNeighbors(bins, p, bx, by, bz, radius*radius, true, false, 0);
+		}
+	});
+	std::vector<int> roots(bins.order.size());
+	knResolveParticleSlab(slabs, maps, bins, parent, roots);
+	finishComponents(maps, parent, info);
+
+	labels.setConst(0);
+	knNumberParticles(roots, parent, bins, labels);
+}
+
+//************************************************************************
+// Python interface
+
+ConnectedComponents::ConnectedComponents(FluidSolver* parent) : PbClass(parent) {}
+
+int ConnectedComponents::labelFlags(Grid<int>& labels, const FlagGrid& flags, int type) {
+	labelCells(labels, FlagMember(flags, type), mInfo);
+	return getNum();
+}
+
+int ConnectedComponents::labelGrid(Grid<int>& labels, const Grid<Real>& grid, Real threshold, bool below) {
+	labelCells(labels, ThresholdMember(grid, threshold, below), mInfo);
+	return getNum();
+}
+
+int ConnectedComponents::labelParticles(ParticleDataImpl<int>& labels, const BasicParticleSystem& parts, Real radius) {
+	assertMsg(labels.getParticleSys() == &parts && labels.size() == parts.size(),
+		"ConnectedComponents: labels have to be particle data of the given particle system");
+	labelParticleComponents(labels, parts, getParent()->getGridSize(), getParent()->is3D(), radius, mInfo);
+	return getNum();
+}
+
+const ComponentInfo& ConnectedComponents::info(int c) const {
+	assertMsg(c>=1 && c<=getNum(), "ConnectedComponents: invalid component "<<c);
+	return mInfo[c-1];
+}
+
+//! Kernel: component number to size
+KERNEL(idx)
+void knLabelsToSizes(Grid<int>& labels, const std::vector<ComponentInfo>& info) {
+	if(labels[idx] > 0) labels[idx] = (int)info[labels[idx]-1].size;
+}
+void ConnectedComponents::labelsToSizes(Grid<int>& labels) const { knLabelsToSizes(labels, mInfo); }
+
+KERNEL(pts)
+void knLabelsToSizesPdata(ParticleDataImpl<int>& labels, const std::vector<ComponentInfo>& info) {
+	if(labels[idx] > 0) labels[idx] = (int)info[labels[idx]-1].size;
+}
+void ConnectedComponents::labelsToSizesPdata(ParticleDataImpl<int>& labels) const { knLabelsToSizesPdata(labels, mInfo); }
+
+} // namespace
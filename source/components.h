@@ -0,0 +1,123 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2011 Tobias Pfaff, Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Connected component labeling of grids and particles
+ *
+ ******************************************************************************/
+
+#ifndef _COMPONENTS_H
+#define _COMPONENTS_H
+
+#include "grid.h"
+#include "particle.h"
+
+namespace Manta {
+
+//! Disjoint set forest, the root of each set is its smallest element
+class UnionFind {
+public:
+	UnionFind(int n=0) { reset(n); }
+	void reset(int n) {
+		mParent.resize(n);
+		for(int i=0; i<n; ++i) mParent[i] = i;
+	}
+	//! find with path halving
+	inline int find(int x) {
+		while(mParent[x] != x) {
+			mParent[x] = mParent[mParent[x]];
+			x = mParent[x];
+		}
+		return x;
+	}
+	inline void unite(int a, int b) {
+		a = find(a);
+		b = find(b);
+		if(a < b) mParent[b] = a;
+		else if(b < a) mParent[a] = b;
+	}
+
+	//! versions working on external parent arrays, entries < 0 are not part of any set
+	static inline int find(const std::vector<int>& parent, int x) {
+		while(parent[x] != x) x = parent[x];
+		return x;
+	}
+	static inline void unite(std::vector<int>& parent, int a, int b) {
+		a = find(parent, a);
+		b = find(parent, b);
+		if(a < b) parent[b] = a;
+		else if(b < a) parent[a] = b;
+	}
+protected:
+	std::vector<int> mParent;
+};
+
+//! Statistics of one connected component, in grid coordinates
+struct ComponentInfo {
+	ComponentInfo() : size(0), bboxMin(std::numeric_limits<Real>::max()), bboxMax(-std::numeric_limits<Real>::max()) { posSum[0] = posSum[1] = posSum[2] = 0.; }
+	inline void add(const Vec3& p, const Vec3& extent) {
+		size++;
+		for(int c=0; c<3; ++c) {
+			bboxMin[c] = std::min(bboxMin[c], p[c]);
+			bboxMax[c] = std::max(bboxMax[c], p[c] + extent[c]);
+			posSum[c] += p[c] + 0.5 * extent[c];
+		}
+	}
+	inline void join(const ComponentInfo& o) {
+		size += o.size;
+		for(int c=0; c<3; ++c) {
+			bboxMin[c] = std::min(bboxMin[c], o.bboxMin[c]);
+			bboxMax[c] = std::max(bboxMax[c], o.bboxMax[c]);
+			posSum[c] += o.posSum[c];
+		}
+	}
+	inline Vec3 centroid() const { return size > 0 ? Vec3(posSum[0]/size, posSum[1]/size, posSum[2]/size) : Vec3(0.); }
+
+	IndexInt size;
+	Vec3 bboxMin, bboxMax;
+	double posSum[3];
+};
+
+//! Parallel connected component labeling
+/*! Cells are connected to their face neighbors (4 in 2D, 6 in 3D), active particles to all particles
+	within the given radius. The domain is split into slabs along z (y in 2D), which are labeled with a
+	union-find in parallel, and merged along their interfaces afterwards. Labels are 1..getNum(), in
+	the order of the first cell of each component (for particles, the order of their bins), 0 for cells
+	and particles not in any component. The statistics of all components are computed in the same pass, and the result does not
+	depend on the number of threads. */
+PYTHON() class ConnectedComponents : public PbClass {
+public:
+	PYTHON() ConnectedComponents(FluidSolver* parent);
+
+	//! label cells with any of the flag bits in type, returns the number of components
+	PYTHON() int labelFlags(Grid<int>& labels, const FlagGrid& flags, int type);
+	//! label cells with values below threshold (above with below=false), returns the number of components
+	PYTHON() int labelGrid(Grid<int>& labels, const Grid<Real>& grid, Real threshold=0., bool below=true);
+	//! label active particles, which are connected if their distance is at most radius (in cells)
+	PYTHON() int labelParticles(ParticleDataImpl<int>& labels, const BasicParticleSystem& parts, Real radius=1.);
+
+	//! accessors for the components of the last labeling, c=1..getNum()
+	PYTHON() int getNum() const { return (int)mInfo.size(); }
+	PYTHON() int getSize(int c) const { return (int)info(c).size; }
+	PYTHON() Vec3 getBBoxMin(int c) const { return info(c).bboxMin; }
+	PYTHON() Vec3 getBBoxMax(int c) const { return info(c).bboxMax; }
+	PYTHON() Vec3 getCentroid(int c) const { return info(c).centroid(); }
+	//! replace the labels with the size of the component, 0 outside
+	PYTHON() void labelsToSizes(Grid<int>& labels) const;
+	PYTHON() void labelsToSizesPdata(ParticleDataImpl<int>& labels) const;
+
+	const ComponentInfo& info(int c) const;
+	const std::vector<ComponentInfo>& getInfo() const { return mInfo; }
+
+protected:
+	std::vector<ComponentInfo> mInfo;
+};
+
+} // namespace
+
+#endif
@@ -13,6 +13,10 @@
 
 #include "conjugategrad.h"
 #include "commonkernels.h"
+#include "decomposition.h"
+#include "pressuresolver.h"
+#include <algorithm>
+#include <map>
 
 using namespace std;
 namespace Manta {
@@ -33,6 +37,7 @@ void InitPreconditionIncompCholesky(const FlagGrid& flags,
 	Aj.copyFrom( orgAj );
 	Ak.copyFrom( orgAk );
 	
+	const bool is3D = flags.is3D();
 	FOR_IJK(A0) {
 		if (flags.isFluid(i,j,k)) {
 			const IndexInt idx = A0.index(i,j,k);
@@ -54,7 +59,7 @@ void InitPreconditionIncompCholesky(const FlagGrid& flags,
 			//        A(i,j) = A(i,j) - A(i,k) * A(j,k)
 			A0(i+1,j,k) -= square(Ai[idx]);
 			A0(i,j+1,k) -= square(Aj[idx]);
-			A0(i,j,k+1) -= square(Ak[idx]);
+			if(is3D) A0(i,j,k+1) -= square(Ak[idx]);
 		}
 	}
 	
@@ -63,6 +68,7 @@ void InitPreconditionIncompCholesky(const FlagGrid& flags,
 };
 
 //! Preconditioning using modified IC ala Bridson (needs 1 add. grid)
+//! in 2D, the z-couplings are left out (Ak is unused)
 void InitPreconditionModifiedIncompCholesky2(const FlagGrid& flags,
 				Grid<Real>&Aprecond, 
 				Grid<Real>&A0, Grid<Real>& Ai, Grid<Real>& Aj, Grid<Real>& Ak) 
@@ -70,6 +76,7 @@ void InitPreconditionModifiedIncompCholesky2(const FlagGrid& flags,
 	// compute IC according to Golub and Van Loan
 	Aprecond.clear();
 	
+	const bool is3D = flags.is3D();
 	FOR_IJK(flags) {
 		if (!flags.isFluid(i,j,k)) continue;
 
@@ -78,15 +85,24 @@ void InitPreconditionModifiedIncompCholesky2(const FlagGrid& flags,
 			
 		// compute modified incomplete cholesky
 		Real e = 0.;
-		e = A0(i,j,k) 
-			- square(Ai(i-1,j,k) * Aprecond(i-1,j,k) )
-			- square(Aj(i,j-1,k) * Aprecond(i,j-1,k) )
-			- square(Ak(i,j,k-1) * Aprecond(i,j,k-1) ) ;
-		e -= tau * (
-				Ai(i-1,j,k) * ( Aj(i-1,j,k) + Ak(i-1,j,k) )* square( Aprecond(i-1,j,k) ) +
-				Aj(i,j-1,k) * ( Ai(i,j-1,k) + Ak(i,j-1,k) )* square( Aprecond(i,j-1,k) ) +
-				Ak(i,j,k-1) * ( Ai(i,j,k-1) + Aj(i,j,k-1) )* square( Aprecond(i,j,k-1) ) +
-				0. );
+		if(is3D) {
+			e = A0(i,j,k) 
+				- square(Ai(i-1,j,k) * Aprecond(i-1,j,k) )
+				- square(Aj(i,j-1,k) * Aprecond(i,j-1,k) )
+				- square(Ak(i,j,k-1) * Aprecond(i,j,k-1) ) ;
+			e -= tau * (
+					Ai(i-1,j,k) * ( Aj(i-1,j,k) + Ak(i-1,j,k) )* square( Aprecond(i-1,j,k) ) +
+					Aj(i,j-1,k) * ( Ai(i,j-1,k) + Ak(i,j-1,k) )* square( Aprecond(i,j-1,k) ) +
+					Ak(i,j,k-1) * ( Ai(i,j,k-1) + Aj(i,j,k-1) )* square( Aprecond(i,j,k-1) ) +
+					0. );
+		} else {
+			e = A0(i,j,k) 
+				- square(Ai(i-1,j,k) * Aprecond(i-1,j,k) )
+				- square(Aj(i,j-1,k) * Aprecond(i,j-1,k) ) ;
+			e -= tau * (
+					Ai(i-1,j,k) * Aj(i-1,j,k) * square( Aprecond(i-1,j,k) ) +
+					Aj(i,j-1,k) * Ai(i,j-1,k) * square( Aprecond(i,j-1,k) ) );
+		}
 
 		// stability cutoff
 		if(e < sigma * A0(i,j,k))
@@ -110,14 +126,15 @@ void ApplyPreconditionIncompCholesky(Grid<Real>& dst, Grid<Real>& Var1, const Fl
 				Grid<Real>& A0, Grid<Real>& Ai, Grid<Real>& Aj, Grid<Real>& Ak,
 				Grid<Real>& orgA0, Grid<Real>& orgAi, Grid<Real>& orgAj, Grid<Real>& orgAk)
 {
-	
+	const bool is3D = flags.is3D();
+
 	// forward substitution        
 	FOR_IJK(dst) {
 		if (!flags.isFluid(i,j,k)) continue;
 		dst(i,j,k) = A0(i,j,k) * (Var1(i,j,k)
 				 - dst(i-1,j,k) * Ai(i-1,j,k)
 				 - dst(i,j-1,k) * Aj(i,j-1,k)
-				 - dst(i,j,k-1) * Ak(i,j,k-1));    
+				 - (is3D ? dst(i,j,k-1) * Ak(i,j,k-1) : Real(0)) );
 	}
 	
 	// backward substitution
@@ -127,7 +144,7 @@ void ApplyPreconditionIncompCholesky(Grid<Real>& dst, Grid<Real>& Var1, const Fl
 		dst[idx] = A0[idx] * ( dst[idx] 
 			   - dst(i+1,j,k) * Ai[idx]
 			   - dst(i,j+1,k) * Aj[idx]
-			   - dst(i,j,k+1) * Ak[idx]);
+			   - (is3D ? dst(i,j,k+1) * Ak[idx] : Real(0)) );
 	}
 }
 
@@ -136,6 +153,8 @@ void ApplyPreconditionModifiedIncompCholesky2(Grid<Real>& dst, Grid<Real>& Var1,
 				Grid<Real>& Aprecond, 
 				Grid<Real>& A0, Grid<Real>& Ai, Grid<Real>& Aj, Grid<Real>& Ak) 
 {
+	const bool is3D = flags.is3D();
+
 	// forward substitution        
 	FOR_IJK(dst) {
 		if (!flags.isFluid(i,j,k)) continue;
@@ -143,7 +162,7 @@ void ApplyPreconditionModifiedIncompCholesky2(Grid<Real>& dst, Grid<Real>& Var1,
 		dst(i,j,k) = p * (Var1(i,j,k)
 				 - dst(i-1,j,k) * Ai(i-1,j,k) * Aprecond(i-1,j,k)
 				 - dst(i,j-1,k) * Aj(i,j-1,k) * Aprecond(i,j-1,k)
-				 - dst(i,j,k-1) * Ak(i,j,k-1) * Aprecond(i,j,k-1) );
+				 - (is3D ? dst(i,j,k-1) * Ak(i,j,k-1) * Aprecond(i,j,k-1) : Real(0)) );
 	}
 	
 	// backward substitution
@@ -154,7 +173,7 @@ void ApplyPreconditionModifiedIncompCholesky2(Grid<Real>& dst, Grid<Real>& Var1,
 		dst[idx] = p * ( dst[idx] 
 			   - dst(i+1,j,k) * Ai[idx] * p
 			   - dst(i,j+1,k) * Aj[idx] * p
-			   - dst(i,j,k+1) * Ak[idx] * p);
+			   - (is3D ? dst(i,j,k+1) * Ak[idx] * p : Real(0)) );
 	}
 }
 
@@ -170,13 +189,6 @@ void ApplyPreconditionMultigrid(GridMg* pMG, Grid<Real>& dst, Grid<Real>& Var1)
 //*****************************************************************************
 // Kernels    
 
-//! Kernel: Compute the dot product between two Real grids
-/*! Uses double precision internally */
-KERNEL(idx, reduce=+) returns(double result=0.0)
-double GridDotProduct (const Grid<Real>& a, const Grid<Real>& b) {
-	result += (a[idx] * b[idx]);    
-};
-
 //! Kernel: compute residual (init) and add to sigma
 KERNEL(idx, reduce=+) returns(double sigma=0)
 double InitSigma (const FlagGrid& flags, Grid<Real>& dst, Grid<Real>& rhs, Grid<Real>& temp)
@@ -189,6 +201,12 @@ double InitSigma (const FlagGrid& flags, Grid<Real>& dst, Grid<Real>& rhs, Grid<
 		sigma += res*res;
 };
 
+//! Kernel: residual for a given initial guess, zero outside of the fluid region
+KERNEL(idx) void InitResidual (const FlagGrid& flags, Grid<Real>& dst, const Grid<Real>& rhs, const Grid<Real>& temp)
+{
+	dst[idx] = flags.isFluid(idx) ? rhs[idx] - temp[idx] : Real(0);
+}
+
 //! Kernel: update search vector
 KERNEL(idx) void UpdateSearchVec (Grid<Real>& dst, Grid<Real>& src, Real factor)
 {
@@ -206,32 +224,75 @@ GridCg<APPLYMAT>::GridCg(Grid<Real>& dst, Grid<Real>& rhs, Grid<Real>& residual,
 	mPcMethod(PC_None), mpPCA0(nullptr), mpPCAi(nullptr), mpPCAj(nullptr), mpPCAk(nullptr), mMG(nullptr), mSigma(0.), mAccuracy(VECTOR_EPSILON), mResNorm(1e20) 
 { }
 
+template<class APPLYMAT>
+void GridCg<APPLYMAT>::applyMatrix(Grid<Real>& dst, const Grid<Real>& src) {
+	if (mCompactFlags)
+		ApplyMatrixCompact(dst, *mCompactFlags, src, *mpA0, *mpAi, *mpAj, *mpAk);
+	else
+		APPLYMAT (mFlags, dst, src, *mpA0, *mpAi, *mpAj, *mpAk);
+}
+
+template<class APPLYMAT>
+void GridCg<APPLYMAT>::applyPreconditioner() {
+	if (mPcMethod == PC_ICP)
+		ApplyPreconditionIncompCholesky(mTmp, mResidual, mFlags, *mpPCA0, *mpPCAi, *mpPCAj, *mpPCAk, *mpA0, *mpAi, *mpAj, *mpAk);
+	else if (mPcMethod == PC_mICP)
+		ApplyPreconditionModifiedIncompCholesky2(mTmp, mResidual, mFlags, *mpPCA0, *mpA0, *mpAi, *mpAj, *mpAk);
+	else if (mPcMethod == PC_MGP)
+		ApplyPreconditionMultigrid(mMG, mTmp, mResidual);
+	else
+		mTmp.copyFrom( mResidual );
+
+	// block preconditioner: each rank only keeps the result for its own cells
+	if(mDecomp) mDecomp->clearGhosts(mTmp);
+}
+
+template<class APPLYMAT>
+double GridCg<APPLYMAT>::dotProduct(const Grid<Real>& a, const Grid<Real>& b) {
+	const double dp = gridDot(a, b);
+	return mDecomp ? mDecomp->allReduceSum(dp) : dp;
+}
+
+template<class APPLYMAT>
+Real GridCg<APPLYMAT>::residualNorm() {
+	// use the l2 norm of the residual for convergence check? (usually max norm is recommended instead)
+	if(this->mUseL2Norm) { 
+		const double sum = mResidual.getStats(0, false).sumSquare;
+		return mDecomp ? mDecomp->allReduceSum(sum) : sum;
+	} else {
+		const Real maxAbs = mResidual.getStats(0, false).getMaxAbs();
+		return mDecomp ? mDecomp->allReduceMax(maxAbs) : maxAbs;
+	}
+}
+
 template<class APPLYMAT>
 void GridCg<APPLYMAT>::doInit() {
 	mInited = true;
 	mIterations = 0;
 
-	mDst.clear();
-	mResidual.copyFrom( mRhs ); // p=0, residual = b
+	if(mUseInitialGuess) {
+		if(mDecomp) mDecomp->exchange(&mDst);
+		applyMatrix(mTmp, mDst);
+		InitResidual (mFlags, mResidual, mRhs, mTmp); // residual = b - A*p
+	} else {
+		mDst.clear();
+		mResidual.copyFrom( mRhs ); // p=0, residual = b
+	}
+	// ghost cells are solved by the neighboring ranks
+	if(mDecomp) mDecomp->clearGhosts(mResidual);
 	
 	if (mPcMethod == PC_ICP) {
-		assertMsg(mDst.is3D(), "ICP only supports 3D grids so far");
-		InitPreconditionIncompCholesky(mFlags, *mpPCA0, *mpPCAi, *mpPCAj, *mpPCAk, *mpA0, *mpAi, *mpAj, *mpAk);
-		ApplyPreconditionIncompCholesky(mTmp, mResidual, mFlags, *mpPCA0, *mpPCAi, *mpPCAj, *mpPCAk, *mpA0, *mpAi, *mpAj, *mpAk);
+		if(!mReusePc) InitPreconditionIncompCholesky(mFlags, *mpPCA0, *mpPCAi, *mpPCAj, *mpPCAk, *mpA0, *mpAi, *mpAj, *mpAk);
 	} else if (mPcMethod == PC_mICP) {
-		assertMsg(mDst.is3D(), "mICP only supports 3D grids so far");
-		InitPreconditionModifiedIncompCholesky2(mFlags, *mpPCA0, *mpA0, *mpAi, *mpAj, *mpAk);
-		ApplyPreconditionModifiedIncompCholesky2(mTmp, mResidual, mFlags, *mpPCA0, *mpA0, *mpAi, *mpAj, *mpAk);
+		if(!mReusePc) InitPreconditionModifiedIncompCholesky2(mFlags, *mpPCA0, *mpA0, *mpAi, *mpAj, *mpAk);
 	} else if (mPcMethod == PC_MGP) {
 		InitPreconditionMultigrid(mMG, *mpA0, *mpAi, *mpAj, *mpAk, mAccuracy);
-		ApplyPreconditionMultigrid(mMG, mTmp, mResidual);
-	} else {
-		mTmp.copyFrom( mResidual );
 	}
+	applyPreconditioner();
 	
 	mSearch.copyFrom( mTmp );
 	
-	mSigma = GridDotProduct(mTmp, mResidual);    
+	mSigma = dotProduct(mTmp, mResidual);    
 }
 
 template<class APPLYMAT>
@@ -244,31 +305,21 @@ bool GridCg<APPLYMAT>::iterate() {
 	// this could reinterpret the mpA pointers (not so clean right now)
 	// tmp = applyMat(search)
 	
-	APPLYMAT (mFlags, mTmp, mSearch, *mpA0, *mpAi, *mpAj, *mpAk);
+	if(mDecomp) mDecomp->exchange(&mSearch);
+	applyMatrix(mTmp, mSearch);
+	if(mDecomp) mDecomp->clearGhosts(mTmp);
 	
 	// alpha = sigma/dot(tmp, search)
-	Real dp = GridDotProduct(mTmp, mSearch);
+	Real dp = dotProduct(mTmp, mSearch);
 	Real alpha = 0.;
 	if(fabs(dp)>0.) alpha = mSigma / (Real)dp;
 	
 	gridScaledAdd<Real,Real>(mDst, mSearch, alpha);    // dst += search * alpha
 	gridScaledAdd<Real,Real>(mResidual, mTmp, -alpha); // residual += tmp * -alpha
 	
-	if (mPcMethod == PC_ICP)
-		ApplyPreconditionIncompCholesky(mTmp, mResidual, mFlags, *mpPCA0, *mpPCAi, *mpPCAj, *mpPCAk, *mpA0, *mpAi, *mpAj, *mpAk);
-	else if (mPcMethod == PC_mICP)
-		ApplyPreconditionModifiedIncompCholesky2(mTmp, mResidual, mFlags, *mpPCA0, *mpA0, *mpAi, *mpAj, *mpAk);
-	else if (mPcMethod == PC_MGP)
-		ApplyPreconditionMultigrid(mMG, mTmp, mResidual);
-	else
-		mTmp.copyFrom( mResidual );
+	applyPreconditioner();
 		
-	// use the l2 norm of the residual for convergence check? (usually max norm is recommended instead)
-	if(this->mUseL2Norm) { 
-		mResNorm = GridSumSqr(mResidual).sum; 
-	} else {
-		mResNorm = mResidual.getMaxAbs();        
-	}
+	mResNorm = residualNorm();
 
 	// abort here to safe some work...
 	if(mResNorm<mAccuracy) {
@@ -276,7 +327,7 @@ bool GridCg<APPLYMAT>::iterate() {
 		return false;
 	}
 
-	Real sigmaNew = GridDotProduct(mTmp, mResidual);
+	Real sigmaNew = dotProduct(mTmp, mResidual);
 	Real beta = sigmaNew / mSigma;
 	
 	// search =  tmp + beta * search
@@ -306,19 +357,11 @@ void GridCg<APPLYMAT>::solve(int maxIter) {
 	return;
 }
 
-static bool gPrint2dWarning = true;
 template<class APPLYMAT>
 void GridCg<APPLYMAT>::setICPreconditioner(PreconditionType method, Grid<Real> *A0, Grid<Real> *Ai, Grid<Real> *Aj, Grid<Real> *Ak) {
-	assertMsg(method==PC_ICP || method==PC_mICP, "GridCg<APPLYMAT>::setICPreconditioner: Invalid method specified.");
+	assertMsg(method==PC_None || method==PC_ICP || method==PC_mICP, "GridCg<APPLYMAT>::setICPreconditioner: Invalid method specified.");
 
 	mPcMethod = method;
-	if( (!A0->is3D())) {
-		if(gPrint2dWarning) {
-			debMsg("ICP/mICP pre-conditioning only supported in 3D for now, disabling it.", 1);
-			gPrint2dWarning = false;
-		}
-		mPcMethod=PC_None;
-	}
 	mpPCA0 = A0;
 	mpPCAi = Ai;
 	mpPCAj = Aj;
@@ -340,89 +383,527 @@ template class GridCg<ApplyMatrix2D>;
 
 
 
-//***************************************************************************** 
-// diffusion for real and vec grids, e.g. for viscosity
-
+//*****************************************************************************
+//  Compact CG, only stores and iterates fluid cells
 
-//! do a CG solve for diffusion; note: diffusion coefficient alpha given in grid space, 
-//  rescale in python file for discretization independence (or physical correspondence)
-//  see lidDrivenCavity.py for an example
-PYTHON() void cgSolveDiffusion(const FlagGrid& flags, GridBase& grid,
-						Real alpha = 0.25, Real cgMaxIterFac = 1.0, Real cgAccuracy   = 1e-4 )
+//! compact index of grid cell gi among the sorted cells [first,last), -1 if it is not active
+static inline int findCompactCell(const std::vector<IndexInt>& cells, IndexInt first, IndexInt last, IndexInt gi)
 {
-	// reserve temp grids
-	FluidSolver* parent = flags.getParent();
-	Grid<Real> rhs(parent);
-	Grid<Real> residual(parent), search(parent), tmp(parent);
-	Grid<Real> A0(parent), Ai(parent), Aj(parent), Ak(parent);
-		
-	// setup matrix and boundaries
-	FlagGrid flagsDummy(parent);
-	flagsDummy.setConst(FlagGrid::TypeFluid);
-	MakeLaplaceMatrix (flagsDummy, A0, Ai, Aj, Ak);
+	const std::vector<IndexInt>::const_iterator end = cells.begin() + last;
+	const std::vector<IndexInt>::const_iterator it = std::lower_bound(cells.begin() + first, end, gi);
+	return (it!=end && *it==gi) ? int(it - cells.begin()) : -1;
+}
 
-	FOR_IJK(flags) {
-		if(flags.isObstacle(i,j,k)) {
-			Ai(i,j,k)  = Aj(i,j,k)  = Ak(i,j,k)  = 0.0;
-			A0(i,j,k)  = 1.0;
+//! Kernel: assemble poisson matrix for the active cells, see MakeLaplaceMatrix
+//! cells are unique and sorted, so a neighbor at grid offset s is at most s entries away
+KERNEL(pts)
+void knCompactMakeLaplace(const std::vector<IndexInt>& cells, const FlagGrid& flags, const MACGrid* fractions,
+				std::vector<int>& nbr, std::vector<Real>& diag, std::vector<Real>& off)
+{
+	const IndexInt gi = cells[idx];
+	const IndexInt n = (IndexInt)cells.size();
+	const IndexInt stride[3] = { flags.getStrideX(), flags.getStrideY(), flags.getStrideZ() };
+	const int dim = flags.is3D() ? 3 : 2;
+
+	Real a0 = 0.;
+	for(int d=0; d<3; d++) {
+		nbr[idx*6+2*d] = nbr[idx*6+2*d+1] = -1;
+		off[idx*3+d] = 0.;
+		if(d>=dim) continue;
+
+		const IndexInt lo = gi - stride[d], hi = gi + stride[d];
+		const int clo = findCompactCell(cells, std::max(IndexInt(0), idx - stride[d]), idx, lo);
+		const int chi = findCompactCell(cells, idx + 1, std::min(n, idx + 1 + stride[d]), hi);
+		nbr[idx*6+2*d]   = clo;
+		nbr[idx*6+2*d+1] = chi;
+
+		if(!fractions) {
+			if(!flags.isObstacle(lo)) a0 += 1.;
+			if(!flags.isObstacle(hi)) a0 += 1.;
+			if(chi>=0) off[idx*3+d] = -1.;
 		} else {
-			Ai(i,j,k) *= alpha;
-			Aj(i,j,k) *= alpha;
-			Ak(i,j,k) *= alpha;
-			A0(i,j,k) *= alpha;
-			A0(i,j,k) += 1.;
+			a0 += (*fractions)[gi][d] + (*fractions)[hi][d];
+			if(chi>=0) off[idx*3+d] = -(*fractions)[hi][d];
 		}
 	}
+	diag[idx] = a0;
+}
 
-	GridCgInterface *gcg;
-	// note , no preconditioning for now...
-	const int maxIter = (int)(cgMaxIterFac * flags.getSize().max()) * (flags.is3D() ? 1 : 4);
-	
-	if (grid.getType() & GridBase::TypeReal) {
-		Grid<Real>& u = ((Grid<Real>&) grid);
-		rhs.copyFrom(u); 
-		if (flags.is3D())
-			gcg = new GridCg<ApplyMatrix  >(u, rhs, residual, search, flags, tmp, &A0, &Ai, &Aj, &Ak );
-		else
-			gcg = new GridCg<ApplyMatrix2D>(u, rhs, residual, search, flags, tmp, &A0, &Ai, &Aj, &Ak ); 
+//! Kernel: apply compact matrix
+KERNEL(pts)
+void knCompactApplyMatrix(std::vector<Real>& dst, const std::vector<Real>& src,
+				const std::vector<int>& nbr, const std::vector<Real>& diag, const std::vector<Real>& off, int dim)
+{
+	Real sum = diag[idx] * src[idx];
+	for(int d=0; d<dim; d++) {
+		const int lo = nbr[idx*6+2*d], hi = nbr[idx*6+2*d+1];
+		if(lo>=0) sum += off[lo*3+d] * src[lo];
+		if(hi>=0) sum += off[idx*3+d] * src[hi];
+	}
+	dst[idx] = sum;
+}
 
-		gcg->setAccuracy( cgAccuracy ); 
-		gcg->solve(maxIter);
+//! Kernel: dot product of two compact vectors, uses double precision internally
+KERNEL(pts, reduce=+) returns(double result=0.0)
+double knCompactDot(const std::vector<Real>& a, const std::vector<Real>& b) {
+	result += (a[idx] * b[idx]);
+}
+
+//! Kernel: max norm of a compact vector
+KERNEL(pts, reduce=max) returns(Real maxVal=0.)
+Real knCompactMaxAbs(const std::vector<Real>& a) {
+	const Real v = std::fabs(a[idx]);
+	if(v > maxVal) maxVal = v;
+}
+
+//! Kernel: dst += factor * src
+KERNEL(pts)
+void knCompactScaledAdd(std::vector<Real>& dst, const std::vector<Real>& src, Real factor) {
+	dst[idx] += factor * src[idx];
+}
+
+//! Kernel: dst = src + factor * dst
+KERNEL(pts)
+void knCompactUpdateSearchVec(std::vector<Real>& dst, const std::vector<Real>& src, Real factor) {
+	dst[idx] = src[idx] + factor * dst[idx];
+}
+
+//! Kernel: copy grid values of the active cells into a compact vector
+KERNEL(pts)
+void knCompactGather(const std::vector<IndexInt>& cells, std::vector<Real>& dst, const Grid<Real>& src) {
+	dst[idx] = src[cells[idx]];
+}
+
+//! Kernel: write compact vector back to the grid
+KERNEL(pts)
+void knCompactScatter(const std::vector<IndexInt>& cells, const std::vector<Real>& src, Grid<Real>& dst) {
+	dst[cells[idx]] = src[idx];
+}
+
+CompactCg::CompactCg() :
+	mDim(3), mPcMethod(GridCgInterface::PC_None), mPcInited(false),
+	mIterations(0), mAccuracy(VECTOR_EPSILON), mResNorm(1e20), mUseL2Norm(true), mUseInitialGuess(false)
+{ }
+
+void CompactCg::build(const FlagGrid& flags, const MACGrid* fractions) {
+	mDim = flags.is3D() ? 3 : 2;
 
-		debMsg("FluidSolver::solveDiffusion iterations:"<<gcg->getIterations()<<", res:"<<gcg->getSigma(), CG_DEBUGLEVEL);
+	// enumerate fluid cells in grid order, the boundary layer is not part of the system (see MakeLaplaceMatrix)
+	// mCells stays sorted, neighbors are found by binary search instead of a full grid index map
+	mCells.clear();
+	FOR_IJK_BND(flags, 1) {
+		const IndexInt idx = flags.index(i,j,k);
+		if(flags.isFluid(idx)) mCells.push_back(idx);
 	}
-	else 
-	if( (grid.getType() & GridBase::TypeVec3) || (grid.getType() & GridBase::TypeMAC) )
-	{
-		Grid<Vec3>& vec = ((Grid<Vec3>&) grid);
-		Grid<Real> u(parent);
-
-		// core solve is same as for a regular real grid 
-		if (flags.is3D())
-			gcg = new GridCg<ApplyMatrix  >(u, rhs, residual, search, flags, tmp, &A0, &Ai, &Aj, &Ak );
-		else
-			gcg = new GridCg<ApplyMatrix2D>(u, rhs, residual, search, flags, tmp, &A0, &Ai, &Aj, &Ak ); 
-		gcg->setAccuracy( cgAccuracy ); 
 
-		// diffuse every component separately
-		for(int component = 0; component< (grid.is3D() ? 3:2); ++component) {
-			getComponent( vec, u, component );
-			gcg->forceReinit(); 
+	const size_t n = mCells.size();
+	mNbr.resize(n*6);
+	mDiag.resize(n);
+	mOff.resize(n*3);
+	knCompactMakeLaplace(mCells, flags, fractions, mNbr, mDiag, mOff);
+
+	mX.resize(n);
+	mRhs.resize(n);
+	mResidual.resize(n);
+	mSearch.resize(n);
+	mTmp.resize(n);
+	mPcInited = false;
+}
 
-			rhs.copyFrom(u); 
-			gcg->solve(maxIter);
-			debMsg("FluidSolver::solveDiffusion vec3, iterations:"<<gcg->getIterations()<<", res:"<<gcg->getSigma(), CG_DEBUGLEVEL);
+void CompactCg::fixCell(IndexInt gridIdx) {
+	std::vector<IndexInt>::const_iterator it = std::lower_bound(mCells.begin(), mCells.end(), gridIdx);
+	if(it==mCells.end() || *it!=gridIdx) return;
+	const int c = int(it - mCells.begin());
+
+	// trivialize equation, and remove couplings to neighbors in both directions
+	mDiag[c] = 1.;
+	for(int d=0; d<mDim; d++) {
+		mOff[c*3+d] = 0.;
+		const int lo = mNbr[c*6+2*d];
+		if(lo>=0) mOff[lo*3+d] = 0.;
+	}
+	mPcInited = false;
+}
 
-			setComponent( u, vec, component );
+void CompactCg::setPreconditioner(GridCgInterface::PreconditionType method) {
+	assertMsg(method==GridCgInterface::PC_None || method==GridCgInterface::PC_mICP, "CompactCg::setPreconditioner: Invalid method specified.");
+	mPcMethod = method;
+	mPcInited = false;
+}
+
+//! modified IC ala Bridson, see InitPreconditionModifiedIncompCholesky2
+//! lower neighbors always have a smaller compact index, so the grid order carries over
+void CompactCg::initPreconditioner() {
+	mPcInited = true;
+	if(mPcMethod != GridCgInterface::PC_mICP) return;
+
+	const Real tau = 0.97;
+	const Real sigma = 0.25;
+	const int n = getNumCells();
+	mPrecond.resize(n);
+
+	for(int c=0; c<n; c++) {
+		Real e = mDiag[c];
+		for(int d=0; d<mDim; d++) {
+			const int lo = mNbr[c*6+2*d];
+			if(lo<0) continue;
+			const Real pl = mPrecond[lo];
+			Real others = 0.;
+			for(int d2=0; d2<mDim; d2++) {
+				if(d2!=d) others += mOff[lo*3+d2];
+			}
+			e -= square(mOff[lo*3+d] * pl);
+			e -= tau * mOff[lo*3+d] * others * square(pl);
 		}
+
+		// stability cutoff
+		if(e < sigma * mDiag[c])
+			e = mDiag[c];
+
+		mPrecond[c] = 1. / sqrt(e);
+	}
+}
+
+void CompactCg::applyPreconditioner(std::vector<Real>& dst, const std::vector<Real>& src) const {
+	if(mPcMethod != GridCgInterface::PC_mICP) {
+		dst = src;
+		return;
+	}
+	const int n = getNumCells();
+
+	// forward substitution
+	for(int c=0; c<n; c++) {
+		Real sum = src[c];
+		for(int d=0; d<mDim; d++) {
+			const int lo = mNbr[c*6+2*d];
+			if(lo>=0) sum -= dst[lo] * mOff[lo*3+d] * mPrecond[lo];
+		}
+		dst[c] = mPrecond[c] * sum;
+	}
+
+	// backward substitution
+	for(int c=n-1; c>=0; c--) {
+		const Real p = mPrecond[c];
+		Real sum = dst[c];
+		for(int d=0; d<mDim; d++) {
+			const int hi = mNbr[c*6+2*d+1];
+			if(hi>=0) sum -= dst[hi] * mOff[c*3+d] * p;
+		}
+		dst[c] = p * sum;
+	}
+}
+
+void CompactCg::solve(Grid<Real>& dst, const Grid<Real>& rhs, int maxIter) {
+	mIterations = 0;
+	mResNorm = 0.;
+	if(mUseInitialGuess) knCompactGather(mCells, mX, dst);
+	dst.clear();
+	if(mCells.empty()) return;
+	if(!mPcInited) initPreconditioner();
+
+	knCompactGather(mCells, mRhs, rhs);
+	mResidual = mRhs;
+	if(mUseInitialGuess) {
+		knCompactApplyMatrix(mTmp, mX, mNbr, mDiag, mOff, mDim);
+		knCompactScaledAdd(mResidual, mTmp, -1.); // residual = b - A*x
+	} else {
+		std::fill(mX.begin(), mX.end(), Real(0)); // x=0, residual = b
+	}
+
+	applyPreconditioner(mTmp, mResidual);
+	mSearch = mTmp;
+	Real sigma = knCompactDot(mTmp, mResidual);
+
+	for(int iter=0; iter<maxIter; iter++) {
+		mIterations++;
+
+		knCompactApplyMatrix(mTmp, mSearch, mNbr, mDiag, mOff, mDim);
+		const Real dp = knCompactDot(mTmp, mSearch);
+		Real alpha = 0.;
+		if(fabs(dp)>0.) alpha = sigma / dp;
+
+		knCompactScaledAdd(mX, mSearch, alpha);
+		knCompactScaledAdd(mResidual, mTmp, -alpha);
+
+		applyPreconditioner(mTmp, mResidual);
+
+		// same norms as GridCg
+		if(mUseL2Norm) mResNorm = knCompactDot(mResidual, mResidual);
+		else           mResNorm = knCompactMaxAbs(mResidual);
+		if(mResNorm<mAccuracy) break;
+
+		const Real sigmaNew = knCompactDot(mTmp, mResidual);
+		const Real beta = sigmaNew / sigma;
+		knCompactUpdateSearchVec(mSearch, mTmp, beta);
+		debMsg("CompactCg::solve i="<<mIterations<<" sigmaNew="<<sigmaNew<<" sigmaLast="<<sigma<<" alpha="<<alpha<<" beta="<<beta<<" ", CG_DEBUGLEVEL);
+		sigma = sigmaNew;
+
+		if(!(mResNorm<1e35)) errMsg("CompactCg::solve: The CG solver diverged, residual norm > 1e30, stopping.");
+	}
+
+	knCompactScatter(mCells, mX, dst);
+}
+
+
+
+//*****************************************************************************
+// Helmholtz-type systems for implicit diffusion and wave equation solves
+
+//! Kernel: number of cells with different flags
+KERNEL(idx, reduce=+) returns(IndexInt diff=0)
+IndexInt knCountFlagChanges(const FlagGrid& flags, const FlagGrid& ref) {
+	if(flags[idx] != ref[idx]) diff++;
+}
+
+//! Kernel: scale laplacian to I + s*L, obstacleRows: identity rows for obstacles (diffusion)
+KERNEL(idx)
+void knScaleHelmholtz(const FlagGrid& flags, Grid<Real>& A0, Grid<Real>& Ai, Grid<Real>& Aj, Grid<Real>& Ak, Real s, bool obstacleRows) {
+	if(obstacleRows && flags.isObstacle(idx)) {
+		Ai[idx] = Aj[idx] = Ak[idx] = 0.0;
+		A0[idx] = 1.0;
 	} else {
-		errMsg("cgSolveDiffusion: Grid Type is not supported (only Real, Vec3, MAC, or Levelset)");
+		Ai[idx] *= s;
+		Aj[idx] *= s;
+		Ak[idx] *= s;
+		A0[idx] *= s;
+		A0[idx] += 1.;
+	}
+}
+
+//! Kernel: non-zero couplings of fluid cells to non-fluid neighbors, bit per direction
+KERNEL(idx)
+void knHelmholtzBoundary(const FlagGrid& flags, Grid<int>& bnd, const Grid<Real>& Ai, const Grid<Real>& Aj, const Grid<Real>& Ak) {
+	int b = 0;
+	if(flags.isFluid(idx)) {
+		const IndexInt X = 1, Y = flags.getSizeX(), Z = flags.getStrideZ();
+		if(!flags.isFluid(idx-X) && Ai[idx-X]!=0.) b |= 1;
+		if(!flags.isFluid(idx+X) && Ai[idx  ]!=0.) b |= 2;
+		if(!flags.isFluid(idx-Y) && Aj[idx-Y]!=0.) b |= 4;
+		if(!flags.isFluid(idx+Y) && Aj[idx  ]!=0.) b |= 8;
+		if(flags.is3D()) {
+			if(!flags.isFluid(idx-Z) && Ak[idx-Z]!=0.) b |= 16;
+			if(!flags.isFluid(idx+Z) && Ak[idx  ]!=0.) b |= 32;
+		}
+	}
+	bnd[idx] = b;
+}
+
+//! Kernel: remove couplings between fluid and non-fluid cells, identity rows for non-fluid cells
+KERNEL(idx)
+void knHelmholtzSymmetrize(const FlagGrid& flags, Grid<Real>& A0, Grid<Real>& Ai, Grid<Real>& Aj, Grid<Real>& Ak) {
+	if(!flags.isFluid(idx)) {
+		A0[idx] = 1.;
+		Ai[idx] = Aj[idx] = Ak[idx] = 0.;
+		return;
 	}
+	const IndexInt X = 1, Y = flags.getSizeX(), Z = flags.getStrideZ();
+	if(!flags.isFluid(idx+X)) Ai[idx] = 0.;
+	if(!flags.isFluid(idx+Y)) Aj[idx] = 0.;
+	if(!flags.is3D() || !flags.isFluid(idx+Z)) Ak[idx] = 0.;
+}
+
+//! Kernel: move the removed couplings (all -s) with the non-fluid values to the rhs
+KERNEL(idx)
+void knHelmholtzRhs(Grid<Real>& rhs, const Grid<int>& bnd, Real s) {
+	const int b = bnd[idx];
+	if(!b) return;
+	const IndexInt X = 1, Y = rhs.getSizeX(), Z = rhs.getStrideZ();
+	Real sum = 0.;
+	if(b & 1)  sum += rhs[idx-X];
+	if(b & 2)  sum += rhs[idx+X];
+	if(b & 4)  sum += rhs[idx-Y];
+	if(b & 8)  sum += rhs[idx+Y];
+	if(b & 16) sum += rhs[idx-Z];
+	if(b & 32) sum += rhs[idx+Z];
+	rhs[idx] += s * sum;
+}
+
+//! Kernel: the values of non-fluid cells are known, keep them aside and only solve for fluid cells
+KERNEL(idx)
+void knHelmholtzFixedValues(const FlagGrid& flags, Grid<Real>& fixed, Grid<Real>& rhs) {
+	if(flags.isFluid(idx)) return;
+	fixed[idx] = rhs[idx];
+	rhs[idx] = 0.;
+}
+
+KERNEL(idx)
+void knHelmholtzSetFixedValues(const FlagGrid& flags, Grid<Real>& dst, const Grid<Real>& fixed) {
+	if(!flags.isFluid(idx)) dst[idx] = fixed[idx];
+}
+
+static std::map<std::pair<FluidSolver*,int>, HelmholtzSystem*> gMapHelmholtz;
+
+HelmholtzSystem::HelmholtzSystem(FluidSolver* parent, int type) :
+	mParent(parent), mType(type), mValid(false), mS(0.), mFlags(parent), mA0(parent), mAi(parent), mAj(parent), mAk(parent),
+	mBnd(parent), mFixed(parent), mResidual(parent), mSearch(parent), mTmp(parent),
+	mPca0(nullptr), mPca1(nullptr), mPca2(nullptr), mPca3(nullptr), mPcInited(false), mMG(nullptr),
+	mIterations(0), mResNorm(0.), mNumBuilds(0)
+{}
+
+HelmholtzSystem::~HelmholtzSystem() {
+	releasePreconditioner();
+}
+
+HelmholtzSystem& HelmholtzSystem::get(FluidSolver* parent, int type) {
+	HelmholtzSystem*& sys = gMapHelmholtz[std::make_pair(parent, type)];
+	if(!sys) sys = new HelmholtzSystem(parent, type);
+	return *sys;
+}
 
+void HelmholtzSystem::release(FluidSolver* parent) {
+	for(auto it = gMapHelmholtz.begin(); it != gMapHelmholtz.end(); ) {
+		if(!parent || it->first.first == parent) {
+			delete it->second;
+			it = gMapHelmholtz.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void HelmholtzSystem::releasePreconditioner() {
+	Grid<Real>** grids[] = { &mPca0, &mPca1, &mPca2, &mPca3 };
+	for(Grid<Real>** g : grids) {
+		if(*g) delete *g;
+		*g = nullptr;
+	}
+	mPcInited = false;
+	if(mMG) delete mMG;
+	mMG = nullptr;
+}
+
+bool HelmholtzSystem::update(const FlagGrid& flags, Real s) {
+	assertMsg(flags.getParent()==mParent && flags.getSize()==mFlags.getSize(), "HelmholtzSystem::update: flags of a different solver");
+	if(mValid && s==mS && knCountFlagChanges(flags, mFlags)==0) return false;
+
+	mFlags.copyFrom(flags);
+	mS = s;
+	mA0.clear(); mAi.clear(); mAj.clear(); mAk.clear();
+	if(mType == Diffusion) {
+		FlagGrid flagsDummy(mParent);
+		flagsDummy.setConst(FlagGrid::TypeFluid);
+		MakeLaplaceMatrix(flagsDummy, mA0, mAi, mAj, mAk);
+	} else {
+		MakeLaplaceMatrix(flags, mA0, mAi, mAj, mAk);
+	}
+	knScaleHelmholtz(flags, mA0, mAi, mAj, mAk, s, mType==Diffusion);
+	knHelmholtzBoundary(flags, mBnd, mAi, mAj, mAk);
+	knHelmholtzSymmetrize(flags, mA0, mAi, mAj, mAk);
+
+	releasePreconditioner();
+	mValid = true;
+	mNumBuilds++;
+	return true;
+}
+
+void HelmholtzSystem::solve(Grid<Real>& dst, Grid<Real>& rhs, int maxIter, Real accuracy, int preconditioner) {
+	assertMsg(mValid, "HelmholtzSystem::solve: system has not been set up");
+	knHelmholtzRhs(rhs, mBnd, mS);
+	knHelmholtzFixedValues(mFlags, mFixed, rhs);
+	// non-fluid entries of the CG vectors have to be zero, the preconditioners skip them
+	mTmp.clear();
+
+	GridCgInterface *gcg;
+	if (mFlags.is3D())
+		gcg = new GridCg<ApplyMatrix  >(dst, rhs, mResidual, mSearch, mFlags, mTmp, &mA0, &mAi, &mAj, &mAk );
+	else
+		gcg = new GridCg<ApplyMatrix2D>(dst, rhs, mResidual, mSearch, mFlags, mTmp, &mA0, &mAi, &mAj, &mAk );
+	gcg->setAccuracy( accuracy );
+
+	if(preconditioner == PcMIC) {
+		if(!mPca0) {
+			Grid<Real>** grids[] = { &mPca0, &mPca1, &mPca2, &mPca3 };
+			for(Grid<Real>** g : grids) *g = new Grid<Real>(mParent);
+		}
+		gcg->setICPreconditioner(GridCgInterface::PC_mICP, mPca0, mPca1, mPca2, mPca3);
+		// the factors only depend on the matrix
+		gcg->setReusePreconditioner(mPcInited);
+		mPcInited = true;
+	} else if(preconditioner == PcMGDynamic || preconditioner == PcMGStatic) {
+		if(!mMG) mMG = new GridMg(dst.getSize());
+		gcg->setMGPreconditioner(GridCgInterface::PC_MGP, mMG);
+	}
+
+	gcg->solve(maxIter);
+	mIterations = gcg->getIterations();
+	mResNorm = gcg->getResNorm();
 	delete gcg;
+	knHelmholtzSetFixedValues(mFlags, dst, mFixed);
+
+	if(preconditioner == PcMGDynamic && mMG) {
+		delete mMG;
+		mMG = nullptr;
+	}
 }
 
 
+//***************************************************************************** 
+// diffusion for real and vec grids, e.g. for viscosity
+
+//! diffuse all grids with the same system, vector grids per component
+static void solveDiffusionGrids(const FlagGrid& flags, const std::vector<GridBase*>& grids, Real alpha, Real cgMaxIterFac, Real cgAccuracy, int preconditioner)
+{
+	FluidSolver* parent = flags.getParent();
+	HelmholtzSystem& sys = HelmholtzSystem::get(parent, HelmholtzSystem::Diffusion);
+	sys.update(flags, alpha);
+
+	Grid<Real> rhs(parent), u(parent);
+	const int maxIter = (int)(cgMaxIterFac * flags.getSize().max()) * (flags.is3D() ? 1 : 4);
+
+	for(GridBase* grid : grids) {
+		if (grid->getType() & GridBase::TypeReal) {
+			Grid<Real>& g = *((Grid<Real>*) grid);
+			rhs.copyFrom(g);
+			sys.solve(g, rhs, maxIter, cgAccuracy, preconditioner);
+			debMsg("FluidSolver::solveDiffusion iterations:"<<sys.getIterations()<<", res:"<<sys.getResNorm(), CG_DEBUGLEVEL);
+		}
+		else
+		if( (grid->getType() & GridBase::TypeVec3) || (grid->getType() & GridBase::TypeMAC) )
+		{
+			Grid<Vec3>& vec = *((Grid<Vec3>*) grid);
+			// diffuse every component separately
+			for(int component = 0; component< (grid->is3D() ? 3:2); ++component) {
+				getComponent( vec, u, component );
+				rhs.copyFrom(u);
+				sys.solve(u, rhs, maxIter, cgAccuracy, preconditioner);
+				debMsg("FluidSolver::solveDiffusion vec3, iterations:"<<sys.getIterations()<<", res:"<<sys.getResNorm(), CG_DEBUGLEVEL);
+				setComponent( u, vec, component );
+			}
+		} else {
+			errMsg("cgSolveDiffusion: Grid Type is not supported (only Real, Vec3, MAC, or Levelset)");
+		}
+	}
+}
+
+//! do a CG solve for diffusion; note: diffusion coefficient alpha given in grid space, 
+//  rescale in python file for discretization independence (or physical correspondence)
+//  see lidDrivenCavity.py for an example
+//  the system is kept for the next call with the same flags and alpha, with PcMGStatic including
+//  the multigrid hierarchy
+PYTHON() void cgSolveDiffusion(const FlagGrid& flags, GridBase& grid,
+						Real alpha = 0.25, Real cgMaxIterFac = 1.0, Real cgAccuracy   = 1e-4, int preconditioner = PcNone )
+{
+	solveDiffusionGrids(flags, std::vector<GridBase*>(1, &grid), alpha, cgMaxIterFac, cgAccuracy, preconditioner);
+}
+
+//! diffuse several grids (e.g. density, heat and velocity) with one system and preconditioner
+PYTHON() void cgSolveDiffusionBatch(const FlagGrid& flags, std::vector<PbClass*>& grids,
+						Real alpha = 0.25, Real cgMaxIterFac = 1.0, Real cgAccuracy   = 1e-4, int preconditioner = PcMGStatic )
+{
+	std::vector<GridBase*> gridBases;
+	for(PbClass* obj : grids) {
+		GridBase* grid = dynamic_cast<GridBase*>(obj);
+		if(!grid) errMsg("cgSolveDiffusionBatch: '" << obj->getName() << "' is not a grid");
+		gridBases.push_back(grid);
+	}
+	solveDiffusionGrids(flags, gridBases, alpha, cgMaxIterFac, cgAccuracy, preconditioner);
+}
+
+//! release the kept diffusion and wave equation systems of a solver, or of all solvers
+PYTHON() void releaseDiffusionSystems(FluidSolver* solver=nullptr) {
+	HelmholtzSystem::release(solver);
+}
+
 
 
 }; // DDF
@@ -18,9 +18,12 @@
 #include "grid.h"
 #include "kernel.h"
 #include "multigrid.h"
+#include "compactflags.h"
 
 namespace Manta { 
 
+class DomainDecomposition;
+
 static const bool CG_DEBUG = false;
 
 //! Basic CG interface 
@@ -28,7 +31,7 @@ class GridCgInterface {
 	public:
 		enum PreconditionType { PC_None=0, PC_ICP, PC_mICP, PC_MGP };
 		
-		GridCgInterface() : mUseL2Norm(true) {};
+		GridCgInterface() : mUseL2Norm(true), mReusePc(false), mUseInitialGuess(false), mDecomp(nullptr), mCompactFlags(nullptr) {};
 		virtual ~GridCgInterface() {};
 
 		// solving functions
@@ -50,11 +53,28 @@ class GridCgInterface {
 		virtual void forceReinit() = 0;
 
 		void setUseL2Norm(bool set) { mUseL2Norm = set; }
+		//! keep IC factors from a previous solve, the matrix must not have changed since
+		void setReusePreconditioner(bool set) { mReusePc = set; }
+		//! start from the current content of dst instead of zero (warm start)
+		void setUseInitialGuess(bool set) { mUseInitialGuess = set; }
+		//! solve one part of a decomposed domain, the grids contain ghost layers (see DomainDecomposition)
+		void setDecomposition(DomainDecomposition* set) { mDecomp = set; }
+		//! apply the poisson matrix with the one byte cell types of a CompactFlags object (see ApplyMatrixCompact),
+		//! only for the ApplyMatrix / ApplyMatrix2D kernels, the types have to match the flags of the solve
+		void setCompactFlags(const CompactFlags* set) { mCompactFlags = set; }
 
 	protected:
 
 		// use l2 norm of residualfor threshold? (otherwise uses max norm)
 		bool mUseL2Norm; 
+		// skip computation of the IC preconditioner grids in doInit
+		bool mReusePc;
+		// don't clear dst in doInit
+		bool mUseInitialGuess;
+		// exchange halos and reduce norms and dot products over all ranks
+		DomainDecomposition* mDecomp;
+		// cell types for the matrix application, optional
+		const CompactFlags* mCompactFlags;
 };
 
 
@@ -88,6 +108,14 @@ class GridCg : public GridCgInterface {
 		Real getAccuracy() const { return mAccuracy; }
 
 	protected:
+		//! apply the matrix to src, result in dst
+		void applyMatrix(Grid<Real>& dst, const Grid<Real>& src);
+		//! apply preconditioner to the residual, result in tmp
+		void applyPreconditioner();
+		//! dot product and residual norm, global for decomposed domains
+		double dotProduct(const Grid<Real>& a, const Grid<Real>& b);
+		Real residualNorm();
+
 		bool mInited;
 		int mIterations;
 		// grids
@@ -114,6 +142,119 @@ class GridCg : public GridCgInterface {
 }; // GridCg
 
 
+//! CG solver that only works on the fluid cells of a domain
+/*! All fluid cells are gathered into a compact list (in grid order), and the symmetric 7-point
+	stencil is stored per active cell. Memory and iteration time scale with the number of fluid
+	cells instead of the domain size, which pays off for liquids that fill only a small part of it. */
+class CompactCg {
+	public:
+		CompactCg();
+
+		//! gather fluid cells and assemble the poisson matrix (same coefficients as MakeLaplaceMatrix)
+		void build(const FlagGrid& flags, const MACGrid* fractions = nullptr);
+		//! pin pressure of the given grid cell to zero (rhs of this cell has to be zero as well)
+		void fixCell(IndexInt gridIdx);
+		//! only PC_None and PC_mICP are supported
+		void setPreconditioner(GridCgInterface::PreconditionType method);
+
+		//! solve A*dst = rhs, dst is overwritten (zero outside of the fluid region)
+		void solve(Grid<Real>& dst, const Grid<Real>& rhs, int maxIter);
+		//! start from the fluid values of dst instead of zero (warm start)
+		void setUseInitialGuess(bool set) { mUseInitialGuess = set; }
+
+		// access
+		int getNumCells() const { return (int)mCells.size(); }
+		const std::vector<IndexInt>& getCells() const { return mCells; }
+		std::vector<Real>& getDiagonal() { return mDiag; }
+		int getIterations() const { return mIterations; }
+		Real getResNorm() const { return mResNorm; }
+		void setAccuracy(Real set) { mAccuracy = set; }
+		Real getAccuracy() const { return mAccuracy; }
+		void setUseL2Norm(bool set) { mUseL2Norm = set; }
+
+	protected:
+		void initPreconditioner();
+		void applyPreconditioner(std::vector<Real>& dst, const std::vector<Real>& src) const;
+
+		int mDim;
+		//! grid index of each active cell
+		std::vector<IndexInt> mCells;
+		//! compact neighbor indices per cell (-x,+x,-y,+y,-z,+z), -1 if not active
+		std::vector<int> mNbr;
+		//! matrix: diagonal, and couplings to +x,+y,+z neighbors (symmetric storage like Ai,Aj,Ak)
+		std::vector<Real> mDiag, mOff;
+		//! mICP preconditioner
+		std::vector<Real> mPrecond;
+		GridCgInterface::PreconditionType mPcMethod;
+		bool mPcInited;
+
+		//! CG vectors
+		std::vector<Real> mX, mRhs, mResidual, mSearch, mTmp;
+
+		int mIterations;
+		Real mAccuracy;
+		Real mResNorm;
+		bool mUseL2Norm;
+		bool mUseInitialGuess;
+}; // CompactCg
+
+
+//! Helmholtz-type system (I + s*L) of implicit diffusion and wave equation solves
+/*! Matrix, CG temporaries, preconditioner and multigrid hierarchy are kept between solves, and
+	only rebuilt if s or the flags change. Couplings between fluid and non-fluid cells are moved to
+	the right-hand side, the remaining system is symmetric, so that any preconditioner of the
+	pressure solve (the Preconditioner enum in pressuresolver.h) can be used. */
+class HelmholtzSystem {
+	public:
+		//! Diffusion: Laplacian over all cells, identity rows for obstacles (cgSolveDiffusion)
+		//! Wave: Laplacian of MakeLaplaceMatrix (cgSolveWE)
+		enum Type { Diffusion = 0, Wave = 1 };
+
+		HelmholtzSystem(FluidSolver* parent, int type);
+		~HelmholtzSystem();
+
+		//! shared system of a solver, for each type
+		static HelmholtzSystem& get(FluidSolver* parent, int type);
+		//! release the systems of a solver, or of all solvers; called when a solver is destroyed
+		static void release(FluidSolver* parent = nullptr);
+
+		//! rebuild the matrix if s or the flags changed, returns true if it was rebuilt
+		bool update(const FlagGrid& flags, Real s);
+		//! solve for dst, rhs contains the values of the non-fluid cells and is modified,
+		//! only fluid cells are solved for
+		void solve(Grid<Real>& dst, Grid<Real>& rhs, int maxIter, Real accuracy, int preconditioner);
+
+		// access
+		int getIterations() const { return mIterations; }
+		Real getResNorm() const { return mResNorm; }
+		int getNumBuilds() const { return mNumBuilds; }
+
+	protected:
+		void releasePreconditioner();
+
+		FluidSolver* mParent;
+		int mType;
+		bool mValid;
+		Real mS;
+		//! flags the matrix was built for
+		FlagGrid mFlags;
+		Grid<Real> mA0, mAi, mAj, mAk;
+		//! couplings to non-fluid cells that were moved to the rhs, bit per direction (-x,+x,-y,+y,-z,+z)
+		Grid<int> mBnd;
+		//! values of the non-fluid cells during a solve
+		Grid<Real> mFixed;
+		Grid<Real> mResidual, mSearch, mTmp;
+		//! mICP preconditioner, and multigrid hierarchy
+		Grid<Real> *mPca0, *mPca1, *mPca2, *mPca3;
+		bool mPcInited;
+		GridMg* mMG;
+
+		int mIterations;
+		Real mResNorm;
+		int mNumBuilds;
+}; // HelmholtzSystem
+
+
 //! Kernel: Apply symmetric stored Matrix
 KERNEL(idx) 
 void ApplyMatrix (const FlagGrid& flags, Grid<Real>& dst, const Grid<Real>& src, 
@@ -150,6 +291,28 @@ void ApplyMatrix2D (const FlagGrid& flags, Grid<Real>& dst, const Grid<Real>& sr
 				+ src[idx+Y] * Aj[idx];
 }
 
+//! Kernel: Apply symmetric stored Matrix, with one byte cell types instead of the flag grid, 2D and 3D
+KERNEL(idx)
+void ApplyMatrixCompact (Grid<Real>& dst, const CompactFlags& cflags, const Grid<Real>& src,
+						 Grid<Real>& A0, Grid<Real>& Ai, Grid<Real>& Aj, Grid<Real>& Ak)
+{
+	if (!cflags.isFluid(idx)) {
+		dst[idx] = src[idx]; return;
+	}
+
+	Real v =    src[idx] * A0[idx]
+				+ src[idx-X] * Ai[idx-X]
+				+ src[idx+X] * Ai[idx]
+				+ src[idx-Y] * Aj[idx-Y]
+				+ src[idx+Y] * Aj[idx];
+	// same order of the additions as ApplyMatrix
+	if (dst.is3D()) {
+		v += src[idx-Z] * Ak[idx-Z];
+		v += src[idx+Z] * Ak[idx];
+	}
+	dst[idx] = v;
+}
+
 //! Kernel: Construct the matrix for the poisson equation
 KERNEL (bnd=1) 
 void MakeLaplaceMatrix(const FlagGrid& flags, Grid<Real>& A0, Grid<Real>& Ai, Grid<Real>& Aj, Grid<Real>& Ak, const MACGrid* fractions = 0) {
@@ -0,0 +1,459 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2011 Tobias Pfaff, Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Domain decomposition for multi-process simulations
+ *
+ ******************************************************************************/
+
+#include "decomposition.h"
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+#if MULTIPROCESS==1
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#if NOPYTHON!=1
+#include "pythonInclude.h"
+#endif
+#endif
+
+using namespace std;
+namespace Manta {
+
+//! control block at the start of the shared memory region
+struct DecompShared {
+	std::atomic<int> arrived;
+	std::atomic<int> generation;
+	std::atomic<int> failed;
+};
+static const size_t DECOMP_HEADER = 64;
+//! minimal mailbox size, larger transfers (gather, particles) are split into several rounds
+static const size_t DECOMP_MIN_MAILBOX = 1<<22;
+
+static inline DecompShared* sharedCtrl(char* mem) { return reinterpret_cast<DecompShared*>(mem); }
+
+DomainDecomposition::DomainDecomposition(Vec3i gridSize, int dim, int numRanks, int ghostWidth) :
+	PbClass(0), mGlobalSize(gridSize), mLocalSize(gridSize), mDim(dim), mAxis(dim==3 ? 2 : 1),
+	mNumRanks(numRanks), mRank(0), mGhost(ghostWidth), mGhostLo(0), mShared(nullptr), mSharedSize(0),
+	mMailboxSize(0), mParentPid(0)
+{
+	if(mDim==2) mGlobalSize.z = mLocalSize.z = 1;
+	assertMsg(mNumRanks>=1, "DomainDecomposition: invalid number of ranks "<<mNumRanks);
+	assertMsg(mNumRanks==1 || mGhost>=2, "DomainDecomposition: ghost width has to be at least 2");
+
+	// split axis evenly, the first ranks get one more slice if necessary
+	const int len = mGlobalSize[mAxis];
+	mBegin.resize(mNumRanks+1);
+	for(int r=0; r<=mNumRanks; ++r) mBegin[r] = (int)(((long long)len * r) / mNumRanks);
+	for(int r=0; r<mNumRanks; ++r) {
+		if(mNumRanks>1 && ownedSize(r)<mGhost)
+			errMsg("DomainDecomposition: slab of rank "<<r<<" is thinner than the ghost width, use fewer ranks");
+	}
+#	if MULTIPROCESS!=1
+	if(mNumRanks>1) {
+		debMsg("DomainDecomposition: compiled without MULTIPROCESS, running "<<mNumRanks<<" ranks serially as one", 1);
+		mNumRanks = 1;
+		mBegin.assign(1, 0);
+		mBegin.push_back(len);
+	}
+#	endif
+	if(mNumRanks==1) return;
+
+#	if MULTIPROCESS==1
+	// shared memory has to exist before forking
+	mMailboxSize = std::max(DECOMP_MIN_MAILBOX, (size_t)mGhost * (size_t)mGlobalSize.x * (mDim==3 ? mGlobalSize.y : 1) * sizeof(Vec3));
+	mSharedSize = DECOMP_HEADER + sizeof(double)*mNumRanks + 2*mNumRanks*mMailboxSize;
+	void* mem = mmap(nullptr, mSharedSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+	if(mem == MAP_FAILED) errMsg("DomainDecomposition: unable to allocate shared memory of size "<<mSharedSize);
+	mShared = (char*)mem;
+	DecompShared* ctrl = new (mShared) DecompShared;
+	ctrl->arrived = 0;
+	ctrl->generation = 0;
+	ctrl->failed = 0;
+
+	// don't duplicate buffered output in the children
+	std::cout.flush();
+	std::cerr.flush();
+#	if NOPYTHON!=1
+	PyRun_SimpleString("import sys\nsys.stdout.flush()\nsys.stderr.flush()\n");
+	PyOS_BeforeFork();
+#	endif
+	fflush(NULL);
+
+	mParentPid = getpid();
+	for(int r=1; r<mNumRanks; ++r) {
+		const int pid = fork();
+		if(pid<0) {
+			sharedCtrl(mShared)->failed = 1;
+			errMsg("DomainDecomposition: fork failed");
+		}
+		if(pid==0) {
+			mRank = r;
+			mChildren.clear();
+			break;
+		}
+		mChildren.push_back(pid);
+	}
+#	if NOPYTHON!=1
+	if(mRank==0) PyOS_AfterFork_Parent();
+	else         PyOS_AfterFork_Child();
+#	endif
+#	endif // MULTIPROCESS==1
+
+	mGhostLo = ghostLo(mRank);
+	const int ghostHi = (mRank<mNumRanks-1) ? mGhost : 0;
+	mLocalSize[mAxis] = mGhostLo + ownedSize(mRank) + ghostHi;
+	debMsg("DomainDecomposition: rank "<<mRank<<" of "<<mNumRanks<<" owns "<<mBegin[mRank]<<" to "<<mBegin[mRank+1]<<", local size "<<mLocalSize, 2);
+}
+
+DomainDecomposition::~DomainDecomposition() {
+#	if MULTIPROCESS==1
+	if(!mShared) return;
+	if(mRank==0 && !mChildren.empty()) {
+		// abort ranks that are still waiting for us, and don't leave zombies behind
+		sharedCtrl(mShared)->failed = 1;
+		for(size_t i=0; i<mChildren.size(); ++i) {
+			if(mChildren[i]>0) waitpid(mChildren[i], nullptr, 0);
+		}
+	}
+	munmap(mShared, mSharedSize);
+#	endif
+}
+
+Vec3 DomainDecomposition::getOffset() const {
+	Vec3 offset(0.);
+	offset[mAxis] = (Real)axisOffset(mRank);
+	return offset;
+}
+
+char* DomainDecomposition::mailbox(int rank, int side) const {
+	return mShared + DECOMP_HEADER + sizeof(double)*mNumRanks + (2*(size_t)rank + side)*mMailboxSize;
+}
+
+//! detect ranks that terminated (e.g. due to an error in the scene), as the others would wait forever
+void DomainDecomposition::checkPeers() {
+#	if MULTIPROCESS==1
+	DecompShared* ctrl = sharedCtrl(mShared);
+	if(mRank==0) {
+		for(size_t i=0; i<mChildren.size(); ++i) {
+			if(mChildren[i]<=0) continue;
+			// a rank that terminated can't take part in collective operations anymore, whatever its exit status
+			if(waitpid(mChildren[i], nullptr, WNOHANG) == mChildren[i]) {
+				mChildren[i] = 0;
+				ctrl->failed = 1;
+			}
+		}
+	} else if(getppid() != mParentPid) {
+		ctrl->failed = 1;
+	}
+#	endif
+}
+
+void DomainDecomposition::barrier() {
+	if(mNumRanks==1) return;
+	DecompShared* ctrl = sharedCtrl(mShared);
+	const int gen = ctrl->generation;
+	if(ctrl->arrived.fetch_add(1)+1 == mNumRanks) {
+		ctrl->arrived = 0;
+		ctrl->generation.fetch_add(1);
+		return;
+	}
+	for(int spin=1; ctrl->generation==gen; ++spin) {
+		if((spin & 1023)==0) {
+			checkPeers();
+			// the generation is increased before a finished rank sets the flag, so check again
+			if(ctrl->failed && ctrl->generation==gen)
+				errMsg("DomainDecomposition: rank "<<mRank<<" aborting, another rank failed or terminated");
+		}
+		std::this_thread::yield();
+	}
+}
+
+void DomainDecomposition::finish() {
+	barrier();
+	if(mRank!=0) return;
+#	if MULTIPROCESS==1
+	bool ok = true;
+	for(size_t i=0; i<mChildren.size(); ++i) {
+		if(mChildren[i]<=0) continue;
+		int status = 0;
+		waitpid(mChildren[i], &status, 0);
+		if(!WIFEXITED(status) || WEXITSTATUS(status)!=0) ok = false;
+		mChildren[i] = 0;
+	}
+	if(!ok) errMsg("DomainDecomposition: at least one rank did not finish successfully");
+#	endif
+}
+
+double DomainDecomposition::allReduceSum(double value) {
+	if(mNumRanks==1) return value;
+	double* slots = (double*)(mShared + DECOMP_HEADER);
+	slots[mRank] = value;
+	barrier();
+	double sum = 0.;
+	for(int r=0; r<mNumRanks; ++r) sum += slots[r];
+	barrier();
+	return sum;
+}
+
+Real DomainDecomposition::allReduceMax(Real value) {
+	if(mNumRanks==1) return value;
+	double* slots = (double*)(mShared + DECOMP_HEADER);
+	slots[mRank] = value;
+	barrier();
+	double maxVal = slots[0];
+	for(int r=1; r<mNumRanks; ++r) maxVal = std::max(maxVal, slots[r]);
+	barrier();
+	return (Real)maxVal;
+}
+
+//*****************************************************************************
+// grid data transfer, slices along the decomposition axis are contiguous in memory
+
+template<class T> void DomainDecomposition::exchangeData(T* data) {
+	const IndexInt slice = sliceSize();
+	const size_t bytes = sizeof(T) * slice * mGhost;
+	const int owned = ownedSize(mRank);
+	// first and last owned slices go to the lower and upper neighbor
+	if(mRank>0)            memcpy(mailbox(mRank,0), data + slice*mGhostLo, bytes);
+	if(mRank<mNumRanks-1)  memcpy(mailbox(mRank,1), data + slice*(mGhostLo+owned-mGhost), bytes);
+	barrier();
+	if(mRank>0)            memcpy(data, mailbox(mRank-1,1), bytes);
+	if(mRank<mNumRanks-1)  memcpy(data + slice*(mGhostLo+owned), mailbox(mRank+1,0), bytes);
+	barrier();
+}
+
+template<class T> void DomainDecomposition::gatherData(const T* data, T* target) {
+	const IndexInt slice = sliceSize();
+	const size_t chunk = mMailboxSize / sizeof(T);
+	// all ranks have to run the same number of rounds
+	size_t maxCount = 0;
+	for(int r=1; r<mNumRanks; ++r) maxCount = std::max(maxCount, (size_t)(ownedSize(r) * slice));
+	if(mRank==0) memcpy(target, data, sizeof(T) * ownedSize(0) * slice);
+
+	for(size_t start=0; start<maxCount; start+=chunk) {
+		if(mRank>0) {
+			const size_t count = (size_t)(ownedSize(mRank) * slice);
+			if(start<count) memcpy(mailbox(mRank,0), data + slice*mGhostLo + start, sizeof(T)*std::min(chunk, count-start));
+		}
+		barrier();
+		if(mRank==0) {
+			for(int r=1; r<mNumRanks; ++r) {
+				const size_t count = (size_t)(ownedSize(r) * slice);
+				if(start<count) memcpy(target + slice*mBegin[r] + start, mailbox(r,0), sizeof(T)*std::min(chunk, count-start));
+			}
+		}
+		barrier();
+	}
+}
+
+template<class T> void DomainDecomposition::scatterData(T* data, const T* source) {
+	const IndexInt slice = sliceSize();
+	const size_t chunk = mMailboxSize / sizeof(T);
+	// each rank receives its full local range, incl. ghost layers
+	std::vector<size_t> count(mNumRanks);
+	size_t maxCount = 0;
+	for(int r=0; r<mNumRanks; ++r) {
+		const int localLen = ghostLo(r) + ownedSize(r) + ((r<mNumRanks-1) ? mGhost : 0);
+		count[r] = (size_t)(localLen * slice);
+		if(r>0) maxCount = std::max(maxCount, count[r]);
+	}
+	if(mRank==0) memcpy(data, source, sizeof(T) * count[0]);
+
+	for(size_t start=0; start<maxCount; start+=chunk) {
+		if(mRank==0) {
+			for(int r=1; r<mNumRanks; ++r) {
+				if(start<count[r]) memcpy(mailbox(r,0), source + slice*axisOffset(r) + start, sizeof(T)*std::min(chunk, count[r]-start));
+			}
+		}
+		barrier();
+		if(mRank>0 && start<count[mRank]) memcpy(data + start, mailbox(mRank,0), sizeof(T)*std::min(chunk, count[mRank]-start));
+		barrier();
+	}
+}
+
+void DomainDecomposition::exchange(GridBase* grid) {
+	if(mNumRanks==1) return;
+	assertMsg(grid->getSize()==mLocalSize, "DomainDecomposition::exchange: grid size "<<grid->getSize()<<" doesn't match local size "<<mLocalSize);
+	if(grid->getType() & GridBase::TypeReal)      exchangeData(&(*(Grid<Real>*)grid)[0]);
+	else if(grid->getType() & GridBase::TypeInt)  exchangeData(&(*(Grid<int>*) grid)[0]);
+	else if(grid->getType() & GridBase::TypeVec3) exchangeData(&(*(Grid<Vec3>*)grid)[0]);
+	else if(grid->getType() & GridBase::TypeHalf) exchangeData(&(*(Grid<half>*)grid)[0]);
+	else errMsg("DomainDecomposition: unsupported grid type");
+}
+
+void DomainDecomposition::gather(GridBase* grid, GridBase* target) {
+	if(mRank==0) {
+		assertMsg(target && target->getSize()==mGlobalSize && target->getType()==grid->getType(), "DomainDecomposition::gather: rank 0 needs a target grid of global size and the same type");
+	}
+	assertMsg(grid->getSize()==mLocalSize, "DomainDecomposition::gather: grid size doesn't match local size");
+	if(grid->getType() & GridBase::TypeReal)      gatherData(&(*(Grid<Real>*)grid)[0], target ? &(*(Grid<Real>*)target)[0] : nullptr);
+	else if(grid->getType() & GridBase::TypeInt)  gatherData(&(*(Grid<int>*) grid)[0], target ? &(*(Grid<int>*) target)[0] : nullptr);
+	else if(grid->getType() & GridBase::TypeVec3) gatherData(&(*(Grid<Vec3>*)grid)[0], target ? &(*(Grid<Vec3>*)target)[0] : nullptr);
+	else if(grid->getType() & GridBase::TypeHalf) gatherData(&(*(Grid<half>*)grid)[0], target ? &(*(Grid<half>*)target)[0] : nullptr);
+	else errMsg("DomainDecomposition: unsupported grid type");
+}
+
+void DomainDecomposition::scatter(GridBase* grid, GridBase* source) {
+	if(mRank==0) {
+		assertMsg(source && source->getSize()==mGlobalSize && source->getType()==grid->getType(), "DomainDecomposition::scatter: rank 0 needs a source grid of global size and the same type");
+	}
+	assertMsg(grid->getSize()==mLocalSize, "DomainDecomposition::scatter: grid size doesn't match local size");
+	if(grid->getType() & GridBase::TypeReal)      scatterData(&(*(Grid<Real>*)grid)[0], source ? &(*(Grid<Real>*)source)[0] : nullptr);
+	else if(grid->getType() & GridBase::TypeInt)  scatterData(&(*(Grid<int>*) grid)[0], source ? &(*(Grid<int>*) source)[0] : nullptr);
+	else if(grid->getType() & GridBase::TypeVec3) scatterData(&(*(Grid<Vec3>*)grid)[0], source ? &(*(Grid<Vec3>*)source)[0] : nullptr);
+	else if(grid->getType() & GridBase::TypeHalf) scatterData(&(*(Grid<half>*)grid)[0], source ? &(*(Grid<half>*)source)[0] : nullptr);
+	else errMsg("DomainDecomposition: unsupported grid type");
+}
+
+void DomainDecomposition::initDomain(FlagGrid& flags, int boundaryWidth) {
+	assertMsg(flags.getSize()==mLocalSize, "DomainDecomposition::initDomain: flag grid size doesn't match local size");
+	const int w = boundaryWidth;
+	const int offset = axisOffset(mRank);
+	FOR_IJK(flags) {
+		Vec3i g(i,j,k);
+		g[mAxis] += offset;
+		bool bnd = g.x<=w || g.x>=mGlobalSize.x-1-w || g.y<=w || g.y>=mGlobalSize.y-1-w;
+		if(mDim==3) bnd = bnd || g.z<=w || g.z>=mGlobalSize.z-1-w;
+		flags(i,j,k) = bnd ? FlagGrid::TypeObstacle : FlagGrid::TypeEmpty;
+	}
+}
+
+void DomainDecomposition::clearGhosts(Grid<Real>& grid) const {
+	if(mNumRanks==1) return;
+	const IndexInt slice = sliceSize();
+	const int owned = ownedSize(mRank);
+	Real* data = &grid[0];
+	if(mGhostLo>0) memset(data, 0, sizeof(Real)*slice*mGhostLo);
+	const int hi = mLocalSize[mAxis] - mGhostLo - owned;
+	if(hi>0) memset(data + slice*(mGhostLo+owned), 0, sizeof(Real)*slice*hi);
+}
+
+void DomainDecomposition::markGhostBoundary(FlagGrid& flags) const {
+	if(mNumRanks==1) return;
+	const IndexInt slice = sliceSize();
+	int* data = &flags[0];
+	if(mRank>0)           std::fill(data, data+slice, (int)FlagGrid::TypeObstacle);
+	if(mRank<mNumRanks-1) std::fill(data + slice*(mLocalSize[mAxis]-1), data + slice*mLocalSize[mAxis], (int)FlagGrid::TypeObstacle);
+}
+
+//*****************************************************************************
+// particle migration
+
+void DomainDecomposition::removeGhostParticles(BasicParticleSystem& parts) {
+	if(mNumRanks==1) return;
+	const Real lo = (Real)mGhostLo, hi = (Real)(mGhostLo + ownedSize(mRank));
+	for(IndexInt idx=0; idx<parts.size(); ++idx) {
+		if(!parts.isActive(idx)) continue;
+		const Real p = parts.getPos(idx)[mAxis];
+		if((p<lo && mRank>0) || (p>=hi && mRank<mNumRanks-1)) parts.kill(idx);
+	}
+	parts.doCompress();
+}
+
+int DomainDecomposition::migrateParticles(BasicParticleSystem& parts) {
+	int active = 0;
+	if(mNumRanks==1) {
+		for(IndexInt idx=0; idx<parts.size(); ++idx) if(parts.isActive(idx)) active++;
+		return active;
+	}
+
+	// record layout: position, flag, then all pdata channels in registration order
+	size_t recSize = sizeof(Vec3) + sizeof(int);
+	for(IndexInt pd=0; pd<parts.getNumPdata(); ++pd) {
+		switch(parts.getPdata(pd)->getType()) {
+			case ParticleDataBase::TypeReal: recSize += sizeof(Real); break;
+			case ParticleDataBase::TypeInt:  recSize += sizeof(int);  break;
+			case ParticleDataBase::TypeVec3: recSize += sizeof(Vec3); break;
+			default: errMsg("DomainDecomposition::migrateParticles: unsupported pdata type");
+		}
+	}
+	const size_t capacity = (mMailboxSize - sizeof(int)) / recSize;
+
+	// collect particles that left the owned slab
+	std::vector<IndexInt> outgoing[2];
+	const Real lo = (Real)mGhostLo, hi = (Real)(mGhostLo + ownedSize(mRank));
+	const IndexInt numParts = parts.size();
+	for(IndexInt idx=0; idx<numParts; ++idx) {
+		if(!parts.isActive(idx)) continue;
+		const Real p = parts.getPos(idx)[mAxis];
+		if(p<lo && mRank>0)                  outgoing[0].push_back(idx);
+		else if(p>=hi && mRank<mNumRanks-1)  outgoing[1].push_back(idx);
+		else active++;
+	}
+
+	size_t sent[2] = { 0, 0 };
+	int received = 0;
+	while(true) {
+		// pack a chunk for each neighbor
+		for(int side=0; side<2; ++side) {
+			char* box = mailbox(mRank, side);
+			const int num = (int)std::min(capacity, outgoing[side].size() - sent[side]);
+			memcpy(box, &num, sizeof(int));
+			char* ptr = box + sizeof(int);
+			const int dest = mRank + (side==0 ? -1 : 1);
+			const Real shift = (Real)(axisOffset(mRank) - (dest>=0 && dest<mNumRanks ? axisOffset(dest) : 0));
+			for(int n=0; n<num; ++n) {
+				const IndexInt idx = outgoing[side][sent[side]+n];
+				Vec3 pos = parts.getPos(idx);
+				pos[mAxis] += shift;
+				const int flag = parts.getStatus(idx);
+				memcpy(ptr, &pos, sizeof(Vec3));  ptr += sizeof(Vec3);
+				memcpy(ptr, &flag, sizeof(int));  ptr += sizeof(int);
+				for(IndexInt pd=0; pd<parts.getNumPdata(); ++pd) {
+					ParticleDataBase* pdata = parts.getPdata(pd);
+					switch(pdata->getType()) {
+						case ParticleDataBase::TypeReal: memcpy(ptr, &(*(ParticleDataImpl<Real>*)pdata)[idx], sizeof(Real)); ptr += sizeof(Real); break;
+						case ParticleDataBase::TypeInt:  memcpy(ptr, &(*(ParticleDataImpl<int>*) pdata)[idx], sizeof(int));  ptr += sizeof(int);  break;
+						default:                         memcpy(ptr, &(*(ParticleDataImpl<Vec3>*)pdata)[idx], sizeof(Vec3)); ptr += sizeof(Vec3); break;
+					}
+				}
+				parts.kill(idx);
+			}
+			sent[side] += num;
+		}
+		barrier();
+
+		// unpack from the upper mailbox of the lower neighbor, and the lower mailbox of the upper neighbor
+		for(int side=0; side<2; ++side) {
+			const int src = mRank + (side==0 ? -1 : 1);
+			if(src<0 || src>=mNumRanks) continue;
+			const char* box = mailbox(src, 1-side);
+			int num = 0;
+			memcpy(&num, box, sizeof(int));
+			const char* ptr = box + sizeof(int);
+			for(int n=0; n<num; ++n) {
+				BasicParticleData data;
+				memcpy(&data.pos, ptr, sizeof(Vec3));  ptr += sizeof(Vec3);
+				memcpy(&data.flag, ptr, sizeof(int));  ptr += sizeof(int);
+				const IndexInt idx = parts.add(data);
+				for(IndexInt pd=0; pd<parts.getNumPdata(); ++pd) {
+					ParticleDataBase* pdata = parts.getPdata(pd);
+					switch(pdata->getType()) {
+						case ParticleDataBase::TypeReal: memcpy(&(*(ParticleDataImpl<Real>*)pdata)[idx], ptr, sizeof(Real)); ptr += sizeof(Real); break;
+						case ParticleDataBase::TypeInt:  memcpy(&(*(ParticleDataImpl<int>*) pdata)[idx], ptr, sizeof(int));  ptr += sizeof(int);  break;
+						default:                         memcpy(&(*(ParticleDataImpl<Vec3>*)pdata)[idx], ptr, sizeof(Vec3)); ptr += sizeof(Vec3); break;
+					}
+				}
+			}
+			received += num;
+		}
+
+		// continue until all ranks sent everything (includes barriers for mailbox reuse)
+		const double remaining = (double)(outgoing[0].size() - sent[0] + outgoing[1].size() - sent[1]);
+		if(allReduceSum(remaining) == 0.) break;
+	}
+	parts.doCompress();
+	debMsg("DomainDecomposition::migrateParticles rank "<<mRank<<": sent "<<(sent[0]+sent[1])<<", received "<<received, 3);
+	return active + received;
+}
+
+} // namespace
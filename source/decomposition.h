@@ -0,0 +1,107 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2011 Tobias Pfaff, Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Domain decomposition for multi-process simulations
+ *
+ ******************************************************************************/
+
+#ifndef _DECOMPOSITION_H
+#define _DECOMPOSITION_H
+
+#include "grid.h"
+#include "particle.h"
+
+namespace Manta {
+
+//! Slab decomposition of a domain onto several local processes
+/*! The domain is split along z (y in 2D). Upon construction, the calling process forks numRanks-1
+	child processes, and each of them continues the scene script as one rank. Every rank creates its
+	own solver with getLocalSize(), i.e., its slab plus ghostWidth layers towards each neighbor.
+	Ranks communicate through an anonymous shared memory region: halo exchange of grids, particle
+	migration and global reductions. All ranks have to call these functions in the same order.
+	The ghost width has to cover the stencils and the advection distance per step, for second order
+	advection roughly twice the CFL number plus two layers.
+	Forking requires the MULTIPROCESS build option (POSIX only), without it all ranks run serially
+	as one. Only the forking thread survives in the children, so create the decomposition at the
+	start of the scene, before any threaded kernel or python thread has been started. */
+PYTHON() class DomainDecomposition : public PbClass {
+public:
+	PYTHON() DomainDecomposition(Vec3i gridSize, int dim=3, int numRanks=1, int ghostWidth=4);
+	virtual ~DomainDecomposition();
+
+	// python accessors
+	PYTHON() int getRank() const { return mRank; }
+	PYTHON() int getNumRanks() const { return mNumRanks; }
+	PYTHON() Vec3i getLocalSize() const { return mLocalSize; }
+	PYTHON() Vec3i getGlobalSize() const { return mGlobalSize; }
+	//! position of the local grid origin in global grid coordinates, e.g., to offset shapes
+	PYTHON() Vec3 getOffset() const;
+
+	//! init boundaries of the local flag grid, walls are only set at the global domain boundary
+	PYTHON() void initDomain(FlagGrid& flags, int boundaryWidth=0);
+	//! update ghost layers of a grid with the values of the neighboring ranks
+	PYTHON() void exchange(GridBase* grid);
+	//! collect the owned parts of all ranks in a grid of global size on rank 0 (target only needed there)
+	PYTHON() void gather(GridBase* grid, GridBase* target=nullptr);
+	//! distribute a grid of global size from rank 0 (source only needed there), updates ghost layers
+	PYTHON() void scatter(GridBase* grid, GridBase* source=nullptr);
+	//! move particles that left the owned slab to the neighboring ranks, incl. all pdata channels
+	//! returns the number of active local particles afterwards
+	PYTHON() int migrateParticles(BasicParticleSystem& parts);
+	//! delete particles in the ghost layers, e.g., after seeding with shapes that overlap them (the neighbors seed them as well)
+	PYTHON() void removeGhostParticles(BasicParticleSystem& parts);
+
+	//! global reductions over all ranks (deterministic, ranks are combined in order)
+	PYTHON() Real sum(Real value) { return (Real)allReduceSum((double)value); }
+	PYTHON() Real max(Real value) { return allReduceMax(value); }
+	PYTHON() void barrier();
+	//! rank 0 waits for the other ranks to finish, call at the end of the scene
+	PYTHON() void finish();
+
+	double allReduceSum(double value);
+	Real allReduceMax(Real value);
+
+	//! set ghost layers of a grid to zero
+	void clearGhosts(Grid<Real>& grid) const;
+	//! mark the outermost ghost layer as obstacle, so that solvers treat the ghosts as coupled boundary values
+	void markGhostBoundary(FlagGrid& flags) const;
+	//! check whether a local cell (along the decomposition axis) belongs to this rank
+	inline bool isOwned(int axisIdx) const { return axisIdx>=mGhostLo && axisIdx<mGhostLo+ownedSize(mRank); }
+	inline bool isActive() const { return mNumRanks>1; }
+
+protected:
+	int ownedSize(int rank) const { return mBegin[rank+1] - mBegin[rank]; }
+	int ghostLo(int rank) const { return rank>0 ? mGhost : 0; }
+	//! global axis index of local cell 0
+	int axisOffset(int rank) const { return mBegin[rank] - ghostLo(rank); }
+	IndexInt sliceSize() const { return (IndexInt)mLocalSize.x * (mDim==3 ? mLocalSize.y : 1); }
+	char* mailbox(int rank, int side) const;
+	void checkPeers();
+
+	template<class T> void exchangeData(T* data);
+	template<class T> void gatherData(const T* data, T* target);
+	template<class T> void scatterData(T* data, const T* source);
+
+	Vec3i mGlobalSize, mLocalSize;
+	int mDim, mAxis;
+	int mNumRanks, mRank, mGhost;
+	//! first global axis index owned by each rank, numRanks+1 entries
+	std::vector<int> mBegin;
+	int mGhostLo;
+
+	//! shared memory: barrier state, reduction slots and two mailboxes per rank
+	char* mShared;
+	size_t mSharedSize, mMailboxSize;
+	std::vector<int> mChildren;
+	int mParentPid;
+};
+
+} // namespace
+
+#endif
@@ -14,6 +14,7 @@
 #include "fastmarch.h"
 #include "levelset.h"
 #include "kernel.h"
+#include "narrowband.h"
 #include <algorithm>
 
 using namespace std;
@@ -256,9 +257,8 @@ void knExtrapolateMACSimple (MACGrid& vel, int distance , Grid<int>& tmp , const
 		vel(p)[c] = avgVel / nbs;
 	}
 }
-//! copy velocity into domain side, note - don't read & write same grid, hence velTmp copy
-KERNEL(bnd=0)
-void knExtrapolateIntoBnd (FlagGrid& flags, MACGrid& vel, const MACGrid& velTmp)
+//! velocity of a domain side cell, copied from its inner neighbors, returns false for inner cells
+inline bool extrapolateIntoBndValue (const FlagGrid& flags, const MACGrid& velTmp, int i, int j, int k, Vec3& vel)
 {
 	int c=0;
 	Vec3 v(0,0,0);
@@ -295,8 +295,17 @@ void knExtrapolateIntoBnd (FlagGrid& flags, MACGrid& vel, const MACGrid& velTmp)
 		c++;
 	} }
 	if(c>0) {
-		vel(i,j,k) = v/(Real)c;
+		vel = v/(Real)c;
 	}
+	return c>0;
+}
+
+//! copy velocity into domain side, note - don't read & write same grid, hence velTmp copy
+KERNEL(bnd=0)
+void knExtrapolateIntoBnd (FlagGrid& flags, MACGrid& vel, const MACGrid& velTmp)
+{
+	Vec3 v;
+	if(extrapolateIntoBndValue(flags, velTmp, i,j,k, v)) vel(i,j,k) = v;
 }
 
 // todo - use getGradient instead?
@@ -330,13 +339,125 @@ void knUnprojectNormalComp (FlagGrid& flags, MACGrid& vel, Grid<Real>& phi, Real
 		vel(i,j,k) -= n*l;
 	}
 }
+//! Kernel: mark initialized band cells for the extrapolation along component c, tmp has one entry per band cell
+KERNEL(pts)
+void knMarkBandMACSimple (const NarrowBand& band, const FlagGrid& flags, std::vector<int>& tmp, const int c, const bool intoObs)
+{
+	Vec3i dir = 0;
+	dir[c] = 1;
+	FOR_BAND_ROW(band, idx) {
+		const Vec3i p(i,j,k);
+		bool mark = false;
+		if(flags.isInBounds(p,1)) {
+			if(!intoObs) {
+				if( flags.isFluid(p) || flags.isFluid(p-dir) ) mark = true;
+			} else {
+				if( (flags.isFluid(p) || flags.isFluid(p-dir) ) && 
+					(!flags.isObstacle(p)) && (!flags.isObstacle(p-dir)) ) mark = true;
+			}
+		}
+		tmp[BAND_INDEX(band)] = mark ? 1 : 0;
+	}
+}
+
+//! Kernel: band version of knExtrapolateMACSimple, neighbors outside of the band count as uninitialized
+KERNEL(pts)
+void knExtrapolateMACSimpleBand (const NarrowBand& band, const FlagGrid& flags, MACGrid& vel, std::vector<int>& tmp, const int d, const int c)
+{
+	static const Vec3i nb[6] = { 
+		Vec3i(1 ,0,0), Vec3i(-1,0,0),
+		Vec3i(0,1 ,0), Vec3i(0,-1,0),
+		Vec3i(0,0,1 ), Vec3i(0,0,-1) };
+	const int dim = (vel.is3D() ? 3:2);
+
+	FOR_BAND_ROW(band, idx) {
+		const IndexInt b = BAND_INDEX(band);
+		if (tmp[b] != 0) continue;
+		const Vec3i p(i,j,k);
+		if (!flags.isInBounds(p,1)) continue;
+
+		// copy from initialized neighbors
+		int nbs = 0;
+		Real avgVel = 0.;
+		for (int n=0; n<2*dim; ++n) {
+			const Vec3i q = p+nb[n];
+			const IndexInt bq = band.find(q.x,q.y,q.z);
+			if (bq >= 0 && tmp[bq] == d) {
+				avgVel += vel(q)[c];
+				nbs++;
+			}
+		}
+
+		if(nbs>0) {
+			tmp[b]    = d+1;
+			vel(p)[c] = avgVel / nbs;
+		}
+	}
+}
+
+//! Kernel: velocities of the domain sides, row idx (j + k*sizeY) has all cells in the outer rows, and the first
+//! and last cell otherwise; the values are stored at start[idx].. first, and applied afterwards as the sides read each other
+KERNEL(pts)
+void knExtrapolateIntoSides (const std::vector<IndexInt>& start, const FlagGrid& flags, MACGrid& vel, std::vector<Vec3>& val, std::vector<char>& set, const bool apply)
+{
+	if(idx+1 >= (IndexInt)start.size()) return;
+	const int j = idx % flags.getSizeY(), k = idx / flags.getSizeY();
+	const int di = (start[idx+1]-start[idx] == flags.getSizeX()) ? 1 : std::max(flags.getSizeX()-1, 1);
+	IndexInt b = start[idx];
+	for(int i=0; i<flags.getSizeX(); i+=di, ++b) {
+		if(apply) {
+			if(set[b]) vel(i,j,k) = val[b];
+		} else {
+			set[b] = extrapolateIntoBndValue(flags, vel, i,j,k, val[b]) ? 1 : 0;
+		}
+	}
+}
+
+static void extrapolateMACSimpleBand (FlagGrid& flags, MACGrid& vel, int distance, 
+		LevelsetGrid* phiObs, bool intoObs, const NarrowBand& band) 
+{
+	assertMsg(band.isValid(flags), "extrapolateMACSimple: narrow band doesn't match the grid size, call update() first");
+	std::vector<int> tmp( band.getSpans().numCells() );
+	int dim = (flags.is3D() ? 3:2);
+
+	for(int c=0; c<dim; ++c) {
+		knMarkBandMACSimple(band, flags, tmp, c, intoObs);
+		for(int d=1; d<1+distance; ++d) {
+			knExtrapolateMACSimpleBand(band, flags, vel, tmp, d, c);
+		}
+	}
+
+	if(phiObs) {
+		knUnprojectNormalComp( flags, vel, *phiObs, distance );
+	}
+
+	// copy tangential values into sides of domain, all side cells as in the full version
+	const int numRows = flags.getSizeY() * flags.getSizeZ();
+	std::vector<IndexInt> start(numRows+1);
+	start[0] = 0;
+	for(int r=0; r<numRows; ++r) {
+		const int j = r % flags.getSizeY(), k = r / flags.getSizeY();
+		const bool outer = j==0 || j==flags.getSizeY()-1 || (flags.is3D() && (k==0 || k==flags.getSizeZ()-1));
+		start[r+1] = start[r] + (outer ? flags.getSizeX() : std::min(flags.getSizeX(), 2));
+	}
+	std::vector<Vec3> val( start[numRows] );
+	std::vector<char> set( start[numRows] );
+	knExtrapolateIntoSides(start, flags, vel, val, set, false);
+	knExtrapolateIntoSides(start, flags, vel, val, set, true);
+}
+
 // a simple extrapolation step , used for cases where there's no levelset
 // (note, less accurate than fast marching extrapolation.)
 // into obstacle is a special mode for second order obstable boundaries (extrapolating
 // only fluid velocities, not those at obstacles)
+// with a narrow band, only the band cells are processed, its outer width should be at least the distance
 PYTHON() void extrapolateMACSimple (FlagGrid& flags, MACGrid& vel, int distance = 4, 
-		LevelsetGrid* phiObs=NULL , bool intoObs = false ) 
+		LevelsetGrid* phiObs=NULL , bool intoObs = false, const NarrowBand* band=NULL ) 
 {
+	if(band) {
+		extrapolateMACSimpleBand(flags, vel, distance, phiObs, intoObs, *band);
+		return;
+	}
 	Grid<int> tmp( flags.getParent() );
 	int dim = (flags.is3D() ? 3:2);
 
@@ -407,10 +528,64 @@ void knExtrapolateMACFromWeight ( MACGrid& vel, Grid<Vec3>& weight, int distance
 // note - the weight grid values are destroyed! the function is necessary due to discrepancies
 // between velocity mapping on surface-levelset / fluid-flag creation. With this
 // extrapolation we make sure the fluid region is covered by initial velocities
-PYTHON() void extrapolateMACFromWeight ( MACGrid& vel, Grid<Vec3>& weight, int distance = 2) 
+// with a narrow band, only the band cells are processed
+//! Kernel: reset band weights to 0 (uninitialized), and 1 (initialized inner values)
+KERNEL(pts)
+void knResetWeightBand ( const NarrowBand& band, const MACGrid& vel, Grid<Vec3>& weight, const int c ) 
+{
+	FOR_BAND_ROW(band, idx) {
+		Real& w = weight(i,j,k)[c];
+		if(w>0. && vel.isInBounds(Vec3i(i,j,k),1)) w = 1.0;
+	}
+}
+
+//! Kernel: band version of knExtrapolateMACFromWeight, weights outside of the band count as uninitialized
+KERNEL(pts)
+void knExtrapolateMACFromWeightBand ( const NarrowBand& band, MACGrid& vel, Grid<Vec3>& weight, const int d, const int c ) 
+{
+	static const Vec3i nb[6] = { 
+		Vec3i(1 ,0,0), Vec3i(-1,0,0),
+		Vec3i(0,1 ,0), Vec3i(0,-1,0),
+		Vec3i(0,0,1 ), Vec3i(0,0,-1) };
+	const int dim = (vel.is3D() ? 3:2);
+
+	FOR_BAND_ROW(band, idx) {
+		const Vec3i p(i,j,k);
+		if (weight(p)[c] != 0 || !vel.isInBounds(p,1)) continue;
+
+		// copy from initialized neighbors
+		int nbs = 0;
+		Real avgVel = 0.;
+		for (int n=0; n<2*dim; ++n) {
+			const Vec3i q = p+nb[n];
+			if (weight(q)[c] == d && band.find(q.x,q.y,q.z) >= 0) {
+				avgVel += vel(q)[c];
+				nbs++;
+			}
+		}
+
+		if(nbs>0) {
+			weight(p)[c] = d+1;
+			vel(p)[c] = avgVel / nbs;
+		}
+	}
+}
+
+PYTHON() void extrapolateMACFromWeight ( MACGrid& vel, Grid<Vec3>& weight, int distance = 2, const NarrowBand* band=NULL) 
 {
 	const int dim = (vel.is3D() ? 3:2);
 
+	if(band) {
+		assertMsg(band->isValid(vel), "extrapolateMACFromWeight: narrow band doesn't match the grid size, call update() first");
+		for(int c=0; c<dim; ++c) {
+			knResetWeightBand(*band, vel, weight, c);
+			for(int d=1; d<1+distance; ++d) {
+				knExtrapolateMACFromWeightBand(*band, vel, weight, d, c);
+			}
+		}
+		return;
+	}
+
 	for(int c=0; c<dim; ++c) {
 		Vec3i dir = 0;
 		dir[c] = 1;
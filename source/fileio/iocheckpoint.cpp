@@ -0,0 +1,758 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2011 Tobias Pfaff, Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Checkpoints of the complete simulation state of a solver
+ *
+ ******************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <map>
+#include <set>
+#if defined(WIN32) || defined(_WIN32)
+#	include <direct.h>
+#	define getcwd _getcwd
+#else
+#	include <unistd.h>
+#endif
+#if NO_ZLIB!=1
+extern "C" {
+#include <zlib.h>
+}
+#endif
+
+#include "mantaio.h"
+#include "grid.h"
+#include "grid4d.h"
+#include "particle.h"
+#include "vortexpart.h"
+#include "turbulencepart.h"
+#include "noisefield.h"
+#include "shapes.h"
+#include "randomstream.h"
+
+using namespace std;
+
+namespace Manta {
+
+#if NO_ZLIB!=1
+
+//! file layout: header (incl. path and fingerprint of the base checkpoint for deltas), then records
+//! (tag, key, byte length, payload) terminated by CkpEnd, then the block hash index and its file offset.
+//! The path of the base is relative to the directory of the delta. Only this version is supported.
+static const char CKP_MAGIC[9] = "MANTACKP";
+static const int CKP_VERSION = 1;
+//! raw size of the independently compressed blocks of large arrays
+static const size_t CKP_BLOCK = 1<<20;
+//! number of blocks compressed in parallel, bounds the memory needed for streaming
+static const size_t CKP_BATCH = 32;
+//! compressed size of blocks that are unchanged w.r.t. the base checkpoint, their data isn't stored
+static const uint32_t CKP_IN_BASE = 0;
+//! maximal length of a chain of delta checkpoints, guards against cyclic references
+static const int CKP_MAX_CHAIN = 1000;
+
+enum CkpRecord { CkpEnd = 0, CkpSolver, CkpRandom, CkpGrid, CkpGrid4d, CkpParticles, CkpPdata, CkpNoise };
+
+//! entry of the block index, identifies the content of a block
+struct CkpBlockInfo {
+	uint32_t rawSize;
+	uint64_t hash;
+};
+typedef std::map<string, std::vector<CkpBlockInfo> > CkpBlockIndex;
+
+struct CkpBlock {
+	char* data;
+	uLong rawSize;
+	std::vector<Bytef> comp;
+	bool ok;
+	uint64_t hash;
+	//! same block of the base checkpoint, if any
+	const CkpBlockInfo* base;
+	bool inBase;
+};
+
+//! 64 bit hash of a block, processes whole words with a multiply / xor-shift mix per word
+static uint64_t ckpHash(const char* data, size_t bytes) {
+	uint64_t h = 0xcbf29ce484222325ULL ^ bytes;
+	size_t i = 0;
+	for(; i+sizeof(uint64_t)<=bytes; i+=sizeof(uint64_t)) {
+		uint64_t w;
+		memcpy(&w, data+i, sizeof(uint64_t));
+		h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+		h ^= h >> 29;
+	}
+	for(; i<bytes; ++i) {
+		h = (h ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+	}
+	return h ^ (h >> 32);
+}
+
+//*****************************************************************************
+// paths of base checkpoints
+
+static bool ckpIsAbsolute(const string& path) {
+	return !path.empty() && (path[0]=='/' || path[0]=='\\' || (path.size()>1 && path[1]==':'));
+}
+
+//! directory part of a path incl. the trailing separator, empty for files in the working directory
+static string ckpDirName(const string& path) {
+	const size_t sep = path.find_last_of("/\\");
+	return sep==string::npos ? string() : path.substr(0, sep+1);
+}
+
+//! absolute path split into its components, '.' and '..' are resolved lexically
+static std::vector<string> ckpSplitPath(const string& path) {
+	string full = path;
+	if(!ckpIsAbsolute(path)) {
+		char cwd[4096];
+		if(!getcwd(cwd, sizeof(cwd))) errMsg("saveCheckpoint: unable to determine the working directory");
+		full = string(cwd) + "/" + path;
+	}
+	std::vector<string> parts;
+	string cur;
+	for(size_t i=0; i<=full.size(); ++i) {
+		if(i<full.size() && full[i]!='/' && full[i]!='\\') { cur += full[i]; continue; }
+		if(cur == "..") { if(!parts.empty()) parts.pop_back(); }
+		else if(!cur.empty() && cur != ".") parts.push_back(cur);
+		cur.clear();
+	}
+	return parts;
+}
+
+//! path of a base checkpoint (relative to the working directory) as stored in a delta: relative to the directory of the delta,
+//! so that a chain can be moved as a whole. Absolute paths stay absolute.
+static string ckpBasePathFrom(const string& base, const string& delta) {
+	if(ckpIsAbsolute(base)) return base;
+	const std::vector<string> to = ckpSplitPath(base);
+	std::vector<string> from = ckpSplitPath(delta);
+	from.pop_back();
+	size_t common = 0;
+	while(common<from.size() && common+1<to.size() && from[common]==to[common]) common++;
+	string rel;
+	for(size_t i=common; i<from.size(); ++i) rel += "../";
+	for(size_t i=common; i<to.size(); ++i) rel += to[i] + (i+1<to.size() ? "/" : "");
+	return rel;
+}
+
+//! path of the base of a delta checkpoint, relative to the working directory
+static string ckpBasePathOf(const string& base, const string& delta) {
+	if(ckpIsAbsolute(base)) return base;
+	return ckpDirName(delta) + base;
+}
+
+//! hashes blocks, and compresses those that are not part of the base checkpoint
+KERNEL(pts) void knCkpCompress(std::vector<CkpBlock>& blocks, int level) {
+	CkpBlock& b = blocks[idx];
+	b.hash = ckpHash(b.data, b.rawSize);
+	b.inBase = b.base && b.base->rawSize==b.rawSize && b.base->hash==b.hash;
+	if(b.inBase) {
+		b.ok = true;
+		return;
+	}
+	uLongf size = compressBound(b.rawSize);
+	b.comp.resize(size);
+	b.ok = compress2(&b.comp[0], &size, (const Bytef*)b.data, b.rawSize, level) == Z_OK;
+	b.comp.resize(size);
+}
+
+KERNEL(pts) void knCkpUncompress(std::vector<CkpBlock>& blocks) {
+	CkpBlock& b = blocks[idx];
+	uLongf size = b.rawSize;
+	b.ok = uncompress((Bytef*)b.data, &size, &b.comp[0], b.comp.size()) == Z_OK && size == b.rawSize;
+}
+
+//! sequential file with block-compressed arrays, optionally a delta w.r.t. the block index of a base checkpoint
+class CkpWriter {
+public:
+	//! writes to a temporary file, the previous checkpoint of the same name is only replaced by finish()
+	CkpWriter(const string& name, int level, const CkpBlockIndex* base=nullptr) :
+		mName(name), mTempName(name + ".tmp"), mLevel(level), mRecordStart(0), mBase(base), mBlocksTotal(0), mBlocksStored(0) {
+		mFile = fopen(mTempName.c_str(), "wb");
+		if(!mFile) errMsg("saveCheckpoint: can't open file " << mTempName);
+	}
+	~CkpWriter() {
+		// incomplete, e.g. after a write error
+		if(mFile) {
+			fclose(mFile);
+			remove(mTempName.c_str());
+		}
+	}
+
+	void raw(const void* data, size_t bytes) {
+		if(bytes>0 && fwrite(data, 1, bytes, mFile) != bytes) errMsg("saveCheckpoint: write error");
+	}
+	template<class T> void value(const T& v) { raw(&v, sizeof(T)); }
+	void str(const string& s) { value<int>((int)s.size()); raw(s.data(), s.size()); }
+
+	//! compress in batches of blocks, each batch is compressed in parallel and then written;
+	//! blocks with the same hash as in the base checkpoint are only referenced
+	void array(const void* data, size_t bytes) {
+		value<uint64_t>(bytes);
+		const std::vector<CkpBlockInfo>* base = nullptr;
+		if(mBase) {
+			CkpBlockIndex::const_iterator it = mBase->find(mKey);
+			if(it != mBase->end()) base = &it->second;
+		}
+		mIndex.push_back(std::make_pair(mKey, std::vector<CkpBlockInfo>()));
+		std::vector<CkpBlockInfo>& infos = mIndex.back().second;
+
+		std::vector<CkpBlock> blocks;
+		for(size_t start=0; start<bytes; ) {
+			blocks.clear();
+			for(size_t b=0; b<CKP_BATCH && start<bytes; ++b, start+=CKP_BLOCK) {
+				CkpBlock block;
+				block.data = (char*)data + start;
+				block.rawSize = (uLong)std::min(CKP_BLOCK, bytes-start);
+				block.base = (base && infos.size()+b < base->size()) ? &(*base)[infos.size()+b] : nullptr;
+				blocks.push_back(block);
+			}
+			knCkpCompress(blocks, mLevel);
+			for(size_t b=0; b<blocks.size(); ++b) {
+				if(!blocks[b].ok) errMsg("saveCheckpoint: compression failed");
+				CkpBlockInfo info = { (uint32_t)blocks[b].rawSize, blocks[b].hash };
+				infos.push_back(info);
+				mBlocksTotal++;
+				value<uint32_t>(info.rawSize);
+				if(blocks[b].inBase) {
+					value<uint32_t>(CKP_IN_BASE);
+					continue;
+				}
+				mBlocksStored++;
+				value<uint32_t>((uint32_t)blocks[b].comp.size());
+				raw(&blocks[b].comp[0], blocks[b].comp.size());
+			}
+		}
+	}
+
+	//! records start with their byte length, so that readers can skip them
+	void beginRecord(CkpRecord tag, const string& key) {
+		mKey = key;
+		value<int>(tag);
+		str(key);
+		mRecordStart = fileTell(mFile);
+		value<uint64_t>(0);
+	}
+	void endRecord() {
+		const FileOffset end = fileTell(mFile);
+		const uint64_t len = end - mRecordStart - sizeof(uint64_t);
+		fileSeek(mFile, mRecordStart, SEEK_SET);
+		value<uint64_t>(len);
+		fileSeek(mFile, end, SEEK_SET);
+	}
+
+	//! terminate the records, append the block index, close the file and move it to its final name
+	bool finish() {
+		value<int>(CkpEnd);
+		const FileOffset indexStart = fileTell(mFile);
+		value<int>((int)mIndex.size());
+		for(size_t i=0; i<mIndex.size(); ++i) {
+			str(mIndex[i].first);
+			value<uint32_t>((uint32_t)mIndex[i].second.size());
+			for(size_t b=0; b<mIndex[i].second.size(); ++b) {
+				value<uint32_t>(mIndex[i].second[b].rawSize);
+				value<uint64_t>(mIndex[i].second[b].hash);
+			}
+		}
+		value<uint64_t>(indexStart);
+		const bool ok = fflush(mFile) == 0 && fclose(mFile) == 0;
+		mFile = nullptr;
+		if(!ok) {
+			remove(mTempName.c_str());
+			return false;
+		}
+#		if defined(WIN32) || defined(_WIN32)
+		// rename doesn't replace existing files on windows
+		remove(mName.c_str());
+#		endif
+		return rename(mTempName.c_str(), mName.c_str()) == 0;
+	}
+
+	size_t getBlocksTotal() const { return mBlocksTotal; }
+	size_t getBlocksStored() const { return mBlocksStored; }
+
+protected:
+	string mName, mTempName;
+	FILE* mFile;
+	int mLevel;
+	FileOffset mRecordStart;
+	string mKey;
+	const CkpBlockIndex* mBase;
+	std::vector<std::pair<string, std::vector<CkpBlockInfo> > > mIndex;
+	size_t mBlocksTotal, mBlocksStored;
+};
+
+class CkpReader {
+public:
+	CkpReader(const string& name) : mName(name), mHasBase(false), mHeaderEnd(0) {
+		mFile = fopen(name.c_str(), "rb");
+		if(!mFile) errMsg("loadCheckpoint: can't open file " << name);
+	}
+	~CkpReader() { if(mFile) fclose(mFile); }
+
+	void raw(void* data, size_t bytes) {
+		if(bytes>0 && fread(data, 1, bytes, mFile) != bytes) errMsg("loadCheckpoint: unexpected end of file " << mName);
+	}
+	template<class T> T value() { T v; raw(&v, sizeof(T)); return v; }
+	string str() {
+		const int len = value<int>();
+		string s(len, ' ');
+		if(len>0) raw(&s[0], len);
+		return s;
+	}
+
+	void array(void* data, size_t bytes) {
+		const uint64_t stored = value<uint64_t>();
+		if(stored != bytes) errMsg("loadCheckpoint: array size mismatch in " << mName << ", " << stored << " vs. " << bytes);
+		std::vector<CkpBlock> blocks;
+		for(size_t start=0; start<bytes; ) {
+			blocks.clear();
+			for(size_t b=0; b<CKP_BATCH && start<bytes; ++b) {
+				CkpBlock block;
+				block.rawSize = value<uint32_t>();
+				const uint32_t compSize = value<uint32_t>();
+				if(start + block.rawSize > bytes) errMsg("loadCheckpoint: corrupt block in " << mName);
+				block.data = (char*)data + start;
+				start += block.rawSize;
+				// the content was already restored from the base checkpoint
+				if(compSize == CKP_IN_BASE) {
+					if(!mHasBase) errMsg("loadCheckpoint: " << mName << " refers to a base checkpoint, but has none");
+					continue;
+				}
+				block.comp.resize(compSize);
+				raw(&block.comp[0], block.comp.size());
+				blocks.push_back(block);
+			}
+			if(blocks.empty()) continue;
+			knCkpUncompress uncompressBlocks(blocks);
+			for(size_t b=0; b<blocks.size(); ++b) {
+				if(!blocks[b].ok) errMsg("loadCheckpoint: decompression failed, file " << mName << " is corrupt");
+			}
+		}
+	}
+
+	void skip(uint64_t bytes) { fileSeek(mFile, (FileOffset)bytes, SEEK_CUR); }
+	void seek(FileOffset pos, int whence) {
+		if(fileSeek(mFile, pos, whence) != 0) errMsg("loadCheckpoint: unable to seek in " << mName);
+	}
+	void setHasBase(bool hasBase) { mHasBase = hasBase; }
+
+	//! check magic number, version and precision
+	void header(string& info, string& base, uint64_t& baseFingerprint) {
+		char magic[8];
+		raw(magic, 8);
+		if(memcmp(magic, CKP_MAGIC, 8) != 0) errMsg("loadCheckpoint: " << mName << " is not a checkpoint file");
+		const int version = value<int>();
+		if(version != CKP_VERSION) errMsg("loadCheckpoint: unsupported checkpoint version " << version << " of " << mName);
+		const int realSize = value<int>();
+		if(realSize != sizeof(Real)) errMsg("loadCheckpoint: checkpoint " << mName << " was written with a different floating point precision");
+		info = str();
+		base = str();
+		baseFingerprint = base.empty() ? 0 : value<uint64_t>();
+		mHeaderEnd = fileTell(mFile);
+	}
+
+	//! identifies the content of the file by its size, and hashes of its header and of its block index,
+	//! deltas store the fingerprint of their base to detect a rewritten base. Expects header() to be read.
+	uint64_t fingerprint() {
+		const FileOffset pos = fileTell(mFile);
+		std::vector<char> data(mHeaderEnd);
+		seek(0, SEEK_SET);
+		raw(&data[0], data.size());
+		uint64_t h = ckpHash(&data[0], data.size());
+		seek(-(FileOffset)sizeof(uint64_t), SEEK_END);
+		const FileOffset indexStart = (FileOffset)value<uint64_t>();
+		const FileOffset size = fileTell(mFile);
+		if(indexStart < mHeaderEnd || indexStart >= size) errMsg("loadCheckpoint: corrupt block index in " << mName);
+		data.resize(size - indexStart);
+		seek(indexStart, SEEK_SET);
+		raw(&data[0], data.size());
+		h = (h ^ ckpHash(&data[0], data.size())) * 0x9e3779b97f4a7c15ULL;
+		seek(pos, SEEK_SET);
+		return h ^ (uint64_t)size;
+	}
+
+	//! read the block hashes of all arrays from the end of the file
+	void blockIndex(CkpBlockIndex& index) {
+		seek(-(FileOffset)sizeof(uint64_t), SEEK_END);
+		seek((FileOffset)value<uint64_t>(), SEEK_SET);
+		const int num = value<int>();
+		for(int i=0; i<num; ++i) {
+			std::vector<CkpBlockInfo>& infos = index[str()];
+			infos.resize(value<uint32_t>());
+			for(size_t b=0; b<infos.size(); ++b) {
+				infos[b].rawSize = value<uint32_t>();
+				infos[b].hash = value<uint64_t>();
+			}
+		}
+	}
+
+protected:
+	FILE* mFile;
+	string mName;
+	bool mHasBase;
+	FileOffset mHeaderEnd;
+};
+
+//*****************************************************************************
+// object payloads
+
+template<class T> static void writeGridData(CkpWriter& w, Grid<T>* grid) {
+	w.value<int>(grid->getType());
+	w.value<Vec3i>(grid->getSize());
+	w.value<int>(sizeof(T));
+	w.array(&(*grid)[0], sizeof(T) * grid->getSizeX() * grid->getSizeY() * grid->getSizeZ());
+}
+template<class T> static void readGridData(CkpReader& r, Grid<T>* grid) {
+	const int type = r.value<int>();
+	const Vec3i size = r.value<Vec3i>();
+	const int elemSize = r.value<int>();
+	if(type!=grid->getType() || size!=grid->getSize() || elemSize!=sizeof(T))
+		errMsg("loadCheckpoint: grid '" << grid->getName() << "' doesn't match the checkpoint, size " << size << " vs. " << grid->getSize());
+	r.array(&(*grid)[0], sizeof(T) * grid->getSizeX() * grid->getSizeY() * grid->getSizeZ());
+}
+
+template<class T> static void writeGrid4dData(CkpWriter& w, Grid4d<T>* grid) {
+	w.value<int>(grid->getType());
+	w.value<Vec4i>(grid->getSize());
+	w.value<int>(sizeof(T));
+	w.array(&(*grid)[0], sizeof(T) * grid->getSizeX() * grid->getSizeY() * grid->getSizeZ() * grid->getSizeT());
+}
+template<class T> static void readGrid4dData(CkpReader& r, Grid4d<T>* grid) {
+	const int type = r.value<int>();
+	const Vec4i size = r.value<Vec4i>();
+	const int elemSize = r.value<int>();
+	if(type!=grid->getType() || size!=grid->getSize() || elemSize!=sizeof(T))
+		errMsg("loadCheckpoint: 4d grid '" << grid->getName() << "' doesn't match the checkpoint");
+	r.array(&(*grid)[0], sizeof(T) * grid->getSizeX() * grid->getSizeY() * grid->getSizeZ() * grid->getSizeT());
+}
+
+template<class S> static void writeParticleData(CkpWriter& w, ParticleSystem<S>* parts) {
+	IndexInt deletes, chunk;
+	parts->getDeleteCounters(deletes, chunk);
+	w.value<int>(S::getType());
+	w.value<int>(sizeof(S));
+	w.value<IndexInt>(parts->size());
+	w.value<IndexInt>(deletes);
+	w.value<IndexInt>(chunk);
+	w.array(parts->size() ? &(*parts)[0] : nullptr, sizeof(S) * parts->size());
+}
+template<class S> static void readParticleData(CkpReader& r, ParticleSystem<S>* parts) {
+	const int type = r.value<int>();
+	const int elemSize = r.value<int>();
+	const IndexInt size = r.value<IndexInt>();
+	const IndexInt deletes = r.value<IndexInt>();
+	const IndexInt chunk = r.value<IndexInt>();
+	if(type!=S::getType() || elemSize!=sizeof(S))
+		errMsg("loadCheckpoint: particle system '" << parts->getName() << "' doesn't match the checkpoint");
+	// also resizes all pdata channels, their content follows in separate records
+	parts->resizeAll(size);
+	parts->setDeleteCounters(deletes, chunk);
+	r.array(size ? &(*parts)[0] : nullptr, sizeof(S) * size);
+}
+
+template<class T> static void writePdataData(CkpWriter& w, ParticleDataImpl<T>* pdata) {
+	w.value<int>(pdata->getType());
+	w.value<int>(sizeof(T));
+	w.value<IndexInt>(pdata->size());
+	w.array(pdata->size() ? &(*pdata)[0] : nullptr, sizeof(T) * pdata->size());
+}
+template<class T> static void readPdataData(CkpReader& r, ParticleDataImpl<T>* pdata) {
+	const int type = r.value<int>();
+	const int elemSize = r.value<int>();
+	const IndexInt size = r.value<IndexInt>();
+	if(type!=pdata->getType() || elemSize!=sizeof(T) || size!=pdata->size())
+		errMsg("loadCheckpoint: particle data '" << pdata->getName() << "' doesn't match the checkpoint, size " << size << " vs. " << pdata->size());
+	r.array(size ? &(*pdata)[0] : nullptr, sizeof(T) * size);
+}
+
+//! objects of a solver that are part of checkpoints, pdata last (their particle systems resize them upon loading)
+static void collectCheckpointObjects(FluidSolver* solver, std::vector<PbClass*>& objects, std::vector<string>& keys) {
+	PbClass::renameObjects();
+	std::vector<PbClass*> pdata;
+	for(int i=0; i<PbClass::getNumInstances(); ++i) {
+		PbClass* obj = PbClass::getInstance(i);
+		if(obj->getParent() != solver) continue;
+		if(dynamic_cast<ParticleDataBase*>(obj)) { pdata.push_back(obj); continue; }
+		if(dynamic_cast<GridBase*>(obj) || dynamic_cast<Grid4dBase*>(obj) || dynamic_cast<ParticleBase*>(obj) || dynamic_cast<WaveletNoiseField*>(obj)) {
+			objects.push_back(obj);
+		} else if(!dynamic_cast<Shape*>(obj)) {
+			// shapes are stateless, everything else is recreated by the scene
+			debMsg("Checkpoint: object '" << obj->getName() << "' is not included", 2);
+		}
+	}
+	objects.insert(objects.end(), pdata.begin(), pdata.end());
+
+	// identify objects by their python name, keys based on the creation order would silently
+	// restore data into other objects once the scene changes
+	std::set<string> names;
+	for(size_t i=0; i<objects.size(); ++i) {
+		const string name = objects[i]->getName();
+		if(name.empty() || name=="_unnamed")
+			errMsg("Checkpoint: object " << i << " of solver '" << solver->getName() << "' has no name, assign it to a global variable or pass name='...' to create()");
+		if(!names.insert(name).second)
+			errMsg("Checkpoint: several objects of solver '" << solver->getName() << "' are named '" << name << "', names have to be unique");
+		keys.push_back(name);
+	}
+}
+
+//*****************************************************************************
+// save / load
+
+//! Write the complete simulation state of a solver to a single file: all grids, particle systems,
+//! particle data and noise fields created with this solver, the time stepping state of the solver,
+//! and the states of persistent random streams. Large arrays are compressed block-wise in parallel.
+//! Objects are identified by their python names, which have to be unique. The file is written under a
+//! temporary name and only replaces an existing checkpoint once it is complete.
+//! compression: zlib level, 1 (fast) to 9 (small)
+//! base: write a delta checkpoint, blocks of arrays that didn't change w.r.t. this (full or delta)
+//!       checkpoint are not stored again. Loading a delta requires all files of its chain of bases,
+//!       they are referenced relative to the directory of the delta and mustn't be rewritten.
+PYTHON() int saveCheckpoint(FluidSolver* solver, const std::string& name, int compression=1, const std::string& base="") {
+	assertMsg(solver, "saveCheckpoint: no solver given");
+	std::vector<PbClass*> objects;
+	std::vector<string> keys;
+	collectCheckpointObjects(solver, objects, keys);
+
+	CkpBlockIndex baseIndex;
+	uint64_t baseFingerprint = 0;
+	if(!base.empty()) {
+		CkpReader r(base);
+		string info, baseOfBase;
+		uint64_t unused;
+		r.header(info, baseOfBase, unused);
+		baseFingerprint = r.fingerprint();
+		r.blockIndex(baseIndex);
+	}
+
+	CkpWriter w(name, compression, base.empty() ? nullptr : &baseIndex);
+	w.raw(CKP_MAGIC, 8);
+	w.value<int>(CKP_VERSION);
+	w.value<int>(sizeof(Real));
+	w.str(buildInfoString());
+	w.str(base.empty() ? base : ckpBasePathFrom(base, name));
+	if(!base.empty()) w.value<uint64_t>(baseFingerprint);
+
+	w.beginRecord(CkpSolver, "solver");
+	w.value<Vec3i>(solver->getGridSize());
+	w.value<int>(solver->is3D() ? 3 : 2);
+	w.value<Real>(solver->mDt);
+	w.value<Real>(solver->mTimeTotal);
+	w.value<int>(solver->mFrame);
+	w.value<Real>(solver->mCflCond);
+	w.value<Real>(solver->mDtMin);
+	w.value<Real>(solver->mDtMax);
+	w.value<Real>(solver->mFrameLength);
+	w.value<Real>(solver->mTimePerFrame);
+	w.value<int>(solver->getLockDt());
+	w.endRecord();
+
+	// random streams are process wide, store them with every solver
+	std::map<std::string, RandomStream*>& streams = RandomStream::persistentStreams();
+	for(std::map<std::string, RandomStream*>::iterator it=streams.begin(); it!=streams.end(); ++it) {
+		const std::vector<MTRand::uint32> state = it->second->getState();
+		w.beginRecord(CkpRandom, it->first);
+		w.value<int>((int)state.size());
+		for(size_t i=0; i<state.size(); ++i) w.value<uint32_t>((uint32_t)state[i]);
+		w.endRecord();
+	}
+
+	for(size_t i=0; i<objects.size(); ++i) {
+		PbClass* obj = objects[i];
+		if(GridBase* grid = dynamic_cast<GridBase*>(obj)) {
+			w.beginRecord(CkpGrid, keys[i]);
+			if(grid->getType() & GridBase::TypeReal)      writeGridData(w, (Grid<Real>*)grid);
+			else if(grid->getType() & GridBase::TypeInt)  writeGridData(w, (Grid<int>*)grid);
+			else if(grid->getType() & GridBase::TypeVec3) writeGridData(w, (Grid<Vec3>*)grid);
+			else if(grid->getType() & GridBase::TypeHalf) writeGridData(w, (Grid<half>*)grid);
+			else errMsg("saveCheckpoint: unknown grid type of '" << grid->getName() << "'");
+			w.endRecord();
+		} else if(Grid4dBase* grid = dynamic_cast<Grid4dBase*>(obj)) {
+			w.beginRecord(CkpGrid4d, keys[i]);
+			if(grid->getType() & Grid4dBase::TypeReal)      writeGrid4dData(w, (Grid4d<Real>*)grid);
+			else if(grid->getType() & Grid4dBase::TypeInt)  writeGrid4dData(w, (Grid4d<int>*)grid);
+			else if(grid->getType() & Grid4dBase::TypeVec3) writeGrid4dData(w, (Grid4d<Vec3>*)grid);
+			else if(grid->getType() & Grid4dBase::TypeVec4) writeGrid4dData(w, (Grid4d<Vec4>*)grid);
+			else errMsg("saveCheckpoint: unknown 4d grid type of '" << grid->getName() << "'");
+			w.endRecord();
+		} else if(ParticleDataBase* pdata = dynamic_cast<ParticleDataBase*>(obj)) {
+			w.beginRecord(CkpPdata, keys[i]);
+			if(pdata->getType() == ParticleDataBase::TypeReal)      writePdataData(w, (ParticleDataImpl<Real>*)pdata);
+			else if(pdata->getType() == ParticleDataBase::TypeInt)  writePdataData(w, (ParticleDataImpl<int>*)pdata);
+			else if(pdata->getType() == ParticleDataBase::TypeVec3) writePdataData(w, (ParticleDataImpl<Vec3>*)pdata);
+			else errMsg("saveCheckpoint: unknown particle data type of '" << pdata->getName() << "'");
+			w.endRecord();
+		} else if(WaveletNoiseField* noise = dynamic_cast<WaveletNoiseField*>(obj)) {
+			w.beginRecord(CkpNoise, keys[i]);
+			w.value<Vec3>(noise->mPosOffset);
+			w.value<Vec3>(noise->mPosScale);
+			w.value<Real>(noise->mValOffset);
+			w.value<Real>(noise->mValScale);
+			w.value<int>(noise->mClamp);
+			w.value<Real>(noise->mClampNeg);
+			w.value<Real>(noise->mClampPos);
+			w.value<Real>(noise->mTimeAnim);
+			w.endRecord();
+		} else {
+			ParticleBase* parts = dynamic_cast<ParticleBase*>(obj);
+			w.beginRecord(CkpParticles, keys[i]);
+			if(BasicParticleSystem* p = dynamic_cast<BasicParticleSystem*>(parts))            writeParticleData(w, p);
+			else if(ParticleIndexSystem* p = dynamic_cast<ParticleIndexSystem*>(parts))       writeParticleData(w, p);
+			else if(VortexParticleSystem* p = dynamic_cast<VortexParticleSystem*>(parts))     writeParticleData(w, p);
+			else if(TurbulenceParticleSystem* p = dynamic_cast<TurbulenceParticleSystem*>(parts)) writeParticleData(w, p);
+			else errMsg("saveCheckpoint: unsupported particle system type of '" << parts->getName() << "'");
+			w.endRecord();
+		}
+	}
+	if(!w.finish()) errMsg("saveCheckpoint: unable to write file " << name);
+	if(base.empty()) {
+		debMsg("Saved checkpoint '" << name << "' of frame " << solver->mFrame << " with " << objects.size() << " objects", 1);
+	} else {
+		debMsg("Saved delta checkpoint '" << name << "' of frame " << solver->mFrame << " with " << objects.size() << " objects, "
+			<< w.getBlocksStored() << " of " << w.getBlocksTotal() << " blocks changed w.r.t. '" << base << "'", 1);
+	}
+	return 1;
+}
+
+//! read one file of a checkpoint chain, delta checkpoints first restore their base and then overwrite the changed blocks.
+//! Bases are only accepted if they still have the fingerprint recorded by the delta.
+static int readCheckpointFile(FluidSolver* solver, const string& name, const std::map<string, PbClass*>& byKey, std::set<string>& restored,
+	int depth, const string& delta="", uint64_t fingerprint=0)
+{
+	CkpReader r(name);
+	string info, base;
+	uint64_t baseFingerprint;
+	r.header(info, base, baseFingerprint);
+	debMsg("Loading checkpoint '" << name << "', written by " << info, 2);
+	if(!delta.empty() && r.fingerprint() != fingerprint)
+		errMsg("loadCheckpoint: base checkpoint " << name << " was rewritten after the delta " << delta << " was saved");
+	if(!base.empty()) {
+		if(depth >= CKP_MAX_CHAIN) errMsg("loadCheckpoint: chain of delta checkpoints too long, or cyclic, at " << name);
+		readCheckpointFile(solver, ckpBasePathOf(base, name), byKey, restored, depth+1, name, baseFingerprint);
+		r.setHasBase(true);
+	}
+
+	int numLoaded = 0;
+	std::map<std::string, RandomStream*>& streams = RandomStream::persistentStreams();
+	for(int tag=r.value<int>(); tag!=CkpEnd; tag=r.value<int>()) {
+		const string key = r.str();
+		const uint64_t length = r.value<uint64_t>();
+
+		if(tag == CkpSolver) {
+			const Vec3i gridSize = r.value<Vec3i>();
+			const int dim = r.value<int>();
+			if(gridSize != solver->getGridSize() || dim != (solver->is3D() ? 3 : 2))
+				errMsg("loadCheckpoint: solver size " << solver->getGridSize() << " doesn't match the checkpoint " << gridSize);
+			solver->mDt           = r.value<Real>();
+			solver->mTimeTotal    = r.value<Real>();
+			solver->mFrame        = r.value<int>();
+			solver->mCflCond      = r.value<Real>();
+			solver->mDtMin        = r.value<Real>();
+			solver->mDtMax        = r.value<Real>();
+			solver->mFrameLength  = r.value<Real>();
+			solver->mTimePerFrame = r.value<Real>();
+			solver->setLockDt(r.value<int>() != 0);
+			continue;
+		}
+		if(tag == CkpRandom) {
+			std::vector<MTRand::uint32> state(r.value<int>());
+			for(size_t i=0; i<state.size(); ++i) state[i] = r.value<uint32_t>();
+			// static streams are only created upon their first use
+			if(streams.count(key)) streams[key]->setState(state);
+			else RandomStream::pendingStates()[key] = state;
+			continue;
+		}
+
+		std::map<string, PbClass*>::const_iterator it = byKey.find(key);
+		if(it == byKey.end()) {
+			debMsg("loadCheckpoint: no object '" << key << "' in the scene, skipping it", 1);
+			r.skip(length);
+			continue;
+		}
+		PbClass* obj = it->second;
+		restored.insert(key);
+
+		if(tag == CkpGrid && dynamic_cast<GridBase*>(obj)) {
+			GridBase* grid = dynamic_cast<GridBase*>(obj);
+			if(grid->getType() & GridBase::TypeReal)      readGridData(r, (Grid<Real>*)grid);
+			else if(grid->getType() & GridBase::TypeInt)  readGridData(r, (Grid<int>*)grid);
+			else if(grid->getType() & GridBase::TypeVec3) readGridData(r, (Grid<Vec3>*)grid);
+			else if(grid->getType() & GridBase::TypeHalf) readGridData(r, (Grid<half>*)grid);
+			else errMsg("loadCheckpoint: unknown grid type of '" << grid->getName() << "'");
+		} else if(tag == CkpGrid4d && dynamic_cast<Grid4dBase*>(obj)) {
+			Grid4dBase* grid = dynamic_cast<Grid4dBase*>(obj);
+			if(grid->getType() & Grid4dBase::TypeReal)      readGrid4dData(r, (Grid4d<Real>*)grid);
+			else if(grid->getType() & Grid4dBase::TypeInt)  readGrid4dData(r, (Grid4d<int>*)grid);
+			else if(grid->getType() & Grid4dBase::TypeVec3) readGrid4dData(r, (Grid4d<Vec3>*)grid);
+			else if(grid->getType() & Grid4dBase::TypeVec4) readGrid4dData(r, (Grid4d<Vec4>*)grid);
+		} else if(tag == CkpPdata && dynamic_cast<ParticleDataBase*>(obj)) {
+			ParticleDataBase* pdata = dynamic_cast<ParticleDataBase*>(obj);
+			if(pdata->getType() == ParticleDataBase::TypeReal)      readPdataData(r, (ParticleDataImpl<Real>*)pdata);
+			else if(pdata->getType() == ParticleDataBase::TypeInt)  readPdataData(r, (ParticleDataImpl<int>*)pdata);
+			else if(pdata->getType() == ParticleDataBase::TypeVec3) readPdataData(r, (ParticleDataImpl<Vec3>*)pdata);
+		} else if(tag == CkpNoise && dynamic_cast<WaveletNoiseField*>(obj)) {
+			WaveletNoiseField* noise = dynamic_cast<WaveletNoiseField*>(obj);
+			noise->mPosOffset = r.value<Vec3>();
+			noise->mPosScale  = r.value<Vec3>();
+			noise->mValOffset = r.value<Real>();
+			noise->mValScale  = r.value<Real>();
+			noise->mClamp     = r.value<int>() != 0;
+			noise->mClampNeg  = r.value<Real>();
+			noise->mClampPos  = r.value<Real>();
+			noise->mTimeAnim  = r.value<Real>();
+		} else if(tag == CkpParticles && dynamic_cast<ParticleBase*>(obj)) {
+			ParticleBase* parts = dynamic_cast<ParticleBase*>(obj);
+			if(BasicParticleSystem* p = dynamic_cast<BasicParticleSystem*>(parts))            readParticleData(r, p);
+			else if(ParticleIndexSystem* p = dynamic_cast<ParticleIndexSystem*>(parts))       readParticleData(r, p);
+			else if(VortexParticleSystem* p = dynamic_cast<VortexParticleSystem*>(parts))     readParticleData(r, p);
+			else if(TurbulenceParticleSystem* p = dynamic_cast<TurbulenceParticleSystem*>(parts)) readParticleData(r, p);
+		} else {
+			errMsg("loadCheckpoint: object '" << key << "' has a different type than in the checkpoint");
+		}
+		numLoaded++;
+	}
+	return numLoaded;
+}
+
+//! Restore a checkpoint written by saveCheckpoint. The scene has to create the same objects as
+//! before (matched by their python names), afterwards the simulation continues bit-exactly.
+//! The bases of delta checkpoints are resolved and loaded automatically.
+PYTHON() int loadCheckpoint(FluidSolver* solver, const std::string& name) {
+	assertMsg(solver, "loadCheckpoint: no solver given");
+	std::vector<PbClass*> objects;
+	std::vector<string> keys;
+	collectCheckpointObjects(solver, objects, keys);
+	std::map<string, PbClass*> byKey;
+	for(size_t i=0; i<objects.size(); ++i) byKey[keys[i]] = objects[i];
+
+	std::set<string> restored;
+	const int numLoaded = readCheckpointFile(solver, name, byKey, restored, 0);
+	for(std::map<string, PbClass*>::iterator it=byKey.begin(); it!=byKey.end(); ++it) {
+		if(!restored.count(it->first))
+			debMsg("loadCheckpoint: object '" << it->first << "' is not part of the checkpoint, keeping its state", 1);
+	}
+
+	debMsg("Loaded checkpoint '" << name << "' of frame " << solver->mFrame << ", " << numLoaded << " objects", 1);
+	return 1;
+}
+
+#else
+
+PYTHON() int saveCheckpoint(FluidSolver* solver, const std::string& name, int compression=1, const std::string& base="") {
+	debMsg("file format not supported without zlib", 1);
+	return 0;
+}
+PYTHON() int loadCheckpoint(FluidSolver* solver, const std::string& name) {
+	debMsg("file format not supported without zlib", 1);
+	return 0;
+}
+
+#endif // NO_ZLIB!=1
+
+} // namespace
@@ -791,6 +791,91 @@ void readGrid4dUniCleanup(void** fileHandle) {
 	}
 }
 
+#if NO_ZLIB!=1
+//! open 4d uni file for reading single slices
+struct Uni4dSliceFile {
+	gzFile gzf;
+	z_off_t dataStart, pos;
+	Vec4i size;
+};
+#endif
+
+//! number of Real components per element, int elements are stored as they are
+template<class T> static int uniComponents() { return sizeof(T)/sizeof(Real); }
+template<> int uniComponents<int>() { return 0; }
+
+template<class T>
+int readGrid4dUniSlice(const string& name, int t, T* data, Vec4i& size, void** fileHandle)
+{
+#	if NO_ZLIB!=1
+	assertMsg(fileHandle, "readGrid4dUniSlice: needs a file handle");
+	Uni4dSliceFile* file = (Uni4dSliceFile*)(*fileHandle);
+	const int comps = uniComponents<T>();
+	const int bytesOnDisk = comps ? (int)sizeof(float)*comps : (int)sizeof(int);
+	if(!file) {
+		gzFile gzf = (gzFile) safeGzopen(name.c_str(), "rb");
+		if (!gzf) errMsg("readGrid4dUniSlice: can't open file "<<name);
+		char ID[5]={0,0,0,0,0};
+		gzread(gzf, ID, 4);
+		UniHeader head;
+		z_off_t headerSize = 0;
+		if(!strcmp(ID, "M4T3")) {
+			headerSize = sizeof(UniHeader);
+			assertMsg (gzread(gzf, &head, sizeof(UniHeader)) == sizeof(UniHeader), "can't read file, no 4d header present");
+		} else if(!strcmp(ID, "M4T2")) {
+			UniLegacyHeader3 lhead;
+			headerSize = sizeof(UniLegacyHeader3) + sizeof(int);
+			assertMsg (gzread(gzf, &lhead, sizeof(UniLegacyHeader3)) == sizeof(UniLegacyHeader3), "can't read file, no 4dl header present");
+			head.dimX = lhead.dimX; head.dimY = lhead.dimY; head.dimZ = lhead.dimZ;
+			head.bytesPerElement = lhead.bytesPerElement;
+			gzread(gzf, &head.dimT, sizeof(int));
+		} else {
+			gzclose(gzf);
+			errMsg("readGrid4dUniSlice: "<<name<<" is not a 4d uni file");
+		}
+		if(head.bytesPerElement != bytesOnDisk) {
+			gzclose(gzf);
+			errMsg("readGrid4dUniSlice: 4d grid element size doesn't match "<< head.bytesPerElement <<" vs "<< bytesOnDisk);
+		}
+		file = new Uni4dSliceFile;
+		file->gzf = gzf;
+		file->dataStart = file->pos = 4 + headerSize;
+		file->size = Vec4i(head.dimX, head.dimY, head.dimZ, head.dimT);
+		*fileHandle = file;
+	}
+	size = file->size;
+	if(!data) return 1;
+
+	assertMsg(t>=0 && t<size.t, "readGrid4dUniSlice: slice "<<t<<" out of range "<<size.t);
+	const IndexInt cells = (IndexInt)size.x*size.y*size.z;
+	const z_off_t start = file->dataStart + (z_off_t)t * cells * bytesOnDisk;
+	if(file->pos != start) gzseek(file->gzf, start, SEEK_SET);
+	file->pos = start + cells * bytesOnDisk;
+	if(sizeof(float)==sizeof(Real) || !comps) {
+		assertMsg(gzread(file->gzf, data, cells*bytesOnDisk) == cells*bytesOnDisk, "readGrid4dUniSlice: can't read slice "<<t<<" of "<<name);
+	} else {
+		std::vector<float> buf(cells*comps);
+		assertMsg(gzread(file->gzf, &buf[0], cells*bytesOnDisk) == cells*bytesOnDisk, "readGrid4dUniSlice: can't read slice "<<t<<" of "<<name);
+		Real* out = (Real*)data;
+		for(IndexInt i=0; i<cells*comps; ++i) out[i] = (Real)buf[i];
+	}
+	return 1;
+#	else
+	debMsg( "file format not supported without zlib" ,1);
+	return 0;
+#	endif
+}
+void readGrid4dUniSliceCleanup(void** fileHandle) {
+#	if NO_ZLIB!=1
+	if(fileHandle && *fileHandle) {
+		Uni4dSliceFile* file = (Uni4dSliceFile*)(*fileHandle);
+		gzclose(file->gzf);
+		delete file;
+		*fileHandle = NULL;
+	}
+#	endif
+}
+
 template<class T>
 int writeGrid4dRaw(const string& name, Grid4d<T>* grid) {
 	debMsg( "writing grid4d " << grid->getName() << " to raw file " << name ,1);
@@ -993,10 +1078,63 @@ KERNEL(idx) void knQuantizeVec3(Grid<Vec3>& grid, Real step) {
 } 
 PYTHON() void quantizeGridVec3(Grid<Vec3>& grid, Real step) { knQuantizeVec3(grid,step); }
 
+//*****************************************************************************
+// half grids are converted to real grids for uni, vol and npz files, such that the files are
+// compatible with real grids and external tools; raw files contain the 16 bit values
+
+static void halfToRealGrid(const Grid<half>& from, Grid<Real>& to) {
+	to.setName(from.getName());
+	FOR_IDX(from) to[idx] = from[idx];
+}
+static void realToHalfGrid(const Grid<Real>& from, Grid<half>& to) {
+	FOR_IDX(from) to[idx] = half(from[idx]);
+}
+
+template <>
+int writeGridUni<half>(const string& name, Grid<half>* grid) {
+	Grid<Real> temp(grid->getParent());
+	halfToRealGrid(*grid, temp);
+	return writeGridUni(name, &temp);
+}
+template <>
+int readGridUni<half>(const string& name, Grid<half>* grid) {
+	Grid<Real> temp(grid->getParent());
+	const int ret = readGridUni(name, &temp);
+	realToHalfGrid(temp, *grid);
+	return ret;
+}
+template <>
+int writeGridVol<half>(const string& name, Grid<half>* grid) {
+	Grid<Real> temp(grid->getParent());
+	halfToRealGrid(*grid, temp);
+	return writeGridVol(name, &temp);
+}
+template <>
+int readGridVol<half>(const string& name, Grid<half>* grid) {
+	Grid<Real> temp(grid->getParent());
+	const int ret = readGridVol(name, &temp);
+	realToHalfGrid(temp, *grid);
+	return ret;
+}
+template <>
+int writeGridNumpy<half>(const string& name, Grid<half>* grid) {
+	Grid<Real> temp(grid->getParent());
+	halfToRealGrid(*grid, temp);
+	return writeGridNumpy(name, &temp);
+}
+template <>
+int readGridNumpy<half>(const string& name, Grid<half>* grid) {
+	Grid<Real> temp(grid->getParent());
+	const int ret = readGridNumpy(name, &temp);
+	realToHalfGrid(temp, *grid);
+	return ret;
+}
+
 // explicit instantiation
 template int writeGridRaw<int> (const string& name, Grid<int>*  grid);
 template int writeGridRaw<Real>(const string& name, Grid<Real>* grid);
 template int writeGridRaw<Vec3>(const string& name, Grid<Vec3>* grid);
+template int writeGridRaw<half>(const string& name, Grid<half>* grid);
 template int writeGridUni<int> (const string& name, Grid<int>*  grid);
 template int writeGridUni<Real>(const string& name, Grid<Real>* grid);
 template int writeGridUni<Vec3>(const string& name, Grid<Vec3>* grid);
@@ -1005,10 +1143,12 @@ template int writeGridVol<Vec3>(const string& name, Grid<Vec3>* grid);
 template int writeGridTxt<int> (const string& name, Grid<int>*  grid);
 template int writeGridTxt<Real>(const string& name, Grid<Real>* grid);
 template int writeGridTxt<Vec3>(const string& name, Grid<Vec3>* grid);
+template int writeGridTxt<half>(const string& name, Grid<half>* grid);
 
 template int readGridRaw<int>  (const string& name, Grid<int>*  grid);
 template int readGridRaw<Real> (const string& name, Grid<Real>* grid);
 template int readGridRaw<Vec3> (const string& name, Grid<Vec3>* grid);
+template int readGridRaw<half> (const string& name, Grid<half>* grid);
 template int readGridUni<int>  (const string& name, Grid<int>*  grid);
 template int readGridUni<Real> (const string& name, Grid<Real>* grid);
 template int readGridUni<Vec3> (const string& name, Grid<Vec3>* grid);
@@ -1019,6 +1159,10 @@ template int readGrid4dUni<int>  (const string& name, Grid4d<int>*  grid, int re
 template int readGrid4dUni<Real> (const string& name, Grid4d<Real>* grid, int readTslice, Grid4d<Real>* slice, void** fileHandle);
 template int readGrid4dUni<Vec3> (const string& name, Grid4d<Vec3>* grid, int readTslice, Grid4d<Vec3>* slice, void** fileHandle);
 template int readGrid4dUni<Vec4> (const string& name, Grid4d<Vec4>* grid, int readTslice, Grid4d<Vec4>* slice, void** fileHandle);
+template int readGrid4dUniSlice<int> (const string& name, int t, int*  data, Vec4i& size, void** fileHandle);
+template int readGrid4dUniSlice<Real>(const string& name, int t, Real* data, Vec4i& size, void** fileHandle);
+template int readGrid4dUniSlice<Vec3>(const string& name, int t, Vec3* data, Vec4i& size, void** fileHandle);
+template int readGrid4dUniSlice<Vec4>(const string& name, int t, Vec4* data, Vec4i& size, void** fileHandle);
 template int writeGrid4dUni<int> (const string& name, Grid4d<int>*  grid);
 template int writeGrid4dUni<Real>(const string& name, Grid4d<Real>* grid);
 template int writeGrid4dUni<Vec3>(const string& name, Grid4d<Vec3>* grid);
@@ -0,0 +1,342 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2018 Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Sharded containers for training data
+ *
+ ******************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+
+#include "ioshards.h"
+#include "grid.h"
+#include "grid4d.h"
+#include "mantaio.h"
+
+using namespace std;
+
+namespace Manta {
+
+//! shard layout: magic and version, record payloads (each aligned to SHARD_ALIGN bytes), the index
+//! (number of records, then per record name, frame, types, dimensions, offset and byte length),
+//! and finally the file offset of the index followed by SHARD_INDEX_MAGIC
+static const char SHARD_MAGIC[9] = "MANTASHD";
+static const char SHARD_INDEX_MAGIC[9] = "SHARDIDX";
+static const int SHARD_VERSION = 1;
+static const size_t SHARD_ALIGN = 64;
+
+//! element types as in uni files (0 int, 1 float, 2 vec3), plus 3 for vec4;
+//! like uni files, shards always store single precision values
+template<class T> struct ShardElem {};
+template<> struct ShardElem<int>  { static const int type = 0; static const int comps = 1; };
+template<> struct ShardElem<Real> { static const int type = 1; static const int comps = 1; };
+template<> struct ShardElem<Vec3> { static const int type = 2; static const int comps = 3; };
+template<> struct ShardElem<Vec4> { static const int type = 3; static const int comps = 4; };
+template<> struct ShardElem<half> { static const int type = 1; static const int comps = 1; };
+
+template<class T> static void shardPack(const T* src, IndexInt n, char* dst) {
+	float* out = (float*)dst;
+	const Real* in = (const Real*)src;
+	for(IndexInt i=0; i<n*ShardElem<T>::comps; ++i) out[i] = (float)in[i];
+}
+template<> void shardPack<int>(const int* src, IndexInt n, char* dst) {
+	memcpy(dst, src, sizeof(int)*n);
+}
+template<> void shardPack<half>(const half* src, IndexInt n, char* dst) {
+	float* out = (float*)dst;
+	for(IndexInt i=0; i<n; ++i) out[i] = (float)src[i];
+}
+template<class T> static void shardUnpack(const char* src, IndexInt n, T* dst) {
+	const float* in = (const float*)src;
+	Real* out = (Real*)dst;
+	for(IndexInt i=0; i<n*ShardElem<T>::comps; ++i) out[i] = (Real)in[i];
+}
+template<> void shardUnpack<int>(const char* src, IndexInt n, int* dst) {
+	memcpy(dst, src, sizeof(int)*n);
+}
+template<> void shardUnpack<half>(const char* src, IndexInt n, half* dst) {
+	const float* in = (const float*)src;
+	for(IndexInt i=0; i<n; ++i) dst[i] = half(in[i]);
+}
+template<class T> static int shardElemBytes() { return ShardElem<T>::type==0 ? (int)sizeof(int) : (int)sizeof(float)*ShardElem<T>::comps; }
+
+//! raw data of a grid, with its size (t=1 for 3d grids) and type info;
+//! half grids are stored as float elements (type 1), halfData marks the in-memory layout
+struct ShardGridData {
+	ShardGridData() : data(NULL), size(0,0,0,0), elementType(-1), bytesPerElement(0), gridType(0), halfData(false) {}
+	void* data;
+	Vec4i size;
+	int elementType, bytesPerElement, gridType;
+	bool halfData;
+	IndexInt cells() const { return (IndexInt)size.x*size.y*size.z*size.t; }
+};
+
+template<class T> static bool shardCastGrid(PbClass* obj, ShardGridData& info) {
+	if(Grid<T>* grid = dynamic_cast<Grid<T>*>(obj)) {
+		info.data = &(*grid)[0];
+		info.size = Vec4i(grid->getSizeX(), grid->getSizeY(), grid->getSizeZ(), 1);
+		info.gridType = grid->getType();
+	} else if(Grid4d<T>* grid = dynamic_cast<Grid4d<T>*>(obj)) {
+		info.data = &(*grid)[0];
+		info.size = grid->getSize();
+		info.gridType = grid->getType();
+	} else {
+		return false;
+	}
+	info.elementType = ShardElem<T>::type;
+	info.bytesPerElement = shardElemBytes<T>();
+	return true;
+}
+template<> bool shardCastGrid<half>(PbClass* obj, ShardGridData& info) {
+	Grid<half>* grid = dynamic_cast<Grid<half>*>(obj);
+	if(!grid) return false;
+	info.data = &(*grid)[0];
+	info.size = Vec4i(grid->getSizeX(), grid->getSizeY(), grid->getSizeZ(), 1);
+	info.gridType = grid->getType();
+	info.elementType = ShardElem<half>::type;
+	info.bytesPerElement = shardElemBytes<half>();
+	info.halfData = true;
+	return true;
+}
+
+static ShardGridData shardGridData(PbClass* obj) {
+	ShardGridData info;
+	if(!obj || !(shardCastGrid<int>(obj, info) || shardCastGrid<Real>(obj, info) || shardCastGrid<Vec3>(obj, info) || shardCastGrid<Vec4>(obj, info) || shardCastGrid<half>(obj, info)))
+		errMsg("shards: only int, Real, Vec3 and Vec4 grids (3d or 4d) and half grids are supported");
+	return info;
+}
+
+static void shardPackGrid(const ShardGridData& info, char* dst) {
+	switch(info.elementType) {
+		case 0: shardPack((const int*) info.data, info.cells(), dst); break;
+		case 1: if(info.halfData) shardPack((const half*)info.data, info.cells(), dst);
+		        else              shardPack((const Real*)info.data, info.cells(), dst); break;
+		case 2: shardPack((const Vec3*)info.data, info.cells(), dst); break;
+		case 3: shardPack((const Vec4*)info.data, info.cells(), dst); break;
+	}
+}
+
+static void shardUnpackGrid(const char* src, ShardGridData& info) {
+	switch(info.elementType) {
+		case 0: shardUnpack(src, info.cells(), (int*) info.data); break;
+		case 1: if(info.halfData) shardUnpack(src, info.cells(), (half*)info.data);
+		        else              shardUnpack(src, info.cells(), (Real*)info.data); break;
+		case 2: shardUnpack(src, info.cells(), (Vec3*)info.data); break;
+		case 3: shardUnpack(src, info.cells(), (Vec4*)info.data); break;
+	}
+}
+
+static string shardFileName(const string& name, int shard) {
+	char buf[16];
+	snprintf(buf, 16, "_%04d.shard", shard);
+	return name + buf;
+}
+
+template<class T> static void shardPut(std::vector<char>& buf, const T& val) {
+	const char* p = (const char*)&val;
+	buf.insert(buf.end(), p, p+sizeof(T));
+}
+
+template<class T> static T shardGet(const std::vector<char>& buf, size_t& pos) {
+	if(pos+sizeof(T) > buf.size()) errMsg("shards: corrupt index");
+	T val;
+	memcpy(&val, &buf[pos], sizeof(T));
+	pos += sizeof(T);
+	return val;
+}
+
+
+//*****************************************************************************
+// writer
+
+ShardWriter::ShardWriter(FluidSolver* parent, const string& name, int shardSize, int bufferSize)
+	: PbClass(parent), mName(name), mShardSize((uint64_t)max(shardSize,1)<<20), mBufferSize((uint64_t)max(bufferSize,1)<<20),
+	  mFile(NULL), mShard(0), mNumRecords(0), mShardBytes(0)
+{
+}
+
+ShardWriter::~ShardWriter() {
+	// destructors mustn't throw, write errors are only reported by close()
+	try {
+		flush();
+	} catch(const Error& e) {
+		debMsg("ShardWriter: shard " << shardFileName(mName, mShard) << " is incomplete, " << e.what(), 1);
+	}
+	if(mFile) fclose(mFile);
+}
+
+void ShardWriter::openShard() {
+	const string file = shardFileName(mName, mShard);
+	mFile = fopen(file.c_str(), "wb");
+	if(!mFile) errMsg("ShardWriter: can't open file " << file);
+	mBuffer.clear();
+	mBuffer.reserve(mBufferSize + SHARD_ALIGN);
+	mBuffer.insert(mBuffer.end(), SHARD_MAGIC, SHARD_MAGIC+8);
+	shardPut(mBuffer, (int32_t)SHARD_VERSION);
+	mShardBytes = mBuffer.size();
+	mIndex.clear();
+}
+
+void ShardWriter::writeBuffer() {
+	if(!mFile || mBuffer.empty()) return;
+	if(fwrite(&mBuffer[0], 1, mBuffer.size(), mFile) != mBuffer.size())
+		errMsg("ShardWriter: failed to write shard " << shardFileName(mName, mShard));
+	mBuffer.clear();
+}
+
+void ShardWriter::add(std::vector<PbClass*>& grids, int frame) {
+	for(size_t i=0; i<grids.size(); ++i) addGrid(grids[i], (frame<0) ? getParent()->mFrame : frame);
+}
+
+void ShardWriter::addGrid(PbClass* grid, int frame) {
+	ShardGridData info = shardGridData(grid);
+	if(!mFile) openShard();
+
+	ShardRecord rec;
+	rec.name = grid->getName();
+	rec.frame = frame;
+	rec.gridType = info.gridType;
+	rec.elementType = info.elementType;
+	rec.bytesPerElement = info.bytesPerElement;
+	rec.dimX = info.size.x; rec.dimY = info.size.y; rec.dimZ = info.size.z; rec.dimT = info.size.t;
+	rec.shard = mShard;
+	rec.bytes = (uint64_t)info.cells() * info.bytesPerElement;
+
+	const size_t pad = (SHARD_ALIGN - mShardBytes % SHARD_ALIGN) % SHARD_ALIGN;
+	mBuffer.insert(mBuffer.end(), pad, 0);
+	rec.offset = mShardBytes + pad;
+	const size_t start = mBuffer.size();
+	mBuffer.resize(start + rec.bytes);
+	shardPackGrid(info, &mBuffer[start]);
+	mShardBytes = rec.offset + rec.bytes;
+	mIndex.push_back(rec);
+	mNumRecords++;
+
+	if(mBuffer.size() >= mBufferSize) writeBuffer();
+	if(mShardBytes >= mShardSize) flush();
+}
+
+void ShardWriter::flush() {
+	if(!mFile) return;
+	const uint64_t indexOffset = mShardBytes;
+	shardPut(mBuffer, (uint32_t)mIndex.size());
+	for(size_t r=0; r<mIndex.size(); ++r) {
+		const ShardRecord& rec = mIndex[r];
+		shardPut(mBuffer, (uint32_t)rec.name.size());
+		mBuffer.insert(mBuffer.end(), rec.name.begin(), rec.name.end());
+		const int32_t ints[8] = { rec.frame, rec.gridType, rec.elementType, rec.bytesPerElement, rec.dimX, rec.dimY, rec.dimZ, rec.dimT };
+		for(int i=0; i<8; ++i) shardPut(mBuffer, ints[i]);
+		shardPut(mBuffer, rec.offset);
+		shardPut(mBuffer, rec.bytes);
+	}
+	shardPut(mBuffer, indexOffset);
+	mBuffer.insert(mBuffer.end(), SHARD_INDEX_MAGIC, SHARD_INDEX_MAGIC+8);
+	writeBuffer();
+	const bool closed = fclose(mFile) == 0;
+	mFile = NULL;
+	if(!closed) errMsg("ShardWriter: failed to close shard " << shardFileName(mName, mShard));
+	debMsg("ShardWriter: wrote " << mIndex.size() << " records to " << shardFileName(mName, mShard), 2);
+	mIndex.clear();
+	mShard++;
+}
+
+
+//*****************************************************************************
+// reader
+
+ShardReader::ShardReader(FluidSolver* parent, const string& name)
+	: PbClass(parent), mName(name)
+{
+	for(int shard=0; ; ++shard) {
+		const string file = shardFileName(name, shard);
+		FILE* fp = fopen(file.c_str(), "rb");
+		if(!fp) break;
+		mFiles.push_back(fp);
+
+		char magic[8];
+		int32_t version = 0;
+		if(fread(magic, 1, 8, fp)!=8 || memcmp(magic, SHARD_MAGIC, 8)!=0 || fread(&version, sizeof(version), 1, fp)!=1)
+			errMsg("ShardReader: " << file << " is not a shard file");
+		if(version>SHARD_VERSION) errMsg("ShardReader: unsupported shard version " << version << " in " << file);
+
+		// index offset and magic at the end, missing if the writer wasn't closed
+		uint64_t indexOffset = 0;
+		if(fileSeek(fp, -16, SEEK_END)!=0 || fread(&indexOffset, sizeof(indexOffset), 1, fp)!=1 || fread(magic, 1, 8, fp)!=8 || memcmp(magic, SHARD_INDEX_MAGIC, 8)!=0)
+			errMsg("ShardReader: " << file << " has no index, was the ShardWriter closed?");
+		const FileOffset indexEnd = fileTell(fp) - 16;
+		if(indexEnd < 0 || (uint64_t)indexEnd < indexOffset) errMsg("ShardReader: corrupt index offset in " << file);
+		std::vector<char> buf((size_t)(indexEnd - (FileOffset)indexOffset));
+		if(fileSeek(fp, (FileOffset)indexOffset, SEEK_SET)!=0 || (buf.size() && fread(&buf[0], 1, buf.size(), fp)!=buf.size()))
+			errMsg("ShardReader: can't read index of " << file);
+
+		size_t pos = 0;
+		const uint32_t num = shardGet<uint32_t>(buf, pos);
+		for(uint32_t r=0; r<num; ++r) {
+			ShardRecord rec;
+			const uint32_t len = shardGet<uint32_t>(buf, pos);
+			if(pos+len > buf.size()) errMsg("ShardReader: corrupt index in " << file);
+			rec.name.assign(&buf[pos], len);
+			pos += len;
+			rec.frame = shardGet<int32_t>(buf, pos);
+			rec.gridType = shardGet<int32_t>(buf, pos);
+			rec.elementType = shardGet<int32_t>(buf, pos);
+			rec.bytesPerElement = shardGet<int32_t>(buf, pos);
+			rec.dimX = shardGet<int32_t>(buf, pos);
+			rec.dimY = shardGet<int32_t>(buf, pos);
+			rec.dimZ = shardGet<int32_t>(buf, pos);
+			rec.dimT = shardGet<int32_t>(buf, pos);
+			rec.offset = shardGet<uint64_t>(buf, pos);
+			rec.bytes = shardGet<uint64_t>(buf, pos);
+			rec.shard = shard;
+			mLookup[std::make_pair(rec.name, rec.frame)] = (int)mIndex.size();
+			mIndex.push_back(rec);
+		}
+	}
+	if(mFiles.empty()) errMsg("ShardReader: no shards found for " << name);
+	debMsg("ShardReader: " << mIndex.size() << " records in " << mFiles.size() << " shards", 1);
+}
+
+ShardReader::~ShardReader() {
+	for(size_t i=0; i<mFiles.size(); ++i) fclose(mFiles[i]);
+}
+
+const ShardRecord& ShardReader::entry(int record) const {
+	if(record<0 || record>=(int)mIndex.size()) errMsg("ShardReader: invalid record " << record);
+	return mIndex[record];
+}
+
+int ShardReader::find(const string& name, int frame) const {
+	std::map<std::pair<string,int>, int>::const_iterator it = mLookup.find(std::make_pair(name, frame));
+	return (it==mLookup.end()) ? -1 : it->second;
+}
+
+void ShardReader::loadRecord(PbClass* grid, int record) {
+	const ShardRecord& rec = entry(record);
+	ShardGridData info = shardGridData(grid);
+	if(info.elementType!=rec.elementType || info.bytesPerElement!=rec.bytesPerElement)
+		errMsg("ShardReader: type of record " << rec.name << " (frame " << rec.frame << ") doesn't match grid " << grid->getName());
+	if(info.size!=Vec4i(rec.dimX, rec.dimY, rec.dimZ, rec.dimT))
+		errMsg("ShardReader: size of record " << rec.name << " (frame " << rec.frame << ") doesn't match grid " << grid->getName());
+
+	FILE* fp = mFiles[rec.shard];
+	mBuffer.resize(rec.bytes);
+	if(fileSeek(fp, (FileOffset)rec.offset, SEEK_SET)!=0 || (rec.bytes && fread(&mBuffer[0], 1, rec.bytes, fp)!=rec.bytes))
+		errMsg("ShardReader: can't read record " << rec.name << " from " << shardFileName(mName, rec.shard));
+	shardUnpackGrid(mBuffer.empty() ? NULL : &mBuffer[0], info);
+}
+
+void ShardReader::load(std::vector<PbClass*>& grids, int frame) {
+	for(size_t i=0; i<grids.size(); ++i) {
+		const int record = find(grids[i]->getName(), frame);
+		if(record<0) errMsg("ShardReader: no record " << grids[i]->getName() << " for frame " << frame);
+		loadRecord(grids[i], record);
+	}
+}
+
+} //namespace
@@ -0,0 +1,99 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2018 Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Sharded containers for training data: many grids and frames are appended
+ * to a few large files with an index, instead of one small file per grid
+ *
+ ******************************************************************************/
+
+#ifndef _IOSHARDS_H
+#define _IOSHARDS_H
+
+#include <cstdio>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "manta.h"
+
+namespace Manta {
+
+//! index entry of a record in a shard, element and grid types follow the uni file header
+struct ShardRecord {
+	ShardRecord() : frame(0), gridType(0), elementType(0), bytesPerElement(0), dimX(0), dimY(0), dimZ(0), dimT(0), shard(0), offset(0), bytes(0) {}
+	std::string name;
+	int frame;
+	int gridType, elementType, bytesPerElement;
+	int dimX, dimY, dimZ, dimT;
+	int shard;
+	uint64_t offset, bytes;
+};
+
+//! appends grids (Grid or Grid4d) to shard files <name>_0000.shard, <name>_0001.shard, ...
+//! records are collected in a write buffer and written sequentially in large chunks,
+//! a new shard is started once the current one exceeds shardSize MB
+PYTHON() class ShardWriter : public PbClass {
+public:
+	PYTHON() ShardWriter(FluidSolver* parent, const std::string& name, int shardSize=1024, int bufferSize=64);
+	virtual ~ShardWriter();
+
+	//! append grids as records named like the grids, frame defaults to the current solver frame
+	PYTHON() void add(std::vector<PbClass*>& grids, int frame=-1);
+	//! write pending data and the index of the current shard, and close it
+	PYTHON() void flush();
+	//! finish writing, further records start a new shard. Reports write errors, the destructor only logs them
+	PYTHON() void close() { flush(); }
+
+	PYTHON() int getNumRecords() const { return mNumRecords; }
+	PYTHON() int getNumShards() const { return mShard + (mFile ? 1 : 0); }
+
+protected:
+	void addGrid(PbClass* grid, int frame);
+	void openShard();
+	void writeBuffer();
+
+	std::string mName;
+	uint64_t mShardSize, mBufferSize;
+	FILE* mFile;
+	int mShard, mNumRecords;
+	uint64_t mShardBytes;
+	std::vector<char> mBuffer;
+	std::vector<ShardRecord> mIndex;
+};
+
+//! random access to the records of all shards <name>_XXXX.shard, using their indices
+PYTHON() class ShardReader : public PbClass {
+public:
+	PYTHON() ShardReader(FluidSolver* parent, const std::string& name);
+	virtual ~ShardReader();
+
+	PYTHON() int getNumRecords() const { return (int)mIndex.size(); }
+	PYTHON() int getNumShards() const { return (int)mFiles.size(); }
+	PYTHON() std::string getRecordName(int record) const { return entry(record).name; }
+	PYTHON() int getRecordFrame(int record) const { return entry(record).frame; }
+	//! record of a grid name and frame, -1 if there is none
+	PYTHON() int find(const std::string& name, int frame) const;
+	//! load the records of a frame into grids of matching name, type and size
+	PYTHON() void load(std::vector<PbClass*>& grids, int frame);
+
+protected:
+	const ShardRecord& entry(int record) const;
+	void loadRecord(PbClass* grid, int record);
+
+	std::string mName;
+	std::vector<FILE*> mFiles;
+	std::vector<ShardRecord> mIndex;
+	std::map<std::pair<std::string,int>, int> mLookup;
+	std::vector<char> mBuffer;
+};
+
+} // namespace
+
+#endif
@@ -73,6 +73,11 @@ void convertFrom(float& in, Real* out) {
 	(*out) = (Real) in;
 }
 
+template<>
+void convertFrom(float& in, half* out) {
+	(*out) = half(in);
+}
+
 template<>
 void convertFrom(openvdb::Vec3s& in, Vec3* out) {
 	(*out).x = in.x();
@@ -96,6 +101,11 @@ void convertTo(float* out, Real& in) {
 	(*out) = (float) in;
 }
 
+template<>
+void convertTo(float* out, half& in) {
+	(*out) = (float) in;
+}
+
 template<>
 void convertTo(openvdb::Vec3s* out, Vec3& in) {
 	(*out).x() = in.x;
@@ -270,6 +270,7 @@ int writeObjectsVDB(const string& filename, std::vector<PbClass*>* objects, floa
 	for (std::vector<PbClass*>::iterator iter = objects->begin(); iter != objects->end(); ++iter) {
 		openvdb::GridClass gClass = openvdb::GRID_UNKNOWN;
 		openvdb::GridBase::Ptr vdbGrid;
+		bool saveAsHalf = precisionHalf;
 
 		PbClass* object = dynamic_cast<PbClass*>(*iter);
 		const Real dx = object->getParent()->getDx();
@@ -291,6 +292,14 @@ int writeObjectsVDB(const string& filename, std::vector<PbClass*>* objects, floa
 				vdbGrid = exportVDB<Real, openvdb::FloatGrid>(mantaRealGrid);
 				gridsVDB.push_back(vdbGrid);
 			}
+			else if (mantaGrid->getType() & GridBase::TypeHalf) {
+				debMsg("Writing half grid '" << mantaGrid->getName() << "' to vdb file " << filename, 1);
+				gClass = openvdb::GRID_FOG_VOLUME;
+				saveAsHalf = true; // no precision is lost
+				Grid<half>* mantaHalfGrid = (Grid<half>*) mantaGrid;
+				vdbGrid = exportVDB<half, openvdb::FloatGrid>(mantaHalfGrid);
+				gridsVDB.push_back(vdbGrid);
+			}
 			else if (mantaGrid->getType() & GridBase::TypeVec3) {
 				debMsg("Writing vec3 grid '" << mantaGrid->getName() << "' to vdb file " << filename, 1);
 				gClass = (mantaGrid->getType() & GridBase::TypeMAC) ? openvdb::GRID_STAGGERED : openvdb::GRID_UNKNOWN;
@@ -323,7 +332,7 @@ int writeObjectsVDB(const string& filename, std::vector<PbClass*>* objects, floa
 
 		// Set additional grid attributes, e.g. name, grid class, compression level, etc.
 		if (vdbGrid) {
-			setGridOptions<openvdb::GridBase>(vdbGrid, objectName, gClass, voxelSize, precisionHalf);
+			setGridOptions<openvdb::GridBase>(vdbGrid, objectName, gClass, voxelSize, saveAsHalf);
 		}
 	}
 
@@ -435,6 +444,12 @@ int readObjectsVDB(const string& filename, std::vector<PbClass*>* objects, float
 					Grid<Real>* mantaRealGrid = (Grid<Real>*) mantaGrid;
 					importVDB<openvdb::FloatGrid, Real>(vdbFloatGrid, mantaRealGrid);
 				}
+				else if (mantaGrid->getType() & GridBase::TypeHalf) {
+					debMsg("Reading into grid '" << mantaGrid->getName() << "' from real grid '" << vdbGrid->getName() << "' in vdb file " << filename, 1);
+					openvdb::FloatGrid::Ptr vdbFloatGrid = openvdb::gridPtrCast<openvdb::FloatGrid>(vdbGrid);
+					Grid<half>* mantaHalfGrid = (Grid<half>*) mantaGrid;
+					importVDB<openvdb::FloatGrid, half>(vdbFloatGrid, mantaHalfGrid);
+				}
 				else if (mantaGrid->getType() & GridBase::TypeVec3) {
 					debMsg("Reading into grid '" << mantaGrid->getName() << "' from vec3 grid '" << vdbGrid->getName() << "' in vdb file " << filename, 1);
 					openvdb::Vec3SGrid::Ptr vdbVec3Grid = openvdb::gridPtrCast<openvdb::Vec3SGrid>(vdbGrid);
@@ -477,10 +492,12 @@ template void importVDB<openvdb::Vec3f, Vec3>(openvdb::Vec3s vdbValue, ParticleD
 void importVDB(openvdb::points::PointDataGrid::Ptr from, BasicParticleSystem *to, std::vector<ParticleDataBase*>& toPData, float voxelSize=1.0);
 template void importVDB<openvdb::Int32Grid, int>(openvdb::Int32Grid::Ptr from, Grid<int> *to);
 template void importVDB<openvdb::FloatGrid, Real>(openvdb::FloatGrid::Ptr from, Grid<Real> *to);
+template void importVDB<openvdb::FloatGrid, half>(openvdb::FloatGrid::Ptr from, Grid<half> *to);
 template void importVDB<openvdb::Vec3SGrid, Vec3>(openvdb::Vec3SGrid::Ptr from, Grid<Vec3> *to);
 
 template openvdb::Int32Grid::Ptr exportVDB<int, openvdb::Int32Grid>(Grid<int> *from);
 template openvdb::FloatGrid::Ptr exportVDB<Real, openvdb::FloatGrid>(Grid<Real> *from);
+template openvdb::FloatGrid::Ptr exportVDB<half, openvdb::FloatGrid>(Grid<half> *from);
 template openvdb::Vec3SGrid::Ptr exportVDB<Vec3, openvdb::Vec3SGrid>(Grid<Vec3> *from);
 
 openvdb::points::PointDataGrid::Ptr exportVDB(BasicParticleSystem *from, std::vector<ParticleDataBase*>& fromPData, bool skipDeletedParts=false, float voxelSize=1.0);
@@ -15,6 +15,10 @@
 #define _FILEIO_H
 
 #include <string>
+#include <cstdio>
+#if !defined(WIN32) && !defined(_WIN32)
+#	include <sys/types.h>
+#endif
 
 #include "manta.h"
 
@@ -25,6 +29,17 @@
 
 namespace Manta {
 
+//! 64 bit file offsets on all platforms
+#if defined(WIN32) || defined(_WIN32)
+typedef __int64 FileOffset;
+inline int fileSeek(FILE* fp, FileOffset pos, int whence) { return _fseeki64(fp, pos, whence); }
+inline FileOffset fileTell(FILE* fp) { return _ftelli64(fp); }
+#else
+typedef off_t FileOffset;
+inline int fileSeek(FILE* fp, FileOffset pos, int whence) { return fseeko(fp, pos, whence); }
+inline FileOffset fileTell(FILE* fp) { return ftello(fp); }
+#endif
+
 // Forward declations
 class Mesh;
 class FlagGrid;
@@ -74,6 +89,9 @@ int readGridsNumpy(const std::string& name, std::vector<PbClass*>* grids);
 template<class T> int writeGrid4dUni(const std::string& name, Grid4d<T>* grid);
 template<class T> int readGrid4dUni (const std::string& name, Grid4d<T>* grid, int readTslice=-1, Grid4d<T>* slice=NULL, void** fileHandle=NULL);
 void readGrid4dUniCleanup(void** fileHandle);
+//! out-of-core reading of time slice t of a 4d uni file, the file stays open in *fileHandle; data=NULL only returns the size
+template<class T> int readGrid4dUniSlice(const std::string& name, int t, T* data, Vec4i& size, void** fileHandle);
+void readGrid4dUniSliceCleanup(void** fileHandle);
 template<class T> int writeGrid4dRaw(const std::string& name, Grid4d<T>* grid);
 template<class T> int readGrid4dRaw (const std::string& name, Grid4d<T>* grid);
 
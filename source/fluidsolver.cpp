@@ -13,6 +13,7 @@
 
 #include "fluidsolver.h"
 #include "grid.h"
+#include "conjugategrad.h"
 #include <sstream>
 #include <fstream>
 
@@ -58,6 +59,9 @@ template<> Real* FluidSolver::getGridPointer<Real>() {
 template<> Vec3* FluidSolver::getGridPointer<Vec3>() {
 	return mGridsVec.get(mGridSize);    
 }
+template<> half* FluidSolver::getGridPointer<half>() {
+	return mGridsHalf.get(mGridSize);    
+}
 template<> Vec4* FluidSolver::getGridPointer<Vec4>() {
 	return mGridsVec4.get(mGridSize);    
 }
@@ -70,6 +74,9 @@ template<> void FluidSolver::freeGridPointer<Real>(Real* ptr) {
 template<> void FluidSolver::freeGridPointer<Vec3>(Vec3* ptr) {
 	mGridsVec.release(ptr);
 }
+template<> void FluidSolver::freeGridPointer<half>(half* ptr) {
+	mGridsHalf.release(ptr);
+}
 template<> void FluidSolver::freeGridPointer<Vec4>(Vec4* ptr) {
 	mGridsVec4.release(ptr);
 }
@@ -115,9 +122,13 @@ FluidSolver::FluidSolver(Vec3i gridsize, int dim, int fourthDim)
 }
 
 FluidSolver::~FluidSolver() {
+	// kept systems hold grids of this solver
+	HelmholtzSystem::release(this);
+
 	mGridsInt.free();
 	mGridsReal.free();
 	mGridsVec.free();
+	mGridsHalf.free();
 	mGridsVec4.free();
 
 	mGrids4dInt.free();
@@ -162,6 +173,7 @@ void FluidSolver::printMemInfo() {
 	msg << "Allocated grids: int " << mGridsInt.used  <<"/"<< mGridsInt.grids.size()  <<", ";
 	msg << "                 real "<< mGridsReal.used <<"/"<< mGridsReal.grids.size() <<", ";
 	msg << "                 vec3 "<< mGridsVec.used  <<"/"<< mGridsVec.grids.size()  <<". ";
+	msg << "                 half "<< mGridsHalf.used <<"/"<< mGridsHalf.grids.size() <<". ";
 	msg << "                 vec4 "<< mGridsVec4.used <<"/"<< mGridsVec4.grids.size() <<". ";
 	if( supports4D() ) {
 	msg << "Allocated 4d grids: int " << mGrids4dInt.used  <<"/"<< mGrids4dInt.grids.size()  <<", ";
@@ -214,6 +226,16 @@ PYTHON() void setDebugLevel(int level=1) {
 	gDebugLevel = level; 
 }
 
+//! reduce kernels (sums, min/max) combine fixed blocks in a fixed order, the results don't depend on
+//! the number of threads or the scheduling, e.g., for reproducible re-simulations
+PYTHON() void setDeterministicReductions(bool enable=true) {
+	gDeterministicReductions = enable;
+}
+
+PYTHON() bool getDeterministicReductions() {
+	return gDeterministicReductions;
+}
+
 //! helper function to check for numpy compilation
 PYTHON() void assertNumpy() {
 #if NUMPY==1
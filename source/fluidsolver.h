@@ -34,6 +34,9 @@ public:
 	inline Real  getDt() const      { return mDt; }
 	inline Real  getDx() const      { return 1.0 / mGridSize.max(); }
 	inline Real  getTime() const    { return mTimeTotal; }
+	//! timestep lock of adaptTimestep at the end of a frame, e.g., for checkpoints
+	inline bool  getLockDt() const  { return mLockDt; }
+	inline void  setLockDt(bool set) { mLockDt = set; }
 
 	//! Check dimensionality
 	inline bool is2D() const { return mDim==2; }
@@ -89,6 +92,7 @@ protected:
 	GridStorage<int>  mGridsInt;
 	GridStorage<Real> mGridsReal;
 	GridStorage<Vec3> mGridsVec;
+	GridStorage<half> mGridsHalf;
 
 
 	//! 4d data section, only required for simulations working with space-time data 
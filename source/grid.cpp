@@ -43,6 +43,7 @@ template<class T> inline GridBase::GridType typeList() { return GridBase::TypeNo
 template<> inline GridBase::GridType typeList<Real>()  { return GridBase::TypeReal; }
 template<> inline GridBase::GridType typeList<int>()   { return GridBase::TypeInt;  }
 template<> inline GridBase::GridType typeList<Vec3>()  { return GridBase::TypeVec3; }
+template<> inline GridBase::GridType typeList<half>()  { return GridBase::TypeHalf; }
 
 template<class T>
 Grid<T>::Grid(FluidSolver* parent, bool show)
@@ -158,48 +159,156 @@ int Grid<T>::save(string name) {
 //******************************************************************************
 // Grid<T> operators
 
-//! Kernel: Compute min value of Real grid
-KERNEL(idx, reduce=min) returns(Real minVal=std::numeric_limits<Real>::max())
-Real CompMinReal(const Grid<Real>& val) {
-	if (val[idx] < minVal)
-		minVal = val[idx];
-}
+// reductions
+
+//! number of independent accumulators of the inner reduction loops, allows the compiler to vectorize
+//! them without reordering floating point operations
+static const int REDUCE_LANES = 8;
+//! number of values per work item of a reduction over the whole grid
+static const IndexInt REDUCE_CHUNK = 1<<14;
+
+//! per lane accumulation of grid statistics
+struct StatLanes {
+	StatLanes() {
+		for(int l=0; l<REDUCE_LANES; ++l) {
+			mn[l] = std::numeric_limits<Real>::max();
+			mx[l] = -std::numeric_limits<Real>::max();
+			sum[l] = sumAbs[l] = sumSquare[l] = 0.;
+		}
+		count = 0;
+	}
+	//! scalar values
+	template<class T> void add(const T* data, IndexInt n, bool withSums) {
+		for(IndexInt i=0; i<n; i+=REDUCE_LANES) {
+			const int m = (int)std::min((IndexInt)REDUCE_LANES, n-i);
+			for(int l=0; l<m; ++l) {
+				const Real v = (Real)data[i+l];
+				mn[l] = v < mn[l] ? v : mn[l];
+				mx[l] = v > mx[l] ? v : mx[l];
+				sumSquare[l] += (double)v * v;
+			}
+			if(withSums) {
+				for(int l=0; l<m; ++l) {
+					const Real v = (Real)data[i+l];
+					sum[l] += v;
+					sumAbs[l] += std::fabs(v);
+				}
+			}
+		}
+		count += n;
+	}
+	//! vectors, min / max are tracked for the squared norms
+	void add(const Vec3* data, IndexInt n, bool withSums) {
+		for(IndexInt i=0; i<n; i+=REDUCE_LANES) {
+			const int m = (int)std::min((IndexInt)REDUCE_LANES, n-i);
+			for(int l=0; l<m; ++l) {
+				const Real v = normSquare(data[i+l]);
+				mn[l] = v < mn[l] ? v : mn[l];
+				mx[l] = v > mx[l] ? v : mx[l];
+				sumSquare[l] += v;
+			}
+			if(withSums) {
+				for(int l=0; l<m; ++l) sum[l] += std::sqrt(normSquare(data[i+l]));
+			}
+		}
+		count += n;
+	}
+	//! combine the lanes pairwise
+	GridStats finish(bool vectors) const {
+		GridStats lanes[REDUCE_LANES];
+		for(int l=0; l<REDUCE_LANES; ++l) {
+			lanes[l].minVal = mn[l];
+			lanes[l].maxVal = mx[l];
+			lanes[l].sum = sum[l];
+			lanes[l].sumAbs = vectors ? sum[l] : sumAbs[l];
+			lanes[l].sumSquare = sumSquare[l];
+		}
+		for(int w=1; w<REDUCE_LANES; w*=2) {
+			for(int l=0; l+w<REDUCE_LANES; l+=2*w) lanes[l].join(lanes[l+w]);
+		}
+		lanes[0].count = count;
+		if(vectors && count > 0) {
+			lanes[0].minVal = std::sqrt(lanes[0].minVal);
+			lanes[0].maxVal = std::sqrt(lanes[0].maxVal);
+		}
+		return lanes[0];
+	}
 
-//! Kernel: Compute max value of Real grid
-KERNEL(idx, reduce=max) returns(Real maxVal=-std::numeric_limits<Real>::max())
-Real CompMaxReal(const Grid<Real>& val) {
-	if (val[idx] > maxVal)
-		maxVal = val[idx];
-}
+	Real mn[REDUCE_LANES], mx[REDUCE_LANES];
+	double sum[REDUCE_LANES], sumAbs[REDUCE_LANES], sumSquare[REDUCE_LANES];
+	IndexInt count;
+};
 
-//! Kernel: Compute min value of int grid
-KERNEL(idx, reduce=min) returns(int minVal=std::numeric_limits<int>::max())
-int CompMinInt(const Grid<int>& val) {
-	if (val[idx] < minVal)
-		minVal = val[idx];
-}
+//! statistics of vector grids refer to the norms
+template<class T> inline bool statsOfNorms() { return false; }
+template<> inline bool statsOfNorms<Vec3>() { return true; }
 
-//! Kernel: Compute max value of int grid
-KERNEL(idx, reduce=max) returns(int maxVal=-std::numeric_limits<int>::max())
-int CompMaxInt(const Grid<int>& val) {
-	if (val[idx] > maxVal)
-		maxVal = val[idx];
+//! combine partial results pairwise, keeps the rounding independent of the number of threads
+static GridStats joinPairwise(std::vector<GridStats>& parts) {
+	if(parts.empty()) return GridStats();
+	for(size_t w=1; w<parts.size(); w*=2) {
+		for(size_t p=0; p+w<parts.size(); p+=2*w) parts[p].join(parts[p+w]);
+	}
+	return parts[0];
+}
+
+//! Kernel: statistics per work item, either a chunk of the whole grid, or a slice (3D) / row (2D) inside a boundary
+KERNEL(pts) template<class T>
+void knGridStats(std::vector<GridStats>& parts, const Grid<T>& grid, int bnd, bool withSums) {
+	StatLanes lanes;
+	if(bnd == 0) {
+		const IndexInt total = (IndexInt)grid.getSizeX() * grid.getSizeY() * grid.getSizeZ();
+		const IndexInt start = idx * REDUCE_CHUNK;
+		lanes.add(grid.data() + start, std::min(REDUCE_CHUNK, total-start), withSums);
+	} else {
+		const int kMin = grid.is3D() ? bnd+(int)idx : 0, kMax = grid.is3D() ? kMin+1 : 1;
+		const int jMin = grid.is3D() ? bnd : bnd+(int)idx, jMax = grid.is3D() ? grid.getSizeY()-bnd : jMin+1;
+		for(int k=kMin; k<kMax; ++k) for(int j=jMin; j<jMax; ++j) {
+			lanes.add(grid.data() + grid.index(bnd,j,k), grid.getSizeX()-2*bnd, withSums);
+		}
+	}
+	parts[idx] = lanes.finish(statsOfNorms<T>());
 }
 
-//! Kernel: Compute min norm of vec grid
-KERNEL(idx, reduce=min) returns(Real minVal=std::numeric_limits<Real>::max())
-Real CompMinVec(const Grid<Vec3>& val) {
-	const Real s = normSquare(val[idx]);
-	if (s < minVal)
-		minVal = s;
+template<class T> GridStats Grid<T>::getStats(int bnd, bool withSums) const {
+	IndexInt items;
+	if(bnd == 0) {
+		const IndexInt total = (IndexInt)mSize.x * mSize.y * mSize.z;
+		items = (total + REDUCE_CHUNK-1) / REDUCE_CHUNK;
+	} else {
+		if(mSize.x <= 2*bnd || mSize.y <= 2*bnd || (is3D() && mSize.z <= 2*bnd)) return GridStats();
+		items = is3D() ? mSize.z-2*bnd : mSize.y-2*bnd;
+	}
+	std::vector<GridStats> parts(items);
+	knGridStats<T>(parts, *this, bnd, withSums);
+	return joinPairwise(parts);
+}
+
+//! Kernel: dot product per chunk of two grids
+KERNEL(pts)
+void knGridDot(std::vector<double>& parts, const Grid<Real>& a, const Grid<Real>& b) {
+	const IndexInt total = (IndexInt)a.getSizeX() * a.getSizeY() * a.getSizeZ();
+	const IndexInt start = idx * REDUCE_CHUNK, end = std::min(start+REDUCE_CHUNK, total);
+	double lanes[REDUCE_LANES] = { 0. };
+	IndexInt i = start;
+	for(; i+REDUCE_LANES<=end; i+=REDUCE_LANES) {
+		for(int l=0; l<REDUCE_LANES; ++l) lanes[l] += a[i+l] * b[i+l];
+	}
+	for(int l=0; i<end; ++i, ++l) lanes[l] += a[i] * b[i];
+	for(int w=1; w<REDUCE_LANES; w*=2) {
+		for(int l=0; l+w<REDUCE_LANES; l+=2*w) lanes[l] += lanes[l+w];
+	}
+	parts[idx] = lanes[0];
 }
 
-//! Kernel: Compute max norm of vec grid
-KERNEL(idx, reduce=max) returns(Real maxVal=-std::numeric_limits<Real>::max())
-Real CompMaxVec(const Grid<Vec3>& val) {
-	const Real s = normSquare(val[idx]);
-	if (s > maxVal)
-		maxVal = s;
+double gridDot(const Grid<Real>& a, const Grid<Real>& b) {
+	const IndexInt total = (IndexInt)a.getSizeX() * a.getSizeY() * a.getSizeZ();
+	std::vector<double> parts((total + REDUCE_CHUNK-1) / REDUCE_CHUNK);
+	knGridDot(parts, a, b);
+	for(size_t w=1; w<parts.size(); w*=2) {
+		for(size_t p=0; p+w<parts.size(); p+=2*w) parts[p] += parts[p+w];
+	}
+	return parts.empty() ? 0. : parts[0];
 }
 
 template<class T> Grid<T>& Grid<T>::copyFrom (const Grid<T>& a, bool copyType ) {
@@ -243,6 +352,9 @@ KERNEL(idx) void knJoinInt(Grid<int>& a, const Grid<int>& b, bool keepMax) {
 KERNEL(idx) void knJoinReal(Grid<Real>& a, const Grid<Real>& b, bool keepMax) {
 	a[idx] = (keepMax) ? max(a[idx], b[idx]) : min(a[idx], b[idx]);
 }
+KERNEL(idx) void knJoinHalf(Grid<half>& a, const Grid<half>& b, bool keepMax) {
+	a[idx] = (keepMax) ? max(a[idx], b[idx]) : min(a[idx], b[idx]);
+}
 
 template<class T> Grid<T>& Grid<T>::safeDivide (const Grid<T>& a) {
 	knGridSafeDiv<T> (*this, a);
@@ -309,37 +421,45 @@ template<> void Grid<int>::join(const Grid<int>& a, bool keepMax) {
 template<> void Grid<Real>::join(const Grid<Real>& a, bool keepMax) {
 	knJoinReal(*this, a, keepMax);
 }
+template<> void Grid<half>::join(const Grid<half>& a, bool keepMax) {
+	knJoinHalf(*this, a, keepMax);
+}
 
 template<> Real Grid<Real>::getMax() const {
-	return CompMaxReal (*this);
+	return getStats(0, false).maxVal;
 }
 template<> Real Grid<Real>::getMin() const {
-	return CompMinReal (*this);
+	return getStats(0, false).minVal;
 }
 template<> Real Grid<Real>::getMaxAbs() const {
-	Real amin = CompMinReal (*this);
-	Real amax = CompMaxReal (*this);
-	return max( fabs(amin), fabs(amax));
+	return getStats(0, false).getMaxAbs();
 }
 template<> Real Grid<Vec3>::getMax() const {
-	return sqrt(CompMaxVec (*this));
+	return getStats(0, false).maxVal;
 }
 template<> Real Grid<Vec3>::getMin() const {
-	return sqrt(CompMinVec (*this));
+	return getStats(0, false).minVal;
 }
 template<> Real Grid<Vec3>::getMaxAbs() const {
-	return sqrt(CompMaxVec (*this));
+	return getStats(0, false).maxVal;
 }
 template<> Real Grid<int>::getMax() const {
-	return (Real) CompMaxInt (*this);
+	return getStats(0, false).maxVal;
 }
 template<> Real Grid<int>::getMin() const {
-	return (Real) CompMinInt (*this);
+	return getStats(0, false).minVal;
 }
 template<> Real Grid<int>::getMaxAbs() const {
-	int amin = CompMinInt (*this);
-	int amax = CompMaxInt (*this);
-	return max( fabs((Real)amin), fabs((Real)amax));
+	return getStats(0, false).getMaxAbs();
+}
+template<> Real Grid<half>::getMax() const {
+	return getStats(0, false).maxVal;
+}
+template<> Real Grid<half>::getMin() const {
+	return getStats(0, false).minVal;
+}
+template<> Real Grid<half>::getMaxAbs() const {
+	return getStats(0, false).getMaxAbs();
 }
 template<class T> std::string Grid<T>::getDataPointer() {
 	std::ostringstream out;
@@ -349,35 +469,13 @@ template<class T> std::string Grid<T>::getDataPointer() {
 
 // L1 / L2 functions
 
-//! calculate L1 norm for whole grid with non-parallelized loop
-template<class GRID>
-Real loop_calcL1Grid (const GRID &grid, int bnd)
-{
-	double accu = 0.;
-	FOR_IJKT_BND(grid, bnd) { accu += norm(grid(i,j,k,t)); }
-	return (Real)accu;
-}
-
-//! calculate L2 norm for whole grid with non-parallelized loop
-// note - kernels "could" be used here, but they can't be templated at the moment (also, that would
-// mean the bnd parameter is fixed)
-template<class GRID>
-Real loop_calcL2Grid(const GRID &grid, int bnd)
-{
-	double accu = 0.;
-	FOR_IJKT_BND(grid, bnd) {
-		accu += normSquare(grid(i,j,k,t)); // supported for real and vec3,4 types
-	}
-	return (Real)sqrt(accu);
-}
-
-//! compute L1 norm of whole grid content (note, not parallel at the moment)
+//! compute L1 norm of whole grid content
 template<class T> Real Grid<T>::getL1(int bnd) {
-	return loop_calcL1Grid<Grid<T> >(*this, bnd);
+	return (Real)getStats(bnd).sumAbs;
 }
-//! compute L2 norm of whole grid content (note, not parallel at the moment)
+//! compute L2 norm of whole grid content
 template<class T> Real Grid<T>::getL2(int bnd) {
-	return loop_calcL2Grid<Grid<T> >(*this, bnd);
+	return (Real)sqrt(getStats(bnd, false).sumSquare);
 }
 
 KERNEL(reduce=+) returns(int cnt=0)
@@ -498,6 +596,17 @@ PYTHON() void copyRealToVec3 (Grid<Real> &sourceX, Grid<Real> &sourceY, Grid<Rea
 	knCopyRealToVec3(sourceX, sourceY, sourceZ, target);
 }
 
+KERNEL(idx) template<class S, class T> void knCopyConvert(const Grid<S>& source, Grid<T>& target) { target[idx] = T(source[idx]); }
+//! convert a real grid to 16 bit storage, values are rounded to the nearest half value
+PYTHON() void copyRealToHalf (const Grid<Real> &source, Grid<half> &target)
+{
+	knCopyConvert<Real, half>(source, target);
+}
+PYTHON() void copyHalfToReal (const Grid<half> &source, Grid<Real> &target)
+{
+	knCopyConvert<half, Real>(source, target);
+}
+
 PYTHON() void convertLevelsetToReal (LevelsetGrid &source , Grid<Real> &target) { debMsg("Deprecated - do not use convertLevelsetToReal... use copyLevelsetToReal instead",1); copyLevelsetToReal(source,target); }
 
 template<class T> void Grid<T>::printGrid(int zSlice, bool printIndex, int bnd) {
@@ -914,5 +1023,6 @@ void copyMACData(const MACGrid &source, MACGrid &target, const FlagGrid& flags,
 template class Grid<int>;
 template class Grid<Real>;
 template class Grid<Vec3>;
+template class Grid<half>;
 
 } //namespace
@@ -26,7 +26,7 @@ class LevelsetGrid;
 //! Base class for all grids
 PYTHON() class GridBase : public PbClass {
 public:
-	PYTHON() enum GridType { TypeNone = 0, TypeReal = 1, TypeInt = 2, TypeVec3 = 4, TypeMAC = 8, TypeLevelset = 16, TypeFlags = 32 };
+	PYTHON() enum GridType { TypeNone = 0, TypeReal = 1, TypeInt = 2, TypeVec3 = 4, TypeMAC = 8, TypeLevelset = 16, TypeFlags = 32, TypeHalf = 64 };
 		
 	PYTHON() GridBase(FluidSolver* parent);
 	
@@ -88,6 +88,26 @@ protected:
 	IndexInt mStrideZ; 
 };
 
+//! Statistics of grid content, computed in a single pass by Grid<T>::getStats.
+//! For vector grids all values refer to the norms of the vectors.
+struct GridStats {
+	GridStats() : minVal(std::numeric_limits<Real>::max()), maxVal(-std::numeric_limits<Real>::max()), sum(0.), sumAbs(0.), sumSquare(0.), count(0) {}
+	Real minVal, maxVal;
+	double sum, sumAbs, sumSquare;
+	IndexInt count;
+
+	Real getMaxAbs() const { return std::max(std::fabs(minVal), std::fabs(maxVal)); }
+	//! merge statistics of another part of the grid
+	void join(const GridStats& o) {
+		minVal = std::min(minVal, o.minVal);
+		maxVal = std::max(maxVal, o.maxVal);
+		sum += o.sum;
+		sumAbs += o.sumAbs;
+		sumSquare += o.sumSquare;
+		count += o.count;
+	}
+};
+
 //! Grid class
 PYTHON() template<class T>
 class Grid : public GridBase {
@@ -135,6 +155,8 @@ public:
 	inline T& operator[](IndexInt idx)             { DEBUG_ONLY(checkIndex(idx)); return mData[idx]; }
 	//! access data
 	inline const T operator[](IndexInt idx) const  { DEBUG_ONLY(checkIndex(idx)); return mData[idx]; }
+	//! raw read access to the contiguous data, e.g., for vectorized loops
+	inline const T* data() const                   { return mData; }
 
 	//! set data
 	inline void set(int i, int j, int k, T& val)              { mData[index(i,j,k)] = val; }
@@ -213,6 +235,10 @@ public:
 	PYTHON() void printGrid(int zSlice=-1,  bool printIndex=false, int bnd=1); 
 
 	// c++ only operators
+	//! min, max, sum, L1 and L2 of the content (skipping a boundary of width bnd) in one parallel pass;
+	//! the sums are accumulated pairwise in double precision, independently of the number of threads.
+	//! sum and sumAbs (of the norms for vector grids) are only computed if withSums is set.
+	GridStats getStats(int bnd=0, bool withSums=true) const;
 	template<class S> Grid<T>& operator+=(const Grid<S>& a);
 	template<class S> Grid<T>& operator+=(const S& a);
 	template<class S> Grid<T>& operator-=(const Grid<S>& a);
@@ -238,6 +264,8 @@ protected:
 PYTHON() alias Grid<int>  IntGrid;
 PYTHON() alias Grid<Real> RealGrid;
 PYTHON() alias Grid<Vec3> VecGrid;
+//! scalar grid with 16 bit storage, e.g. for passive quantities like smoke density, heat or fuel
+PYTHON() alias Grid<half> HalfGrid;
 
 //! Special function for staggered grids
 PYTHON() class MACGrid : public Grid<Vec3> {
@@ -364,6 +392,9 @@ public:
 	PYTHON() int countCells(int flag, int bnd=0, Grid<Real>* mask=NULL);
 };
 
+//! dot product of two grids, accumulated pairwise in double precision independently of the number of threads
+double gridDot(const Grid<Real>& a, const Grid<Real>& b);
+
 //! helper to compute grid conversion factor between local coordinates of two grids
 inline Vec3 calcGridSizeFactor(Vec3i s1, Vec3i s2) {
 	return Vec3( Real(s1[0])/s2[0], Real(s1[1])/s2[1], Real(s1[2])/s2[2] );
@@ -403,33 +403,29 @@ PYTHON() void setRegion4d    (Grid4d<Real>& dst, Vec4 start, Vec4 end, Real valu
 //! simple init functions in 4d, vec4
 PYTHON() void setRegion4dVec4(Grid4d<Vec4>& dst, Vec4 start, Vec4 end, Vec4 value) { knSetRegion4d<Vec4>(dst,start,end,value); }
 
-//! slow helper to visualize tests, get a 3d slice of a 4d grid
-PYTHON() void getSliceFrom4d(Grid4d<Real>& src, int srct, Grid<Real>& dst) { 
-	const int bnd = 0;
-	if(! src.isInBounds(Vec4i(bnd,bnd,bnd,srct)) ) return;
-
-	for(int k=bnd; k<src.getSizeZ()-bnd; k++) 
-	for(int j=bnd; j<src.getSizeY()-bnd; j++) 
-	for(int i=bnd; i<src.getSizeX()-bnd; i++)
-	{
-		if(!dst.isInBounds(Vec3i(i,j,k))) continue;
-		dst(i,j,k) = src(i,j,k,srct);
-	}
+//! get a 3d slice of a 4d grid
+KERNEL(bnd=0)
+void knGetSliceFrom4d(Grid<Real>& dst, const Grid4d<Real>& src, int srct) {
+	if(i>=src.getSizeX() || j>=src.getSizeY() || k>=src.getSizeZ()) return;
+	dst(i,j,k) = src(i,j,k,srct);
 }
-//! slow helper to visualize tests, get a 3d slice of a 4d vec4 grid
+//! get a 3d slice of a 4d grid, e.g. to visualize tests
+PYTHON() void getSliceFrom4d(Grid4d<Real>& src, int srct, Grid<Real>& dst) { 
+	if(! src.isInBounds(Vec4i(0,0,0,srct)) ) return;
+	knGetSliceFrom4d(dst, src, srct);
+}
+//! get a 3d slice of a 4d vec4 grid, the fourth component optionally goes into dstt
+KERNEL(bnd=0)
+void knGetSliceFrom4dVec(Grid<Vec3>& dst, const Grid4d<Vec4>& src, int srct, Grid<Real>* dstt) {
+	if(i>=src.getSizeX() || j>=src.getSizeY() || k>=src.getSizeZ()) return;
+	const Vec4 v = src(i,j,k,srct);
+	for(int c=0; c<3; ++c) dst(i,j,k)[c] = v[c];
+	if(dstt) (*dstt)(i,j,k) = v[3];
+}
+//! get a 3d slice of a 4d vec4 grid, e.g. to visualize tests
 PYTHON() void getSliceFrom4dVec(Grid4d<Vec4>& src, int srct, Grid<Vec3>& dst, Grid<Real>* dstt=NULL) { 
-	const int bnd = 0;
-	if(! src.isInBounds(Vec4i(bnd,bnd,bnd,srct)) ) return;
-
-	for(int k=bnd; k<src.getSizeZ()-bnd; k++) 
-	for(int j=bnd; j<src.getSizeY()-bnd; j++) 
-	for(int i=bnd; i<src.getSizeX()-bnd; i++)
-	{
-		if(!dst.isInBounds(Vec3i(i,j,k))) continue;
-		for(int c=0; c<3; ++c) 
-			dst(i,j,k)[c] = src(i,j,k,srct)[c];
-		if(dstt) (*dstt)(i,j,k) = src(i,j,k,srct)[3];
-	}
+	if(! src.isInBounds(Vec4i(0,0,0,srct)) ) return;
+	knGetSliceFrom4dVec(dst, src, srct, dstt);
 }
 
 
@@ -443,31 +439,162 @@ static inline void gridFactor4d(Vec4 s1, Vec4 s2, Vec4 optSize, Vec4 scale, Vec4
 	retOff       = -retOff * srcFac + srcFac*0.5;
 }
 
-//! interpolate 4d grid from one size to another size
+//! x rows (j,k,t) of a 4d grid, work items of kernels that process whole rows
+struct Grid4dRows {
+	Grid4dRows(const Vec4i& s) : sy(s.y), sz(s.z), num((IndexInt)s.y*s.z*s.t) {}
+	IndexInt size() const { return num; }
+	inline void get(IndexInt r, int& j, int& k, int& t) const { j = (int)(r % sy); r /= sy; k = (int)(r % sz); t = (int)(r / sz); }
+	int sy, sz;
+	IndexInt num;
+};
+
+//! source indices and weights along one axis for all target positions, computed once per
+//! axis instead of per cell; same clamping as BUILD_INDEX_4D, so results are identical to interpol4d
+struct Interpol4dAxis {
+	Interpol4dAxis(int targetSize, int sourceSize, Real factor, Real offset) : idx(targetSize), w0(targetSize), w1(targetSize) {
+		for(int i=0; i<targetSize; ++i) {
+			Real p = Real(i) * factor + offset - 0.5f;
+			int pi = (int)p;
+			Real s1 = p-(Real)pi, s0 = 1.-s1;
+			if (p < 0.) { pi = 0; s0 = 1.0; s1 = 0.0; }
+			if (pi >= sourceSize-1) { pi = sourceSize-2; s0 = 0.0; s1 = 1.0; }
+			idx[i] = pi; w0[i] = s0; w1[i] = s1;
+		}
+	}
+	std::vector<int> idx;
+	std::vector<Real> w0, w1;
+};
+
+//! quadrilinear interpolation of a whole x row, the y,z,t weights are constant along the row.
+//! d0 and d1 are the two time slices (d1 = d0 + stride t for resident 4d grids)
+template<class S>
+inline void interpol4dRow(S* out, int sizeX, const S* d0, const S* d1, IndexInt sY, IndexInt sZ, const Interpol4dAxis& ax,
+	Real t0, Real t1, Real f0, Real f1, Real g0, Real g1)
+{
+	const IndexInt sX = 1;
+	for(int i=0; i<sizeX; ++i) {
+		const IndexInt idx = ax.idx[i];
+		const Real s0 = ax.w0[i], s1 = ax.w1[i];
+		out[i] = ( ((d0[idx]      *t0 + d0[idx+sY]      *t1) * s0
+		          + (d0[idx+sX]   *t0 + d0[idx+sX+sY]   *t1) * s1) * f0
+		          +((d0[idx+sZ]   *t0 + d0[idx+sY+sZ]   *t1) * s0
+		          + (d0[idx+sX+sZ]*t0 + d0[idx+sX+sY+sZ]*t1) * s1) * f1 ) * g0
+		       +
+		         ( ((d1[idx]      *t0 + d1[idx+sY]      *t1) * s0
+		          + (d1[idx+sX]   *t0 + d1[idx+sX+sY]   *t1) * s1) * f0
+		          +((d1[idx+sZ]   *t0 + d1[idx+sY+sZ]   *t1) * s0
+		          + (d1[idx+sX+sZ]*t0 + d1[idx+sX+sY+sZ]*t1) * s1) * f1 ) * g1 ;
+	}
+}
+
+//! interpolate 4d grid from one size to another size, row by row
 // real valued offsets & scale
-KERNEL(fourd) template<class S>
-void knInterpol4d(Grid4d<S>& target, Grid4d<S>& source, const Vec4& srcFac, const Vec4& offset)
+KERNEL(pts) template<class S>
+void knInterpol4d(const Grid4dRows& rows, Grid4d<S>& target, const Grid4d<S>& source,
+	const Interpol4dAxis& ax, const Interpol4dAxis& ay, const Interpol4dAxis& az, const Interpol4dAxis& at)
 {
-	Vec4 pos = Vec4(i,j,k,t) * srcFac + offset;
-	target(i,j,k,t) = source.getInterpolated(pos);
-} 
+	int j,k,t;
+	rows.get(idx, j,k,t);
+	const S* d0 = source.data() + source.getStrideY()*ay.idx[j] + source.getStrideZ()*az.idx[k] + source.getStrideT()*at.idx[t];
+	interpol4dRow<S>( &target(0,j,k,t), target.getSizeX(), d0, d0 + source.getStrideT(), source.getStrideY(), source.getStrideZ(), ax,
+		ay.w0[j], ay.w1[j], az.w0[k], az.w1[k], at.w0[t], at.w1[t] );
+}
+template<class S>
+static void interpolateGrid4dRows(Grid4d<S>& target, const Grid4d<S>& source, const Vec4& srcFac, const Vec4& offset) {
+	const Vec4i ts = target.getSize(), ss = source.getSize();
+	const Interpol4dAxis ax(ts.x, ss.x, srcFac.x, offset.x), ay(ts.y, ss.y, srcFac.y, offset.y),
+		az(ts.z, ss.z, srcFac.z, offset.z), at(ts.t, ss.t, srcFac.t, offset.t);
+	knInterpol4d<S>(Grid4dRows(ts), target, source, ax, ay, az, at);
+}
 //! linearly interpolate data of a 4d grid
 PYTHON() void interpolateGrid4d( Grid4d<Real>& target, Grid4d<Real>& source , Vec4 offset=Vec4(0.), Vec4 scale=Vec4(1.), Vec4 size=Vec4(-1.) )
 {
 	Vec4 srcFac(1.), off2 = offset;
 	gridFactor4d( toVec4(source.getSize()), toVec4(target.getSize()), size,scale,   srcFac,off2   );
-	knInterpol4d<Real> (target, source, srcFac, off2 );
+	interpolateGrid4dRows<Real> (target, source, srcFac, off2 );
 }
 //! linearly interpolate vec4 data of a 4d grid
 PYTHON() void interpolateGrid4dVec( Grid4d<Vec4>& target, Grid4d<Vec4>& source, Vec4 offset=Vec4(0.), Vec4 scale=Vec4(1.), Vec4 size=Vec4(-1.) )
 {
 	Vec4 srcFac(1.), off2 = offset;
 	gridFactor4d( toVec4(source.getSize()), toVec4(target.getSize()), size,scale,   srcFac,off2   );
-	knInterpol4d<Vec4> (target, source, srcFac, off2 );
+	interpolateGrid4dRows<Vec4> (target, source, srcFac, off2 );
+}
+
+
+//******************************************************************************
+// out-of-core 4d grids
+
+template<class T>
+Grid4dWindow<T>::Grid4dWindow(FluidSolver* parent, std::string filename, int window)
+	: PbClass(parent), mFilename(filename), mSize(0,0,0,0), mFileHandle(NULL), mUseCounter(0), mLoads(0)
+{
+	readGrid4dUniSlice<T>(mFilename, -1, NULL, mSize, &mFileHandle);
+	// time interpolation needs two resident slices
+	window = std::max(std::min(2, mSize.t), std::min(window, mSize.t));
+	mSlices.resize(window);
+	mSliceT.resize(window, -1);
+	mLastUse.resize(window, -1);
+	debMsg("Grid4dWindow: "<<mFilename<<" with size "<<mSize<<", "<<window<<" resident slices", 1);
+}
+
+template<class T>
+Grid4dWindow<T>::~Grid4dWindow() {
+	readGrid4dUniSliceCleanup(&mFileHandle);
+}
+
+template<class T>
+const T* Grid4dWindow<T>::slice(int t) {
+	assertMsg(t>=0 && t<mSize.t, "Grid4dWindow: slice "<<t<<" out of range "<<mSize.t);
+	int s = 0;
+	for(int i=0; i<(int)mSliceT.size(); ++i) {
+		if(mSliceT[i]==t) { mLastUse[i] = mUseCounter++; return &mSlices[i][0]; }
+		if(mLastUse[i] < mLastUse[s]) s = i;
+	}
+	// replace least recently used slice
+	mSlices[s].resize((IndexInt)mSize.x*mSize.y*mSize.z);
+	readGrid4dUniSlice<T>(mFilename, t, &mSlices[s][0], mSize, &mFileHandle);
+	mSliceT[s] = t;
+	mLastUse[s] = mUseCounter++;
+	mLoads++;
+	return &mSlices[s][0];
 }
 
+template<class T>
+void Grid4dWindow<T>::getSlice(Grid<T>& dst, int t) {
+	if(dst.getSize() != Vec3i(mSize.x, mSize.y, mSize.z)) errMsg("Grid4dWindow: size of "<<dst.getName()<<" doesn't match "<<mSize);
+	const T* data = slice(t);
+	std::copy(data, data + (IndexInt)mSize.x*mSize.y*mSize.z, &dst[0]);
+}
+
+//! interpolate a 3d grid at one point in time from two resident slices of a 4d grid
+KERNEL(pts) template<class S>
+void knInterpolSlice(const Grid4dRows& rows, Grid<S>& target, const S* d0, const S* d1, const Vec4i& sourceSize,
+	const Interpol4dAxis& ax, const Interpol4dAxis& ay, const Interpol4dAxis& az, Real g0, Real g1)
+{
+	int j,k,t;
+	rows.get(idx, j,k,t);
+	const IndexInt sY = sourceSize.x, sZ = (IndexInt)sourceSize.x*sourceSize.y;
+	const IndexInt offset = sY*ay.idx[j] + sZ*az.idx[k];
+	interpol4dRow<S>( &target(0,j,k), target.getSizeX(), d0 + offset, d1 + offset, sY, sZ, ax,
+		ay.w0[j], ay.w1[j], az.w0[k], az.w1[k], g0, g1 );
+}
+
+template<class T>
+void Grid4dWindow<T>::interpolateSlice(Grid<T>& dst, Real t) {
+	const Vec3i ts = dst.getSize();
+	const Vec4 srcFac = calcGridSizeFactor4d( Vec4(mSize.x, mSize.y, mSize.z, 1), Vec4(ts.x, ts.y, ts.z, 1) );
+	const Interpol4dAxis ax(ts.x, mSize.x, srcFac.x, srcFac.x*0.5), ay(ts.y, mSize.y, srcFac.y, srcFac.y*0.5),
+		az(ts.z, mSize.z, srcFac.z, srcFac.z*0.5), at(1, mSize.t, 1., t+0.5);
+	const int t0 = at.idx[0];
+	const T* d0 = slice(t0);
+	const T* d1 = (at.w1[0]!=0.) ? slice(t0+1) : d0;
+	knInterpolSlice<T>(Grid4dRows(Vec4i(ts.x, ts.y, ts.z, 1)), dst, d0, d1, mSize, ax, ay, az, at.w0[0], at.w1[0]);
+}
 
 // explicit instantiation
+template class Grid4dWindow<Real>;
+template class Grid4dWindow<Vec3>;
 template class Grid4d<int>;
 template class Grid4d<Real>;
 template class Grid4d<Vec3>;
@@ -134,6 +134,9 @@ public:
 	//! access data
 	inline const T operator[](IndexInt idx) const       { DEBUG_ONLY(checkIndex(idx)); return mData[idx]; }
 	
+	//! raw data, for kernels that read whole rows
+	inline const T* data() const { return mData; }
+
 	// interpolated access
 	inline T    getInterpolated(const Vec4& pos) const { return interpol4d<T>(mData, mSize, mStrideZ, mStrideT, pos); }
 	
@@ -202,6 +205,42 @@ PYTHON() alias Grid4d<Vec3> Grid4Vec3;
 PYTHON() alias Grid4d<Vec4> Grid4Vec4;
 
 
+//! out-of-core access to a 4d uni file for volumes larger than memory: only a window
+//! of time slices is resident, the least recently used slice is replaced when a new one is read.
+//! Slices are read in file order most efficiently (backward seeks restart the decompression)
+PYTHON() template<class T>
+class Grid4dWindow : public PbClass {
+public:
+	PYTHON() Grid4dWindow(FluidSolver* parent, std::string filename, int window=4);
+	virtual ~Grid4dWindow();
+
+	PYTHON() inline Vec4i getSize() const { return mSize; }
+	PYTHON() inline int getSizeT() const { return mSize.t; }
+	//! number of slices read from the file so far
+	PYTHON() inline int getNumLoads() const { return mLoads; }
+
+	//! copy time slice t into a 3d grid of the same size
+	PYTHON() void getSlice(Grid<T>& dst, int t);
+	//! quadrilinear interpolation at time t (in slices, t=1.5 is halfway between slices 1 and 2),
+	//! resampled to the size of dst like interpolateGrid4d
+	PYTHON() void interpolateSlice(Grid<T>& dst, Real t);
+
+	//! resident data of time slice t, reads it if necessary
+	const T* slice(int t);
+
+protected:
+	std::string mFilename;
+	Vec4i mSize;
+	void* mFileHandle;
+	std::vector< std::vector<T> > mSlices;
+	std::vector<int> mSliceT, mLastUse;
+	int mUseCounter, mLoads;
+};
+
+PYTHON() alias Grid4dWindow<Real> Grid4RealWindow;
+PYTHON() alias Grid4dWindow<Vec3> Grid4VecWindow;
+
+
 //! helper to compute grid conversion factor between local coordinates of two grids
 inline Vec4 calcGridSizeFactor4d(Vec4i s1, Vec4i s2) {
 	return Vec4( Real(s1[0])/s2[0], Real(s1[1])/s2[1], Real(s1[2])/s2[2] , Real(s1[3])/s2[3] );
@@ -0,0 +1,49 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2011 Tobias Pfaff, Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Fused k-epsilon turbulence model step, implementation in plugin/kepsilon.cpp
+ *
+ ******************************************************************************/
+
+#ifndef _KEPSILON_H
+#define _KEPSILON_H
+
+#include "grid.h"
+
+namespace Manta {
+
+//! k-epsilon model update that keeps its temporaries between steps
+/*! One call replaces KEpsilonBcs (fillArea=false), KEpsilonComputeProduction, KEpsilonSources and
+	KEpsilonGradientDiffusion: boundary values, clamping, strain, production and source terms are
+	computed in a single sweep, the gradient diffusion of k, eps and vel in a second one, reading
+	from persistent copies of the fields. The results match the separate plugins only in 3D. In 2D,
+	KEpsilonComputeProduction reads the centered velocity at k-1 and k+1 outside of the grid, while
+	the fused step uses uz=0 and the 2D strain rate. */
+PYTHON() class KEpsilonModel : public PbClass {
+public:
+	PYTHON() KEpsilonModel(FluidSolver* parent);
+	virtual ~KEpsilonModel();
+
+	//! one turbulence model step, parameters as for the separate KEpsilon plugins
+	PYTHON() void step(const FlagGrid& flags, MACGrid& vel, Grid<Real>& k, Grid<Real>& eps, Grid<Real>& prod,
+		Grid<Real>& nuT, Real intensity, Real nu, Grid<Real>* strain = 0, Real pscale = 1.0f,
+		bool diffuse = true, bool diffuseVel = true, Real sigmaU = 4.0);
+
+protected:
+	void allocGrids();
+	void releaseGrids();
+
+	//! k, eps and vel after the source terms, read by the diffusion sweep
+	Grid<Real> *mK, *mEps;
+	Grid<Vec3> *mVel;
+};
+
+} // namespace
+
+#endif
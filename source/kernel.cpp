@@ -18,6 +18,8 @@
 
 namespace Manta {
 
+bool gDeterministicReductions = false;
+
 KernelBase::KernelBase(const GridBase* base, int bnd) :    
 	maxX (base->getSizeX()-bnd),
 	maxY (base->getSizeY()-bnd),
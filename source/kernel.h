@@ -25,6 +25,7 @@
 #	include <omp.h>
 #endif
 
+#include <vector>
 #include "general.h"
 
 namespace Manta {
@@ -82,6 +83,57 @@ struct KernelBase {
 	// void setup()    
 };
 
+//! deterministic reductions, off by default, see reduceBlocks
+extern bool gDeterministicReductions;
+//! number of cells per block of a deterministic reduction
+static const IndexInt REDUCE_BLOCK_CELLS = 1<<14;
+
+#if TBB==1
+typedef tbb::blocked_range<IndexInt> KernelRange;
+typedef tbb::split KernelSplit;
+#else
+//! range of a reduce kernel block (with the interface of tbb::blocked_range)
+struct KernelRange {
+	KernelRange(IndexInt begin, IndexInt end) : mBegin(begin), mEnd(end) {}
+	IndexInt begin() const { return mBegin; }
+	IndexInt end() const { return mEnd; }
+	IndexInt mBegin, mEnd;
+};
+struct KernelSplit {};
+#endif
+
+//! Run a reduce kernel in fixed blocks, independent of the number of threads
+/*! The range [begin,end) is split into blocks of about REDUCE_BLOCK_CELLS cells (cellsPerUnit cells per
+	range unit, e.g., a slice), which are reduced in parallel by split copies of the kernel. The partial
+	results are joined pairwise in a fixed order, so the rounding doesn't depend on the number of threads
+	or the scheduling. */
+template<class K>
+void reduceBlocks(K& kernel, IndexInt begin, IndexInt end, IndexInt cellsPerUnit) {
+	const IndexInt unitsPerBlock = std::max(IndexInt(1), REDUCE_BLOCK_CELLS / std::max(IndexInt(1), cellsPerUnit));
+	const IndexInt num = (end - begin + unitsPerBlock-1) / unitsPerBlock;
+	if(num <= 0) return;
+	std::vector<K*> parts(num);
+#if TBB==1
+	tbb::parallel_for(IndexInt(0), num, [&](IndexInt b) {
+		parts[b] = new K(kernel, KernelSplit());
+		(*parts[b])(KernelRange(begin + b*unitsPerBlock, std::min(end, begin + (b+1)*unitsPerBlock)));
+	});
+#else
+#	if OPENMP==1
+#	pragma omp parallel for schedule(static,1)
+#	endif
+	for(IndexInt b=0; b<num; ++b) {
+		parts[b] = new K(kernel, KernelSplit());
+		(*parts[b])(KernelRange(begin + b*unitsPerBlock, std::min(end, begin + (b+1)*unitsPerBlock)));
+	}
+#endif
+	for(IndexInt w=1; w<num; w*=2) {
+		for(IndexInt p=0; p+w<num; p+=2*w) parts[p]->join(*parts[p+w]);
+	}
+	kernel.join(*parts[0]);
+	for(IndexInt b=0; b<num; ++b) delete parts[b];
+}
+
 } // namespace
 
 // all kernels will automatically be added to the "Kernels" group in doxygen
@@ -12,11 +12,11 @@
  ******************************************************************************/
 
 #include "levelset.h"
+#include "components.h"
 #include "fastmarch.h"
 #include "kernel.h"
 #include "mcubes.h"
 #include "mesh.h"
-#include <stack>
 
 using namespace std;
 namespace Manta {
@@ -228,102 +228,48 @@ void LevelsetGrid::reinitMarching( const FlagGrid& flags, Real maxTime, MACGrid*
 }
 
 
-void LevelsetGrid::initFromFlags(const FlagGrid& flags, bool ignoreWalls) {
-	FOR_IDX(*this) {
-		if (flags.isFluid(idx) || (ignoreWalls && flags.isObstacle(idx)))
-			mData[idx] = -0.5;
-		else
-			mData[idx] = 0.5;
-	}
+//! Kernel: initialize levelset from flags
+KERNEL(idx) void KnInitFromFlags(Grid<Real>& phi, const FlagGrid& flags, bool ignoreWalls) {
+	if (flags.isFluid(idx) || (ignoreWalls && flags.isObstacle(idx)))
+		phi[idx] = -0.5;
+	else
+		phi[idx] = 0.5;
 }
 
-void LevelsetGrid::fillHoles(int maxDepth, int boundaryWidth) {
-	Real curVal, i1, i2, j1, j2, k1, k2;
-	Vec3i c, cTmp;
-	std::stack<Vec3i> undoPos;
-	std::stack<Real> undoVal;
-	std::stack<Vec3i> todoPos;
-
-	FOR_IJK_BND(*this, boundaryWidth) {
-
-		curVal = mData[index(i,j,k)];
-		i1 = mData[index(i-1,j,k)];
-		i2 = mData[index(i+1,j,k)];
-		j1 = mData[index(i,j-1,k)];
-		j2 = mData[index(i,j+1,k)];
-		k1 = mData[index(i,j,k-1)];
-		k2 = mData[index(i,j,k+1)];
-
-		/* Skip cells inside and cells outside with no inside neighbours early */
-		if (curVal < 0.) continue;
-		if (curVal > 0. && i1 > 0. && i2 > 0. && j1 > 0. && j2 > 0. && k1 > 0. && k2 > 0.) continue;
-
-		/* Cell at c is positive (outside) and has at least one negative (inside) neighbour cell */
-		c = Vec3i(i,j,k);
-
-		/* Current cell is outside and has inside neighbour(s) */
-		undoPos.push(c);
-		undoVal.push(curVal);
-		todoPos.push(c);
-
-		/* Enforce negative cell - if search depth gets exceeded this will be reverted to the original value */
-		mData[index(c.x, c.y, c.z)] = -0.5;
-
-		while(!todoPos.empty()) {
-			todoPos.pop();
-
-			/* Add neighbouring positive (inside) cells to stacks and set negavtive cell value */
-			if (c.x > 0 && mData[index(c.x-1, c.y, c.z)] > 0.) {
-				cTmp = Vec3i(c.x-1, c.y, c.z); undoPos.push(cTmp); undoVal.push(mData[index(cTmp)]); todoPos.push(cTmp); mData[index(cTmp)] = -0.5;
-			}
-			if (c.y > 0 && mData[index(c.x, c.y-1, c.z)] > 0.) {
-				cTmp = Vec3i(c.x, c.y-1, c.z); undoPos.push(cTmp); undoVal.push(mData[index(cTmp)]); todoPos.push(cTmp); mData[index(cTmp)] = -0.5;
-			}
-			if (c.z > 0 && mData[index(c.x, c.y, c.z-1)] > 0.) {
-				cTmp = Vec3i(c.x, c.y, c.z-1); undoPos.push(cTmp); undoVal.push(mData[index(cTmp)]); todoPos.push(cTmp); mData[index(cTmp)] = -0.5;
-			}
-			if (c.x < (*this).getSizeX()-1 && mData[index(c.x+1, c.y, c.z)] > 0.) {
-				cTmp = Vec3i(c.x+1, c.y, c.z); undoPos.push(cTmp); undoVal.push(mData[index(cTmp)]); todoPos.push(cTmp); mData[index(cTmp)] = -0.5;
-			}
-			if (c.y < (*this).getSizeY()-1 && mData[index(c.x, c.y+1, c.z)] > 0.) {
-				cTmp = Vec3i(c.x, c.y+1, c.z); undoPos.push(cTmp); undoVal.push(mData[index(cTmp)]); todoPos.push(cTmp); mData[index(cTmp)] = -0.5;
-			}
-			if (c.z < (*this).getSizeZ()-1 && mData[index(c.x, c.y, c.z+1)] > 0.) {
-				cTmp = Vec3i(c.x, c.y, c.z+1); undoPos.push(cTmp); undoVal.push(mData[index(cTmp)]); todoPos.push(cTmp); mData[index(cTmp)] = -0.5;
-			}
+void LevelsetGrid::initFromFlags(const FlagGrid& flags, bool ignoreWalls) {
+	KnInitFromFlags(*this, flags, ignoreWalls);
+}
 
-			/* Restore original value in cells if undo needed ie once cell undo count exceeds given limit */
-			if (undoPos.size() > maxDepth) {
-				/* Clear todo stack */
-				while (!todoPos.empty()) {
-					todoPos.pop();
-				}
-				/* Clear undo stack and revert value */
-				while (!undoPos.empty()) {
-					c = undoPos.top();
-					curVal = undoVal.top();
-					undoPos.pop();
-					undoVal.pop();
-					mData[index(c.x, c.y, c.z)] = curVal;
-				}
-				break;
-			}
+//! Kernel: set cells of the marked components to inside
+KERNEL(idx)
+void KnFillHoles(Grid<Real>& phi, const Grid<int>& labels, const std::vector<char>& fill) {
+	if(fill[labels[idx]]) phi[idx] = -0.5;
+}
 
-			/* Ensure that undo stack is cleared at the end if no more items in todo stack left */
-			if (todoPos.empty()) {
-				while (!undoPos.empty()) {
-					undoPos.pop();
-				}
-				while (!undoVal.empty()) {
-					undoVal.pop();
-				}
-			}
-			/* Pop value for next while iteration */
-			else {
-				c = todoPos.top();
+void LevelsetGrid::fillHoles(int maxDepth, int boundaryWidth) {
+	Grid<int> labels(mParent);
+	ConnectedComponents comps(mParent);
+	const int num = comps.labelGrid(labels, *this, 0., false);
+	const int dim = is3D() ? 3 : 2;
+
+	// holes are small components with a cell inside the boundary that touches the inside region
+	std::vector<char> fill(num+1, 0);
+	bool any = false;
+	for(int c=1; c<=num; ++c) {
+		const ComponentInfo& info = comps.info(c);
+		if(info.size > maxDepth) continue;
+		const Vec3i p0 = toVec3i(info.bboxMin), p1 = toVec3i(info.bboxMax);
+		for(int k=p0.z; k<p1.z && !fill[c]; ++k) for(int j=p0.y; j<p1.y && !fill[c]; ++j) for(int i=p0.x; i<p1.x && !fill[c]; ++i) {
+			const Vec3i p(i,j,k);
+			if(labels(p) != c || !isInBounds(p, boundaryWidth)) continue;
+			for(int nb=0; nb<2*dim; nb++) {
+				const Vec3i pn = p + neighbors[nb];
+				if(isInBounds(pn) && get(pn) <= 0.) fill[c] = 1;
 			}
 		}
+		any = any || fill[c];
 	}
+	if(any) KnFillHoles(*this, labels, fill);
 }
 
 //! run marching cubes to create a mesh for the 0-levelset
@@ -41,6 +41,7 @@ public:
 	//! initialize levelset from flags (+/- 0.5 heaviside)
 	PYTHON() void initFromFlags(const FlagGrid& flags, bool ignoreWalls=false);
 	//! fill holes (pos cells enclosed by neg ones) up to given size with -0.5 (ie not preserving sdf)
+	//! holes are the connected components of positive cells with at most maxDepth cells
 	PYTHON() void fillHoles(int maxDepth=10, int boundaryWidth=1);
 	
 	static Real invalidTimeValue();
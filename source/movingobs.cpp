@@ -14,6 +14,7 @@
 #include "movingobs.h"
 #include "commonkernels.h"
 #include "randomstream.h"
+#include "interpol.h"
 
 using namespace std;
 namespace Manta {
@@ -24,7 +25,8 @@ namespace Manta {
 int MovingObstacle::sIDcnt = 10;
 
 MovingObstacle::MovingObstacle (FluidSolver* parent, int emptyType)
-	: PbClass(parent), mEmptyType(emptyType)
+	: PbClass(parent), mEmptyType(emptyType), mSdfSize(0), mFlagsValid(false),
+	  mRand(3123984 + sIDcnt, "MovingObstacle" + std::to_string(sIDcnt))
 {
 	mID = 1<<sIDcnt;
 	sIDcnt++;
@@ -34,9 +36,121 @@ MovingObstacle::MovingObstacle (FluidSolver* parent, int emptyType)
 
 void MovingObstacle::add(Shape* shape) {
 	mShapes.push_back(shape);
+	mSdf.clear();
+	mFlagsValid = false;
 }
 
-void MovingObstacle::projectOutside(FlagGrid& flags, BasicParticleSystem& parts) {
+bool MovingObstacle::getBounds(Vec3& p0, Vec3& p1, Real margin) const {
+	if(mShapes.empty()) return false;
+	p0 = Vec3(std::numeric_limits<Real>::max());
+	p1 = Vec3(-std::numeric_limits<Real>::max());
+	for(size_t i=0; i<mShapes.size(); i++) {
+		Vec3 s0, s1;
+		if(!mShapes[i]->getBounds(s0, s1, margin)) return false;
+		for(int c=0; c<3; ++c) {
+			p0[c] = std::min(p0[c], s0[c]);
+			p1[c] = std::max(p1[c], s1[c]);
+		}
+	}
+	return true;
+}
+
+//! cell range [lo,hi) covering a box, clamped to the grid
+static void boxToRange(const FlagGrid& flags, const Vec3& p0, const Vec3& p1, int bnd, Vec3i& lo, Vec3i& hi) {
+	for(int c=0; c<3; ++c) {
+		lo[c] = std::max((int)std::floor(p0[c]) - 1, bnd);
+		hi[c] = std::min((int)std::ceil(p1[c]) + 1, flags.getSize()[c] - bnd);
+	}
+	if(!flags.is3D()) { lo.z = 0; hi.z = 1; }
+}
+
+void MovingObstacle::updateLocalSdf(const FlagGrid& flags, const Vec3& p0, const Vec3& p1) {
+	if(!mSdf.empty() && normSquare((p1-p0) - mSdfExtent) < VECTOR_EPSILON) return;
+	
+	// samples at cell centers of a local grid, with a margin for the interpolation
+	const Real margin = 2.;
+	mSdfOrigin = Vec3(std::floor(p0.x - margin), std::floor(p0.y - margin), std::floor(p0.z - margin));
+	for(int c=0; c<3; ++c) mSdfSize[c] = (int)std::ceil(p1[c] + margin - mSdfOrigin[c]);
+	if(!flags.is3D()) { mSdfOrigin.z = 0; mSdfSize.z = 1; }
+	mSdfBoundsMin = p0;
+	mSdfExtent = p1-p0;
+	
+	mSdf.resize((size_t)mSdfSize.x * mSdfSize.y * mSdfSize.z);
+	for(int k=0, idx=0; k<mSdfSize.z; k++)
+	for(int j=0; j<mSdfSize.y; j++)
+	for(int i=0; i<mSdfSize.x; i++, idx++) {
+		Vec3 pos = mSdfOrigin + Vec3(i+0.5, j+0.5, k+0.5);
+		if(!flags.is3D()) pos.z = 0.5*(p0.z+p1.z);
+		Real d = std::numeric_limits<Real>::max();
+		for(size_t s=0; s<mShapes.size(); s++)
+			d = std::min(d, mShapes[s]->getDistance(pos));
+		mSdf[idx] = d;
+	}
+}
+
+Real MovingObstacle::getLocalSdf(const Vec3& pos) const {
+	Vec3 p = pos - mSdfOrigin;
+	if(mSdfSize.z == 1) p.z = 0.5;
+	return interpol<Real>(&mSdf[0], mSdfSize, (mSdfSize.z > 1) ? mSdfSize.x*mSdfSize.y : 0, p);
+}
+
+Vec3 MovingObstacle::getLocalSdfGradient(const Vec3& pos) const {
+	const Real h = 0.5;
+	Vec3 g;
+	g.x = getLocalSdf(pos + Vec3(h,0,0)) - getLocalSdf(pos - Vec3(h,0,0));
+	g.y = getLocalSdf(pos + Vec3(0,h,0)) - getLocalSdf(pos - Vec3(0,h,0));
+	g.z = (mSdfSize.z > 1) ? getLocalSdf(pos + Vec3(0,0,h)) - getLocalSdf(pos - Vec3(0,0,h)) : 0.;
+	return g / (2.*h);
+}
+
+//! uniform random number in [0,1) for a particle, from a hash of the seed, the particle index and the draw n
+inline static Real hashedRandom(uint64_t seed, IndexInt idx, int n) {
+	uint64_t x = seed + (uint64_t)idx * 0x9E3779B97F4A7C15ull + (uint64_t)n * 0xD1B54A32D192ED03ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	x ^= x >> 31;
+	return (Real)((x >> 40) * (1.0 / 16777216.0));
+}
+
+//! push particles inside the obstacle (box [p0,p1]) along the SDF gradient, shift moves positions into the local frame;
+//! all particles are clamped to the outer boundaries
+KERNEL(pts) // random numbers are hashed from seed and particle index, independent of the threads
+void KnProjectOutsideSdf(BasicParticleSystem& parts, const MovingObstacle& obs, const Vec3& shift, const Vec3& p0, const Vec3& p1, const Vec3& domain, bool is3D, uint64_t seed) {
+	const Real jlen = 0.1;
+	if(!parts.isActive(idx)) return;
+	Vec3 p = parts[idx].pos;
+	const bool inBox = !(p.x < p0.x || p.y < p0.y || p.x > p1.x || p.y > p1.y) && !(is3D && (p.z < p0.z || p.z > p1.z));
+	
+	// a few steps, the interpolated SDF underestimates the depth near the medial axis
+	Vec3 n(0.);
+	for(int it=0; inBox && it<4; ++it) {
+		const Real dist = obs.getLocalSdf(p - shift);
+		if(dist >= 0.) break;
+		Vec3 g = obs.getLocalSdfGradient(p - shift);
+		if(normalize(g) < VECTOR_EPSILON) break;
+		n = g;
+		p -= n * dist;
+	}
+	if(normSquare(n) > 0.) p += n * jlen * (1 + hashedRandom(seed, idx, 0));
+	
+	// clamp to outer boundaries (+jitter)
+	Vec3 jitter = jlen * Vec3(hashedRandom(seed, idx, 1), hashedRandom(seed, idx, 2), hashedRandom(seed, idx, 3));
+	Vec3 pc = clamp(p, Vec3(1,1,1)+jitter, domain-Vec3(1,1,1)-jitter);
+	if(!is3D) pc.z = p.z;
+	parts[idx].pos = pc;
+}
+
+void MovingObstacle::projectOutside(FlagGrid& flags, BasicParticleSystem& parts, bool shapesOnly) {
+	Vec3 p0, p1;
+	if(shapesOnly && getBounds(p0, p1)) {
+		updateLocalSdf(flags, p0, p1);
+		const Vec3 shift = p0 - mSdfBoundsMin;
+		// one draw per call keeps the persistent stream (and checkpoints) in sync
+		const uint64_t seed = (uint64_t)(mRand.getDouble() * 4294967296.);
+		KnProjectOutsideSdf(parts, *this, shift, p0, p1, toVec3(flags.getSize()), flags.is3D(), seed);
+		return;
+	}
+	
 	LevelsetGrid levelset(mParent,false);
 	Grid<Vec3> gradient(mParent);
 	
@@ -67,10 +181,19 @@ void MovingObstacle::moveLinear(Real t, Real t0, Real t1, Vec3 p0, Vec3 p1, Flag
 		for (size_t i=0; i<mShapes.size(); i++)
 			mShapes[i]->setCenter(pos);
 		
-		// reset flags
-		FOR_IDX(flags) {
-			if ((flags[idx] & mID) != 0)
-				flags[idx] = mEmptyType;
+		// reset flags, only in the region of the last application for bounded shapes
+		if (mFlagsValid && flags.getSize() == mFlagsGridSize) {
+			for (int k=mFlagsLo.z; k<mFlagsHi.z; k++)
+			for (int j=mFlagsLo.y; j<mFlagsHi.y; j++)
+			for (int i=mFlagsLo.x; i<mFlagsHi.x; i++) {
+				if ((flags(i,j,k) & mID) != 0)
+					flags(i,j,k) = mEmptyType;
+			}
+		} else {
+			FOR_IDX(flags) {
+				if ((flags[idx] & mID) != 0)
+					flags[idx] = mEmptyType;
+			}
 		}
 		// apply new flags
 		for (size_t i=0; i<mShapes.size(); i++) {
@@ -83,7 +206,18 @@ void MovingObstacle::moveLinear(Real t, Real t0, Real t1, Vec3 p0, Vec3 p1, Flag
 #			endif
 		}
 		// apply velocities
-		FOR_IJK_BND(flags,1) {
+		Vec3 b0, b1;
+		mFlagsValid = getBounds(b0, b1);
+		Vec3i lo(1), hi(flags.getSize() - Vec3i(1));
+		if (mFlagsValid) {
+			boxToRange(flags, b0, b1, 0, mFlagsLo, mFlagsHi);
+			mFlagsGridSize = flags.getSize();
+			boxToRange(flags, b0, b1, 1, lo, hi);
+		}
+		if (!flags.is3D()) { lo.z = 0; hi.z = 1; }
+		for (int k=lo.z; k<hi.z; k++)
+		for (int j=lo.y; j<hi.y; j++)
+		for (int i=lo.x; i<hi.x; i++) {
 			bool cur = (flags(i,j,k) & mID) != 0;
 			if (cur || (flags(i-1,j,k) & mID) != 0) vel(i,j,k).x = v.x;
 			if (cur || (flags(i,j-1,k) & mID) != 0) vel(i,j,k).y = v.y;
@@ -16,6 +16,7 @@
 
 #include "shapes.h"
 #include "particle.h"
+#include "randomstream.h"
 
 namespace Manta {
 
@@ -28,13 +29,37 @@ public:
 	//! If t in [t0,t1], apply linear motion path from p0 to p1
 	PYTHON() void moveLinear(Real t, Real t0, Real t1, Vec3 p0, Vec3 p1, FlagGrid& flags, MACGrid& vel, bool smooth=true);
 	//! Compute levelset, and project FLIP particles outside obstacles
-	PYTHON() void projectOutside(FlagGrid& flags, BasicParticleSystem& flip);
+	/*! By default the levelset is rebuilt from all obstacle cells of the domain (incl. walls and static
+		obstacles), and particles are pushed out of all of them. With shapesOnly, and if all shapes are
+		bounded, their signed distance is sampled once in the local frame of the obstacle instead, and only
+		particles in the bounding box of the moved obstacle are pushed out of its shapes; other obstacle
+		cells are not considered then, use e.g. pushOutofObs for them. All particles are clamped to the
+		domain boundary in both cases. */
+	PYTHON() void projectOutside(FlagGrid& flags, BasicParticleSystem& flip, bool shapesOnly=false);
+	
+	//! local SDF, pos is relative to the shape bounds at sampling time
+	Real getLocalSdf(const Vec3& pos) const;
+	Vec3 getLocalSdfGradient(const Vec3& pos) const;
 	
 protected:
+	//! union of the shape bounds, false if any shape is unbounded
+	bool getBounds(Vec3& p0, Vec3& p1, Real margin=0.) const;
+	//! sample the local SDF around the current shape positions, if it is missing or the shapes were resized
+	void updateLocalSdf(const FlagGrid& flags, const Vec3& p0, const Vec3& p1);
+	
 	std::vector<Shape*> mShapes;
 	int mEmptyType;
 	int mID;
 	static int sIDcnt;
+	
+	std::vector<Real> mSdf;  //!< SDF samples with unit spacing, empty if invalid
+	Vec3i mSdfSize;
+	Vec3 mSdfOrigin;         //!< lower corner of the samples
+	Vec3 mSdfBoundsMin;      //!< lower corner of the shape bounds when sampling
+	Vec3 mSdfExtent;         //!< extent of the shape bounds when sampling
+	bool mFlagsValid;        //!< flags of the obstacle are only set in [mFlagsLo,mFlagsHi)
+	Vec3i mFlagsLo, mFlagsHi, mFlagsGridSize;
+	RandomStream mRand;
 };
 	
 
@@ -0,0 +1,138 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2011 Tobias Pfaff, Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Narrow band of cells around a liquid surface
+ *
+ ******************************************************************************/
+
+#include <algorithm>
+#include "narrowband.h"
+
+using namespace std;
+
+namespace Manta {
+
+//! spans of one row as sorted pairs lo,hi of disjoint, non-adjacent cell ranges
+typedef std::vector<int> RowSpans;
+
+//! append span [lo,hi) to the spans of a row, lo is not smaller than the last lo; merges overlapping and adjacent spans
+inline static void appendSpan(RowSpans& spans, int lo, int hi) {
+	if(!spans.empty() && lo <= spans.back()) spans.back() = std::max(spans.back(), hi);
+	else { spans.push_back(lo); spans.push_back(hi); }
+}
+
+//! Kernel: spans of the cells with -inner <= phi <= outer, per row
+KERNEL(pts)
+void knRowSpansFromLevelset(std::vector<RowSpans>& rows, const Grid<Real>& phi, Real inner, Real outer) {
+	const int sizeX = phi.getSizeX();
+	const IndexInt start = (IndexInt)idx * sizeX;
+	RowSpans& out = rows[idx];
+	out.clear();
+	for(int i=0; i<sizeX; ++i) {
+		const Real v = phi[start+i];
+		if(v >= -inner && v <= outer) appendSpan(out, i, i+1);
+	}
+}
+
+//! Kernel: grow the spans of each row by one cell along x
+KERNEL(pts)
+void knDilateRowSpansX(std::vector<RowSpans>& dst, const std::vector<RowSpans>& src, int sizeX) {
+	const RowSpans& in = src[idx];
+	RowSpans& out = dst[idx];
+	out.clear();
+	for(size_t s=0; s<in.size(); s+=2)
+		appendSpan(out, std::max(in[s]-1, 0), std::min(in[s+1]+1, sizeX));
+}
+
+//! Kernel: union of the spans of each row and its neighbor rows along y (axis 1) or z (axis 2)
+KERNEL(pts)
+void knDilateRowSpans(std::vector<RowSpans>& dst, const std::vector<RowSpans>& src, int sizeY, int axis) {
+	const IndexInt numRows = (IndexInt)src.size();
+	const IndexInt stride = (axis==1) ? 1 : sizeY;
+	const bool hasLo = (axis==1) ? (idx % sizeY) > 0       : idx >= stride;
+	const bool hasHi = (axis==1) ? (idx % sizeY) < sizeY-1 : idx + stride < numRows;
+	const RowSpans* in[3] = { &src[idx], hasLo ? &src[idx-stride] : NULL, hasHi ? &src[idx+stride] : NULL };
+	size_t pos[3] = { 0, 0, 0 };
+	RowSpans& out = dst[idx];
+	out.clear();
+	// merge the sorted span lists by their lower ends
+	while(true) {
+		int next = -1;
+		for(int n=0; n<3; ++n) {
+			if(!in[n] || pos[n] >= in[n]->size()) continue;
+			if(next < 0 || (*in[n])[pos[n]] < (*in[next])[pos[next]]) next = n;
+		}
+		if(next < 0) break;
+		appendSpan(out, (*in[next])[pos[next]], (*in[next])[pos[next]+1]);
+		pos[next] += 2;
+	}
+}
+
+KERNEL(pts)
+void knFillSpans(const std::vector<int>& rows, BandSpans& spans, const std::vector<RowSpans>& rowSpans) {
+	const int r = rows[idx];
+	const RowSpans& in = rowSpans[r];
+	IndexInt s = spans.spanStart[r];
+	for(size_t n=0; n<in.size(); n+=2, ++s) {
+		spans.lo[s] = in[n];
+		spans.hi[s] = in[n+1];
+	}
+}
+
+static void buildSpans(const std::vector<RowSpans>& rowSpans, BandSpans& spans) {
+	const int numRows = (int)rowSpans.size();
+	spans.clear();
+	spans.spanStart.resize(numRows+1);
+	spans.spanStart[0] = 0;
+	for(int r=0; r<numRows; ++r) {
+		const IndexInt count = (IndexInt)rowSpans[r].size() / 2;
+		spans.spanStart[r+1] = spans.spanStart[r] + count;
+		if(count > 0) spans.rows.push_back(r);
+	}
+	const IndexInt numSpans = spans.spanStart[numRows];
+	spans.lo.resize(numSpans);
+	spans.hi.resize(numSpans);
+	knFillSpans(spans.rows, spans, rowSpans);
+
+	spans.offset.resize(numSpans+1);
+	spans.offset[0] = 0;
+	for(IndexInt s=0; s<numSpans; ++s)
+		spans.offset[s+1] = spans.offset[s] + (spans.hi[s] - spans.lo[s]);
+}
+
+NarrowBand::NarrowBand(FluidSolver* parent) : PbClass(parent), mSize(0), mSizeY(0) {}
+
+void NarrowBand::update(const Grid<Real>& phi, Real inner, Real outer) {
+	mSize  = phi.getSize();
+	mSizeY = mSize.y;
+
+	// a single pass over the levelset, the neighbors are added on the spans of the rows
+	std::vector<RowSpans> rows((IndexInt)mSize.y * mSize.z), tmp(rows.size());
+	knRowSpansFromLevelset(rows, phi, inner, outer);
+	buildSpans(rows, mCore);
+
+	knDilateRowSpansX(tmp, rows, mSize.x);
+	knDilateRowSpans(rows, tmp, mSize.y, 1);
+	if(phi.is3D()) {
+		knDilateRowSpans(tmp, rows, mSize.y, 2);
+		rows.swap(tmp);
+	}
+	buildSpans(rows, mBand);
+}
+
+void NarrowBand::markGrid(Grid<int>& mark) const {
+	assertMsg(isValid(mark), "NarrowBand::markGrid: grid size doesn't match the band");
+	mark.clear();
+	FOR_IJK(mark) {
+		if(isInCore(i,j,k)) mark(i,j,k) = 2;
+		else if(find(i,j,k) >= 0) mark(i,j,k) = 1;
+	}
+}
+
+} // namespace
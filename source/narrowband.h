@@ -0,0 +1,84 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2011 Tobias Pfaff, Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Narrow band of cells around a liquid surface
+ *
+ ******************************************************************************/
+
+#ifndef _NARROWBAND_H
+#define _NARROWBAND_H
+
+#include "grid.h"
+
+namespace Manta {
+
+//! Cells of a band, as spans [lo,hi) of the rows (j + k*sizeY) of a grid
+struct BandSpans {
+	void clear() { rows.clear(); spanStart.clear(); lo.clear(); hi.clear(); offset.clear(); }
+	//! index of cell i of row r in the band, -1 if it's not in the band
+	inline IndexInt find(int i, int r) const {
+		for(IndexInt s=spanStart[r]; s<spanStart[r+1]; ++s) {
+			if(i < lo[s]) return -1;
+			if(i < hi[s]) return offset[s] + (i-lo[s]);
+		}
+		return -1;
+	}
+	inline IndexInt numCells() const { return offset.empty() ? 0 : offset.back(); }
+
+	std::vector<int> rows;            //!< rows with band cells
+	std::vector<IndexInt> spanStart;  //!< spans of row r are spanStart[r]..spanStart[r+1]-1
+	std::vector<int> lo, hi;
+	std::vector<IndexInt> offset;     //!< band index of the first cell of each span, plus the total
+};
+
+//! loop over the cells i,j,k of work item idx in band kernels, BAND_INDEX gives the band index of the cell
+#define FOR_BAND_ROW(band, idx) \
+	for(int __r=(band).getSpans().rows[idx], j=__r%(band).getSizeY(), k=__r/(band).getSizeY(), __once=1; __once; __once=0) \
+	for(IndexInt __s=(band).getSpans().spanStart[__r]; __s<(band).getSpans().spanStart[__r+1]; ++__s) \
+	for(int i=(band).getSpans().lo[__s]; i<(band).getSpans().hi[__s]; ++i)
+#define BAND_INDEX(band) ((band).getSpans().offset[__s] + (i - (band).getSpans().lo[__s]))
+
+//! Narrow band for FLIP simulations
+/*! Contains the cells with -inner <= phi <= outer, and their neighbors (3x3x3) for the stencils of the
+	particle mapping and the extrapolation. With a band, mapPartsToMAC, combineGridVel and extrapolateMACSimple
+	only process the band cells, cells deep inside the liquid and far outside keep their values. Temporary
+	data of these functions is allocated for the band cells only. The band itself is only stored as row spans,
+	the grids (velocity, weights, pressure) stay dense, as the pressure solve needs the whole liquid. */
+PYTHON() class NarrowBand : public PbClass {
+public:
+	PYTHON() NarrowBand(FluidSolver* parent);
+
+	//! compute the band from a levelset, inner should cover the particles and the extrapolation from their weights,
+	//! e.g. narrowBandWidth+2, and outer the extrapolation distance; reads the levelset once, the
+	//! neighbors are added on the spans
+	PYTHON() void update(const Grid<Real>& phi, Real inner, Real outer);
+	//! mark the band cells in a grid, 2 for the band of the levelset, 1 for its neighbors
+	PYTHON() void markGrid(Grid<int>& mark) const;
+	PYTHON() int getNumCells() const { return (int)mBand.numCells(); }
+	PYTHON() int getNumSpans() const { return (int)mBand.lo.size(); }
+
+	//! band index of a cell, -1 outside
+	inline IndexInt find(int i, int j, int k) const { return mBand.find(i, j + k*mSizeY); }
+	//! in the band of the levelset, without neighbors
+	inline bool isInCore(int i, int j, int k) const { return mCore.find(i, j + k*mSizeY) >= 0; }
+	//! number of rows with band cells, the work items of the band kernels
+	inline IndexInt size() const { return (IndexInt)mBand.rows.size(); }
+	inline int getSizeY() const { return mSizeY; }
+	inline const BandSpans& getSpans() const { return mBand; }
+	inline bool isValid(const GridBase& grid) const { return grid.getSize() == mSize; }
+
+protected:
+	Vec3i mSize;
+	int mSizeY;
+	BandSpans mBand, mCore;
+};
+
+} // namespace
+
+#endif
@@ -31,6 +31,8 @@ namespace Manta {
 int WaveletNoiseField::randomSeed = 13322223;
 Real* WaveletNoiseField::mNoiseTile = NULL;
 std::atomic<int> WaveletNoiseField::mNoiseReferenceCount(0);
+std::vector<Vec3> WaveletNoiseField::mCurlTile;
+int WaveletNoiseField::mCurlTileRes = 0;
 
 static Real _aCoeffs[32] = {
 	0.000334,-0.001528, 0.000410, 0.003545,-0.000938,-0.008233, 0.002172, 0.019120,
@@ -63,7 +65,7 @@ void WaveletNoiseField::upsample(Real *from, Real *to, int n, int stride) {
 
 WaveletNoiseField::WaveletNoiseField(FluidSolver* parent, int fixedSeed, int loadFromFile) :
 	PbClass(parent), mPosOffset(0.), mPosScale(1.), mValOffset(0.), mValScale(1.), mClamp(false), 
-	mClampNeg(0), mClampPos(1), mTimeAnim(0), mGsInvX(0), mGsInvY(0), mGsInvZ(0)
+	mClampNeg(0), mClampPos(1), mTimeAnim(0), mGsInvX(0), mGsInvY(0), mGsInvZ(0), mUseCurlCache(false)
 {
 	Real scale = 1.0/parent->getGridSize().max();
 	mGsInvX = scale;
@@ -80,6 +82,33 @@ WaveletNoiseField::WaveletNoiseField(FluidSolver* parent, int fixedSeed, int loa
 	generateTile( loadFromFile );
 };
 
+//! curl of the raw tile noise at the sample positions of the curl tile
+KERNEL(pts)
+void knCacheCurlTile(std::vector<Vec3>& curl, const Real* tile, int resolution) {
+	const int n = NOISE_TILE_SIZE * resolution;
+	const int n3 = square(NOISE_TILE_SIZE) * NOISE_TILE_SIZE;
+	const Vec3 p = Vec3(idx % n, (idx / n) % n, idx / ((IndexInt)n*n)) / (Real)resolution;
+	const Vec3 d0 = WaveletNoiseField::WNoiseVec(p, (Real*)&tile[0]),
+	           d1 = WaveletNoiseField::WNoiseVec(p, (Real*)&tile[n3]),
+	           d2 = WaveletNoiseField::WNoiseVec(p, (Real*)&tile[2*n3]);
+	curl[idx] = Vec3(d0.y-d1.z, d2.z-d0.x, d1.x-d2.y);
+}
+
+void WaveletNoiseField::cacheCurl(int resolution) {
+	if(resolution<1 || (resolution & (resolution-1)))
+		errMsg("NoiseField::cacheCurl: resolution has to be a power of two, not " << resolution);
+	if(mClamp)
+		debMsg("NoiseField::cacheCurl: noise is clamped, curl will be evaluated without the cache", 1);
+	if(mCurlTileRes != resolution || mCurlTile.empty()) {
+		const IndexInt n = NOISE_TILE_SIZE * resolution;
+		debMsg("Caching " << n << "^3 curl noise tile", 1);
+		mCurlTile.resize(n*n*n);
+		mCurlTileRes = resolution;
+		knCacheCurlTile(mCurlTile, mNoiseTile, resolution);
+	}
+	mUseCurlCache = true;
+}
+
 string WaveletNoiseField::toString() {
 	std::ostringstream out;
 	out <<  "NoiseField: name '"<<mName<<"' "<<
@@ -18,6 +18,7 @@
 #include "manta.h"
 #include "grid.h"
 #include <atomic>
+#include <vector>
 
 namespace Manta {
 
@@ -29,7 +30,7 @@ class WaveletNoiseField : public PbClass {
 	public:     
 		PYTHON() WaveletNoiseField( FluidSolver* parent, int fixedSeed=-1 , int loadFromFile=false );
 		~WaveletNoiseField() {
-			if(mNoiseTile && !mNoiseReferenceCount) { delete mNoiseTile; mNoiseTile=NULL; }
+			if(mNoiseTile && !mNoiseReferenceCount) { delete mNoiseTile; mNoiseTile=NULL; std::vector<Vec3>().swap(mCurlTile); }
 		};
 
 		//! evaluate noise
@@ -38,9 +39,21 @@ class WaveletNoiseField : public PbClass {
 		inline Vec3 evaluateVec(Vec3 pos, int tile=0) const;
 		//! evaluate curl noise
 		inline Vec3 evaluateCurl(Vec3 pos) const;
+		//! curl noise from the cached curl tile, trilinear lookup
+		inline Vec3 evaluateCurlCached(Vec3 pos) const;
+
+		//! precompute the curl of the noise tile with resolution samples per tile cell (power of two),
+		//! evaluateCurl then uses trilinear lookups instead of the wavelet noise. time animation and
+		//! position offsets only translate the lookup, so the cache stays valid; clamped noise is
+		//! always evaluated exactly. the noise has most of its energy close to the tile resolution,
+		//! 2 samples per cell (200MB for float) give about 10% L2 error, 1 is only a coarse preview
+		PYTHON() void cacheCurl(int resolution=2);
+		PYTHON() void disableCurlCache() { mUseCurlCache = false; }
 
 		//! direct data access
 		Real* data() { return mNoiseTile; }
+		//! derivatives of the raw noise of a tile, at a position in tile space
+		static inline Vec3  WNoiseVec(const Vec3& p, Real *data);
 
 		//! compute wavelet decomposition of an input grid (stores residual coefficients)
 		static void computeCoefficients(Grid<Real>& input, Grid<Real>& tempIn1, Grid<Real>& tempIn2);
@@ -64,7 +77,6 @@ class WaveletNoiseField : public PbClass {
 	protected:
 		// noise evaluation functions
 		static inline Real WNoiseDx (const Vec3& p, Real *data);
-		static inline Vec3  WNoiseVec(const Vec3& p, Real *data);
 		static inline Real WNoise   (const Vec3& p, Real *data);
 
 		// helpers for tile generation , for periodic 128 grids only
@@ -80,6 +92,8 @@ class WaveletNoiseField : public PbClass {
 		#define modFast128(x)  ((x) & 127)
 
 		inline Real getTime() const { return mParent->getTime() * mParent->getDx() * mTimeAnim; }
+		//! position in the noise tile, including seed, time animation, scale and offset
+		inline Vec3 toTileSpace(Vec3 pos) const;
 
 		// pre-compute tile data for wavelet noise
 		void generateTile( int loadFromFile );
@@ -89,6 +103,8 @@ class WaveletNoiseField : public PbClass {
 		Real mGsInvX, mGsInvY, mGsInvZ;
 		// random offset into tile to simulate different random seeds
 		Vec3 mSeedOffset;
+		// use the cached curl tile in evaluateCurl
+		bool mUseCurlCache;
 
 		static Real* mNoiseTile;
 		// global random seed storage
@@ -96,6 +112,10 @@ class WaveletNoiseField : public PbClass {
 
 		// global reference count for noise tile
 		static std::atomic<int> mNoiseReferenceCount;
+
+		// curl of the noise tile, shared like the tile, and its samples per tile cell
+		static std::vector<Vec3> mCurlTile;
+		static int mCurlTileRes;
 };
 
 
@@ -329,7 +349,7 @@ inline Vec3 WaveletNoiseField::WNoiseVec(const Vec3& p, Real *data)
 #undef ADD_WEIGHTEDY
 #undef ADD_WEIGHTEDZ
 
-inline Real WaveletNoiseField::evaluate(Vec3 pos, int tile) const { 
+inline Vec3 WaveletNoiseField::toTileSpace(Vec3 pos) const {
 	pos[0] *= mGsInvX;
 	pos[1] *= mGsInvY;
 	pos[2] *= mGsInvZ;
@@ -342,6 +362,11 @@ inline Real WaveletNoiseField::evaluate(Vec3 pos, int tile) const {
 	pos[1] *= mPosScale[1];
 	pos[2] *= mPosScale[2];
 	pos += mPosOffset;
+	return pos;
+}
+
+inline Real WaveletNoiseField::evaluate(Vec3 pos, int tile) const { 
+	pos = toTileSpace(pos);
 
 	const int n3 = square(NOISE_TILE_SIZE) * NOISE_TILE_SIZE;
 	Real v = WNoise(pos, &mNoiseTile[tile*n3]);
@@ -356,18 +381,7 @@ inline Real WaveletNoiseField::evaluate(Vec3 pos, int tile) const {
 }
 
 inline Vec3 WaveletNoiseField::evaluateVec(Vec3 pos, int tile) const { 
-	pos[0] *= mGsInvX;
-	pos[1] *= mGsInvY;
-	pos[2] *= mGsInvZ;
-	pos += mSeedOffset;
-
-	// time anim
-	pos += Vec3(getTime());
-
-	pos[0] *= mPosScale[0];
-	pos[1] *= mPosScale[1];
-	pos[2] *= mPosScale[2];
-	pos += mPosOffset;
+	pos = toTileSpace(pos);
 
 	const int n3 = square(NOISE_TILE_SIZE) * NOISE_TILE_SIZE;
 	Vec3 v = WNoiseVec(pos, &mNoiseTile[tile*n3]);
@@ -385,6 +399,8 @@ inline Vec3 WaveletNoiseField::evaluateVec(Vec3 pos, int tile) const {
 }
 
 inline Vec3 WaveletNoiseField::evaluateCurl(Vec3 pos) const {
+	if(mUseCurlCache && !mClamp) return evaluateCurlCached(pos);
+
 	// gradients of w0-w2
 	Vec3 d0 = evaluateVec(pos,0), 
 		 d1 = evaluateVec(pos,1), 
@@ -393,6 +409,23 @@ inline Vec3 WaveletNoiseField::evaluateCurl(Vec3 pos) const {
 	return Vec3(d0.y-d1.z, d2.z-d0.x, d1.x-d2.y);
 }
 
+inline Vec3 WaveletNoiseField::evaluateCurlCached(Vec3 pos) const {
+	// the value offset cancels out in the curl, only the scaling remains
+	const int n = NOISE_TILE_SIZE * mCurlTileRes;
+	pos = toTileSpace(pos) * (Real)mCurlTileRes;
+	const int x0 = (int)std::floor(pos[0]), y0 = (int)std::floor(pos[1]), z0 = (int)std::floor(pos[2]);
+	const Real fx = pos[0]-x0, fy = pos[1]-y0, fz = pos[2]-z0;
+	// periodic tile, n is a power of two
+	const IndexInt xa = x0 & (n-1), xb = (x0+1) & (n-1);
+	const IndexInt ya = (y0 & (n-1)) * n, yb = ((y0+1) & (n-1)) * n;
+	const IndexInt za = (IndexInt)(z0 & (n-1)) * n * n, zb = (IndexInt)((z0+1) & (n-1)) * n * n;
+	const Vec3* c = &mCurlTile[0];
+
+	const Vec3 v0 = (c[za+ya+xa] * (1-fx) + c[za+ya+xb] * fx) * (1-fy) + (c[za+yb+xa] * (1-fx) + c[za+yb+xb] * fx) * fy;
+	const Vec3 v1 = (c[zb+ya+xa] * (1-fx) + c[zb+ya+xb] * fx) * (1-fy) + (c[zb+yb+xa] * (1-fx) + c[zb+yb+xb] * fx) * fy;
+	return (v0 * (1-fz) + v1 * fz) * mValScale;
+}
+
 } // namespace  
 
 #endif
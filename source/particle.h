@@ -139,6 +139,9 @@ public:
 
 	//! explicitly trigger compression from outside
 	void doCompress() { if ( mDeletes > mDeleteChunk) compress(); }
+	//! deletion bookkeeping, e.g., to resume from checkpoints exactly
+	void getDeleteCounters(IndexInt& deletes, IndexInt& chunk) const { deletes = mDeletes; chunk = mDeleteChunk; }
+	void setDeleteCounters(IndexInt deletes, IndexInt chunk) { mDeletes = deletes; mDeleteChunk = chunk; }
 	//! insert buffered positions as new particles, update additional particle data
 	void insertBufferedParticles();
 	//! resize data vector, and all pdata fields
@@ -538,7 +541,7 @@ void ParticleSystem<S>::advectInGrid(
 KERNEL(pts, single) // no thread-safe random gen yet
 template<class S>
 void KnProjectParticles(ParticleSystem<S>& part, Grid<Vec3>& gradient) {
-	static RandomStream rand (3123984);
+	static RandomStream rand (3123984, "KnProjectParticles" + std::to_string((int)S::getType()));
 	const double jlen = 0.1;
 	
 	if (part.isActive(idx)) {
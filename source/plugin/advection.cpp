@@ -21,28 +21,35 @@ using namespace std;
 namespace Manta { 
 
 
-//! Semi-Lagrange interpolation kernel
-KERNEL(bnd=1) template<class T> 
-void SemiLagrange (const FlagGrid& flags, const MACGrid& vel, Grid<T>& dst, const Grid<T>& src, Real dt, bool isLevelset, int orderSpace, int orderTrace)
+//! Semi-Lagrange interpolation of a single cell
+template<class T>
+inline T semiLagrangeCell(const MACGrid& vel, const Grid<T>& src, Real dt, int orderSpace, int orderTrace, int i, int j, int k)
 {
     if (orderTrace == 1) {
         // traceback position
         Vec3 pos = Vec3(i+0.5f,j+0.5f,k+0.5f) - vel.getCentered(i,j,k) * dt;
-        dst(i,j,k) = src.getInterpolatedHi(pos, orderSpace);
+        return src.getInterpolatedHi(pos, orderSpace);
     } else if (orderTrace == 2) {
         // backtracing using explicit midpoint
         Vec3 p0 = Vec3(i+0.5f,j+0.5f,k+0.5f);
         Vec3 p1 = p0 - vel.getCentered(i,j,k)*dt*0.5;
         Vec3 p2 = p0 - vel.getInterpolated(p1)*dt;
-        dst(i,j,k) = src.getInterpolatedHi(p2, orderSpace);
+        return src.getInterpolatedHi(p2, orderSpace);
     } else {
         assertMsg(false, "Unknown backtracing order "<<orderTrace);
     }
+    return T(0.);
 }
 
-//! Semi-Lagrange interpolation kernel for MAC grids
-KERNEL(bnd=1)
-void SemiLagrangeMAC(const FlagGrid& flags, const MACGrid& vel, MACGrid& dst, const MACGrid& src, Real dt, int orderSpace, int orderTrace)
+//! Semi-Lagrange interpolation kernel
+KERNEL(bnd=1) template<class T> 
+void SemiLagrange (const FlagGrid& flags, const MACGrid& vel, Grid<T>& dst, const Grid<T>& src, Real dt, bool isLevelset, int orderSpace, int orderTrace)
+{
+    dst(i,j,k) = semiLagrangeCell<T>(vel, src, dt, orderSpace, orderTrace, i,j,k);
+}
+
+//! Semi-Lagrange interpolation of a single cell of a MAC grid
+inline Vec3 semiLagrangeMACCell(const MACGrid& vel, const MACGrid& src, Real dt, int orderSpace, int orderTrace, int i, int j, int k)
 {
     if (orderTrace == 1) {
         // get currect velocity at MAC position
@@ -54,7 +61,7 @@ void SemiLagrangeMAC(const FlagGrid& flags, const MACGrid& vel, MACGrid& dst, co
         Vec3 zpos = Vec3(i+0.5f,j+0.5f,k+0.5f) - vel.getAtMACZ(i,j,k) * dt;
         Real vz = src.getInterpolatedComponentHi<2>(zpos, orderSpace);
 	
-        dst(i,j,k) = Vec3(vx,vy,vz);
+        return Vec3(vx,vy,vz);
     } else if (orderTrace == 2) {
         Vec3 p0 = Vec3(i+0.5,j+0.5,k+0.5);
         Vec3 xp0 = Vec3(i,j+0.5f,k+0.5f);
@@ -70,31 +77,47 @@ void SemiLagrangeMAC(const FlagGrid& flags, const MACGrid& vel, MACGrid& dst, co
         Vec3 zp2 = p0 - src.getInterpolated(zp1)*dt;
         Real vz = src.getInterpolatedComponentHi<2>(zp2, orderSpace);
         
-        dst(i,j,k) = Vec3(vx,vy,vz);
+        return Vec3(vx,vy,vz);
     } else {
         assertMsg(false, "Unknown backtracing order "<<orderTrace);
     }
+    return Vec3(0.);
 }
 
+//! Semi-Lagrange interpolation kernel for MAC grids
+KERNEL(bnd=1)
+void SemiLagrangeMAC(const FlagGrid& flags, const MACGrid& vel, MACGrid& dst, const MACGrid& src, Real dt, int orderSpace, int orderTrace)
+{
+    dst(i,j,k) = semiLagrangeMACCell(vel, src, dt, orderSpace, orderTrace, i,j,k);
+}
 
-//! Kernel: Correct based on forward and backward SL steps (for both centered & mac grids)
-KERNEL(idx) template<class T> 
-void MacCormackCorrect(const FlagGrid& flags, Grid<T>& dst, const Grid<T>& old, const Grid<T>& fwd,  const Grid<T>& bwd,
-					   Real strength, bool isLevelSet, bool isMAC=false )
+
+//! MacCormack correction of a single cell
+template<class T>
+inline T macCormackCorrectCell(const FlagGrid& flags, const Grid<T>& old, const Grid<T>& fwd, const Grid<T>& bwd, Real strength, IndexInt idx)
 {
-	dst[idx] = fwd[idx];
+	T dst = fwd[idx];
 
 	if (flags.isFluid(idx)) {
 		// only correct inside fluid region; note, strenth of correction can be modified here
-		dst[idx] += strength * 0.5 * (old[idx] - bwd[idx]);
+		dst += strength * 0.5 * (old[idx] - bwd[idx]);
 	}
+	return dst;
 }
 
 //! Kernel: Correct based on forward and backward SL steps (for both centered & mac grids)
-KERNEL() template<class T> 
-void MacCormackCorrectMAC(const FlagGrid& flags, Grid<T>& dst, const Grid<T>& old, const Grid<T>& fwd,  const Grid<T>& bwd,
+KERNEL(idx) template<class T> 
+void MacCormackCorrect(const FlagGrid& flags, Grid<T>& dst, const Grid<T>& old, const Grid<T>& fwd,  const Grid<T>& bwd,
 					   Real strength, bool isLevelSet, bool isMAC=false )
 {
+	dst[idx] = macCormackCorrectCell<T>(flags, old, fwd, bwd, strength, idx);
+}
+
+//! MacCormack correction of a single cell of a MAC grid
+template<class T>
+inline T macCormackCorrectMACCell(const FlagGrid& flags, const Grid<T>& old, const Grid<T>& fwd, const Grid<T>& bwd, Real strength, bool isMAC, int i, int j, int k)
+{
+	T dst;
 	bool skip[3] = { false, false, false };
 
 	if (!flags.isFluid(i,j,k)) skip[0] = skip[1] = skip[2] = true;
@@ -106,12 +129,21 @@ void MacCormackCorrectMAC(const FlagGrid& flags, Grid<T>& dst, const Grid<T>& ol
 
 	for(int c=0; c<3; ++c ) {
 		if ( skip[c] ) {
-			dst(i,j,k)[c] = fwd(i,j,k)[c];
+			dst[c] = fwd(i,j,k)[c];
 		} else { 
 			// perform actual correction with given strength
-			dst(i,j,k)[c] = fwd(i,j,k)[c] + strength * 0.5 * (old(i,j,k)[c] - bwd(i,j,k)[c]);
+			dst[c] = fwd(i,j,k)[c] + strength * 0.5 * (old(i,j,k)[c] - bwd(i,j,k)[c]);
 		}
 	}
+	return dst;
+}
+
+//! Kernel: Correct based on forward and backward SL steps (for both centered & mac grids)
+KERNEL() template<class T> 
+void MacCormackCorrectMAC(const FlagGrid& flags, Grid<T>& dst, const Grid<T>& old, const Grid<T>& fwd,  const Grid<T>& bwd,
+					   Real strength, bool isLevelSet, bool isMAC=false )
+{
+	dst(i,j,k) = macCormackCorrectMACCell<T>(flags, old, fwd, bwd, strength, isMAC, i,j,k);
 }
 
 // Helper to collect min/max in a template
@@ -236,12 +268,10 @@ inline Real doClampComponentMAC(const FlagGrid& flags, const Vec3i& gridSize, Re
 
 #undef checkFlag
 
-//! Kernel: Clamp obtained value to min/max in source area, and reset values that point out of grid or into boundaries
-//          (note - MAC grids are handled below)
-KERNEL(bnd=1) template<class T>
-void MacCormackClamp(const FlagGrid& flags, const MACGrid& vel, Grid<T>& dst, const Grid<T>& orig, const Grid<T>& fwd, Real dt, const int clampMode)
+//! Clamp the corrected value dval of a single cell, see MacCormackClamp
+template<class T>
+inline T macCormackClampCell(const FlagGrid& flags, const MACGrid& vel, T dval, const Grid<T>& orig, const Grid<T>& fwd, Real dt, const int clampMode, int i, int j, int k)
 {
-	T     dval       = dst(i,j,k);
 	Vec3i gridUpper  = flags.getSize() - 1;
 	
 	dval = doClampComponent<T>(gridUpper, flags, dval, orig, fwd(i,j,k), Vec3(i,j,k), vel.getCentered(i,j,k) * dt, clampMode );
@@ -262,16 +292,21 @@ void MacCormackClamp(const FlagGrid& flags, const MACGrid& vel, Grid<T>& dst, co
 		}
 	}
 	// clampMode 2 handles flags in doClampComponent call
+	return dval;
+}
 
-	dst(i,j,k) = dval;
+//! Kernel: Clamp obtained value to min/max in source area, and reset values that point out of grid or into boundaries
+//          (note - MAC grids are handled below)
+KERNEL(bnd=1) template<class T>
+void MacCormackClamp(const FlagGrid& flags, const MACGrid& vel, Grid<T>& dst, const Grid<T>& orig, const Grid<T>& fwd, Real dt, const int clampMode)
+{
+	dst(i,j,k) = macCormackClampCell<T>(flags, vel, dst(i,j,k), orig, fwd, dt, clampMode, i,j,k);
 }
 
-//! Kernel: same as MacCormackClamp above, but specialized version for MAC grids
-KERNEL(bnd=1) 
-void MacCormackClampMAC (const FlagGrid& flags, const MACGrid& vel, MACGrid& dst, const MACGrid& orig, const MACGrid& fwd, Real dt, const int clampMode)
+//! Clamp the corrected value dval of a single cell of a MAC grid, see MacCormackClampMAC
+inline Vec3 macCormackClampMACCell(const FlagGrid& flags, const MACGrid& vel, Vec3 dval, const MACGrid& orig, const MACGrid& fwd, Real dt, const int clampMode, int i, int j, int k)
 {
 	Vec3  pos(i,j,k);
-	Vec3  dval       = dst(i,j,k);
 	Vec3  dfwd       = fwd(i,j,k);
 	Vec3i gridUpper  = flags.getSize() - 1;
 	
@@ -282,8 +317,14 @@ void MacCormackClampMAC (const FlagGrid& flags, const MACGrid& vel, MACGrid& dst
 
 	// note - the MAC version currently does not check whether source points were inside an obstacle! (unlike centered version)
 	// this would need to be done for each face separately to stay symmetric...
+	return dval;
+}
 
-	dst(i,j,k) = dval;
+//! Kernel: same as MacCormackClamp above, but specialized version for MAC grids
+KERNEL(bnd=1) 
+void MacCormackClampMAC (const FlagGrid& flags, const MACGrid& vel, MACGrid& dst, const MACGrid& orig, const MACGrid& fwd, Real dt, const int clampMode)
+{
+	dst(i,j,k) = macCormackClampMACCell(flags, vel, dst(i,j,k), orig, fwd, dt, clampMode, i,j,k);
 }
 
 
@@ -455,8 +496,276 @@ PYTHON() void advectSemiLagrange (const FlagGrid* flags, const MACGrid* vel, Gri
 	else if (grid->getType() & GridBase::TypeVec3) {    
 		fnAdvectSemiLagrange< Grid<Vec3> >(flags->getParent(), *flags, *vel, *((Grid<Vec3>*) grid), order, strength, orderSpace, clampMode, orderTrace);
 	}
+	else if (grid->getType() & GridBase::TypeHalf) {
+		fnAdvectSemiLagrange< Grid<half> >(flags->getParent(), *flags, *vel, *((Grid<half>*) grid), order, strength, orderSpace, clampMode, orderTrace);
+	}
+	else
+		errMsg("AdvectSemiLagrange: Grid Type is not supported (only Real, Half, Vec3, MAC, Levelset)");    
+}
+
+// local time stepping
+
+//! end of a block of cells starting at p0, clamped to the grid
+inline Vec3i blockEnd(const GridBase& grid, const Vec3i& p0, int blockSize) {
+	Vec3i p1(std::min(p0.x+blockSize, grid.getSizeX()), std::min(p0.y+blockSize, grid.getSizeY()), std::min(p0.z+blockSize, grid.getSizeZ()));
+	if(!grid.is3D()) p1.z = 1;
+	return p1;
+}
+//! outer layer of cells that the regular (bnd=1) kernels don't touch
+inline bool isOuterCell(const GridBase& grid, int i, int j, int k) {
+	return i<1 || j<1 || i>=grid.getSizeX()-1 || j>=grid.getSizeY()-1 || (grid.is3D() && (k<1 || k>=grid.getSizeZ()-1));
+}
+
+//! max. velocity per block
+KERNEL(pts) void knBlockMaxVel(const std::vector<Vec3i>& blocks, std::vector<Real>& blockMax, const MACGrid& vel, int blockSize) {
+	const Vec3i p0 = blocks[idx], p1 = blockEnd(vel, p0, blockSize);
+	Real maxVal = 0.;
+	for(int k=p0.z; k<p1.z; ++k) for(int j=p0.y; j<p1.y; ++j) for(int i=p0.x; i<p1.x; ++i) {
+		maxVal = std::max(maxVal, normSquare(vel(i,j,k)));
+	}
+	blockMax[idx] = sqrt(maxVal);
+}
+
+//! SL step for all cells of a list of blocks, the outer layer of the grid is reset as in SemiLagrange
+KERNEL(pts) template<class T>
+void knSemiLagrangeBlocks(const std::vector<Vec3i>& blocks, int blockSize, const MACGrid& vel, Grid<T>& dst, const Grid<T>& src, Real dt, int orderSpace, int orderTrace) {
+	const Vec3i p0 = blocks[idx], p1 = blockEnd(dst, p0, blockSize);
+	for(int k=p0.z; k<p1.z; ++k) for(int j=p0.y; j<p1.y; ++j) for(int i=p0.x; i<p1.x; ++i) {
+		dst(i,j,k) = isOuterCell(dst,i,j,k) ? T(0.) : semiLagrangeCell<T>(vel, src, dt, orderSpace, orderTrace, i,j,k);
+	}
+}
+KERNEL(pts)
+void knSemiLagrangeMACBlocks(const std::vector<Vec3i>& blocks, int blockSize, const MACGrid& vel, MACGrid& dst, const MACGrid& src, Real dt, int orderSpace, int orderTrace) {
+	const Vec3i p0 = blocks[idx], p1 = blockEnd(dst, p0, blockSize);
+	for(int k=p0.z; k<p1.z; ++k) for(int j=p0.y; j<p1.y; ++j) for(int i=p0.x; i<p1.x; ++i) {
+		dst(i,j,k) = isOuterCell(dst,i,j,k) ? Vec3(0.) : semiLagrangeMACCell(vel, src, dt, orderSpace, orderTrace, i,j,k);
+	}
+}
+
+//! MacCormack correction and clamping for all cells of a list of blocks
+KERNEL(pts) template<class T>
+void knMacCormackBlocks(const std::vector<Vec3i>& blocks, int blockSize, const FlagGrid& flags, const MACGrid& vel, Grid<T>& dst,
+	const Grid<T>& orig, const Grid<T>& fwd, const Grid<T>& bwd, Real dt, Real strength, int clampMode) {
+	const Vec3i p0 = blocks[idx], p1 = blockEnd(dst, p0, blockSize);
+	for(int k=p0.z; k<p1.z; ++k) for(int j=p0.y; j<p1.y; ++j) for(int i=p0.x; i<p1.x; ++i) {
+		T val = macCormackCorrectCell<T>(flags, orig, fwd, bwd, strength, dst.index(i,j,k));
+		if(!isOuterCell(dst,i,j,k)) val = macCormackClampCell<T>(flags, vel, val, orig, fwd, dt, clampMode, i,j,k);
+		dst(i,j,k) = val;
+	}
+}
+KERNEL(pts)
+void knMacCormackMACBlocks(const std::vector<Vec3i>& blocks, int blockSize, const FlagGrid& flags, const MACGrid& vel, MACGrid& dst,
+	const MACGrid& orig, const MACGrid& fwd, const MACGrid& bwd, Real dt, Real strength, int clampMode) {
+	const Vec3i p0 = blocks[idx], p1 = blockEnd(dst, p0, blockSize);
+	for(int k=p0.z; k<p1.z; ++k) for(int j=p0.y; j<p1.y; ++j) for(int i=p0.x; i<p1.x; ++i) {
+		Vec3 val = macCormackCorrectMACCell<Vec3>(flags, orig, fwd, bwd, strength, true, i,j,k);
+		if(!isOuterCell(dst,i,j,k)) val = macCormackClampMACCell(flags, vel, val, orig, fwd, dt, clampMode, i,j,k);
+		dst(i,j,k) = val;
+	}
+}
+
+KERNEL(pts) template<class T>
+void knCopyBlocks(const std::vector<Vec3i>& blocks, int blockSize, Grid<T>& dst, const Grid<T>& src) {
+	const Vec3i p0 = blocks[idx], p1 = blockEnd(dst, p0, blockSize);
+	for(int k=p0.z; k<p1.z; ++k) for(int j=p0.y; j<p1.y; ++j) for(int i=p0.x; i<p1.x; ++i) {
+		dst(i,j,k) = src(i,j,k);
+	}
+}
+
+//! values of the blocks at time fraction alpha between start and end of their current interval
+KERNEL(pts) template<class T>
+void knInterpolateBlocksInTime(const std::vector<Vec3i>& blocks, const std::vector<Real>& alpha, int blockSize, Grid<T>& dst,
+	const Grid<T>& start, const Grid<T>& end) {
+	const Vec3i p0 = blocks[idx], p1 = blockEnd(dst, p0, blockSize);
+	const Real a = alpha[idx];
+	for(int k=p0.z; k<p1.z; ++k) for(int j=p0.y; j<p1.y; ++j) for(int i=p0.x; i<p1.x; ++i) {
+		dst(i,j,k) = (a >= 1.) ? end(i,j,k) : T(start(i,j,k) * (1.-a) + end(i,j,k) * a);
+	}
+}
+
+// grid type specific steps of the block-wise advection
+template<class T> void semiLagrangeBlocks(const std::vector<Vec3i>& blocks, int blockSize, const MACGrid& vel, Grid<T>& dst, const Grid<T>& src, Real dt, int orderSpace, int orderTrace) {
+	knSemiLagrangeBlocks<T>(blocks, blockSize, vel, dst, src, dt, orderSpace, orderTrace);
+}
+void semiLagrangeBlocks(const std::vector<Vec3i>& blocks, int blockSize, const MACGrid& vel, MACGrid& dst, const MACGrid& src, Real dt, int orderSpace, int orderTrace) {
+	knSemiLagrangeMACBlocks(blocks, blockSize, vel, dst, src, dt, orderSpace, orderTrace);
+}
+template<class T> void macCormackBlocks(const std::vector<Vec3i>& blocks, int blockSize, const FlagGrid& flags, const MACGrid& vel, Grid<T>& dst,
+	const Grid<T>& orig, const Grid<T>& fwd, const Grid<T>& bwd, Real dt, Real strength, int clampMode) {
+	knMacCormackBlocks<T>(blocks, blockSize, flags, vel, dst, orig, fwd, bwd, dt, strength, clampMode);
+}
+void macCormackBlocks(const std::vector<Vec3i>& blocks, int blockSize, const FlagGrid& flags, const MACGrid& vel, MACGrid& dst,
+	const MACGrid& orig, const MACGrid& fwd, const MACGrid& bwd, Real dt, Real strength, int clampMode) {
+	knMacCormackMACBlocks(blocks, blockSize, flags, vel, dst, orig, fwd, bwd, dt, strength, clampMode);
+}
+
+//! Block-wise CFL estimation: each block gets 2^level substeps such that it moves at most cfl cells
+//! per substep, levels of neighboring blocks differ by at most one. Returns the max. level, and per
+//! level the blocks and the blocks within halo blocks of them, with their levels.
+static int computeBlockLevels(const MACGrid& vel, Real dt, Real cfl, int blockSize, int maxSubsteps, int halo,
+	std::vector< std::vector<Vec3i> >& levelBlocks, std::vector< std::vector<Vec3i> >& haloBlocks,
+	std::vector< std::vector<int> >& haloLevels)
+{
+	const Vec3i size = vel.getSize();
+	const Vec3i nb((size.x+blockSize-1)/blockSize, (size.y+blockSize-1)/blockSize, vel.is3D() ? (size.z+blockSize-1)/blockSize : 1);
+	std::vector<Vec3i> blocks;
+	for(int k=0; k<nb.z; ++k) for(int j=0; j<nb.y; ++j) for(int i=0; i<nb.x; ++i)
+		blocks.push_back(Vec3i(i,j,k) * blockSize);
+	std::vector<Real> blockMax(blocks.size());
+	knBlockMaxVel(blocks, blockMax, vel, blockSize);
+
+	int maxLevel = 0, numClamped = 0;
+	while((2<<maxLevel) <= maxSubsteps) maxLevel++;
+	std::vector<int> level(blocks.size(), 0);
+	for(size_t b=0; b<blocks.size(); ++b) {
+		const Real substeps = blockMax[b] * dt / cfl;
+		while((1<<level[b]) < substeps && level[b] < maxLevel) level[b]++;
+		if((1<<level[b]) < substeps) numClamped++;
+	}
+	if(numClamped > 0)
+		debMsg("advectSemiLagrangeLocal: CFL condition violated in " << numClamped << " blocks, increase maxSubsteps", 1);
+
+	// limit level differences of neighbors
+	const int nz = vel.is3D() ? 1 : 0;
+	for(bool changed=true; changed; ) {
+		changed = false;
+		for(int k=0; k<nb.z; ++k) for(int j=0; j<nb.y; ++j) for(int i=0; i<nb.x; ++i) {
+			int& l = level[i + nb.x*(j + nb.y*k)];
+			for(int dk=-nz; dk<=nz; ++dk) for(int dj=-1; dj<=1; ++dj) for(int di=-1; di<=1; ++di) {
+				const Vec3i n(i+di, j+dj, k+dk);
+				if(n.x<0 || n.y<0 || n.z<0 || n.x>=nb.x || n.y>=nb.y || n.z>=nb.z) continue;
+				const int ln = level[n.x + nb.x*(n.y + nb.y*n.z)];
+				if(ln-1 > l) { l = ln-1; changed = true; }
+			}
+		}
+	}
+
+	int usedLevel = 0;
+	levelBlocks.assign(maxLevel+1, std::vector<Vec3i>());
+	haloBlocks.assign(maxLevel+1, std::vector<Vec3i>());
+	haloLevels.assign(maxLevel+1, std::vector<int>());
+	for(size_t b=0; b<blocks.size(); ++b) {
+		levelBlocks[level[b]].push_back(blocks[b]);
+		usedLevel = std::max(usedLevel, level[b]);
+	}
+	const int hz = vel.is3D() ? halo : 0;
+	for(int l=0; l<=usedLevel; ++l) {
+		for(int k=0; k<nb.z; ++k) for(int j=0; j<nb.y; ++j) for(int i=0; i<nb.x; ++i) {
+			bool near = false;
+			for(int dk=-hz; dk<=hz && !near; ++dk) for(int dj=-halo; dj<=halo && !near; ++dj) for(int di=-halo; di<=halo && !near; ++di) {
+				const Vec3i n(i+di, j+dj, k+dk);
+				if(n.x<0 || n.y<0 || n.z<0 || n.x>=nb.x || n.y>=nb.y || n.z>=nb.z) continue;
+				near = level[n.x + nb.x*(n.y + nb.y*n.z)] == l;
+			}
+			if(!near) continue;
+			haloBlocks[l].push_back(Vec3i(i,j,k) * blockSize);
+			haloLevels[l].push_back(level[i + nb.x*(j + nb.y*k)]);
+		}
+	}
+	levelBlocks.resize(usedLevel+1);
+	haloBlocks.resize(usedLevel+1);
+	haloLevels.resize(usedLevel+1);
+	return usedLevel;
+}
+
+//! SL advection with local time steps: fast blocks take several substeps of the global time step,
+//! slow ones a single one. All blocks of one level are advanced together, so that the MacCormack
+//! steps of a level use a consistent dt (the forward step is also computed in a halo of blocks).
+//! Levels are advanced coarse to fine at the start of their interval; finer levels read the blocks
+//! of coarser levels interpolated in time between the start and end of the coarse interval.
+template<class GridType>
+int fnAdvectSemiLagrangeLocal(FluidSolver* parent, const FlagGrid& flags, const MACGrid& vel, GridType& orig, int order, Real strength,
+	int orderSpace, int clampMode, int orderTrace, Real cfl, int blockSize, int maxSubsteps)
+{
+	typedef typename GridType::BASETYPE T;
+	const Real dt = parent->getDt();
+	// traced positions, interpolation stencil and clamping lookups of cells of a level have to lie in its halo
+	const int haloCells = (int)ceil(2.*cfl) + 2;
+	std::vector< std::vector<Vec3i> > levelBlocks, haloBlocks;
+	std::vector< std::vector<int> > haloLevels;
+	const int maxLevel = computeBlockLevels(vel, dt, cfl, blockSize, maxSubsteps, (haloCells+blockSize-1)/blockSize, levelBlocks, haloBlocks, haloLevels);
+	const int numSubsteps = 1<<maxLevel;
+
+	GridType fwd(parent);
+	GridType bwd(parent);
+	GridType newGrid(parent);
+	// start values of the current interval of each block (orig holds the end values), and the
+	// values of the halo of a level at the start of its substep
+	GridType startGrid(parent);
+	GridType src(parent);
+	std::vector<Real> alpha;
+	IndexInt blockUpdates = 0;
+	for(int s=0; s<numSubsteps; ++s) {
+		for(int l=0; l<=maxLevel; ++l) {
+			const std::vector<Vec3i>& blocks = levelBlocks[l];
+			if(blocks.empty() || s % (numSubsteps>>l) != 0) continue;
+			const Real dtl = dt / (1<<l);
+			blockUpdates += (IndexInt)blocks.size();
+
+			// coarser blocks in the halo are already at the end of their interval
+			bool interpolate = false;
+			alpha.resize(haloBlocks[l].size());
+			for(size_t b=0; b<alpha.size(); ++b) {
+				const int period = numSubsteps >> haloLevels[l][b];
+				alpha[b] = (haloLevels[l][b] < l) ? Real(s % period) / period : 1.;
+				interpolate |= alpha[b] < 1.;
+			}
+			if(interpolate) knInterpolateBlocksInTime<T>(haloBlocks[l], alpha, blockSize, src, startGrid, orig);
+			const GridType& cur = interpolate ? src : orig;
+
+			if(order == 1) {
+				semiLagrangeBlocks(blocks, blockSize, vel, newGrid, cur, dtl, orderSpace, orderTrace);
+			} else {
+				semiLagrangeBlocks(haloBlocks[l], blockSize, vel, fwd, cur, dtl, orderSpace, orderTrace);
+				semiLagrangeBlocks(blocks, blockSize, vel, bwd, fwd, -dtl, orderSpace, orderTrace);
+				macCormackBlocks(blocks, blockSize, flags, vel, newGrid, cur, fwd, bwd, dtl, strength, clampMode);
+			}
+			// finer levels interpolate these blocks during the interval
+			if(l < maxLevel) knCopyBlocks<T>(blocks, blockSize, startGrid, orig);
+			knCopyBlocks<T>(blocks, blockSize, orig, newGrid);
+		}
+	}
+	IndexInt numBlocks = 0;
+	for(int l=0; l<=maxLevel; ++l) numBlocks += (IndexInt)levelBlocks[l].size();
+	debMsg("advectSemiLagrangeLocal: " << numSubsteps << " substeps for the fastest blocks, " << blockUpdates << " block updates instead of " << numBlocks*numSubsteps, 2);
+	return numSubsteps;
+}
+
+//! Perform semi-lagrangian advection with local time stepping. The global time step is split into
+//! substeps per block of blockSize^3 cells, such that each block moves at most cfl cells per substep.
+//! Quiescent regions thus take a single step, while fast regions (e.g. jets) are substepped; the
+//! pressure projection is done once per global step by the scene. Takes the same parameters as
+//! advectSemiLagrange, returns the number of substeps of the fastest blocks.
+PYTHON() int advectSemiLagrangeLocal (const FlagGrid* flags, const MACGrid* vel, GridBase* grid,
+                                      int order = 1, Real strength = 1.0, int orderSpace = 1, int clampMode = 2, int orderTrace = 1,
+                                      Real cfl = 1.0, int blockSize = 8, int maxSubsteps = 16)
+{
+	assertMsg(order==1 || order==2, "advectSemiLagrangeLocal: Only order 1 (regular SL) and 2 (MacCormack) supported");
+	assertMsg(cfl > 0. && blockSize > 0 && maxSubsteps > 0, "advectSemiLagrangeLocal: invalid cfl, blockSize or maxSubsteps");
+	FluidSolver* parent = flags->getParent();
+
+	if (grid->getType() & GridBase::TypeReal) {
+		return fnAdvectSemiLagrangeLocal< Grid<Real> >(parent, *flags, *vel, *((Grid<Real>*) grid), order, strength, orderSpace, clampMode, orderTrace, cfl, blockSize, maxSubsteps);
+	}
+	else if (grid->getType() & GridBase::TypeMAC) {
+		MACGrid& mac = *((MACGrid*) grid);
+		if (orderSpace != 1) { debMsg("Warning higher order for MAC grids not yet implemented...",1); }
+		// the advected grid changes during the substeps, keep the velocity of the step constant
+		MACGrid prev(parent);
+		prev.copyFrom(mac);
+		const int substeps = fnAdvectSemiLagrangeLocal< MACGrid >(parent, *flags, (grid==vel) ? prev : *vel, mac, order, strength, orderSpace, clampMode, orderTrace, cfl, blockSize, maxSubsteps);
+		applyOutflowBC(*flags, mac, prev, parent->getDt());
+		return substeps;
+	}
+	else if (grid->getType() & GridBase::TypeVec3) {
+		return fnAdvectSemiLagrangeLocal< Grid<Vec3> >(parent, *flags, *vel, *((Grid<Vec3>*) grid), order, strength, orderSpace, clampMode, orderTrace, cfl, blockSize, maxSubsteps);
+	}
+	else if (grid->getType() & GridBase::TypeHalf) {
+		return fnAdvectSemiLagrangeLocal< Grid<half> >(parent, *flags, *vel, *((Grid<half>*) grid), order, strength, orderSpace, clampMode, orderTrace, cfl, blockSize, maxSubsteps);
+	}
 	else
-		errMsg("AdvectSemiLagrange: Grid Type is not supported (only Real, Vec3, MAC, Levelset)");    
+		errMsg("advectSemiLagrangeLocal: Grid Type is not supported (only Real, Half, Vec3, MAC, Levelset)");
+	return 0;
 }
 
 } // end namespace DDF 
@@ -14,6 +14,7 @@
 #include "vectorbase.h"
 #include "grid.h"
 #include "commonkernels.h"
+#include "compactflags.h"
 #include "particle.h"
 
 using namespace std;
@@ -69,7 +70,8 @@ PYTHON() void addGravityNoScale(const FlagGrid& flags, MACGrid& vel, const Vec3&
 }
 
 //! kernel to add Buoyancy force 
-KERNEL(bnd=1) void KnAddBuoyancy(const FlagGrid& flags, const Grid<Real>& factor, MACGrid& vel, Vec3 strength) {
+KERNEL(bnd=1) template<class T>
+void KnAddBuoyancy(const FlagGrid& flags, const Grid<T>& factor, MACGrid& vel, Vec3 strength) {
 	if (!flags.isFluid(i,j,k)) return;
 	if (flags.isFluid(i-1,j,k))
 		vel(i,j,k).x += (0.5 * strength.x) * (factor(i,j,k)+factor(i-1,j,k));
@@ -79,11 +81,17 @@ KERNEL(bnd=1) void KnAddBuoyancy(const FlagGrid& flags, const Grid<Real>& factor
 		vel(i,j,k).z += (0.5 * strength.z) * (factor(i,j,k)+factor(i,j,k-1));
 }
 
-//! add Buoyancy force based on factor (e.g. smoke density), optionally adapts to different grid sizes automatically
-PYTHON() void addBuoyancy(const FlagGrid& flags, const Grid<Real>& density, MACGrid& vel, Vec3 gravity, Real coefficient=1., bool scale=true) {
+//! add Buoyancy force based on factor (e.g. smoke density), optionally adapts to different grid sizes automatically.
+//! The density can be a real grid or a half grid
+PYTHON() void addBuoyancy(const FlagGrid& flags, const GridBase& density, MACGrid& vel, Vec3 gravity, Real coefficient=1., bool scale=true) {
 	float gridScale = (scale) ? flags.getDx() : 1;
 	Vec3 f = -gravity * flags.getParent()->getDt() / gridScale * coefficient;
-	KnAddBuoyancy(flags,density, vel, f);
+	if (density.getType() & GridBase::TypeHalf)
+		KnAddBuoyancy<half>(flags, (const Grid<half>&)density, vel, f);
+	else if (density.getType() & GridBase::TypeReal)
+		KnAddBuoyancy<Real>(flags, (const Grid<Real>&)density, vel, f);
+	else
+		errMsg("addBuoyancy: only real and half grids are supported");
 }
 
 // inflow / outflow boundaries
@@ -216,6 +224,43 @@ KERNEL() void KnSetWallBcs(const FlagGrid& flags, MACGrid& vel, const MACGrid* o
 	}
 }
 
+//! KnSetWallBcs with the cell type and neighbor faces of compact flags, one load per cell
+KERNEL() void KnSetWallBcsCompact(const CompactFlags& cflags, MACGrid& vel, const MACGrid* obvel) {
+
+	const IndexInt idx = vel.index(i,j,k);
+	const uint32_t m = cflags.getMask(idx);
+	bool curFluid = m & FlagGrid::TypeFluid;
+	bool curObs   = m & FlagGrid::TypeObstacle;
+	Vec3 bcsVel(0.,0.,0.);
+	if (!curFluid && !curObs) return;
+
+	if (obvel) {
+		bcsVel.x = (*obvel)[idx].x;
+		bcsVel.y = (*obvel)[idx].y;
+		if((*obvel).is3D()) bcsVel.z = (*obvel)[idx].z;
+	}
+
+	// faces outside of the domain have no type, no need to check i>0
+	typedef CompactFlags CF;
+	if (m & CF::nb(CF::NbObstacle, CF::FaceXm))           vel[idx].x = bcsVel.x;
+	if (curObs && (m & CF::nb(CF::NbFluid, CF::FaceXm)))  vel[idx].x = bcsVel.x;
+	if (m & CF::nb(CF::NbObstacle, CF::FaceYm))           vel[idx].y = bcsVel.y;
+	if (curObs && (m & CF::nb(CF::NbFluid, CF::FaceYm)))  vel[idx].y = bcsVel.y;
+
+	if(!vel.is3D()) {                                     vel[idx].z = 0; } else {
+	if (m & CF::nb(CF::NbObstacle, CF::FaceZm))           vel[idx].z = bcsVel.z;
+	if (curObs && (m & CF::nb(CF::NbFluid, CF::FaceZm)))  vel[idx].z = bcsVel.z; }
+
+	if (curFluid) {
+		if (m & (CF::nb(CF::NbStick, CF::FaceXm) | CF::nb(CF::NbStick, CF::FaceXp)))
+			vel[idx].y = vel[idx].z = 0;
+		if (m & (CF::nb(CF::NbStick, CF::FaceYm) | CF::nb(CF::NbStick, CF::FaceYp)))
+			vel[idx].x = vel[idx].z = 0;
+		if (vel.is3D() && (m & (CF::nb(CF::NbStick, CF::FaceZm) | CF::nb(CF::NbStick, CF::FaceZp))))
+			vel[idx].x = vel[idx].y = 0;
+	}
+}
+
 //! set wall BCs for fill fraction mode, note - only needs obstacle SDF
 KERNEL() void KnSetWallBcsFrac(const FlagGrid& flags, const MACGrid& vel, MACGrid& velTarget, const MACGrid* obvel,
 							const Grid<Real>* phiObs, const int &boundaryWidth=0) 
@@ -304,9 +349,15 @@ KERNEL() void KnSetWallBcsFrac(const FlagGrid& flags, const MACGrid& vel, MACGri
 
 //! set zero normal velocity boundary condition on walls
 // (optionally with second order accuracy using the obstacle SDF , fractions grid currentlyl not needed)
-PYTHON() void setWallBcs(const FlagGrid& flags, MACGrid& vel, const MACGrid* obvel = 0, const MACGrid* fractions = 0, const Grid<Real>* phiObs = 0, int boundaryWidth=0) {
+// cflags: compact flags, optional, replace the flag lookups of the first order version (see CompactFlags)
+PYTHON() void setWallBcs(const FlagGrid& flags, MACGrid& vel, const MACGrid* obvel = 0, const MACGrid* fractions = 0, const Grid<Real>* phiObs = 0, int boundaryWidth=0,
+	const CompactFlags* cflags = 0) {
 	if(!phiObs || !fractions) {
-		KnSetWallBcs(flags, vel, obvel);
+		if(cflags) {
+			if(!cflags->isValid(flags)) errMsg("setWallBcs: compact flags don't match the size of the flag grid, call update(flags) first");
+			KnSetWallBcsCompact(*cflags, vel, obvel);
+		} else
+			KnSetWallBcs(flags, vel, obvel);
 	} else {
 		MACGrid tmpvel(vel.getParent());
 		KnSetWallBcsFrac(flags, vel, tmpvel, obvel, phiObs, boundaryWidth);
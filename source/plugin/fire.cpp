@@ -19,10 +19,17 @@ using namespace std;
 
 namespace Manta {
 
-KERNEL (bnd=1)
-void KnProcessBurn(Grid<Real>& fuel, Grid<Real>& density, Grid<Real>& react,
-				   Grid<Real>* red, Grid<Real>* green, Grid<Real>* blue,
-				   Grid<Real>* heat, Real burningRate, Real flameSmoke,
+//! the passive grids of the fire functions are either all real grids or all half grids
+template<class T> inline Grid<T>* passiveGrid(const GridBase* grid, int type) {
+	if (grid && !(grid->getType() & type))
+		errMsg("grid '" << grid->getName() << "' has a different type, use either real grids or half grids for all quantities");
+	return (Grid<T>*) grid;
+}
+
+KERNEL (bnd=1) template<class T>
+void KnProcessBurn(Grid<T>& fuel, Grid<T>& density, Grid<T>& react,
+				   Grid<T>* red, Grid<T>* green, Grid<T>* blue,
+				   Grid<T>* heat, Real burningRate, Real flameSmoke,
 				   Real ignitionTemp, Real maxTemp, Real dt, Vec3 flameSmokeColor)
 {
 	// Save initial values
@@ -48,7 +55,7 @@ void KnProcessBurn(Grid<Real>& fuel, Grid<Real>& density, Grid<Real>& react,
 	smokeEmit = (origFuel < 1.0f) ? (1.0 - origFuel) * 0.5f : 0.0f;
 	smokeEmit = (smokeEmit + 0.5f) * (origFuel - fuel(i,j,k)) * 0.1f * flameSmoke;
 	density(i,j,k) += smokeEmit;
-	clamp( density(i,j,k), (Real)0.0f, (Real)1.0f);
+	clamp( (Real)density(i,j,k), (Real)0.0f, (Real)1.0f);
 	
 	// Set fluid temperature from the flame temperature profile
 	if (heat && flame)
@@ -63,20 +70,36 @@ void KnProcessBurn(Grid<Real>& fuel, Grid<Real>& density, Grid<Real>& react,
 	}
 }
 
-PYTHON() void processBurn(Grid<Real>& fuel, Grid<Real>& density, Grid<Real>& react,
-						  Grid<Real>* red = NULL, Grid<Real>* green = NULL, Grid<Real>* blue = NULL,
-						  Grid<Real>* heat = NULL, Real burningRate = 0.75f,
+template<class T>
+void fnProcessBurn(GridBase& fuel, GridBase& density, GridBase& react, GridBase* red, GridBase* green, GridBase* blue,
+				   GridBase* heat, Real burningRate, Real flameSmoke, Real ignitionTemp, Real maxTemp, Vec3 flameSmokeColor, int type)
+{
+	Real dt = fuel.getParent()->getDt();
+	KnProcessBurn<T>(*passiveGrid<T>(&fuel, type), *passiveGrid<T>(&density, type), *passiveGrid<T>(&react, type),
+					 passiveGrid<T>(red, type), passiveGrid<T>(green, type), passiveGrid<T>(blue, type), passiveGrid<T>(heat, type),
+					 burningRate, flameSmoke, ignitionTemp, maxTemp, dt, flameSmokeColor);
+}
+
+//! burn fuel, works with real grids or half grids (HalfGrid) for all quantities
+PYTHON() void processBurn(GridBase& fuel, GridBase& density, GridBase& react,
+						  GridBase* red = NULL, GridBase* green = NULL, GridBase* blue = NULL,
+						  GridBase* heat = NULL, Real burningRate = 0.75f,
 						  Real flameSmoke = 1.0f, Real ignitionTemp = 1.25f,
 						  Real maxTemp = 1.75f, Vec3 flameSmokeColor = Vec3(0.7f, 0.7f, 0.7f))
 {
-	Real dt = fuel.getParent()->getDt();
-	KnProcessBurn(fuel, density, react, red, green, blue, heat, burningRate,
-				  flameSmoke, ignitionTemp, maxTemp, dt, flameSmokeColor);
+	if (fuel.getType() & GridBase::TypeHalf)
+		fnProcessBurn<half>(fuel, density, react, red, green, blue, heat, burningRate,
+							flameSmoke, ignitionTemp, maxTemp, flameSmokeColor, GridBase::TypeHalf);
+	else if (fuel.getType() & GridBase::TypeReal)
+		fnProcessBurn<Real>(fuel, density, react, red, green, blue, heat, burningRate,
+							flameSmoke, ignitionTemp, maxTemp, flameSmokeColor, GridBase::TypeReal);
+	else
+		errMsg("processBurn: only real and half grids are supported");
 }
 
 
-KERNEL (bnd=1)
-void KnUpdateFlame(const Grid<Real>& react, Grid<Real>& flame)
+KERNEL (bnd=1) template<class T>
+void KnUpdateFlame(const Grid<T>& react, Grid<T>& flame)
 {
 	if (react(i,j,k) > 0.0f)
 		flame(i,j,k) = pow(react(i,j,k), 0.5f);
@@ -84,9 +107,15 @@ void KnUpdateFlame(const Grid<Real>& react, Grid<Real>& flame)
 		flame(i,j,k) = 0.0f;
 }
 
-PYTHON() void updateFlame(const Grid<Real>& react, Grid<Real>& flame)
+//! works with real grids or half grids
+PYTHON() void updateFlame(const GridBase& react, GridBase& flame)
 {
-	KnUpdateFlame(react, flame);
+	if (react.getType() & GridBase::TypeHalf)
+		KnUpdateFlame<half>(*passiveGrid<half>(&react, GridBase::TypeHalf), *passiveGrid<half>(&flame, GridBase::TypeHalf));
+	else if (react.getType() & GridBase::TypeReal)
+		KnUpdateFlame<Real>(*passiveGrid<Real>(&react, GridBase::TypeReal), *passiveGrid<Real>(&flame, GridBase::TypeReal));
+	else
+		errMsg("updateFlame: only real and half grids are supported");
 }
 
 } // namespace
@@ -20,6 +20,7 @@
 #include "levelset.h"
 #include "shapes.h"
 #include "matrixbase.h"
+#include "narrowband.h"
 
 using namespace std;
 namespace Manta {
@@ -568,20 +569,60 @@ void knMapLinearVec3ToMACGrid(const BasicParticleSystem& p, const FlagGrid& flag
 	vel.setInterpolated( p[idx].pos, pvel[idx], &tmp[0] );
 }
 
+//! Kernel: band version of knMapLinearVec3ToMACGrid, only particles in the core of the band are mapped
+KERNEL(pts, single)
+void knMapLinearVec3ToMACGridBand(const BasicParticleSystem& p, const NarrowBand& band, const MACGrid& vel, Grid<Vec3>& tmp,
+			      const ParticleDataImpl<Vec3>& pvel, const ParticleDataImpl<int>* ptype, const int exclude)
+{
+	if (!p.isActive(idx) || (ptype && ((*ptype)[idx] & exclude))) return;
+	const Vec3i c = toVec3i(p[idx].pos);
+	if (!vel.isInBounds(c) || !band.isInCore(c.x, c.y, c.z)) return;
+	vel.setInterpolated( p[idx].pos, pvel[idx], &tmp[0] );
+}
+
+KERNEL(pts)
+void knClearBand(const NarrowBand& band, MACGrid& vel, Grid<Vec3>& weight) {
+	FOR_BAND_ROW(band, idx) {
+		vel(i,j,k)    = Vec3(0.);
+		weight(i,j,k) = Vec3(0.);
+	}
+}
+
+KERNEL(pts)
+void knNormalizeBand(const NarrowBand& band, MACGrid& vel, MACGrid& velOld, Grid<Vec3>& weight) {
+	FOR_BAND_ROW(band, idx) {
+		Vec3& w = weight(i,j,k);
+		for(int c=0; c<3; ++c) if(w[c] < VECTOR_EPSILON) w[c] = 0.;
+		vel(i,j,k)    = safeDivide(vel(i,j,k), w);
+		velOld(i,j,k) = vel(i,j,k);
+	}
+}
+
 // optionally , this function can use an existing vec3 grid to store the weights
 // this is useful in combination with the simple extrapolation function
+// with a narrow band, only the band cells are written, and only particles in the band are mapped
 PYTHON() void mapPartsToMAC(const FlagGrid& flags, MACGrid& vel, MACGrid& velOld,
 			    const BasicParticleSystem& parts, const ParticleDataImpl<Vec3>& partVel, Grid<Vec3>* weight=NULL,
-			    const ParticleDataImpl<int>* ptype=NULL, const int exclude=0)
+			    const ParticleDataImpl<int>* ptype=NULL, const int exclude=0, const NarrowBand* band=NULL)
 {
 	// interpol -> grid. tmpgrid for particle contribution weights
 	bool freeTmp = false;
 	if(!weight) {
 		weight = new Grid<Vec3>(flags.getParent());
 		freeTmp = true;
-	} else {
+	} else if(!band) {
 		weight->clear(); // make sure we start with a zero grid!
 	}
+
+	if(band) {
+		assertMsg(band->isValid(flags), "mapPartsToMAC: narrow band doesn't match the grid size, call update() first");
+		knClearBand( *band, vel, *weight );
+		knMapLinearVec3ToMACGridBand( parts, *band, vel, *weight, partVel, ptype, exclude );
+		knNormalizeBand( *band, vel, velOld, *weight );
+		if(freeTmp) delete weight;
+		return;
+	}
+
 	vel.clear();
 	knMapLinearVec3ToMACGrid( parts, flags, vel, *weight, partVel, ptype, exclude );
 
@@ -676,9 +717,10 @@ PYTHON() void flipVelocityUpdate(const FlagGrid& flags, const MACGrid& vel, cons
 //******************************************************************************
 // narrow band 
 
-KERNEL()
-void knCombineVels(MACGrid& vel, const Grid<Vec3>& w, MACGrid& combineVel, const LevelsetGrid* phi, Real narrowBand, Real thresh ) {
-	int idx = vel.index(i,j,k);
+inline void combineVelCell(MACGrid& vel, const Grid<Vec3>& w, MACGrid& combineVel, const LevelsetGrid* phi, Real narrowBand, Real thresh,
+	int i, int j, int k)
+{
+	const IndexInt idx = vel.index(i,j,k);
 
 	for(int c=0; c<3; ++c)
 	{
@@ -700,9 +742,26 @@ void knCombineVels(MACGrid& vel, const Grid<Vec3>& w, MACGrid& combineVel, const
 	}
 }
 
-//! narrow band velocity combination
+KERNEL()
+void knCombineVels(MACGrid& vel, const Grid<Vec3>& w, MACGrid& combineVel, const LevelsetGrid* phi, Real narrowBand, Real thresh ) {
+	combineVelCell(vel, w, combineVel, phi, narrowBand, thresh, i,j,k);
+}
+
+KERNEL(pts)
+void knCombineVelsBand(const NarrowBand& band, MACGrid& vel, const Grid<Vec3>& w, MACGrid& combineVel, const LevelsetGrid* phi, Real narrowBand, Real thresh ) {
+	FOR_BAND_ROW(band, idx) {
+		combineVelCell(vel, w, combineVel, phi, narrowBand, thresh, i,j,k);
+	}
+}
+
+//! narrow band velocity combination, with a band only its cells are processed
 PYTHON() void combineGridVel( MACGrid& vel, const Grid<Vec3>& weight, MACGrid& combineVel, const LevelsetGrid* phi=NULL,
-    Real narrowBand=0.0, Real thresh=0.0) {
+    Real narrowBand=0.0, Real thresh=0.0, const NarrowBand* band=NULL) {
+	if(band) {
+		assertMsg(band->isValid(vel), "combineGridVel: narrow band doesn't match the grid size, call update() first");
+		knCombineVelsBand(*band, vel, weight, combineVel, phi, narrowBand, thresh);
+		return;
+	}
 	knCombineVels(vel, weight, combineVel, phi, narrowBand, thresh);
 }
 
@@ -15,6 +15,8 @@
 #include "kernel.h"
 #include "conjugategrad.h"
 #include "rcmatrix.h"
+#include "pressuresolver.h"
+#include "timing.h"
 
 using namespace std;
 namespace Manta {
@@ -135,22 +137,21 @@ void applySeparableKernel(MACGrid &grid, const FlagGrid &flags, const Matrix &ke
 	else applySeparableKernel3D(grid, flags, kernel);
 }
 
+//! Kernel: max. squared norm of the difference of two vector grids (no temporary grid needed)
+KERNEL(idx, reduce=max) returns(Real maxVal=0)
+Real knMaxNormDiff(const MACGrid& a, const MACGrid& b) {
+	const Real s = normSquare(a[idx] - b[idx]);
+	if(s > maxVal) maxVal = s;
+}
 
 //! Compute r-norm for the stopping criterion
 Real getRNorm(const MACGrid &x, const MACGrid &z) {
-	MACGrid r = MACGrid(x.getParent());
-	r.copyFrom(x);
-	r.sub(z);
-	return r.getMaxAbs();
+	return sqrt(knMaxNormDiff(x, z));
 }
 
 //! Compute s-norm for the stopping criterion
 Real getSNorm(const Real rho, const MACGrid &z, const MACGrid &z_prev) {
-	MACGrid s = MACGrid(z_prev.getParent());
-	s.copyFrom(z_prev);
-	s.sub(z);
-	s.multConst(rho);
-	return s.getMaxAbs();
+	return fabs(rho) * sqrt(knMaxNormDiff(z_prev, z));
 }
 
 //! Compute primal eps for the stopping criterion
@@ -270,34 +271,31 @@ void prox_f(MACGrid& v, const FlagGrid &flags, const MACGrid& Q, const MACGrid&
 	v.add(velC);
 }
 
-// *****************************************************************************
+//! the pressure rhs assumes no flux through obstacle faces, the z-update adds flux there; reset the normal
+//! components between fluid and obstacle cells to the obstacle velocity (zero without obvel)
+KERNEL() void KnGuidingWallFaces(const FlagGrid& flags, MACGrid& vel, const MACGrid* obvel) {
+	const bool curFluid = flags.isFluid(i,j,k);
+	const bool curObs   = flags.isObstacle(i,j,k);
+	if (!curFluid && !curObs) return;
+	const Vec3 bcsVel = obvel ? (*obvel)(i,j,k) : Vec3(0.);
+
+	if (i>0 && (curObs ? flags.isFluid(i-1,j,k) : flags.isObstacle(i-1,j,k))) vel(i,j,k).x = bcsVel.x;
+	if (j>0 && (curObs ? flags.isFluid(i,j-1,k) : flags.isObstacle(i,j-1,k))) vel(i,j,k).y = bcsVel.y;
+	if (vel.is3D() && k>0 && (curObs ? flags.isFluid(i,j,k-1) : flags.isObstacle(i,j,k-1))) vel(i,j,k).z = bcsVel.z;
+}
 
-// re-uses main pressure solve from pressure.cpp
-void solvePressure( 
-        MACGrid& vel, Grid<Real>& pressure, const FlagGrid& flags, Real cgAccuracy = 1e-3,
-	const Grid<Real>* phi = 0,
-	const Grid<Real>* perCellCorr = 0,
-	const MACGrid* fractions = 0,
-	const MACGrid* obvel = 0,
-	Real gfClamp = 1e-04,
-	Real cgMaxIterFac = 1.5,
-	bool precondition = true,
-	int preconditioner = 1,
-	bool enforceCompatibility = false,
-	bool useL2Norm = false, 
-	bool zeroPressureFixing = false,
-	const Grid<Real> *curv = NULL,
-	const Real surfTens = 0.0,
-	Grid<Real>* retRhs = NULL );
+// *****************************************************************************
 
 //! Main function for fluid guiding , includes "regular" pressure solve
+//! cgAccuracyFac: inexact ADMM, inner CG tolerance relative to the ADMM residuals (0 = always cgAccuracy)
 PYTHON() void PD_fluid_guiding(MACGrid& vel, MACGrid& velT,
 	Grid<Real>& pressure, FlagGrid& flags, Grid<Real>& weight, int blurRadius = 5,
 	Real theta = 1.0, Real tau = 1.0, Real sigma = 1.0,
 	Real epsRel = 1e-3, Real epsAbs = 1e-3, int maxIters = 200,
 	// duplicated for pressure solve
 	Grid<Real>* phi = 0, Grid<Real>* perCellCorr = 0, MACGrid* fractions = 0, MACGrid* obvel = 0, Real gfClamp = 1e-04, Real cgMaxIterFac = 1.5, Real cgAccuracy = 1e-3,
-	int preconditioner = 1, bool zeroPressureFixing = false, const Grid<Real> *curv = NULL, const Real surfTens = 0.)
+	int preconditioner = 1, bool zeroPressureFixing = false, const Grid<Real> *curv = NULL, const Real surfTens = 0.,
+	Real cgAccuracyFac = 0.)
 {
 	FluidSolver* parent = vel.getParent();
 
@@ -316,8 +314,12 @@ PYTHON() void PD_fluid_guiding(MACGrid& vel, MACGrid& velT,
 	MACGrid invA = MACGrid(parent);
 	precomputeInvA(invA, weight, sigma);
 
+	// the flags don't change during the iterations, matrix and preconditioner are assembled only once
+	PressureSolver psolver(parent);
+
 	// loop
-	int iter = 0;
+	int iter = 0, cgIters = 0;
+	Real rNorm = 0.;
 	for (iter = 0; iter < maxIters; iter++) {
 		// x-update
 		x0.copyFrom(x);
@@ -329,10 +331,19 @@ PYTHON() void PD_fluid_guiding(MACGrid& vel, MACGrid& velT,
 		// z-update
 		z0.copyFrom(z);
 		z.addScaled(x, -tau);
-		Real cgAccuracyAdaptive = cgAccuracy;
 
-		solvePressure (z, pressure, flags, cgAccuracyAdaptive, phi, perCellCorr, fractions, obvel, gfClamp,
-		    cgMaxIterFac, true, preconditioner, false, false, zeroPressureFixing, curv, surfTens );
+		// inexact ADMM (cgAccuracyFac>0): the projection only needs to be as accurate as the current progress
+		// of the iterations, tolerance follows the r-norm of the last and the s-norm of this iteration, down to cgAccuracy
+		const Real sNorm = getSNorm(tau, x, x0);
+		const Real cgAccuracyAdaptive = max(cgAccuracy, cgAccuracyFac * max(rNorm, sNorm));
+
+		// without wall faces the rhs of a closed domain is incompatible, and the (M)IC preconditioned CG diverges
+		KnGuidingWallFaces(flags, z, obvel);
+
+		// from the second iteration on, the pressure of the previous iterate is a good initial guess
+		psolver.solve (z, pressure, flags, cgAccuracyAdaptive, phi, perCellCorr, fractions, obvel, gfClamp,
+		    cgMaxIterFac, preconditioner, false, false, zeroPressureFixing, curv, surfTens, NULL, false, iter>0 );
+		cgIters += psolver.getIterations();
 
 		// y-update
 		y.copyFrom(z);
@@ -341,7 +352,9 @@ PYTHON() void PD_fluid_guiding(MACGrid& vel, MACGrid& velT,
 		y.add(z);
 
 		// stopping criterion
-		bool stop = (iter > 0 && getRNorm(z, z0) < getEpsDual(epsAbs, epsRel, z));
+		rNorm = getRNorm(z, z0);
+		bool stop = (iter > 0 && rNorm < getEpsDual(epsAbs, epsRel, z));
+		debMsg("PD_fluid_guiding iteration "<<iter<<": r-norm "<<rNorm<<", s-norm "<<sNorm<<", cg accuracy "<<cgAccuracyAdaptive<<", cg iterations "<<psolver.getIterations(), 2);
 
 		if (stop || (iter == maxIters - 1)) break;
 	}
@@ -350,6 +363,9 @@ PYTHON() void PD_fluid_guiding(MACGrid& vel, MACGrid& velT,
 	vel.copyFrom(z);
 
 	debMsg("PD_fluid_guiding iterations:" << iter, 1);
+	TimingData::instance().addStat("PD_fluid_guiding ADMM iterations", iter);
+	TimingData::instance().addStat("PD_fluid_guiding CG iterations", cgIters);
+	TimingData::instance().addStat("PD_fluid_guiding r-norm", rNorm);
 }
 
 //! reset precomputation
@@ -24,8 +24,8 @@ using namespace std;
 namespace Manta {
 	
 //! Apply noise to grid
-KERNEL() 
-void KnApplyNoiseInfl(const FlagGrid& flags, Grid<Real>& density, const WaveletNoiseField& noise, const Grid<Real>& sdf, Real scale, Real sigma)
+KERNEL() template<class T>
+void KnApplyNoiseInfl(const FlagGrid& flags, Grid<T>& density, const WaveletNoiseField& noise, const Grid<Real>& sdf, Real scale, Real sigma)
 {
 	if (!flags.isFluid(i,j,k) || sdf(i,j,k) > sigma) return;
 	Real factor = clamp(1.0-0.5/sigma * (sdf(i,j,k)+sigma), 0.0, 1.0);
@@ -35,11 +35,16 @@ void KnApplyNoiseInfl(const FlagGrid& flags, Grid<Real>& density, const WaveletN
 		density(i,j,k) = target;
 }
 
-//! Init noise-modulated density inside shape
-PYTHON() void densityInflow(const FlagGrid& flags, Grid<Real>& density, const WaveletNoiseField& noise, Shape* shape, Real scale=1.0, Real sigma=0)
+//! Init noise-modulated density inside shape, the density can be a real grid or a half grid
+PYTHON() void densityInflow(const FlagGrid& flags, GridBase& density, const WaveletNoiseField& noise, Shape* shape, Real scale=1.0, Real sigma=0)
 {
 	Grid<Real> sdf = shape->computeLevelset();
-	KnApplyNoiseInfl(flags, density, noise, sdf, scale, sigma);
+	if (density.getType() & GridBase::TypeHalf)
+		KnApplyNoiseInfl<half>(flags, (Grid<half>&)density, noise, sdf, scale, sigma);
+	else if (density.getType() & GridBase::TypeReal)
+		KnApplyNoiseInfl<Real>(flags, (Grid<Real>&)density, noise, sdf, scale, sigma);
+	else
+		errMsg("densityInflow: only real and half grids are supported");
 }
 //! Apply noise to real grid based on an SDF
 KERNEL() void KnAddNoise(const FlagGrid& flags, Grid<Real>& density, const WaveletNoiseField& noise, const Grid<Real>* sdf, Real scale) {
@@ -140,7 +145,7 @@ PYTHON() void densityInflowMeshNoise(const FlagGrid& flags, Grid<Real>& density,
 {
 	LevelsetGrid sdf(density.getParent(), false);
 	mesh->computeLevelset(sdf, 1.);
-	KnApplyNoiseInfl(flags, density, noise, sdf, scale, sigma);
+	KnApplyNoiseInfl<Real>(flags, density, noise, sdf, scale, sigma);
 }
 
 //! Init constant density inside mesh
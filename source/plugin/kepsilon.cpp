@@ -15,6 +15,7 @@
 #include "commonkernels.h"
 #include "vortexsheet.h"
 #include "conjugategrad.h"
+#include "kepsilon.h"
 
 using namespace std;
 
@@ -34,21 +35,37 @@ const Real keImax = 1.0;
 const Real keNuMin = 1e-3;
 const Real keNuMax = 5.0;
 
-//! clamp k and epsilon to limits    
-KERNEL(idx) 
-void KnTurbulenceClamp(Grid<Real>& kgrid, Grid<Real>& egrid, Real minK, Real maxK, Real minNu, Real maxNu) {
-	Real eps = egrid[idx];
-	Real ke = clamp(kgrid[idx],minK,maxK);
+//! clamp k and epsilon of a cell to limits
+inline void turbulenceClamp(Real& ke, Real& eps, Real minK, Real maxK, Real minNu, Real maxNu) {
+	ke = clamp(ke,minK,maxK);
 	Real nu = keCmu*square(ke)/eps;
 	if (nu > maxNu) 
 		eps = keCmu*square(ke)/maxNu;
 	if (nu < minNu) 
 		eps = keCmu*square(ke)/minNu;
+}
+
+//! clamp k and epsilon to limits    
+KERNEL(idx) 
+void KnTurbulenceClamp(Grid<Real>& kgrid, Grid<Real>& egrid, Real minK, Real maxK, Real minNu, Real maxNu) {
+	Real eps = egrid[idx];
+	Real ke = kgrid[idx];
+	turbulenceClamp(ke, eps, minK, maxK, minNu, maxNu);
 
 	kgrid[idx] = ke;
 	egrid[idx] = eps;
 }
 
+//! squared strain rate sum_ij(Sij^2), Sij = 1/2 * (dU_i/dx_j + dU_j/dx_i)
+inline Real strainRateSquared(const MACGrid& vel, int i, int j, int k, const Vec3& ux, const Vec3& uy, const Vec3& uz) {
+	Vec3 diag = Vec3(vel(i+1,j,k).x, vel(i,j+1,k).y, vel(i,j,k+1).z) - vel(i,j,k);
+	Real S12 = 0.5*(ux.y+uy.x);
+	Real S13 = 0.5*(ux.z+uz.x);
+	Real S23 = 0.5*(uy.z+uz.y);
+	return square(diag.x) + square(diag.y) + square(diag.z) +
+		   2.0*square(S12) + 2.0*square(S13) + 2.0*square(S23);
+}
+
 //! Compute k-epsilon production term P = 2*nu_T*sum_ij(Sij^2) and the turbulent viscosity nu_T=C_mu*k^2/eps
 KERNEL(bnd=1) 
 void KnComputeProduction(const MACGrid& vel, const Grid<Vec3>& velCenter, const Grid<Real>& ke, const Grid<Real>& eps, 
@@ -60,15 +77,10 @@ void KnComputeProduction(const MACGrid& vel, const Grid<Vec3>& velCenter, const
 		Real curNu = keCmu * square(ke(i,j,k)) / curEps;
 		
 		// compute Sij = 1/2 * (dU_i/dx_j + dU_j/dx_i)
-		Vec3 diag = Vec3(vel(i+1,j,k).x, vel(i,j+1,k).y, vel(i,j,k+1).z) - vel(i,j,k);
 		Vec3 ux = 0.5*(velCenter(i+1,j,k)-velCenter(i-1,j,k));
 		Vec3 uy = 0.5*(velCenter(i,j+1,k)-velCenter(i,j-1,k));
 		Vec3 uz = 0.5*(velCenter(i,j,k+1)-velCenter(i,j,k-1));
-		Real S12 = 0.5*(ux.y+uy.x);
-		Real S13 = 0.5*(ux.z+uz.x);
-		Real S23 = 0.5*(uy.z+uz.y);
-		Real S2 = square(diag.x) + square(diag.y) + square(diag.z) +
-				  2.0*square(S12) + 2.0*square(S13) + 2.0*square(S23);
+		Real S2 = strainRateSquared(vel, i,j,k, ux, uy, uz);
 		
 		// P = 2*nu_T*sum_ij(Sij^2)
 		prod(i,j,k) = 2.0 * curNu * S2 * pscale;
@@ -98,18 +110,25 @@ PYTHON() void KEpsilonComputeProduction(const MACGrid& vel, Grid<Real>& k, Grid<
 	KnComputeProduction(vel, vcenter, k, eps, prod, nuT, strain, pscale);    
 }
 
-//! Integrate source terms of k-epsilon equation
-KERNEL(idx) 
-void KnAddTurbulenceSource(Grid<Real>& kgrid, Grid<Real>& egrid, const Grid<Real>& pgrid, Real dt) {
-	Real eps = egrid[idx], prod = pgrid[idx], ke = kgrid[idx];
+//! Integrate source terms of k-epsilon equation for a cell
+inline void turbulenceSource(Real& ke, Real& eps, Real prod, Real dt) {
 	if (ke <= 0) ke = 1e-3; // pre-clamp to avoid nan
 	
 	Real newK = ke + dt*(prod - eps);
 	Real newEps = eps + dt*(prod * keC1 - eps * keC2) * (eps / ke);
 	if (newEps <= 0) newEps = 1e-4; // pre-clamp to avoid nan
 
-	kgrid[idx] = newK;
-	egrid[idx] = newEps;
+	ke = newK;
+	eps = newEps;
+}
+
+//! Integrate source terms of k-epsilon equation
+KERNEL(idx) 
+void KnAddTurbulenceSource(Grid<Real>& kgrid, Grid<Real>& egrid, const Grid<Real>& pgrid, Real dt) {
+	Real eps = egrid[idx], ke = kgrid[idx];
+	turbulenceSource(ke, eps, pgrid[idx], dt);
+	kgrid[idx] = ke;
+	egrid[idx] = eps;
 }
 
 
@@ -180,4 +199,143 @@ PYTHON() void KEpsilonGradientDiffusion(Grid<Real>& k, Grid<Real>& eps, Grid<Rea
 
 
 
+//*****************************************************************************
+// fused k-epsilon step
+
+//! centered velocity as computed by GetCentered followed by FillInBoundary
+inline Vec3 keCentered(const MACGrid& vel, int i, int j, int k) {
+	i = clamp(i, 1, vel.getSizeX()-2);
+	j = clamp(j, 1, vel.getSizeY()-2);
+	if(vel.is3D()) k = clamp(k, 1, vel.getSizeZ()-2);
+	Vec3 v = 0.5 * ( vel(i,j,k) + Vec3(vel(i+1,j,k).x, vel(i,j+1,k).y, 0. ) );
+	if(vel.is3D()) v[2] += 0.5 * vel(i,j,k+1).z;
+	else           v[2]  = 0.;
+	return v;
+}
+
+//! boundary values, clamping, production and source terms of a cell in one pass,
+//! same operations as KEpsilonBcs, KEpsilonComputeProduction and KEpsilonSources.
+//! optionally stores k, eps and vel for the diffusion pass
+KERNEL()
+void KnKEpsilonUpdate(const FlagGrid& flags, const MACGrid& vel, Grid<Real>& kgrid, Grid<Real>& egrid, Grid<Real>& prod, Grid<Real>& nuT,
+	Grid<Real>* strain, Grid<Real>* kcopy, Grid<Real>* ecopy, Grid<Vec3>* vcopy, Real vk, Real ve, Real minK, Real maxK, Real pscale, Real dt)
+{
+	Real ke = kgrid(i,j,k), eps = egrid(i,j,k);
+	if (flags.isObstacle(i,j,k)) {
+		ke = vk;
+		eps = ve;
+	}
+	turbulenceClamp(ke, eps, minK, maxK, keNuMin, keNuMax);
+
+	// production and turbulent viscosity, boundary cells keep their values
+	if (flags.isInBounds(Vec3i(i,j,k), 1)) {
+		if (eps > 0) {
+			Real curNu = keCmu * square(ke) / eps;
+			Vec3 ux = 0.5*(keCentered(vel,i+1,j,k)-keCentered(vel,i-1,j,k));
+			Vec3 uy = 0.5*(keCentered(vel,i,j+1,k)-keCentered(vel,i,j-1,k));
+			Vec3 uz(0.);
+			Real S2;
+			if (vel.is3D()) {
+				uz = 0.5*(keCentered(vel,i,j,k+1)-keCentered(vel,i,j,k-1));
+				S2 = strainRateSquared(vel, i,j,k, ux, uy, uz);
+			} else {
+				Vec3 diag = Vec3(vel(i+1,j,k).x, vel(i,j+1,k).y, 0.) - vel(i,j,k);
+				S2 = square(diag.x) + square(diag.y) + 2.0*square(0.5*(ux.y+uy.x));
+			}
+			prod(i,j,k) = 2.0 * curNu * S2 * pscale;
+			nuT(i,j,k) = curNu;
+			if (strain) (*strain)(i,j,k) = sqrt(S2);
+		} else {
+			prod(i,j,k) = 0;
+			nuT(i,j,k) = 0;
+			if (strain) (*strain)(i,j,k) = 0;
+		}
+	}
+
+	turbulenceSource(ke, eps, prod(i,j,k), dt);
+	turbulenceClamp(ke, eps, minK, maxK, keNuMin, keNuMax);
+	kgrid(i,j,k) = ke;
+	egrid(i,j,k) = eps;
+	if (kcopy) (*kcopy)(i,j,k) = ke;
+	if (ecopy) (*ecopy)(i,j,k) = eps;
+	if (vcopy) (*vcopy)(i,j,k) = vel(i,j,k);
+}
+
+//! Laplacian as computed by LaplaceOp, optionally of one vector component
+template<class T> inline Real keComp(const T& v, int c) { return v; }
+template<> inline Real keComp<Vec3>(const Vec3& v, int c) { return v[c]; }
+template<class T> inline Real keLaplace(const Grid<T>& g, int i, int j, int k, int c=0) {
+	Real l = keComp(g(i+1, j, k),c) - 2.0*keComp(g(i, j, k),c) + keComp(g(i-1, j, k),c);
+	l += keComp(g(i, j+1, k),c) - 2.0*keComp(g(i, j, k),c) + keComp(g(i, j-1, k),c);
+	if(g.is3D()) {
+	l += keComp(g(i, j, k+1),c) - 2.0*keComp(g(i, j, k),c) + keComp(g(i, j, k-1),c); }
+	return l;
+}
+
+//! gradient diffusion of k, eps and vel in one pass, same as KEpsilonGradientDiffusion
+KERNEL(bnd=1)
+void KnKEpsilonDiffusion(Grid<Real>& kgrid, Grid<Real>& egrid, MACGrid* vel, const Grid<Real>& kc, const Grid<Real>& ec, const Grid<Vec3>* vc,
+	const Grid<Real>& nuT, Real dt, Real sigmaU)
+{
+	const Real nu = nuT(i,j,k);
+	Real res = keLaplace(kc,i,j,k);
+	res *= nu;
+	res *= dt/keS1;
+	kgrid(i,j,k) = kc(i,j,k) + res;
+
+	res = keLaplace(ec,i,j,k);
+	res *= nu;
+	res *= dt/keS2;
+	egrid(i,j,k) = ec(i,j,k) + res;
+
+	if (vel) {
+		for (int c=0; c<3; c++) {
+			res = keLaplace(*vc,i,j,k,c);
+			res *= nu;
+			res *= dt/sigmaU;
+			(*vel)(i,j,k)[c] = (*vc)(i,j,k)[c] + res;
+		}
+	}
+}
+
+KEpsilonModel::KEpsilonModel(FluidSolver* parent) :
+	PbClass(parent), mK(nullptr), mEps(nullptr), mVel(nullptr)
+{}
+
+KEpsilonModel::~KEpsilonModel() {
+	releaseGrids();
+}
+
+void KEpsilonModel::allocGrids() {
+	if(mK) return;
+	mK   = new Grid<Real>(getParent(), false);
+	mEps = new Grid<Real>(getParent(), false);
+	mVel = new Grid<Vec3>(getParent(), false);
+}
+
+void KEpsilonModel::releaseGrids() {
+	if(mK)   delete mK;
+	if(mEps) delete mEps;
+	if(mVel) delete mVel;
+	mK = mEps = nullptr;
+	mVel = nullptr;
+}
+
+void KEpsilonModel::step(const FlagGrid& flags, MACGrid& vel, Grid<Real>& k, Grid<Real>& eps, Grid<Real>& prod,
+	Grid<Real>& nuT, Real intensity, Real nu, Grid<Real>* strain, Real pscale, bool diffuse, bool diffuseVel, Real sigmaU)
+{
+	const Real dt = k.getParent()->getDt();
+	// boundary values and limits
+	const Real vk = 1.5*square(keU0)*square(intensity);
+	const Real ve = keCmu*square(vk) / nu;
+	const Real minK = 1.5*square(keU0)*square(keImin);
+	const Real maxK = 1.5*square(keU0)*square(keImax);
+
+	if(diffuse) allocGrids();
+	KnKEpsilonUpdate(flags, vel, k, eps, prod, nuT, strain, diffuse ? mK : NULL, diffuse ? mEps : NULL,
+		(diffuse && diffuseVel) ? mVel : NULL, vk, ve, minK, maxK, pscale, dt);
+	if(diffuse)
+		KnKEpsilonDiffusion(k, eps, diffuseVel ? &vel : NULL, *mK, *mEps, mVel, nuT, dt, sigmaU);
+}
+
 } // namespace
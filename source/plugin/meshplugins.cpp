@@ -24,6 +24,7 @@
 #include "mesh.h"
 #include "kernel.h"
 #include "edgecollapse.h"
+#include "components.h"
 #include <mesh.h>
 #include <stack>
 
@@ -562,41 +563,22 @@ PYTHON() void subdivideMesh(Mesh& mesh, Real minAngle, Real minLength, Real maxL
 	
 PYTHON() void killSmallComponents(Mesh& mesh, int elements = 10) {
 	const int num = mesh.numTris();
-	vector<int> comp(num);
-	vector<int> numEl;
 	vector<int> deletedNodes;
 	vector<bool> isNodeDel(mesh.numNodes());
 	map<int,bool> taintedTris;
-	// enumerate components
-	int cur=0;
+	// enumerate components, triangles are connected over their edges
+	UnionFind comp(num);
 	for (int i=0; i<num; i++) {
-		if (comp[i]==0) {
-			cur++;
-			comp[i] = cur;
-			
-			stack<int> stack;
-			stack.push(i);
-			int cnt = 1;
-			while(!stack.empty()) {
-				int tri = stack.top();
-				stack.pop();
-				for (int c=0; c<3; c++) {
-					int op = mesh.corners(tri,c).opposite;
-					if (op < 0) continue;
-					int ntri = mesh.corners(op).tri;
-					if (comp[ntri]==0) {
-						comp[ntri] = cur;
-						stack.push(ntri);
-						cnt++;
-					}
-				}
-			}
-			numEl.push_back(cnt);
+		for (int c=0; c<3; c++) {
+			int op = mesh.corners(i,c).opposite;
+			if (op >= 0) comp.unite(i, mesh.corners(op).tri);
 		}
 	}
+	vector<int> numEl(num, 0);
+	for (int i=0; i<num; i++) numEl[comp.find(i)]++;
 	// kill small components
 	for (int j=0; j<num; j++) {
-		if (numEl[comp[j]-1] < elements) {
+		if (numEl[comp.find(j)] < elements) {
 			taintedTris[j] = true;
 			for (int c=0; c<3; c++) {
 				int n=mesh.tris(j).c[c];
@@ -14,30 +14,36 @@
 #include "kernel.h"
 #include "conjugategrad.h"
 #include "multigrid.h"
+#include "pressuresolver.h"
+#include "decomposition.h"
+#include <cstring>
 
 using namespace std;
 namespace Manta {
 
-//! Preconditioner for CG solver
-// - None: Use standard CG
-// - MIC: Modified incomplete Cholesky preconditioner
-// - MGDynamic: Multigrid preconditioner, rebuilt for each solve
-// - MGStatic: Multigrid preconditioner, built only once (faster than
-//       MGDynamic, but works only if Poisson equation does not change)
-enum Preconditioner { PcNone = 0, PcMIC = 1, PcMGDynamic = 2, PcMGStatic = 3 };
-
 inline static Real surfTensHelper(const IndexInt idx, const int offset, const Grid<Real> &phi, const Grid<Real> &curv, const Real surfTens, const Real gfClamp);
 
+//! neighbor of cell idx at offset is empty, from the neighbor mask of the compact flags if available
+inline static bool isEmptyFace(const FlagGrid& flags, const CompactFlags* cflags, uint32_t mask,
+	IndexInt idx, IndexInt offset, CompactFlags::Face face)
+{
+	return cflags ? (mask & CompactFlags::nb(CompactFlags::NbEmpty, face)) != 0 : flags.isEmpty(idx+offset);
+}
+
 //! Kernel: Construct the right-hand side of the poisson equation
+//! cflags: compact flags, optional, replace the flag lookups
 KERNEL(bnd=1, reduce=+) returns(int cnt=0) returns(double sum=0)
 void MakeRhs(
 	const FlagGrid& flags, Grid<Real>& rhs, const MACGrid& vel,
 	const Grid<Real>* perCellCorr, const MACGrid* fractions, const MACGrid* obvel,
 	// note - all of the following are necessary for surface tension
-	const Grid<Real> *phi, const Grid<Real> *curv, const Real surfTens, const Real gfClamp)
+	const Grid<Real> *phi, const Grid<Real> *curv, const Real surfTens, const Real gfClamp,
+	const CompactFlags* cflags)
 {
-	if(!flags.isFluid(i,j,k)) {
-		rhs(i,j,k) = 0;
+	const IndexInt idx = flags.index(i,j,k);
+	const uint32_t mask = cflags ? cflags->getMask(idx) : 0;
+	if(cflags ? !(mask & FlagGrid::TypeFluid) : !flags.isFluid(idx)) {
+		rhs[idx] = 0;
 		return;
 	}
 
@@ -60,15 +66,14 @@ void MakeRhs(
 
 	// compute surface tension effect (optional)
 	if(phi && curv) {
-		const IndexInt idx = flags.index(i,j,k);
 		const int X = flags.getStrideX(), Y = flags.getStrideY(), Z = flags.getStrideZ();
-		if(flags.isEmpty(i-1,j,k))         set += surfTensHelper(idx, -X, *phi, *curv, surfTens, gfClamp);
-		if(flags.isEmpty(i+1,j,k))         set += surfTensHelper(idx, +X, *phi, *curv, surfTens, gfClamp);
-		if(flags.isEmpty(i,j-1,k))         set += surfTensHelper(idx, -Y, *phi, *curv, surfTens, gfClamp);
-		if(flags.isEmpty(i,j+1,k))         set += surfTensHelper(idx, +Y, *phi, *curv, surfTens, gfClamp);
+		if(isEmptyFace(flags, cflags, mask, idx, -X, CompactFlags::FaceXm)) set += surfTensHelper(idx, -X, *phi, *curv, surfTens, gfClamp);
+		if(isEmptyFace(flags, cflags, mask, idx, +X, CompactFlags::FaceXp)) set += surfTensHelper(idx, +X, *phi, *curv, surfTens, gfClamp);
+		if(isEmptyFace(flags, cflags, mask, idx, -Y, CompactFlags::FaceYm)) set += surfTensHelper(idx, -Y, *phi, *curv, surfTens, gfClamp);
+		if(isEmptyFace(flags, cflags, mask, idx, +Y, CompactFlags::FaceYp)) set += surfTensHelper(idx, +Y, *phi, *curv, surfTens, gfClamp);
 		if(vel.is3D()) {
-			if(flags.isEmpty(i,j,k-1)) set += surfTensHelper(idx, -Z, *phi, *curv, surfTens, gfClamp);
-			if(flags.isEmpty(i,j,k+1)) set += surfTensHelper(idx, +Z, *phi, *curv, surfTens, gfClamp);
+			if(isEmptyFace(flags, cflags, mask, idx, -Z, CompactFlags::FaceZm)) set += surfTensHelper(idx, -Z, *phi, *curv, surfTens, gfClamp);
+			if(isEmptyFace(flags, cflags, mask, idx, +Z, CompactFlags::FaceZp)) set += surfTensHelper(idx, +Z, *phi, *curv, surfTens, gfClamp);
 		}
 	}
 
@@ -80,7 +85,7 @@ void MakeRhs(
 	sum += set;
 	cnt++;
 
-	rhs(i,j,k) = set;
+	rhs[idx] = set;
 }
 
 //! Kernel: make velocity divergence free by subtracting pressure gradient
@@ -108,6 +113,33 @@ void knCorrectVelocity(const FlagGrid& flags, MACGrid& vel, const Grid<Real>& pr
 	}
 }
 
+//! Kernel: knCorrectVelocity with the cell type and neighbor faces of compact flags, one load per cell
+KERNEL(bnd = 1)
+void knCorrectVelocityCompact(const CompactFlags& cflags, MACGrid& vel, const Grid<Real>& pressure)
+{
+	const IndexInt X = vel.getStrideX(), Y = vel.getStrideY(), Z = vel.getStrideZ();
+	const IndexInt idx = vel.index(i,j,k);
+	const uint32_t m = cflags.getMask(idx);
+	if(m & FlagGrid::TypeFluid) {
+		if(                m & CompactFlags::nb(CompactFlags::NbFluid, CompactFlags::FaceXm)) vel[idx].x -= (pressure[idx] - pressure[idx-X]);
+		if(                m & CompactFlags::nb(CompactFlags::NbFluid, CompactFlags::FaceYm)) vel[idx].y -= (pressure[idx] - pressure[idx-Y]);
+		if(vel.is3D() &&  (m & CompactFlags::nb(CompactFlags::NbFluid, CompactFlags::FaceZm))) vel[idx].z -= (pressure[idx] - pressure[idx-Z]);
+
+		if(                m & CompactFlags::nb(CompactFlags::NbEmpty, CompactFlags::FaceXm)) vel[idx].x -= pressure[idx];
+		if(                m & CompactFlags::nb(CompactFlags::NbEmpty, CompactFlags::FaceYm)) vel[idx].y -= pressure[idx];
+		if(vel.is3D() &&  (m & CompactFlags::nb(CompactFlags::NbEmpty, CompactFlags::FaceZm))) vel[idx].z -= pressure[idx];
+	} else if((m & FlagGrid::TypeEmpty) && !(m & FlagGrid::TypeOutflow)) { // don't change velocities in outflow cells
+		if(m & CompactFlags::nb(CompactFlags::NbFluid, CompactFlags::FaceXm)) vel[idx].x += pressure[idx-X];
+		else                                                                  vel[idx].x  = 0.f;
+		if(m & CompactFlags::nb(CompactFlags::NbFluid, CompactFlags::FaceYm)) vel[idx].y += pressure[idx-Y];
+		else                                                                  vel[idx].y  = 0.f;
+		if(vel.is3D()) {
+			if(m & CompactFlags::nb(CompactFlags::NbFluid, CompactFlags::FaceZm)) vel[idx].z += pressure[idx-Z];
+			else                                                                  vel[idx].z  = 0.f;
+		}
+	}
+}
+
 // *****************************************************************************
 // Ghost fluid helpers
 
@@ -150,6 +182,23 @@ void ApplyGhostFluidDiagonal(Grid<Real> &A0, const FlagGrid &flags, const Grid<R
 	}
 }
 
+//! Kernel: Adapt diagonal of a compact system for ghost fluid, see ApplyGhostFluidDiagonal
+KERNEL(pts)
+void ApplyGhostFluidDiagonalCompact(std::vector<Real> &diag, const std::vector<IndexInt> &cells, const FlagGrid &flags, const Grid<Real> &phi, const Real gfClamp)
+{
+	const int X = flags.getStrideX(), Y = flags.getStrideY(), Z = flags.getStrideZ();
+	const IndexInt gi = cells[idx];
+
+	if(flags.isEmpty(gi-X))         diag[idx] -= ghostFluidHelper(gi, -X, phi, gfClamp);
+	if(flags.isEmpty(gi+X))         diag[idx] -= ghostFluidHelper(gi, +X, phi, gfClamp);
+	if(flags.isEmpty(gi-Y))         diag[idx] -= ghostFluidHelper(gi, -Y, phi, gfClamp);
+	if(flags.isEmpty(gi+Y))         diag[idx] -= ghostFluidHelper(gi, +Y, phi, gfClamp);
+	if(flags.is3D()) {
+		if(flags.isEmpty(gi-Z)) diag[idx] -= ghostFluidHelper(gi, -Z, phi, gfClamp);
+		if(flags.isEmpty(gi+Z)) diag[idx] -= ghostFluidHelper(gi, +Z, phi, gfClamp);
+	}
+}
+
 //! Kernel: Apply velocity update: ghost fluid contribution
 KERNEL(bnd=1)
 void knCorrectVelocityGhostFluid(
@@ -244,6 +293,45 @@ void fixPressure(int fixPidx, Real value, Grid<Real>& rhs, Grid<Real>& A0, Grid<
 	if(rhs.is3D()) { Ak[fixPidx - Ak.getStrideZ()] = Real(0); }
 }
 
+//! Determine cell for zeroPressureFixing, returns -1 if there are empty cells (no fixing needed)
+static IndexInt findPressureFixingCell(const FlagGrid& flags)
+{
+	if(FLOATINGPOINT_PRECISION==1) debMsg("Warning - high CG accuracy with single-precision floating point accuracy might not converge...", 2);
+
+	int numEmpty = CountEmptyCells(flags);
+	IndexInt fixPidx = -1;
+	if(numEmpty==0) {
+		// Determine appropriate fluid cell for pressure fixing
+		// 1) First check some preferred positions for approx. symmetric zeroPressureFixing
+		Vec3i topCenter(flags.getSizeX() / 2, flags.getSizeY() - 1, flags.is3D() ? flags.getSizeZ() / 2 : 0);
+		Vec3i preferredPos [] = { topCenter,
+					  topCenter - Vec3i(0,1,0),
+					  topCenter - Vec3i(0,2,0) };
+
+		for (Vec3i pos : preferredPos) {
+			if(flags.isFluid(pos)) {
+				fixPidx = flags.index(pos);
+				break;
+			}
+		}
+
+		// 2) Then search whole domain
+		if(fixPidx == -1) {
+			FOR_IJK_BND(flags,1) {
+				if(flags.isFluid(i,j,k)) {
+					fixPidx = flags.index(i,j,k);
+					// break FOR_IJK_BND loop
+					i = flags.getSizeX()-1;
+					j = flags.getSizeY()-1;
+					k = __kmax;
+				}
+			}
+		}
+		//debMsg("No empty cells! Fixing pressure of cell "<<fixPidx<<" to zero",1);
+	}
+	return fixPidx;
+}
+
 // for "static" MG mode, keep one MG data structure per fluid solver
 // leave cleanup to OS/user if nonzero at program termination (PcMGStatic mode)
 // alternatively, manually release in scene file with releaseMG
@@ -273,6 +361,13 @@ PYTHON() void releaseMG(FluidSolver* solver=nullptr) {
 // identical parameters, apart from the RHS grid (and different const values)
 
 
+//! compact flags have to be computed for the flags of the solve
+static void checkCompactFlags(const CompactFlags* cflags, const FlagGrid& flags)
+{
+	if(cflags && !cflags->isValid(flags))
+		errMsg("solvePressure: compact flags don't match the size of the flag grid, call update(flags) first");
+}
+
 //! Compute rhs for pressure solve
 PYTHON() void computePressureRhs(
 	Grid<Real>& rhs, const MACGrid& vel,
@@ -289,15 +384,173 @@ PYTHON() void computePressureRhs(
 	bool useL2Norm = false,
 	bool zeroPressureFixing = false,
 	const Grid<Real> *curv = NULL,
-	const Real surfTens = 0. )
+	const Real surfTens = 0.,
+	DomainDecomposition* decomposition = nullptr,
+	const CompactFlags* cflags = nullptr )
 {
+	checkCompactFlags(cflags, flags);
+
 	// compute divergence and init right hand side
-	MakeRhs kernMakeRhs (flags, rhs, vel, perCellCorr, fractions, obvel, phi, curv, surfTens, gfClamp );
+	MakeRhs kernMakeRhs (flags, rhs, vel, perCellCorr, fractions, obvel, phi, curv, surfTens, gfClamp, cflags );
+
+	if(decomposition && decomposition->isActive()) {
+		if(enforceCompatibility) errMsg("computePressureRhs: enforceCompatibility is not supported for decomposed domains");
+		// ghost cells belong to the neighboring ranks
+		decomposition->clearGhosts(rhs);
+		return;
+	}
 
 	if(enforceCompatibility)
 		rhs += (Real)(-kernMakeRhs.sum / (Real)kernMakeRhs.cnt);
 }
 
+//! Max. number of CG iterations, MG converges in few iterations
+//! note: the last factor increases the max iterations for 2d, where a larger fraction of
+//! the cells are active boundary cells; converging solves stop early anyway
+static int pressureMaxIter(const FlagGrid& flags, Real cgMaxIterFac, int preconditioner)
+{
+	if(preconditioner == PcMGDynamic || preconditioner == PcMGStatic) return 100;
+	return (int)(cgMaxIterFac * flags.getSize().max()) * (flags.is3D() ? 1 : 4);
+}
+
+//! Assemble compact system (see CompactCg), returns pinned cell or -1
+static IndexInt setupPressureSystemCompact(CompactCg& cg, const FlagGrid& flags, Real cgAccuracy,
+	const Grid<Real>* phi, const MACGrid* fractions, Real gfClamp, int preconditioner, bool zeroPressureFixing)
+{
+	cg.build(flags, fractions);
+
+	if(phi) {
+		ApplyGhostFluidDiagonalCompact(cg.getDiagonal(), cg.getCells(), flags, *phi, gfClamp);
+	}
+
+	IndexInt fixPidx = -1;
+	if(zeroPressureFixing || cgAccuracy<1e-07) {
+		fixPidx = findPressureFixingCell(flags);
+		if(fixPidx>=0) {
+			cg.fixCell(fixPidx);
+			static bool msgOnce = false;
+			if(!msgOnce) { debMsg("Pinning pressure of cell "<<fixPidx<<" to zero", 2); msgOnce=true; }
+		}
+	}
+
+	if(preconditioner == PcMGDynamic || preconditioner == PcMGStatic) {
+		static bool msgOnce = false;
+		if(!msgOnce) { debMsg("solvePressure: multigrid preconditioning needs the full grid, using MIC for compact system", 1); msgOnce=true; }
+		preconditioner = PcMIC;
+	}
+	cg.setPreconditioner(preconditioner == PcMIC ? GridCgInterface::PC_mICP : GridCgInterface::PC_None);
+	return fixPidx;
+}
+
+//! Solve an assembled compact system
+static void runPressureSolveCompact(CompactCg& cg, Grid<Real>& rhs, Grid<Real>& pressure, const FlagGrid& flags,
+	Real cgAccuracy, Real cgMaxIterFac, bool useL2Norm, IndexInt fixPidx)
+{
+	if(fixPidx>=0) rhs[fixPidx] = 0.;
+	cg.setAccuracy(cgAccuracy);
+	cg.setUseL2Norm(useL2Norm);
+
+	cg.solve(pressure, rhs, pressureMaxIter(flags, cgMaxIterFac, PcMIC));
+	debMsg("FluidSolver::solvePressure (compact, "<<cg.getNumCells()<<" cells) done. Iterations:"<<cg.getIterations()<<", residual:"<<cg.getResNorm(), 2);
+}
+
+//! Solve pressure system on a compact list of fluid cells (see CompactCg)
+//! the system and all CG temporaries scale with the number of fluid cells, not the domain size
+static void solvePressureSystemCompact(
+	Grid<Real>& rhs, Grid<Real>& pressure, const FlagGrid& flags, Real cgAccuracy,
+	const Grid<Real>* phi, const MACGrid* fractions, Real gfClamp, Real cgMaxIterFac,
+	int preconditioner, bool useL2Norm, bool zeroPressureFixing)
+{
+	CompactCg cg;
+	IndexInt fixPidx = setupPressureSystemCompact(cg, flags, cgAccuracy, phi, fractions, gfClamp, preconditioner, zeroPressureFixing);
+	runPressureSolveCompact(cg, rhs, pressure, flags, cgAccuracy, cgMaxIterFac, useL2Norm, fixPidx);
+}
+
+//! Assemble poisson matrix, incl. ghost fluid and pressure fixing, returns pinned cell or -1
+static IndexInt setupPressureMatrix(Grid<Real>& rhs, const FlagGrid& flags, Grid<Real>& A0, Grid<Real>& Ai, Grid<Real>& Aj, Grid<Real>& Ak,
+	Real cgAccuracy, const Grid<Real>* phi, const MACGrid* fractions, Real gfClamp, bool zeroPressureFixing,
+	bool decomposed = false)
+{
+	MakeLaplaceMatrix(flags, A0, Ai, Aj, Ak, fractions);
+
+	if(phi) {
+		ApplyGhostFluidDiagonal(A0, flags, *phi, gfClamp);
+	}
+
+	// check whether we need to fix some pressure value...
+	// (manually enable, or automatically for high accuracy, can cause asymmetries otherwise)
+	// (not for decomposed domains, the local parts are not singular)
+	IndexInt fixPidx = -1;
+	if(!decomposed && (zeroPressureFixing || cgAccuracy<1e-07)) {
+		fixPidx = findPressureFixingCell(flags);
+		if(fixPidx>=0) {
+			fixPressure(fixPidx, Real(0), rhs, A0, Ai, Aj, Ak);
+			static bool msgOnce = false;
+			if(!msgOnce) { debMsg("Pinning pressure of cell "<<fixPidx<<" to zero", 2); msgOnce=true; }
+		}
+	}
+	return fixPidx;
+}
+
+//! Run CG iterations until convergence or maxIter
+static void runPressureCg(GridCgInterface* gcg, int maxIter)
+{
+	for (int iter=0; iter<maxIter; iter++) {
+		if(!gcg->iterate()) iter=maxIter;
+		if(iter<maxIter) debMsg("FluidSolver::solvePressure iteration "<<iter<<", residual: "<<gcg->getResNorm(), 9);
+	}
+	debMsg("FluidSolver::solvePressure done. Iterations:"<<gcg->getIterations()<<", residual:"<<gcg->getResNorm(), 2);
+}
+
+//! Solve the local part of a decomposed pressure system, the CG exchanges halos and reduces globally
+static void solvePressureSystemDecomposed(
+	Grid<Real>& rhs, Grid<Real>& pressure, const FlagGrid& flags, Real cgAccuracy,
+	const Grid<Real>* phi, const MACGrid* fractions, Real gfClamp, Real cgMaxIterFac,
+	int preconditioner, bool useL2Norm, bool compactSystem, DomainDecomposition& decomposition)
+{
+	if(compactSystem) errMsg("solvePressureSystem: compactSystem is not supported for decomposed domains");
+	if(preconditioner == PcMGDynamic || preconditioner == PcMGStatic) {
+		static bool msgOnce = false;
+		if(!msgOnce) { debMsg("solvePressureSystem: multigrid preconditioning is not supported for decomposed domains, using MIC", 1); msgOnce=true; }
+		preconditioner = PcMIC;
+	}
+
+	// the outermost ghost layer closes the local system, the inner ghost cells couple to the neighbors
+	FluidSolver* parent = flags.getParent();
+	FlagGrid sysFlags(parent);
+	sysFlags.copyFrom(flags);
+	decomposition.markGhostBoundary(sysFlags);
+
+	Grid<Real> residual(parent);
+	Grid<Real> search(parent);
+	Grid<Real> A0(parent);
+	Grid<Real> Ai(parent);
+	Grid<Real> Aj(parent);
+	Grid<Real> Ak(parent);
+	Grid<Real> tmp(parent);
+	Grid<Real> pca0(parent);
+	Grid<Real> pca1(parent);
+	Grid<Real> pca2(parent);
+	Grid<Real> pca3(parent);
+	setupPressureMatrix(rhs, sysFlags, A0, Ai, Aj, Ak, cgAccuracy, phi, fractions, gfClamp, false, true);
+
+	GridCgInterface *gcg;
+	if(flags.is3D())
+		gcg = new GridCg<ApplyMatrix>  (pressure, rhs, residual, search, sysFlags, tmp, &A0, &Ai, &Aj, &Ak);
+	else
+		gcg = new GridCg<ApplyMatrix2D>(pressure, rhs, residual, search, sysFlags, tmp, &A0, &Ai, &Aj, &Ak);
+	gcg->setAccuracy( cgAccuracy );
+	gcg->setUseL2Norm( useL2Norm );
+	gcg->setDecomposition( &decomposition );
+	gcg->setICPreconditioner( preconditioner == PcMIC ? GridCgInterface::PC_mICP : GridCgInterface::PC_None,
+		&pca0, &pca1, &pca2, &pca3);
+
+	runPressureCg(gcg, pressureMaxIter(flags, cgMaxIterFac, preconditioner));
+	delete gcg;
+
+	decomposition.exchange(&pressure);
+}
+
 //! Build and solve pressure system of equations
 //! perCellCorr: a divergence correction for each cell, optional
 //! fractions: for 2nd order obstacle boundaries, optional
@@ -309,6 +562,11 @@ PYTHON() void computePressureRhs(
 //! curv: curvature for surface tension effects
 //! surfTens: surface tension coefficient
 //! retRhs: return RHS divergence, e.g., for debugging; optional
+//! compactSystem: only store and iterate fluid cells, recommended for liquids (no multigrid preconditioning)
+//! decomposition: solve the part of a decomposed domain owned by this rank (see DomainDecomposition),
+//!                with a block MIC preconditioner per rank
+//! cflags: one byte cell types and neighbor masks of the flags (see CompactFlags), optional;
+//!         built by solvePressure if not given
 PYTHON() void solvePressureSystem(
 	Grid<Real>& rhs, MACGrid& vel,
 	Grid<Real>& pressure, const FlagGrid& flags, Real cgAccuracy = 1e-3,
@@ -323,9 +581,25 @@ PYTHON() void solvePressureSystem(
 	const bool useL2Norm = false,
 	const bool zeroPressureFixing = false,
 	const Grid<Real> *curv = NULL,
-	const Real surfTens = 0.)
+	const Real surfTens = 0.,
+	bool compactSystem = false,
+	DomainDecomposition* decomposition = nullptr,
+	const CompactFlags* cflags = nullptr)
 {
 	if(precondition==false) preconditioner = PcNone; // for backwards compatibility
+	checkCompactFlags(cflags, flags);
+
+	if(decomposition && decomposition->isActive()) {
+		solvePressureSystemDecomposed(rhs, pressure, flags, cgAccuracy, phi, fractions, gfClamp, cgMaxIterFac,
+			preconditioner, useL2Norm, compactSystem, *decomposition);
+		return;
+	}
+
+	if(compactSystem) {
+		solvePressureSystemCompact(rhs, pressure, flags, cgAccuracy, phi, fractions, gfClamp, cgMaxIterFac,
+			preconditioner, useL2Norm, zeroPressureFixing);
+		return;
+	}
 
 	// reserve temp grids
 	FluidSolver* parent = flags.getParent();
@@ -338,57 +612,9 @@ PYTHON() void solvePressureSystem(
 	Grid<Real> tmp(parent);
 
 	// setup matrix and boundaries
-	MakeLaplaceMatrix(flags, A0, Ai, Aj, Ak, fractions);
-
-	if(phi) {
-		ApplyGhostFluidDiagonal(A0, flags, *phi, gfClamp);
-	}
-
-	// check whether we need to fix some pressure value...
-	// (manually enable, or automatically for high accuracy, can cause asymmetries otherwise)
-	if(zeroPressureFixing || cgAccuracy<1e-07) {
-		if(FLOATINGPOINT_PRECISION==1) debMsg("Warning - high CG accuracy with single-precision floating point accuracy might not converge...", 2);
-
-		int numEmpty = CountEmptyCells(flags);
-		IndexInt fixPidx = -1;
-		if(numEmpty==0) {
-			// Determine appropriate fluid cell for pressure fixing
-			// 1) First check some preferred positions for approx. symmetric zeroPressureFixing
-			Vec3i topCenter(flags.getSizeX() / 2, flags.getSizeY() - 1, flags.is3D() ? flags.getSizeZ() / 2 : 0);
-			Vec3i preferredPos [] = { topCenter,
-						  topCenter - Vec3i(0,1,0),
-						  topCenter - Vec3i(0,2,0) };
-
-			for (Vec3i pos : preferredPos) {
-				if(flags.isFluid(pos)) {
-					fixPidx = flags.index(pos);
-					break;
-				}
-			}
-
-			// 2) Then search whole domain
-			if(fixPidx == -1) {
-				FOR_IJK_BND(flags,1) {
-					if(flags.isFluid(i,j,k)) {
-						fixPidx = flags.index(i,j,k);
-						// break FOR_IJK_BND loop
-						i = flags.getSizeX()-1;
-						j = flags.getSizeY()-1;
-						k = __kmax;
-					}
-				}
-			}
-			//debMsg("No empty cells! Fixing pressure of cell "<<fixPidx<<" to zero",1);
-		}
-		if(fixPidx>=0) {
-			fixPressure(fixPidx, Real(0), rhs, A0, Ai, Aj, Ak);
-			static bool msgOnce = false;
-			if(!msgOnce) { debMsg("Pinning pressure of cell "<<fixPidx<<" to zero", 2); msgOnce=true; }
-		}
-	}
+	setupPressureMatrix(rhs, flags, A0, Ai, Aj, Ak, cgAccuracy, phi, fractions, gfClamp, zeroPressureFixing);
 
 	// CG setup
-	// note: the last factor increases the max iterations for 2d, which right now can't use a preconditioner
 	GridCgInterface *gcg;
 	if(vel.is3D())
 		gcg = new GridCg<ApplyMatrix>  (pressure, rhs, residual, search, flags, tmp, &A0, &Ai, &Aj, &Ak);
@@ -397,16 +623,15 @@ PYTHON() void solvePressureSystem(
 
 	gcg->setAccuracy( cgAccuracy );
 	gcg->setUseL2Norm( useL2Norm );
+	gcg->setCompactFlags( cflags );
 
-	int maxIter = 0;
+	const int maxIter = pressureMaxIter(flags, cgMaxIterFac, preconditioner);
 
 	Grid<Real> *pca0 = nullptr, *pca1 = nullptr, *pca2 = nullptr, *pca3 = nullptr;
 	GridMg* pmg = nullptr;
 
 	// optional preconditioning
 	if(preconditioner == PcNone || preconditioner == PcMIC) {
-		maxIter = (int)(cgMaxIterFac * flags.getSize().max()) * (flags.is3D() ? 1 : 4);
-
 		pca0 = new Grid<Real>(parent);
 		pca1 = new Grid<Real>(parent);
 		pca2 = new Grid<Real>(parent);
@@ -416,8 +641,6 @@ PYTHON() void solvePressureSystem(
 			preconditioner == PcMIC ? GridCgInterface::PC_mICP : GridCgInterface::PC_None,
 			pca0, pca1, pca2, pca3);
 	} else if(preconditioner == PcMGDynamic || preconditioner == PcMGStatic) {
-		maxIter = 100;
-
 		pmg = gMapMG[parent];
 		// Release MG from previous step if present (e.g. if previous solve was with MGStatic)
 		if (pmg && preconditioner == PcMGDynamic) {
@@ -433,11 +656,7 @@ PYTHON() void solvePressureSystem(
 	}
 
 	// CG solve
-	for (int iter=0; iter<maxIter; iter++) {
-		if(!gcg->iterate()) iter=maxIter;
-		if(iter<maxIter) debMsg("FluidSolver::solvePressure iteration "<<iter<<", residual: "<<gcg->getResNorm(), 9);
-	}
-	debMsg("FluidSolver::solvePressure done. Iterations:"<<gcg->getIterations()<<", residual:"<<gcg->getResNorm(), 2);
+	runPressureCg(gcg, maxIter);
 
 	// Cleanup
 	if(gcg)  delete gcg;
@@ -465,18 +684,27 @@ PYTHON() void correctVelocity(
 	bool useL2Norm = false,
 	bool zeroPressureFixing = false,
 	const Grid<Real> *curv = NULL,
-	const Real surfTens = 0.)
+	const Real surfTens = 0.,
+	DomainDecomposition* decomposition = nullptr,
+	const CompactFlags* cflags = nullptr)
 {
-	knCorrectVelocity(flags, vel, pressure);
+	checkCompactFlags(cflags, flags);
+	if(cflags)
+		knCorrectVelocityCompact(*cflags, vel, pressure);
+	else
+		knCorrectVelocity(flags, vel, pressure);
 	if(phi) {
 		knCorrectVelocityGhostFluid(vel, flags, pressure, *phi, gfClamp,  curv, surfTens);
 		// improve behavior of clamping for large time steps:
 		knReplaceClampedGhostFluidVels(vel, flags, pressure, *phi, gfClamp);
 	}
+	if(decomposition) decomposition->exchange(&vel);
 }
 
 //! Perform pressure projection of the velocity grid, calls
 //! all three pressure helper functions in a row.
+//! cflags: optional compact flags (see CompactFlags), replace the flag lookups of the kernels and CG
+//! iterations; built by the caller, e.g. once per step with CompactFlags.update, and shared between calls
 PYTHON() void solvePressure(
 	MACGrid& vel, Grid<Real>& pressure, const FlagGrid& flags, Real cgAccuracy = 1e-3,
 	const Grid<Real>* phi = 0,
@@ -492,7 +720,10 @@ PYTHON() void solvePressure(
 	bool zeroPressureFixing = false,
 	const Grid<Real> *curv = NULL,
 	const Real surfTens = 0.,
-	Grid<Real>* retRhs = NULL)
+	Grid<Real>* retRhs = NULL,
+	bool compactSystem = false,
+	DomainDecomposition* decomposition = nullptr,
+	const CompactFlags* cflags = nullptr)
 {
 	Grid<Real> rhs(vel.getParent());
 
@@ -500,19 +731,19 @@ PYTHON() void solvePressure(
 		rhs, vel, pressure, flags, cgAccuracy,
 		phi, perCellCorr, fractions, obvel, gfClamp,
 		cgMaxIterFac, precondition, preconditioner, enforceCompatibility,
-		useL2Norm, zeroPressureFixing, curv, surfTens);
+		useL2Norm, zeroPressureFixing, curv, surfTens, decomposition, cflags);
 
 	solvePressureSystem(
 		rhs, vel, pressure, flags, cgAccuracy,
 		phi, perCellCorr, fractions, gfClamp,
 		cgMaxIterFac, precondition, preconditioner, enforceCompatibility,
-		useL2Norm, zeroPressureFixing, curv, surfTens);
+		useL2Norm, zeroPressureFixing, curv, surfTens, compactSystem, decomposition, cflags);
 
 	correctVelocity(
 		vel, pressure, flags, cgAccuracy,
 		phi, perCellCorr, fractions, gfClamp,
 		cgMaxIterFac, precondition, preconditioner, enforceCompatibility,
-		useL2Norm, zeroPressureFixing, curv, surfTens);
+		useL2Norm, zeroPressureFixing, curv, surfTens, decomposition, cflags);
 
 	// optionally , return RHS
 	if(retRhs) {
@@ -520,4 +751,153 @@ PYTHON() void solvePressure(
 	}
 }
 
+// *****************************************************************************
+// Persistent pressure solver
+
+//! mix cell index and value bits into a well distributed hash (splitmix64 finalizer)
+inline static uint64_t hashCell(uint64_t idx, uint64_t val) {
+	uint64_t x = (idx * 0x9E3779B97F4A7C15ULL) ^ val;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+inline static uint64_t realBits(Real val) {
+	uint64_t bits = 0;
+	memcpy(&bits, &val, sizeof(Real));
+	return bits;
+}
+
+//! Kernel: order independent hash (sum of cell hashes) of the inputs of the poisson matrix
+KERNEL(idx, reduce=+) returns(uint64_t hash=0)
+uint64_t knHashPressureSystem(const FlagGrid& flags, const Grid<Real>* phi, const MACGrid* fractions) {
+	const uint64_t key = uint64_t(idx) * 5;
+	hash += hashCell(key, uint64_t(flags[idx]));
+	if(phi) hash += hashCell(key+1, realBits((*phi)[idx]));
+	if(fractions) {
+		for(int c=0; c<3; c++) hash += hashCell(key+2+c, realBits((*fractions)[idx][c]));
+	}
+}
+
+PressureSolver::PressureSolver(FluidSolver* parent) :
+	PbClass(parent), mValid(false), mHash(0), mFixPidx(-1),
+	mA0(nullptr), mAi(nullptr), mAj(nullptr), mAk(nullptr), mResidual(nullptr), mSearch(nullptr), mTmp(nullptr),
+	mPca0(nullptr), mPca1(nullptr), mPca2(nullptr), mPca3(nullptr), mMG(nullptr), mCellFlags(parent),
+	mIterations(0), mResNorm(0.), mNumRebuilds(0)
+{}
+
+PressureSolver::~PressureSolver() {
+	releaseGrids();
+}
+
+void PressureSolver::allocGrids() {
+	if(mA0) return;
+	Grid<Real>** grids[] = { &mA0, &mAi, &mAj, &mAk, &mResidual, &mSearch, &mTmp, &mPca0, &mPca1, &mPca2, &mPca3 };
+	for(Grid<Real>** g : grids) *g = new Grid<Real>(getParent(), false);
+}
+
+void PressureSolver::releaseGrids() {
+	Grid<Real>** grids[] = { &mA0, &mAi, &mAj, &mAk, &mResidual, &mSearch, &mTmp, &mPca0, &mPca1, &mPca2, &mPca3 };
+	for(Grid<Real>** g : grids) {
+		if(*g) delete *g;
+		*g = nullptr;
+	}
+	if(mMG) delete mMG;
+	mMG = nullptr;
+}
+
+uint64_t PressureSolver::computeHash(const FlagGrid& flags, const Grid<Real>* phi, const MACGrid* fractions, Real gfClamp,
+	int preconditioner, bool fixPressure, bool compactSystem) const
+{
+	uint64_t hash = knHashPressureSystem(flags, phi, fractions);
+	// settings, keyed with indices outside of the grid
+	const uint64_t key = uint64_t(flags.getSizeX()) * flags.getSizeY() * flags.getSizeZ() * 5;
+	hash += hashCell(key,   uint64_t(preconditioner) | (uint64_t(fixPressure) << 8) | (uint64_t(compactSystem) << 9));
+	hash += hashCell(key+1, phi ? realBits(gfClamp) : 0);
+	return hash;
+}
+
+void PressureSolver::solve(MACGrid& vel, Grid<Real>& pressure, const FlagGrid& flags, Real cgAccuracy,
+	const Grid<Real>* phi, const Grid<Real>* perCellCorr, const MACGrid* fractions,
+	const MACGrid* obvel, Real gfClamp, Real cgMaxIterFac, int preconditioner,
+	bool enforceCompatibility, bool useL2Norm, bool zeroPressureFixing,
+	const Grid<Real>* curv, const Real surfTens, Grid<Real>* retRhs, bool compactSystem,
+	bool warmStart)
+{
+	// only reassemble if any of the matrix inputs changed
+	const bool fixing = zeroPressureFixing || cgAccuracy<1e-07;
+	const uint64_t hash = computeHash(flags, phi, fractions, gfClamp, preconditioner, fixing, compactSystem);
+	const bool rebuild = !mValid || hash!=mHash;
+	if(rebuild) {
+		mValid = true;
+		mHash = hash;
+		mNumRebuilds++;
+		mCellFlags.update(flags);
+		debMsg("PressureSolver::solve: assembling system", 2);
+	}
+
+	Grid<Real> rhs(getParent());
+	computePressureRhs(
+		rhs, vel, pressure, flags, cgAccuracy,
+		phi, perCellCorr, fractions, obvel, gfClamp,
+		cgMaxIterFac, true, preconditioner, enforceCompatibility,
+		useL2Norm, zeroPressureFixing, curv, surfTens, nullptr, &mCellFlags);
+
+	if(compactSystem) {
+		if(rebuild) {
+			releaseGrids();
+			mFixPidx = setupPressureSystemCompact(mCompact, flags, cgAccuracy, phi, fractions, gfClamp, preconditioner, zeroPressureFixing);
+		}
+		mCompact.setUseInitialGuess(warmStart);
+		runPressureSolveCompact(mCompact, rhs, pressure, flags, cgAccuracy, cgMaxIterFac, useL2Norm, mFixPidx);
+		mIterations = mCompact.getIterations();
+		mResNorm = mCompact.getResNorm();
+	} else {
+		if(rebuild) {
+			allocGrids();
+			mA0->clear(); mAi->clear(); mAj->clear(); mAk->clear();
+			mFixPidx = setupPressureMatrix(rhs, flags, *mA0, *mAi, *mAj, *mAk, cgAccuracy, phi, fractions, gfClamp, zeroPressureFixing);
+			if(mMG) delete mMG;
+			mMG = nullptr;
+		} else if(mFixPidx>=0) {
+			rhs[mFixPidx] = 0.;
+		}
+
+		GridCgInterface *gcg;
+		if(vel.is3D())
+			gcg = new GridCg<ApplyMatrix>  (pressure, rhs, *mResidual, *mSearch, flags, *mTmp, mA0, mAi, mAj, mAk);
+		else
+			gcg = new GridCg<ApplyMatrix2D>(pressure, rhs, *mResidual, *mSearch, flags, *mTmp, mA0, mAi, mAj, mAk);
+		gcg->setAccuracy( cgAccuracy );
+		gcg->setUseL2Norm( useL2Norm );
+		gcg->setUseInitialGuess( warmStart );
+		gcg->setCompactFlags( &mCellFlags );
+
+		if(preconditioner == PcNone || preconditioner == PcMIC) {
+			gcg->setICPreconditioner(
+				preconditioner == PcMIC ? GridCgInterface::PC_mICP : GridCgInterface::PC_None,
+				mPca0, mPca1, mPca2, mPca3);
+			gcg->setReusePreconditioner(!rebuild);
+		} else if(preconditioner == PcMGDynamic || preconditioner == PcMGStatic) {
+			if(!mMG) mMG = new GridMg(pressure.getSize());
+			gcg->setMGPreconditioner( GridCgInterface::PC_MGP, mMG);
+		}
+
+		runPressureCg(gcg, pressureMaxIter(flags, cgMaxIterFac, preconditioner));
+		mIterations = gcg->getIterations();
+		mResNorm = gcg->getResNorm();
+		delete gcg;
+	}
+
+	correctVelocity(
+		vel, pressure, flags, cgAccuracy,
+		phi, perCellCorr, fractions, gfClamp,
+		cgMaxIterFac, true, preconditioner, enforceCompatibility,
+		useL2Norm, zeroPressureFixing, curv, surfTens, nullptr, &mCellFlags);
+
+	if(retRhs) {
+		retRhs->copyFrom(rhs);
+	}
+}
+
 } // end namespace
@@ -115,7 +115,7 @@ void knFlipSampleSecondaryParticlesMoreCylinders(
 
 	if (!(flags(i, j, k) & itype)) return;
 
-	static RandomStream mRand(9832);
+	static RandomStream mRand(9832, "knFlipSampleSecondaryParticlesMoreCylinders");
 	Real radius = 0.25;	//diameter=0.5 => sampling with two cylinders in each dimension since cell size=1
 	for (Real x = i - radius; x <= i + radius; x += 2 * radius) {
 		for (Real y = j - radius; y <= j + radius; y += 2 * radius) {
@@ -172,7 +172,7 @@ void knFlipSampleSecondaryParticles(
 
 	const int n = KE * (k_ta*TA + k_wc*WC) * dt;		//number of secondary particles
 	if (n == 0) return;
-	static RandomStream mRand(9832);
+	static RandomStream mRand(9832, "knFlipSampleSecondaryParticles");
 
 	Vec3 xi = Vec3(i, j, k) + mRand.getVec3(); //randomized offset uniform in cell
 	Vec3 vi = v.getInterpolated(xi);
@@ -12,6 +12,7 @@
  ******************************************************************************/
 
 #include "levelset.h"
+#include "components.h"
 #include "commonkernels.h"
 #include "particle.h"
 #include <cmath>
@@ -147,62 +148,72 @@ void extractFeatureGeo(
 	knExtractFeatureGeo(p, reinterpret_cast<Real*>(fv.pData), N_row, off_begin, flag, scale, ptype, exclude, window);
 }
 
+//! extract training tiles
+
+// from tileplugins.cpp
+int extractTilesToBuffer(Real* buffer, int numSlots, int channels, Vec3i tileSize, const Grid<Real>* density, const GridBase* vel,
+	Vec3i strides, Real densityMinimum, Vec3 rotation, Vec3i flip, const Grid<Real>* selectDensity, Real velScale);
+
+//! cut tiles directly into a preallocated numpy batch of shape [tiles, z, y, x, channels], see extractTiles
+PYTHON()
+int extractTilesNumpy(
+	PyArrayContainer batch, const Grid<Real>* density=NULL, const GridBase* vel=NULL,
+	Vec3i strides=Vec3i(0), Real densityMinimum=0., Vec3 rotation=Vec3(0.), Vec3i flip=Vec3i(0), int startTile=0,
+	const Grid<Real>* selectDensity=NULL, Real velScale=1.)
+{
+	if(batch.Dims.size()!=5) errMsg("extractTilesNumpy: batch needs the shape [tiles, z, y, x, channels]");
+	if(startTile<0 || startTile>=batch.Dims[0]) errMsg("extractTilesNumpy: start tile "<<startTile<<" outside of batch");
+	const Vec3i tileSize(batch.Dims[3], batch.Dims[2], batch.Dims[1]);
+	const int channels = batch.Dims[4];
+	const IndexInt tileValues = (IndexInt)tileSize.x * tileSize.y * tileSize.z * channels;
+	return extractTilesToBuffer(reinterpret_cast<Real*>(batch.pData) + startTile*tileValues, batch.Dims[0]-startTile, channels, tileSize,
+		density, vel, strides, densityMinimum, rotation, flip, selectDensity, velScale);
+}
+
 
 // non-numpy related helpers
 
-//! region detection functions
+//! region detection functions, regions are numbered 1..n in the order of their first cell
 
-void floodFillRegion(Grid<int> &r, const FlagGrid &flags, const IndexInt idx, const int c, const int type)
+PYTHON() int getRegions(Grid<int> &r, const FlagGrid &flags, const int ctype)
 {
-	r(idx) = c;
-	if((flags(idx-flags.getStrideX()) & type) && !r[idx-flags.getStrideX()]) floodFillRegion(r, flags, idx-flags.getStrideX(), c, type);
-	if((flags(idx+flags.getStrideX()) & type) && !r[idx+flags.getStrideX()]) floodFillRegion(r, flags, idx+flags.getStrideX(), c, type);
-	if((flags(idx-flags.getStrideY()) & type) && !r[idx-flags.getStrideY()]) floodFillRegion(r, flags, idx-flags.getStrideY(), c, type);
-	if((flags(idx+flags.getStrideY()) & type) && !r[idx+flags.getStrideY()]) floodFillRegion(r, flags, idx+flags.getStrideY(), c, type);
-	if(!flags.is3D()) return;
-	if((flags(idx-flags.getStrideZ()) & type) && !r[idx-flags.getStrideZ()]) floodFillRegion(r, flags, idx-flags.getStrideZ(), c, type);
-	if((flags(idx+flags.getStrideZ()) & type) && !r[idx+flags.getStrideZ()]) floodFillRegion(r, flags, idx+flags.getStrideZ(), c, type);
+	ConnectedComponents comps(flags.getParent());
+	return comps.labelFlags(r, flags, ctype);
 }
 
-PYTHON() int getRegions(Grid<int> &r, const FlagGrid &flags, const int ctype)
+PYTHON() void getRegionalCounts(Grid<int> &r, const FlagGrid &flags, const int ctype)
 {
-	r.clear();
-	int n_regions = 0;
+	ConnectedComponents comps(flags.getParent());
+	comps.labelFlags(r, flags, ctype);
+	comps.labelsToSizes(r);
+}
 
-	FOR_IDX(flags) {
-		if((flags(idx) & ctype) && !r(idx)) floodFillRegion(r, flags, idx, ++n_regions, ctype);
-	}
-	return n_regions;
+//! Kernel: mark cells next to the region
+KERNEL(idx)
+void knExtendRegionMark(Grid<int> &update, const FlagGrid &flags, const int region, const int exclude)
+{
+	update[idx] = 0;
+	if(flags[idx] & exclude) return;
+	const int i = idx % flags.getSizeX(), j = (idx / flags.getSizeX()) % flags.getSizeY(), k = idx / (flags.getSizeX()*flags.getSizeY());
+	const int I=flags.getSizeX()-1, J=flags.getSizeY()-1, K=flags.getSizeZ()-1;
+	if((i>0 && (flags[idx-flags.getStrideX()]&region)) || (i<I && (flags[idx+flags.getStrideX()]&region)) ||
+	   (j>0 && (flags[idx-flags.getStrideY()]&region)) || (j<J && (flags[idx+flags.getStrideY()]&region)) ||
+	   (flags.is3D() && ((k>0 && (flags[idx-flags.getStrideZ()]&region)) || (k<K && (flags[idx+flags.getStrideZ()]&region)))))
+		update[idx] = 1;
 }
 
-PYTHON() void getRegionalCounts(Grid<int> &r, const FlagGrid &flags, const int ctype)
+KERNEL(idx)
+void knExtendRegionApply(FlagGrid &flags, const Grid<int> &update, const int region)
 {
-	const int n_regions = getRegions(r, flags, ctype);
-	std::vector<int> cnt(n_regions+1, 0);
-	FOR_IDX(flags) {
-		if(r[idx]>0) ++(cnt[r[idx]]);
-	}
-	FOR_IDX(flags) {
-		r[idx] = cnt[r[idx]];
-	}
+	if(update[idx]) flags[idx] = region;
 }
 
 PYTHON() void extendRegion(FlagGrid &flags, const int region, const int exclude, const int depth)
 {
-	const int I=flags.getSizeX()-1, J=flags.getSizeY()-1, K=flags.getSizeZ()-1;
+	Grid<int> update(flags.getParent());
 	for(int i_depth=0; i_depth<depth; ++i_depth) {
-		std::vector<int> update;
-		FOR_IJK(flags) {
-			if(flags.get(i, j, k) & exclude) continue;
-			if((i>0 && (flags.get(i-1, j, k)&region)) || (i<I && (flags.get(i+1, j, k)&region)) ||
-			   (j>0 && (flags.get(i, j-1, k)&region)) || (j<J && (flags.get(i, j+1, k)&region)) ||
-			   (flags.is3D() && ((k>0 && (flags.get(i, j, k-1)&region)) || (k<K && (flags.get(i, j, k+1)&region)))))
-				update.push_back(flags.index(i, j, k));
-		}
-
-		for(std::vector<int>::const_iterator it=update.begin(); it!=update.end(); ++it) {
-			flags[*it] = region;
-		}
+		knExtendRegionMark(update, flags, region, exclude);
+		knExtendRegionApply(flags, update, region);
 	}
 }
 
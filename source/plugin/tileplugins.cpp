@@ -0,0 +1,182 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2018 Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Tile extraction and augmentation for training data generation
+ * (native version of the tile cutting in tensorflow/tools/tilecreator.py)
+ *
+ ******************************************************************************/
+
+#include "grid.h"
+#include "grid4d.h"
+#include "matrixbase.h"
+#include <cmath>
+
+using namespace std;
+
+namespace Manta {
+
+//! a tile to cut: center in source grid cells, and its slot in the batch
+struct TileJob {
+	TileJob() : center(0.), slot(-1) {}
+	TileJob(const Vec3& c) : center(c), slot(-1) {}
+	Vec3 center;
+	int  slot;
+};
+
+//! snap matrix entries of multiples of 90 degree rotations, so that tiles sample exact cell centers
+static inline Real snapRotEntry(Real v) {
+	const Real eps = 1e-6;
+	if(std::fabs(v)     < eps) return 0.;
+	if(std::fabs(v-1.)  < eps) return 1.;
+	if(std::fabs(v+1.)  < eps) return -1.;
+	return v;
+}
+
+//! orthogonal tile transform, maps source directions to tile directions: first rotate around
+//! x, y and z (angles in degrees), then mirror along the axes with flip!=0
+static Matrix3x3f tileTransform(Vec3 rotation, Vec3i flip, bool is3D) {
+	if(!is3D && (rotation.x!=0. || rotation.y!=0.))
+		errMsg("extractTiles: 2D tiles can only be rotated around the z axis");
+	const Vec3 a = rotation * Real(M_PI/180.);
+	const Real cx = cos(a.x), sx = sin(a.x), cy = cos(a.y), sy = sin(a.y), cz = cos(a.z), sz = sin(a.z);
+	const Matrix3x3f rx(1,0,0,  0,cx,-sx,  0,sx,cx);
+	const Matrix3x3f ry(cy,0,sy,  0,1,0,  -sy,0,cy);
+	const Matrix3x3f rz(cz,-sz,0,  sz,cz,0,  0,0,1);
+	const Matrix3x3f mirror(Vec3(flip.x ? -1. : 1., flip.y ? -1. : 1., (flip.z && is3D) ? -1. : 1.));
+	Matrix3x3f m = mirror * rz * ry * rx;
+	for(int c=0; c<9; ++c) m.v1[c] = snapRotEntry(m.v1[c]);
+	return m;
+}
+
+//! sampling position in the source grid for cell i,j,k of a tile, transformed around the tile center
+static inline Vec3 tileSourcePos(const Matrix3x3f& trafo, const Vec3& center, const Vec3& halfSize, int i, int j, int k, bool is3D) {
+	Vec3 p = center + trafo.transposedMul(Vec3(i+0.5, j+0.5, k+0.5) - halfSize);
+	if(!is3D) p.z = 0.5;
+	return p;
+}
+
+//! density sum of each (transformed) tile, used to reject empty tiles
+KERNEL(pts)
+void knTileDensity(const std::vector<TileJob>& jobs, std::vector<Real>& sums, const Grid<Real>& density, Vec3i tileSize, Real scale, const Matrix3x3f& trafo) {
+	const Vec3 center = jobs[idx].center * scale, halfSize = toVec3(tileSize) * Real(0.5);
+	Real sum = 0.;
+	for(int k=0; k<tileSize.z; ++k) for(int j=0; j<tileSize.y; ++j) for(int i=0; i<tileSize.x; ++i) {
+		sum += density.getInterpolated( tileSourcePos(trafo, center, halfSize, i,j,k, density.is3D()) );
+	}
+	sums[idx] = sum;
+}
+
+//! cut tiles into their batch slots, layout [tile][z][y][x][channel], channels are the
+//! density (if given) followed by the transformed velocity components
+KERNEL(pts)
+void knCutTiles(const std::vector<TileJob>& jobs, Real* buffer, int channels, Vec3i tileSize, const Matrix3x3f& trafo,
+	const Grid<Real>* density, const Grid<Vec3>* vel, const MACGrid* mac, Real velScale, bool is3D)
+{
+	if(jobs[idx].slot<0) return;
+	const Vec3 center = jobs[idx].center, halfSize = toVec3(tileSize) * Real(0.5);
+	const int velComps = channels - (density ? 1 : 0);
+	Real* out = buffer + (IndexInt)jobs[idx].slot * tileSize.x * tileSize.y * tileSize.z * channels;
+	for(int k=0; k<tileSize.z; ++k) for(int j=0; j<tileSize.y; ++j) for(int i=0; i<tileSize.x; ++i) {
+		const Vec3 pos = tileSourcePos(trafo, center, halfSize, i,j,k, is3D);
+		if(density) *(out++) = density->getInterpolated(pos);
+		if(velComps>0) {
+			const Vec3 v = trafo * ((mac ? mac->getInterpolated(pos) : vel->getInterpolated(pos)) * velScale);
+			for(int c=0; c<velComps; ++c) *(out++) = v[c];
+		}
+	}
+}
+
+//! cut a regular, possibly overlapping pattern of tiles (strides<=0 means tile size) from density and/or
+//! velocity (MAC or Vec3 grid) into a contiguous buffer with numSlots tiles, see knCutTiles for the layout.
+//! Tiles with less than densityMinimum*tile volume of density are skipped; the density test uses
+//! selectDensity if given (e.g., the low-res density when cutting high-res tiles, so that both pick the
+//! same tiles). Returns the number of tiles written.
+int extractTilesToBuffer(Real* buffer, int numSlots, int channels, Vec3i tileSize, const Grid<Real>* density, const GridBase* vel,
+	Vec3i strides, Real densityMinimum, Vec3 rotation, Vec3i flip, const Grid<Real>* selectDensity, Real velScale)
+{
+	const GridBase* src = density ? (const GridBase*)density : vel;
+	assertMsg(src, "extractTiles: needs density and/or velocity to cut tiles from");
+	const Vec3i size = src->getSize();
+	const bool is3D = src->is3D();
+	if(vel && vel->getSize()!=size) errMsg("extractTiles: density and velocity sizes don't match");
+	if(vel && !(vel->getType() & GridBase::TypeVec3) && !(vel->getType() & GridBase::TypeMAC))
+		errMsg("extractTiles: velocity has to be a MAC or Vec3 grid");
+	const int velComps = channels - (density ? 1 : 0);
+	if(!(velComps==0 && !vel) && !(vel && (velComps==3 || (velComps==2 && !is3D))))
+		errMsg("extractTiles: " << channels << " channels don't fit to the given grids (density 1, velocity 3, or 2 in 2D)");
+	if(!is3D && tileSize.z!=1) errMsg("extractTiles: 2D tiles need z size 1");
+
+	for(int c=0; c<3; ++c) if(strides[c]<=0) strides[c] = tileSize[c];
+	if(!is3D) strides.z = 1;
+	Vec3i numTiles;
+	for(int c=0; c<3; ++c) numTiles[c] = (size[c]<tileSize[c]) ? 0 : (size[c]-tileSize[c]) / strides[c] + 1;
+
+	// same order as tilecreator.createTiles, x is the fastest index
+	std::vector<TileJob> jobs;
+	const Vec3 halfSize = toVec3(tileSize) * Real(0.5);
+	for(int tz=0; tz<numTiles.z; ++tz) for(int ty=0; ty<numTiles.y; ++ty) for(int tx=0; tx<numTiles.x; ++tx) {
+		jobs.push_back( TileJob( toVec3(Vec3i(tx,ty,tz) * strides) + halfSize ) );
+	}
+	const Matrix3x3f trafo = tileTransform(rotation, flip, is3D);
+
+	// reject tiles with too little density
+	const Grid<Real>* select = selectDensity ? selectDensity : density;
+	std::vector<Real> sums(jobs.size(), 0.);
+	Vec3i selTileSize = tileSize;
+	Real selScale = 1.;
+	if(select && densityMinimum>0.) {
+		const Vec3i selSize = select->getSize();
+		const int factor = max(1, size.x / max(1, selSize.x));
+		if(selSize.x*factor!=size.x || selSize.y*factor!=size.y || (is3D && selSize.z*factor!=size.z))
+			errMsg("extractTiles: selection density has to be coarser by the same integer factor along all axes");
+		selScale = Real(1.)/factor;
+		for(int c=0; c<3; ++c) selTileSize[c] = max(1, tileSize[c]/factor);
+		knTileDensity(jobs, sums, *select, selTileSize, selScale, trafo);
+	}
+	const Real threshold = densityMinimum * selTileSize.x * selTileSize.y * selTileSize.z;
+
+	int count = 0;
+	for(size_t t=0; t<jobs.size() && count<numSlots; ++t) {
+		if(select && densityMinimum>0. && sums[t] < threshold) continue;
+		jobs[t].slot = count++;
+	}
+
+	const Grid<Vec3>* vec3Vel = (vel && !(vel->getType() & GridBase::TypeMAC)) ? (const Grid<Vec3>*)vel : NULL;
+	const MACGrid* macVel     = (vel &&  (vel->getType() & GridBase::TypeMAC)) ? (const MACGrid*)vel : NULL;
+	knCutTiles(jobs, buffer, channels, tileSize, trafo, density, vec3Vel, macVel, velScale, is3D);
+	debMsg("extractTiles: "<<count<<" of "<<jobs.size()<<" tiles written", 2);
+	return count;
+}
+
+//! cut tiles (see extractTilesToBuffer) into a 4d batch grid: x,y,z is the tile size, t the tile index.
+//! Real batches hold the density, Vec3 batches the velocity, and Vec4 batches density plus velocity,
+//! i.e. the (tile,z,y,x,channel) memory layout of tilecreator's 'dens_vel' data.
+//! Tiles are written starting at startTile, returns the number of tiles written.
+PYTHON() int extractTiles(Grid4dBase& batch, const Grid<Real>* density=NULL, const GridBase* vel=NULL,
+	Vec3i strides=Vec3i(0), Real densityMinimum=0., Vec3 rotation=Vec3(0.), Vec3i flip=Vec3i(0), int startTile=0,
+	const Grid<Real>* selectDensity=NULL, Real velScale=1.)
+{
+	const Vec4i bs = batch.getSize();
+	if(startTile<0 || startTile>=bs.t) errMsg("extractTiles: start tile "<<startTile<<" outside of batch with "<<bs.t<<" tiles");
+	Real* data = NULL;
+	int channels = 0;
+	switch(batch.getType()) {
+		case Grid4dBase::TypeReal: data = &((Grid4d<Real>&)batch)[0];        channels = 1; break;
+		case Grid4dBase::TypeVec3: data = &((Grid4d<Vec3>&)batch)[0][0];     channels = 3; break;
+		case Grid4dBase::TypeVec4: data = &((Grid4d<Vec4>&)batch)[0][0];     channels = 4; break;
+		default: errMsg("extractTiles: batch has to be a Real, Vec3 or Vec4 4d grid");
+	}
+	if(channels==1 && !density) errMsg("extractTiles: Real batches need a density grid");
+	if(channels==3 && density)  errMsg("extractTiles: Vec3 batches only hold the velocity, use a Vec4 batch for density and velocity");
+	const IndexInt tileCells = (IndexInt)bs.x * bs.y * bs.z;
+	return extractTilesToBuffer(data + startTile * tileCells * channels, bs.t - startTile, channels, Vec3i(bs.x, bs.y, bs.z),
+		density, vel, strides, densityMinimum, rotation, flip, selectDensity, velScale);
+}
+
+} //namespace
@@ -169,7 +169,7 @@ PYTHON() void smoothVorticity(VortexSheetMesh& mesh, int iter=1, Real sigma=0.2,
 PYTHON() void VPseedK41(VortexParticleSystem& system, const Shape* shape, Real strength=0, Real sigma0=0.2, Real sigma1=1.0, Real probability=1.0, Real N=3.0) {
 	Grid<Real> temp(system.getParent());
 	const Real dt = system.getParent()->getDt();
-	static RandomStream rand(3489572);
+	static RandomStream rand(3489572, "VPseedK41");
 	Real s0 = pow( (Real)sigma0, (Real)(-N+1.0) );
 	Real s1 = pow( (Real)sigma1, (Real)(-N+1.0) );
 	
@@ -194,6 +194,97 @@ PYTHON() void computeEnergy( const FlagGrid& flags, const MACGrid& vel, Grid<Rea
 }
 
 
+//*****************************************************************************
+
+// fused upres stage for wavelet turbulence
+
+//! check whether the low-res cells covered by a high-res tile contain density
+static bool upresTileHasDensity(const Grid<Real>& density, const Vec3i& lo, const Vec3i& hi, const Vec3& sourceFactor, const Vec3& off, Real threshold)
+{
+	const Vec3 p0 = toVec3(lo) * sourceFactor + off, p1 = toVec3(hi - Vec3i(1)) * sourceFactor + off;
+	Vec3i l, h;
+	for(int c=0; c<3; ++c) {
+		l[c] = clamp((int)std::floor(p0[c]) - 1, 0, density.getSize()[c]-1);
+		h[c] = clamp((int)std::ceil (p1[c]) + 1, 0, density.getSize()[c]-1);
+	}
+	if(!density.is3D()) l.z = h.z = 0;
+	for(int k=l.z; k<=h.z; ++k) for(int j=l.y; j<=h.y; ++j) for(int i=l.x; i<=h.x; ++i) {
+		if(density(i,j,k) > threshold) return true;
+	}
+	return false;
+}
+
+//! one high-res tile: interpolate low-res velocity and energy once per cell, add all noise octaves
+//! and write the final velocity. same operations and order as interpolateGrid, interpolateMACGrid
+//! and one applyNoiseVec3 call per octave
+KERNEL(pts)
+void knWaveletUpresTiles(const std::vector<Vec3i>& tiles, int tileSize, const FlagGrid& flags, MACGrid& target, const MACGrid& source,
+	const Grid<Real>& energy, const std::vector<const WaveletNoiseField*>& noises, const std::vector<Real>& scales, Real scaleSpatial,
+	const Grid<Real>* density, Real densityThreshold, const Vec3& sourceFactor, const Vec3& off, int orderSpace)
+{
+	const Vec3i lo = tiles[idx];
+	Vec3i hi = lo + Vec3i(tileSize);
+	for(int c=0; c<3; ++c) hi[c] = std::min(hi[c], target.getSize()[c]);
+	if(!target.is3D()) hi.z = 1;
+	const bool active = (density==NULL) || upresTileHasDensity(*density, lo, hi, sourceFactor, off, densityThreshold);
+
+	for(int k=lo.z; k<hi.z; ++k) for(int j=lo.y; j<hi.y; ++j) for(int i=lo.x; i<hi.x; ++i) {
+		const Vec3 pos = Vec3(i,j,k) * sourceFactor + off;
+		Vec3 v(0.);
+		v.x = source.getInterpolatedHi(pos - Vec3(0.5,0,0), orderSpace)[0];
+		v.y = source.getInterpolatedHi(pos - Vec3(0,0.5,0), orderSpace)[1];
+		if(source.is3D()) v.z = source.getInterpolatedHi(pos - Vec3(0,0,0.5), orderSpace)[2];
+
+		if(active && flags.isFluid(i,j,k)) {
+			Vec3 epos = pos;
+			if(!energy.is3D()) epos[2] = 0;
+			const Real w = energy.getInterpolatedHi(epos, orderSpace);
+			const Vec3 npos = (Vec3(i,j,k)+Vec3(0.5)) * scaleSpatial;
+			for(size_t o=0; o<noises.size(); ++o) {
+				v += noises[o]->evaluateCurl(npos) * scales[o] * w;
+			}
+		}
+		target(i,j,k) = v;
+	}
+}
+
+//! fused wavelet turbulence upres, replaces interpolateGrid (energy to weight), interpolateMACGrid
+//! and applyNoiseVec3 for each octave with a single sweep over the high-res grid.
+//! octave o is scaled by scale*octaveScale^o, if a low-res density is given noise is
+//! only added in tiles that cover density above the threshold
+PYTHON() void applyWaveletUpres(const FlagGrid& flags, MACGrid& target, const MACGrid& source, const Grid<Real>& energy,
+	std::vector<PbClass*>& noises, Real scale=1.0, Real octaveScale=0.6, Real scaleSpatial=1.0,
+	const Grid<Real>* density=NULL, Real densityThreshold=0., int tileSize=8, int orderSpace=1)
+{
+	assertMsg( energy.getSize()==source.getSize(), "applyWaveletUpres: energy and low-res velocity have to match");
+	if(density) assertMsg( density->getSize()==source.getSize(), "applyWaveletUpres: density and low-res velocity have to match");
+	if(tileSize<1) errMsg("applyWaveletUpres: invalid tile size " << tileSize);
+
+	std::vector<const WaveletNoiseField*> octaves;
+	std::vector<Real> scales;
+	Real s = scale;
+	for(size_t o=0; o<noises.size(); ++o) {
+		const WaveletNoiseField* noise = dynamic_cast<const WaveletNoiseField*>(noises[o]);
+		if(!noise) errMsg("applyWaveletUpres: octave " << o << " is not a noise field");
+		octaves.push_back(noise);
+		scales.push_back(s);
+		s *= octaveScale;
+	}
+
+	Vec3 sourceFactor(1.), off(0.);
+	calcGridSizeFactorMod(source.getSize(), target.getSize(), Vec3i(-1), Vec3(1.), sourceFactor, off);
+
+	std::vector<Vec3i> tiles;
+	const Vec3i size = target.getSize();
+	for(int k=0; k<(target.is3D() ? size.z : 1); k+=tileSize)
+		for(int j=0; j<size.y; j+=tileSize)
+			for(int i=0; i<size.x; i+=tileSize)
+				tiles.push_back(Vec3i(i,j,k));
+
+	knWaveletUpresTiles(tiles, tileSize, flags, target, source, energy, octaves, scales, scaleSpatial, density, densityThreshold, sourceFactor, off, orderSpace);
+}
+
+
 PYTHON() void computeWaveletCoeffs(Grid<Real>& input)
 {
 	Grid<Real> temp1(input.getParent()), temp2(input.getParent());
@@ -15,6 +15,7 @@
 #include "commonkernels.h"
 #include "particle.h"
 #include "conjugategrad.h"
+#include "pressuresolver.h"
 #include <cmath>
 
 using namespace std;
@@ -43,19 +44,14 @@ PYTHON() void calcSecDeriv2d(const Grid<Real>& v, Grid<Real>& curv) {
 
 // mass conservation 
 
-KERNEL(bnd=1, reduce=+) returns(double sum=0)
-double knTotalSum(Grid<Real>& h) { sum += h(i,j,k); }
-
 //! calculate the sum of all values in a grid (for wave equation solves)
 PYTHON() Real totalSum(Grid<Real>& height) {
-	knTotalSum ts(height);
-	return ts.sum;
+	return (Real)height.getStats(1).sum;
 }
 
 //! normalize all values in a grid (for wave equation solves)
 PYTHON() void normalizeSumTo(Grid<Real>& height, Real target) {
-	knTotalSum ts(height);
-	Real factor = target / ts.sum;
+	Real factor = target / height.getStats(1).sum;
 	height.multConst(factor);
 }
 
@@ -84,36 +80,26 @@ void MakeRhsWE(const FlagGrid& flags, Grid<Real>& rhs, const Grid<Real>& ut, con
 
 
 //! do a CG solve for the wave equation (note, out grid only there for debugging... could be removed)
+//! the system is kept for the next call with the same flags and time step, with PcMGStatic including
+//! the multigrid hierarchy
 PYTHON() void cgSolveWE(const FlagGrid& flags, Grid<Real>& ut, Grid<Real>& utm1, Grid<Real>& out,
 						bool crankNic     = false,
 						Real cSqr         = 0.25,
 						Real cgMaxIterFac = 1.5,
-						Real cgAccuracy   = 1e-5 )
+						Real cgAccuracy   = 1e-5,
+						int preconditioner = PcNone )
 {
 	// reserve temp grids
 	FluidSolver* parent = flags.getParent();
 	Grid<Real> rhs(parent);
-	Grid<Real> residual(parent);
-	Grid<Real> search(parent);
-	Grid<Real> A0(parent);
-	Grid<Real> Ai(parent);
-	Grid<Real> Aj(parent);
-	Grid<Real> Ak(parent);
-	Grid<Real> tmp(parent);
 	// solution...
 	out.clear();
 		
 	// setup matrix and boundaries
-	MakeLaplaceMatrix (flags, A0, Ai, Aj, Ak);
 	Real dt   = parent->getDt();
 	Real s    = dt*dt*cSqr * 0.5;
-	FOR_IJK(flags) {
-		Ai(i,j,k) *= s;
-		Aj(i,j,k) *= s;
-		Ak(i,j,k) *= s;
-		A0(i,j,k) *= s;
-		A0(i,j,k) += 1.;
-	}
+	HelmholtzSystem& sys = HelmholtzSystem::get(parent, HelmholtzSystem::Wave);
+	sys.update(flags, s);
 	
 	// compute divergence and init right hand side
 	rhs.clear();
@@ -126,24 +112,11 @@ PYTHON() void cgSolveWE(const FlagGrid& flags, Grid<Real>& ut, Grid<Real>& utm1,
 	MakeRhsWE kernMakeRhs(flags, rhs, ut,utm1, s, crankNic);
 	
 	const int maxIter = (int)(cgMaxIterFac * flags.getSize().max()) * (flags.is3D() ? 1 : 4);
-	GridCgInterface *gcg;
-	if (flags.is3D())
-		gcg = new GridCg<ApplyMatrix  >(out, rhs, residual, search, flags, tmp, &A0, &Ai, &Aj, &Ak );
-	else
-		gcg = new GridCg<ApplyMatrix2D>(out, rhs, residual, search, flags, tmp, &A0, &Ai, &Aj, &Ak );
-	
-	gcg->setAccuracy( cgAccuracy ); 
-
-	// no preconditioning for now...
-	for (int iter=0; iter<maxIter; iter++) {
-		if (!gcg->iterate()) iter=maxIter;
-	} 
-	debMsg("cgSolveWaveEq iterations:"<<gcg->getIterations()<<", res:"<<gcg->getSigma(), 1);
+	sys.solve(out, rhs, maxIter, cgAccuracy, preconditioner);
+	debMsg("cgSolveWaveEq iterations:"<<sys.getIterations()<<", res:"<<sys.getResNorm(), 1);
 
 	utm1.swap( ut );
 	ut.copyFrom( out );
-
-	delete gcg;
 }
 
 
@@ -139,8 +139,9 @@ void run() {
 }
 );
 
-const string TmpRunTBB = STR(
-void operator() (const tbb::blocked_range<IndexInt>& __r) $CONST$ {
+// loop over a range of slices (3D), rows (2D) or cells, shared by the TBB kernels and deterministic reductions
+const string TmpRangeOp = STR(
+void operator() (const KernelRange& __r) $CONST$ {
 @IF(IJK)
 	const int _maxX = maxX;
 	const int _maxY = maxY;
@@ -158,11 +159,14 @@ void operator() (const tbb::blocked_range<IndexInt>& __r) $CONST$ {
 @ELSE
 @IF(FOURD)
 	if (maxT>1) {
-		for (int t=__r.begin(); t!=(int)__r.end(); t++)
-		for (int k=$BND$; k<maxZ; k++)
-		for (int j=$BND$; j<maxY; j++)
-		for (int i=$BND$; i<maxX; i++)
-			op(i,j,k,t,$CALL$);
+		const IndexInt _nz = maxZ-minZ;
+		for (IndexInt __s=__r.begin(); __s!=(IndexInt)__r.end(); __s++) {
+			const int t = minT + (int)(__s/_nz);
+			const int k = minZ + (int)(__s%_nz);
+			for (int j=$BND$; j<maxY; j++)
+			for (int i=$BND$; i<maxX; i++)
+				op(i,j,k,t,$CALL$);
+		}
 	} else if (maxZ>1) {
 		const int t=0;
 		for (int k=__r.begin(); k!=(int)__r.end(); k++)
@@ -182,7 +186,46 @@ void operator() (const tbb::blocked_range<IndexInt>& __r) $CONST$ {
 @END
 @END
 }
+);
+
+// fixed blocks of the same ranges for deterministic reductions, see reduceBlocks
+const string TmpReduceBlocks = STR(
+@IF(IJK)
+	if (maxZ>1)
+		reduceBlocks(*this, minZ, maxZ, (IndexInt)maxX*maxY);
+	else
+		reduceBlocks(*this, $BND$, maxY, maxX);
+@ELSE
+@IF(FOURD)
+	if (maxT>1)
+		reduceBlocks(*this, 0, (IndexInt)(maxT-minT)*(maxZ-minZ), (IndexInt)maxX*maxY);
+	else if (maxZ>1)
+		reduceBlocks(*this, minZ, maxZ, (IndexInt)maxX*maxY);
+	else
+		reduceBlocks(*this, $BND$, maxY, maxX);
+@ELSE
+	reduceBlocks(*this, 0, size, 1);
+@END
+@END
+);
+
+// split constructor and join of reduce kernels
+const string TmpSplitJoin = STR(
+	$IKERNEL$ ($IKERNEL$& o, KernelSplit) : KernelBase(o) $COPY$ $LOCALSET$ {}
+	
+	void join(const $IKERNEL$ & o) {
+		$JOINER$
+	}
+);
+
+const string TmpRunTBB = TmpRangeOp + STR(
 void run() {
+@IF(REDUCE)
+	if (gDeterministicReductions) {
+		$REDUCE_BLOCKS$
+		return;
+	}
+@END
 @IF(IJK)
 	if (maxZ>1)
 		tbb::parallel_$METHOD$ (tbb::blocked_range<IndexInt>(minZ, maxZ), *this);
@@ -191,7 +234,7 @@ void run() {
 @ELSE
 @IF(FOURD)
 	if (maxT>1) {
-		tbb::parallel_$METHOD$ (tbb::blocked_range<IndexInt>(minT, maxT), *this);
+		tbb::parallel_$METHOD$ (tbb::blocked_range<IndexInt>(0, (IndexInt)(maxT-minT)*(maxZ-minZ)), *this);
 	} else if (maxZ>1) {
 		tbb::parallel_$METHOD$ (tbb::blocked_range<IndexInt>(minZ, maxZ), *this);
 	} else {
@@ -202,16 +245,22 @@ void run() {
 @END
 }
 @IF(REDUCE)
-	$IKERNEL$ ($IKERNEL$& o, tbb::split) : KernelBase(o) $COPY$ $LOCALSET$ {}
-	
-	void join(const $IKERNEL$ & o) {
-		$JOINER$
-	}
+$SPLIT_JOIN$
 @END
 );
 
 const string TmpRunOMP = STR(
+@IF(REDUCE)
+$RANGE_OP$
+$SPLIT_JOIN$
+@END
 void run() {
+@IF(REDUCE)
+	if (gDeterministicReductions) {
+		$REDUCE_BLOCKS$
+		return;
+	}
+@END
 @IF(IJK)
 	const int _maxX = maxX; 
 	const int _maxY = maxY;
@@ -241,15 +290,18 @@ void run() {
 	const int _maxX = maxX; 
 	const int _maxY = maxY;
 	if (maxT > 1) {
-		const int _maxZ = maxZ;
+		const IndexInt _nz = maxZ-minZ;
+		const IndexInt _slabs = (IndexInt)(maxT-minT)*_nz;
 		$PRAGMA$ omp parallel $NL$
 		{
 			$OMP_DIRECTIVE$
-			for (int t=$BND$; t < maxT; t++)
-			for (int k=$BND$; k < _maxZ; k++)
-			for (int j=$BND$; j < _maxY; j++)
-			for (int i=$BND$; i < _maxX; i++)
-			   op(i,j,k,t,$CALL$);
+			for (IndexInt __s=0; __s < _slabs; __s++) {
+				const int t = minT + (int)(__s/_nz);
+				const int k = minZ + (int)(__s%_nz);
+				for (int j=$BND$; j < _maxY; j++)
+				for (int i=$BND$; i < _maxX; i++)
+				   op(i,j,k,t,$CALL$);
+			}
 		   $OMP_POST$
 		}
 	} else if (maxZ > 1) {
@@ -508,8 +560,11 @@ void processKernel(const Block& block, const string& code, Sink& sink) {
 	else if (mtType == MTOpenMP) {
 		string ompTempl = TmpRunOMP;
 		replaceAll(ompTempl, "$OMP_DIRECTIVE$", TmpOMPDirective);
+		replaceAll(ompTempl, "$RANGE_OP$", TmpRangeOp);
 		replaceAll(templ, "$RUN$", ompTempl);
 	}
+	replaceAll(templ, "$SPLIT_JOIN$", TmpSplitJoin);
+	replaceAll(templ, "$REDUCE_BLOCKS$", TmpReduceBlocks);
 
 	// synthesize code
 	sink.inplace << block.linebreaks() << replaceSet(templ, table);
@@ -0,0 +1,87 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2011 Tobias Pfaff, Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Persistent pressure solver, implementation in plugin/pressure.cpp
+ *
+ ******************************************************************************/
+
+#ifndef _PRESSURESOLVER_H
+#define _PRESSURESOLVER_H
+
+#include "grid.h"
+#include "conjugategrad.h"
+
+namespace Manta {
+
+//! Preconditioner for CG solver
+// - None: Use standard CG
+// - MIC: Modified incomplete Cholesky preconditioner
+// - MGDynamic: Multigrid preconditioner, rebuilt for each solve
+// - MGStatic: Multigrid preconditioner, built only once (faster than
+//       MGDynamic, but works only if Poisson equation does not change)
+enum Preconditioner { PcNone = 0, PcMIC = 1, PcMGDynamic = 2, PcMGStatic = 3 };
+
+//! Pressure solver that keeps the poisson matrix, preconditioner and CG temporaries between solves
+/*! The system is only assembled again if the flags, fractions, ghost fluid levelset or solver settings
+	change, which is detected with a hash of these inputs. For smoke with static obstacles, all setup
+	work is thus done once. For MG, the dynamic and static modes behave the same here: the hierarchy is
+	kept as long as the system does not change. */
+PYTHON() class PressureSolver : public PbClass {
+public:
+	PYTHON() PressureSolver(FluidSolver* parent);
+	virtual ~PressureSolver();
+
+	//! pressure projection of vel, parameters as for the solvePressure plugin
+	//! warmStart: use the current pressure as initial guess, e.g., for repeated solves of similar problems
+	PYTHON() void solve(MACGrid& vel, Grid<Real>& pressure, const FlagGrid& flags, Real cgAccuracy = 1e-3,
+		const Grid<Real>* phi = 0, const Grid<Real>* perCellCorr = 0, const MACGrid* fractions = 0,
+		const MACGrid* obvel = 0, Real gfClamp = 1e-04, Real cgMaxIterFac = 1.5, int preconditioner = PcMIC,
+		bool enforceCompatibility = false, bool useL2Norm = false, bool zeroPressureFixing = false,
+		const Grid<Real>* curv = NULL, const Real surfTens = 0., Grid<Real>* retRhs = NULL, bool compactSystem = false,
+		bool warmStart = false);
+
+	//! force reassembly of the system upon the next solve
+	PYTHON() void invalidate() { mValid = false; }
+
+	// access
+	PYTHON() int getIterations() const { return mIterations; }
+	PYTHON() Real getResNorm() const { return mResNorm; }
+	//! number of times the system was (re)assembled
+	PYTHON() int getNumRebuilds() const { return mNumRebuilds; }
+
+protected:
+	//! hash of everything the matrix and preconditioner depend on
+	uint64_t computeHash(const FlagGrid& flags, const Grid<Real>* phi, const MACGrid* fractions, Real gfClamp,
+		int preconditioner, bool fixPressure, bool compactSystem) const;
+	void allocGrids();
+	void releaseGrids();
+
+	bool mValid;
+	uint64_t mHash;
+	//! cell with pinned pressure, -1 if none
+	IndexInt mFixPidx;
+
+	//! full grid system: matrix, CG temporaries and preconditioner
+	Grid<Real> *mA0, *mAi, *mAj, *mAk;
+	Grid<Real> *mResidual, *mSearch, *mTmp;
+	Grid<Real> *mPca0, *mPca1, *mPca2, *mPca3;
+	GridMg* mMG;
+	//! compact system, keeps its own preconditioner
+	CompactCg mCompact;
+	//! cell types and neighbor masks of the flags the system was assembled for
+	CompactFlags mCellFlags;
+
+	int mIterations;
+	Real mResNorm;
+	int mNumRebuilds;
+};
+
+} // namespace
+
+#endif
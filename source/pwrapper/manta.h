@@ -23,6 +23,7 @@
 #include "general.h"
 #include "vectorbase.h"
 #include "vector4d.h"
+#include "half.h"
 #include "registry.h"
 #include "pclass.h"
 #include "pconvert.h"
@@ -65,6 +65,9 @@ template<> PyObject* toPy<float>( const float& v) {
 template<> PyObject* toPy<double>( const double& v) {
 	return PyFloat_FromDouble(v);     
 }
+template<> PyObject* toPy<half>( const half& v) {
+	return PyFloat_FromDouble((float)v);     
+}
 template<> PyObject* toPy<bool>( const bool& v) {
 	return PyBool_FromLong(v);     
 }
@@ -131,6 +134,9 @@ template<> double fromPy<double>(PyObject* obj) {
 	if (PyLong_Check(obj)) return PyLong_AsDouble(obj);
 	errMsg("argument is not a double");    
 }
+template<> half fromPy<half>(PyObject* obj) {
+	return half(fromPy<float>(obj));
+}
 template<> PyObject* fromPy<PyObject*>(PyObject *obj) {
 	return obj;
 }
@@ -291,6 +297,7 @@ template<class T> T* tmpAlloc(PyObject* obj,std::vector<void*>* tmp) {
 }
 template<> float* fromPyPtr<float>(PyObject* obj, std::vector<void*>* tmp) { return tmpAlloc<float>(obj,tmp); }
 template<> double* fromPyPtr<double>(PyObject* obj, std::vector<void*>* tmp) { return tmpAlloc<double>(obj,tmp); }
+template<> half* fromPyPtr<half>(PyObject* obj, std::vector<void*>* tmp) { return tmpAlloc<half>(obj,tmp); }
 template<> int* fromPyPtr<int>(PyObject* obj, std::vector<void*>* tmp) { return tmpAlloc<int>(obj,tmp); }
 template<> std::string* fromPyPtr<std::string>(PyObject* obj, std::vector<void*>* tmp) { return tmpAlloc<std::string>(obj,tmp); }
 template<> bool* fromPyPtr<bool>(PyObject* obj, std::vector<void*>* tmp) { return tmpAlloc<bool>(obj,tmp); }
@@ -312,6 +319,9 @@ template<> bool isPy<double>(PyObject* obj) {
 #endif
 	return PyFloat_Check(obj) || PyLong_Check(obj);
 }
+template<> bool isPy<half>(PyObject* obj) {
+	return isPy<float>(obj);
+}
 template<> bool isPy<PyObject*>(PyObject *obj) {
 	return true;
 }
@@ -50,6 +50,7 @@ template<class T> T* fromPyPtr(PyObject* obj, std::vector<void*>* tmp) {
 
 template<> float* fromPyPtr<float>(PyObject* obj, std::vector<void*>* tmp);
 template<> double* fromPyPtr<double>(PyObject* obj, std::vector<void*>* tmp);
+template<> half* fromPyPtr<half>(PyObject* obj, std::vector<void*>* tmp);
 template<> int* fromPyPtr<int>(PyObject* obj, std::vector<void*>* tmp);
 template<> std::string* fromPyPtr<std::string>(PyObject* obj, std::vector<void*>* tmp);
 template<> bool* fromPyPtr<bool>(PyObject* obj, std::vector<void*>* tmp);
@@ -85,6 +86,7 @@ template<class T> T fromPy(PyObject* obj) {
 // builtin types
 template<> float fromPy<float>(PyObject* obj);
 template<> double fromPy<double>(PyObject* obj);
+template<> half fromPy<half>(PyObject* obj);
 template<> int fromPy<int>(PyObject *obj);
 template<> PyObject* fromPy<PyObject*>(PyObject *obj);
 template<> std::string fromPy<std::string>(PyObject *obj);
@@ -104,6 +106,7 @@ template<> PyObject* toPy<int>( const int& v);
 template<> PyObject* toPy<std::string>( const std::string& val);
 template<> PyObject* toPy<float>( const float& v);
 template<> PyObject* toPy<double>( const double& v);
+template<> PyObject* toPy<half>( const half& v);
 template<> PyObject* toPy<bool>( const bool& v);
 template<> PyObject* toPy<Vec3i>( const Vec3i& v);
 template<> PyObject* toPy<Vec3>( const Vec3& v);
@@ -116,6 +119,7 @@ template<> PyObject* toPy<std::vector<float>>( const std::vector<float>& vec);
 
 template<> bool isPy<float>(PyObject* obj);
 template<> bool isPy<double>(PyObject* obj);
+template<> bool isPy<half>(PyObject* obj);
 template<> bool isPy<int>(PyObject *obj);
 template<> bool isPy<PyObject*>(PyObject *obj);
 template<> bool isPy<std::string>(PyObject *obj);
@@ -22,14 +22,35 @@ namespace Manta {
 // Shape class members
 
 Shape::Shape (FluidSolver* parent) 
-	: PbClass(parent), mType(TypeNone)
+	: PbClass(parent), mType(TypeNone), mStatic(false), mLevelsetCache(NULL)
 {
 }
 
+Shape::~Shape() {
+	delete mLevelsetCache;
+}
+
+void Shape::clearCache() {
+	mCellRaster.clear();
+	mFaceRaster.clear();
+	mSmoothRaster.clear();
+	delete mLevelsetCache;
+	mLevelsetCache = NULL;
+}
+
 LevelsetGrid Shape::computeLevelset() {
 	// note - 3d check deactivated! TODO double check...
 	LevelsetGrid phi(getParent());
-	generateLevelset(phi); 
+	if (!mStatic) {
+		generateLevelset(phi); 
+		return phi;
+	}
+	if (!mLevelsetCache || mLevelsetCache->getSize() != phi.getSize()) {
+		delete mLevelsetCache;
+		mLevelsetCache = new Grid<Real>(getParent(), false);
+		generateLevelset(*mLevelsetCache);
+	}
+	phi.copyFrom(*mLevelsetCache);
 	return phi;
 }
 
@@ -68,16 +89,197 @@ KERNEL() void ApplyShapeToMACGrid (MACGrid* grid, Shape* shape, Vec3 value, Flag
 	if (shape->isInside(Vec3(i+0.5,j+0.5,k))) (*grid)(i,j,k).z = value.z;
 }
 
+//! Rows (x direction) of the grid that intersect the bounding boxes of a list of shapes
+struct ShapeRows {
+	struct Piece {
+		const Shape* shape;
+		Vec3i lo, hi;
+	};
+
+	//! margin extends the bounding boxes, e.g. for the smoothing band
+	ShapeRows(const Shape& shape, const GridBase& grid, Real margin) : lo(grid.getSize()), hi(0) {
+		std::vector<const Shape*> shapes;
+		shape.getPieces(shapes);
+		for (size_t s=0; s<shapes.size(); s++) {
+			Piece pc;
+			pc.shape = shapes[s];
+			Vec3 p0, p1;
+			if (pc.shape->getBounds(p0, p1, margin)) {
+				// conservative, covers cell centers and faces
+				for (int c=0; c<3; c++) {
+					pc.lo[c] = std::max((int)std::floor(p0[c]) - 1, 0);
+					pc.hi[c] = std::min((int)std::ceil (p1[c]) + 2, grid.getSize()[c]);
+				}
+			} else {
+				pc.lo = Vec3i(0);
+				pc.hi = grid.getSize();
+			}
+			if (!grid.is3D()) { pc.lo.z = 0; pc.hi.z = 1; }
+			if (pc.lo.x >= pc.hi.x || pc.lo.y >= pc.hi.y || pc.lo.z >= pc.hi.z) continue;
+			pieces.push_back(pc);
+			for (int c=0; c<3; c++) {
+				lo[c] = std::min(lo[c], pc.lo[c]);
+				hi[c] = std::max(hi[c], pc.hi[c]);
+			}
+		}
+	}
+	//! number of rows, also the number of work items of the row kernels
+	inline IndexInt size() const { return pieces.empty() ? 0 : (IndexInt)(hi.y-lo.y) * (hi.z-lo.z); }
+	inline void row(IndexInt idx, int& j, int& k) const { j = lo.y + (int)(idx % (hi.y-lo.y)); k = lo.z + (int)(idx / (hi.y-lo.y)); }
+	inline bool covers(const Piece& pc, int j, int k) const { return j>=pc.lo.y && j<pc.hi.y && k>=pc.lo.z && k<pc.hi.z; }
+
+	std::vector<Piece> pieces;
+	Vec3i lo, hi;
+};
+
+//! Kernel: collect the cells (or faces) inside the shapes, per row
+KERNEL(pts)
+void knShapeRowCells(const ShapeRows& rows, std::vector<std::vector<IndexInt> >& cells, std::vector<std::vector<unsigned char> >& faces, 
+	const GridBase& grid, bool mac) 
+{
+	int j, k;
+	rows.row(idx, j, k);
+	for (size_t p=0; p<rows.pieces.size(); p++) {
+		const ShapeRows::Piece& pc = rows.pieces[p];
+		if (!rows.covers(pc, j, k)) continue;
+		for (int i=pc.lo.x; i<pc.hi.x; i++) {
+			if (!mac) {
+				if (pc.shape->isInsideGrid(i,j,k)) cells[idx].push_back(grid.index(i,j,k));
+				continue;
+			}
+			const unsigned char bits = (pc.shape->isInside(Vec3(i,j+0.5,k+0.5)) ? 1 : 0) | 
+			                           (pc.shape->isInside(Vec3(i+0.5,j,k+0.5)) ? 2 : 0) | 
+			                           (pc.shape->isInside(Vec3(i+0.5,j+0.5,k)) ? 4 : 0);
+			if (bits) {
+				cells[idx].push_back(grid.index(i,j,k));
+				faces[idx].push_back(bits);
+			}
+		}
+	}
+}
+
+//! Kernel: collect the cells in the smoothing band of the shapes, per row, the SDF of a group is the minimum of its members
+KERNEL(pts)
+void knShapeRowBand(const ShapeRows& rows, std::vector<std::vector<IndexInt> >& cells, std::vector<std::vector<Real> >& phi, 
+	const GridBase& grid, Real sigma, Real shift) 
+{
+	int j, k;
+	rows.row(idx, j, k);
+	std::vector<Real> dist(rows.hi.x - rows.lo.x, std::numeric_limits<Real>::max());
+	for (size_t p=0; p<rows.pieces.size(); p++) {
+		const ShapeRows::Piece& pc = rows.pieces[p];
+		if (!rows.covers(pc, j, k)) continue;
+		for (int i=pc.lo.x; i<pc.hi.x; i++) {
+			Real& d = dist[i - rows.lo.x];
+			d = std::min(d, pc.shape->getDistance(Vec3(i+0.5,j+0.5,k+0.5)));
+		}
+	}
+	for (int i=rows.lo.x; i<rows.hi.x; i++) {
+		const Real d = dist[i - rows.lo.x];
+		if (d - shift < sigma) {
+			cells[idx].push_back(grid.index(i,j,k));
+			phi[idx].push_back(d);
+		}
+	}
+}
+
+//! concatenate the rows
+template<class T> static void joinRows(std::vector<std::vector<T> >& rows, std::vector<T>& out) {
+	size_t total = 0;
+	for (size_t r=0; r<rows.size(); r++) total += rows[r].size();
+	out.clear();
+	out.reserve(total);
+	for (size_t r=0; r<rows.size(); r++) {
+		out.insert(out.end(), rows[r].begin(), rows[r].end());
+		std::vector<T>().swap(rows[r]);
+	}
+}
+
+const ShapeRaster& Shape::getRaster(const GridBase& grid, bool mac, ShapeRaster& tmp) {
+	ShapeRaster& raster = mStatic ? (mac ? mFaceRaster : mCellRaster) : tmp;
+	if (raster.valid && raster.size == grid.getSize()) return raster;
+
+	const ShapeRows rows(*this, grid, 0.);
+	std::vector<std::vector<IndexInt> > cells(rows.size());
+	std::vector<std::vector<unsigned char> > faces(rows.size());
+	knShapeRowCells(rows, cells, faces, grid, mac);
+	joinRows(cells, raster.cells);
+	joinRows(faces, raster.faces);
+	raster.size = grid.getSize();
+	raster.valid = true;
+	return raster;
+}
+
+//! Kernel: set value in the rasterized cells
+KERNEL(pts) template<class T>
+void knApplyRaster(const std::vector<IndexInt>& cells, Grid<T>& grid, T value, const FlagGrid* respectFlags) {
+	const IndexInt c = cells[idx];
+	if (respectFlags && respectFlags->isObstacle(c)) return;
+	grid[c] = value;
+}
+
+//! Kernel: set value in the rasterized faces
+KERNEL(pts)
+void knApplyRasterMAC(const std::vector<IndexInt>& cells, const std::vector<unsigned char>& faces, MACGrid& grid, Vec3 value, const FlagGrid* respectFlags) {
+	const IndexInt c = cells[idx];
+	if (respectFlags && respectFlags->isObstacle(c)) return;
+	if (faces[idx] & 1) grid[c].x = value.x;
+	if (faces[idx] & 2) grid[c].y = value.y;
+	if (faces[idx] & 4) grid[c].z = value.z;
+}
+
+//! Kernel: set value in the smoothing band, same as ApplyShapeToGridSmooth
+KERNEL(pts) template<class T>
+void knApplyRasterSmooth(const std::vector<IndexInt>& cells, const std::vector<Real>& phi, Grid<T>& grid, Real sigma, Real shift, T value, 
+	const FlagGrid* respectFlags) 
+{
+	const IndexInt c = cells[idx];
+	if (respectFlags && respectFlags->isObstacle(c)) return;
+	const Real p = phi[idx] - shift;
+	if (p < -sigma)
+		grid[c] = value;
+	else if (p < sigma)
+		grid[c] = value*(0.5f*(1.0f-p/sigma));
+}
+
+//! check whether all shapes to rasterize have bounds
+static bool isBounded(const Shape& shape) {
+	Vec3 p0, p1;
+	return shape.getBounds(p0, p1);
+}
+
 void Shape::applyToGrid(GridBase* grid, FlagGrid* respectFlags) {
 #	if NOPYTHON!=1
+	const bool mac = (grid->getType() & GridBase::TypeMAC) != 0;
+	if (!mStatic && !isBounded(*this)) {
+		// full sweep, avoids storing the cells of a large shape
+		if (grid->getType() & GridBase::TypeInt)
+			ApplyShapeToGrid<int> ((Grid<int>*)grid, this, _args.get<int>("value"), respectFlags);
+		else if (grid->getType() & GridBase::TypeReal)
+			ApplyShapeToGrid<Real> ((Grid<Real>*)grid, this, _args.get<Real>("value"), respectFlags);
+		else if (grid->getType() & GridBase::TypeHalf)
+			ApplyShapeToGrid<half> ((Grid<half>*)grid, this, _args.get<half>("value"), respectFlags);
+		else if (mac)
+			ApplyShapeToMACGrid ((MACGrid*)grid, this, _args.get<Vec3>("value"), respectFlags);
+		else if (grid->getType() & GridBase::TypeVec3)
+			ApplyShapeToGrid<Vec3> ((Grid<Vec3>*)grid, this, _args.get<Vec3>("value"), respectFlags);
+		else
+			errMsg("Shape::applyToGrid(): unknown grid type");
+		return;
+	}
+
+	ShapeRaster tmp;
+	const ShapeRaster& raster = getRaster(*grid, mac, tmp);
 	if (grid->getType() & GridBase::TypeInt)
-		ApplyShapeToGrid<int> ((Grid<int>*)grid, this, _args.get<int>("value"), respectFlags);
+		knApplyRaster<int> (raster.cells, *(Grid<int>*)grid, _args.get<int>("value"), respectFlags);
 	else if (grid->getType() & GridBase::TypeReal)
-		ApplyShapeToGrid<Real> ((Grid<Real>*)grid, this, _args.get<Real>("value"), respectFlags);
-	else if (grid->getType() & GridBase::TypeMAC)
-		ApplyShapeToMACGrid ((MACGrid*)grid, this, _args.get<Vec3>("value"), respectFlags);
+		knApplyRaster<Real> (raster.cells, *(Grid<Real>*)grid, _args.get<Real>("value"), respectFlags);
+	else if (grid->getType() & GridBase::TypeHalf)
+		knApplyRaster<half> (raster.cells, *(Grid<half>*)grid, _args.get<half>("value"), respectFlags);
+	else if (mac)
+		knApplyRasterMAC (raster.cells, raster.faces, *(MACGrid*)grid, _args.get<Vec3>("value"), respectFlags);
 	else if (grid->getType() & GridBase::TypeVec3)
-		ApplyShapeToGrid<Vec3> ((Grid<Vec3>*)grid, this, _args.get<Vec3>("value"), respectFlags);
+		knApplyRaster<Vec3> (raster.cells, *(Grid<Vec3>*)grid, _args.get<Vec3>("value"), respectFlags);
 	else
 		errMsg("Shape::applyToGrid(): unknown grid type");
 #	else
@@ -86,16 +288,48 @@ void Shape::applyToGrid(GridBase* grid, FlagGrid* respectFlags) {
 }
 
 void Shape::applyToGridSmooth(GridBase* grid, Real sigma, Real shift, FlagGrid* respectFlags) {
-	Grid<Real> phi(grid->getParent());
-	generateLevelset(phi);
-
 #	if NOPYTHON!=1
+	if (!isBounded(*this)) {
+		Grid<Real> phi(grid->getParent());
+		generateLevelset(phi);
+
+		if (grid->getType() & GridBase::TypeInt)
+			ApplyShapeToGridSmooth<int> ((Grid<int>*)grid, phi, sigma, shift, _args.get<int>("value"), respectFlags);
+		else if (grid->getType() & GridBase::TypeReal)
+			ApplyShapeToGridSmooth<Real> ((Grid<Real>*)grid, phi, sigma, shift, _args.get<Real>("value"), respectFlags);
+		else if (grid->getType() & GridBase::TypeHalf)
+			ApplyShapeToGridSmooth<half> ((Grid<half>*)grid, phi, sigma, shift, _args.get<half>("value"), respectFlags);
+		else if (grid->getType() & GridBase::TypeVec3)
+			ApplyShapeToGridSmooth<Vec3> ((Grid<Vec3>*)grid, phi, sigma, shift, _args.get<Vec3>("value"), respectFlags);
+		else
+			errMsg("Shape::applyToGridSmooth(): unknown grid type");
+		return;
+	}
+
+	// only cells with an SDF value below sigma+shift are changed
+	ShapeRaster tmp;
+	ShapeRaster& band = mStatic ? mSmoothRaster : tmp;
+	if (!band.valid || band.size != grid->getSize() || band.sigma != sigma || band.shift != shift) {
+		const ShapeRows rows(*this, *grid, std::max(sigma + shift, Real(0)));
+		std::vector<std::vector<IndexInt> > cells(rows.size());
+		std::vector<std::vector<Real> > phi(rows.size());
+		knShapeRowBand(rows, cells, phi, *grid, sigma, shift);
+		joinRows(cells, band.cells);
+		joinRows(phi, band.phi);
+		band.size = grid->getSize();
+		band.sigma = sigma;
+		band.shift = shift;
+		band.valid = true;
+	}
+
 	if (grid->getType() & GridBase::TypeInt)
-		ApplyShapeToGridSmooth<int> ((Grid<int>*)grid, phi, sigma, shift, _args.get<int>("value"), respectFlags);
+		knApplyRasterSmooth<int> (band.cells, band.phi, *(Grid<int>*)grid, sigma, shift, _args.get<int>("value"), respectFlags);
 	else if (grid->getType() & GridBase::TypeReal)
-		ApplyShapeToGridSmooth<Real> ((Grid<Real>*)grid, phi, sigma, shift, _args.get<Real>("value"), respectFlags);
+		knApplyRasterSmooth<Real> (band.cells, band.phi, *(Grid<Real>*)grid, sigma, shift, _args.get<Real>("value"), respectFlags);
+	else if (grid->getType() & GridBase::TypeHalf)
+		knApplyRasterSmooth<half> (band.cells, band.phi, *(Grid<half>*)grid, sigma, shift, _args.get<half>("value"), respectFlags);
 	else if (grid->getType() & GridBase::TypeVec3)
-		ApplyShapeToGridSmooth<Vec3> ((Grid<Vec3>*)grid, phi, sigma, shift, _args.get<Vec3>("value"), respectFlags);
+		knApplyRasterSmooth<Vec3> (band.cells, band.phi, *(Grid<Vec3>*)grid, sigma, shift, _args.get<Vec3>("value"), respectFlags);
 	else
 		errMsg("Shape::applyToGridSmooth(): unknown grid type");
 #	else
@@ -174,46 +408,45 @@ void Box::generateMesh(Mesh* mesh) {
 	mesh->rebuildLookup(oldtri,-1);
 }
 
-//! Kernel: Analytic SDF for box shape
-KERNEL() void BoxSDF(Grid<Real>& phi, const Vec3& p1, const Vec3& p2) {
-	const Vec3 p(i+0.5, j+0.5, k+0.5);
+//! Analytic SDF for box shape
+static inline Real boxDistance(const Vec3& p, const Vec3& p1, const Vec3& p2, bool is3D) {
 	if (p.x <= p2.x && p.x >= p1.x && p.y <= p2.y && p.y >= p1.y && p.z <= p2.z && p.z >= p1.z) {
 		// inside: minimal surface distance
 		Real mx = max(p.x-p2.x, p1.x-p.x);
 		Real my = max(p.y-p2.y, p1.y-p.y);
 		Real mz = max(p.z-p2.z, p1.z-p.z);
-		if(!phi.is3D()) mz = mx; // skip for 2d...
-		phi(i,j,k) = max(mx,max(my,mz));
+		if(!is3D) mz = mx; // skip for 2d...
+		return max(mx,max(my,mz));
 	} else if (p.y <= p2.y && p.y >= p1.y && p.z <= p2.z && p.z >= p1.z) {
 		// outside plane X
-		phi(i,j,k) = max(p.x-p2.x, p1.x-p.x);
+		return max(p.x-p2.x, p1.x-p.x);
 	} else if (p.x <= p2.x && p.x >= p1.x && p.z <= p2.z && p.z >= p1.z) {
 		// outside plane Y
-		phi(i,j,k) = max(p.y-p2.y, p1.y-p.y);
+		return max(p.y-p2.y, p1.y-p.y);
 	} else if (p.x <= p2.x && p.x >= p1.x && p.y <= p2.y && p.y >= p1.y) {
 		// outside plane Z
-		phi(i,j,k) = max(p.z-p2.z, p1.z-p.z);
+		return max(p.z-p2.z, p1.z-p.z);
 	} else if (p.x > p1.x && p.x < p2.x) {
 		// lines X
 		Real m1 = sqrt(square(p1.y-p.y)+square(p1.z-p.z));
 		Real m2 = sqrt(square(p2.y-p.y)+square(p1.z-p.z));
 		Real m3 = sqrt(square(p1.y-p.y)+square(p2.z-p.z));
 		Real m4 = sqrt(square(p2.y-p.y)+square(p2.z-p.z));
-		phi(i,j,k) = min(m1,min(m2,min(m3,m4)));
+		return min(m1,min(m2,min(m3,m4)));
 	} else if (p.y > p1.y && p.y < p2.y) {
 		// lines Y
 		Real m1 = sqrt(square(p1.x-p.x)+square(p1.z-p.z));
 		Real m2 = sqrt(square(p2.x-p.x)+square(p1.z-p.z));
 		Real m3 = sqrt(square(p1.x-p.x)+square(p2.z-p.z));
 		Real m4 = sqrt(square(p2.x-p.x)+square(p2.z-p.z));
-		phi(i,j,k) = min(m1,min(m2,min(m3,m4)));
+		return min(m1,min(m2,min(m3,m4)));
 	} else if (p.z > p1.x && p.z < p2.z) {
 		// lines Z
 		Real m1 = sqrt(square(p1.y-p.y)+square(p1.x-p.x));
 		Real m2 = sqrt(square(p2.y-p.y)+square(p1.x-p.x));
 		Real m3 = sqrt(square(p1.y-p.y)+square(p2.x-p.x));
 		Real m4 = sqrt(square(p2.y-p.y)+square(p2.x-p.x));
-		phi(i,j,k) = min(m1,min(m2,min(m3,m4)));
+		return min(m1,min(m2,min(m3,m4)));
 	} else {
 		// points
 		Real m =   norm(p-Vec3(p1.x,p1.y,p1.z));
@@ -224,9 +457,17 @@ KERNEL() void BoxSDF(Grid<Real>& phi, const Vec3& p1, const Vec3& p2) {
 		m = min(m, norm(p-Vec3(p2.x,p1.y,p2.z)));
 		m = min(m, norm(p-Vec3(p2.x,p2.y,p1.z)));
 		m = min(m, norm(p-Vec3(p2.x,p2.y,p2.z)));
-		phi(i,j,k) = m;
+		return m;
 	}
 }
+
+//! Kernel: Analytic SDF for box shape
+KERNEL() void BoxSDF(Grid<Real>& phi, const Vec3& p1, const Vec3& p2) {
+	phi(i,j,k) = boxDistance(Vec3(i+0.5, j+0.5, k+0.5), p1, p2, phi.is3D());
+}
+Real Box::getDistance(const Vec3& pos) const {
+	return boxDistance(pos, mP0, mP1, getParent()->is3D());
+}
 void Box::generateLevelset(Grid<Real>& phi) {
 	BoxSDF(phi, mP0, mP1);
 }
@@ -309,6 +550,16 @@ void Sphere::generateMesh(Mesh* mesh) {
 KERNEL() void SphereSDF(Grid<Real>& phi, Vec3 center, Real radius, Vec3 scale) {
 	phi(i,j,k) = norm((Vec3(i+0.5,j+0.5,k+0.5)-center)/scale)-radius;
 }
+Real Sphere::getDistance(const Vec3& pos) const {
+	return norm((pos-mCenter)/mScale)-mRadius;
+}
+bool Sphere::getBounds(Vec3& p0, Vec3& p1, Real margin) const {
+	// the scaled SDF grows by at least 1/scale per unit distance
+	const Vec3 ext = (mRadius + std::max(margin, Real(0))) * Vec3(fabs(mScale.x), fabs(mScale.y), fabs(mScale.z));
+	p0 = mCenter - ext;
+	p1 = mCenter + ext;
+	return true;
+}
 void Sphere::generateLevelset(Grid<Real>& phi) {
 	SphereSDF(phi, mCenter, mRadius, mScale);
 } 
@@ -364,25 +615,37 @@ void Cylinder::generateMesh(Mesh* mesh) {
 	mesh->rebuildLookup(oldtri,-1);
 }
 	
-KERNEL() void 
-CylinderSDF(Grid<Real>& phi, Vec3 center, Real radius, Vec3 zaxis, Real maxz) {
-	Vec3 p=Vec3(i+0.5,j+0.5,k+0.5)-center;
+static inline Real cylinderDistance(const Vec3& pos, const Vec3& center, Real radius, const Vec3& zaxis, Real maxz) {
+	Vec3 p=pos-center;
 	Real z = fabs(dot(p, zaxis));
 	Real r = sqrt(normSquare(p)-z*z);
 	if (z < maxz) {        
 		// cylinder z area
 		if (r < radius) 
-			phi(i,j,k) = max(r-radius,z-maxz);
+			return max(r-radius,z-maxz);
 		else
-			phi(i,j,k) = r-radius;        
+			return r-radius;        
 	} else if (r < radius) {
 		// cylinder top area
-		phi(i,j,k) = fabs(z-maxz);
+		return fabs(z-maxz);
 	} else {
 		// edge
-		phi(i,j,k) = sqrt(square(z-maxz)+square(r-radius));
+		return sqrt(square(z-maxz)+square(r-radius));
 	}
 }
+
+KERNEL() void 
+CylinderSDF(Grid<Real>& phi, Vec3 center, Real radius, Vec3 zaxis, Real maxz) {
+	phi(i,j,k) = cylinderDistance(Vec3(i+0.5,j+0.5,k+0.5), center, radius, zaxis, maxz);
+}
+Real Cylinder::getDistance(const Vec3& pos) const {
+	return cylinderDistance(pos, mCenter, mRadius, mZDir, mZ);
+}
+bool Cylinder::getBounds(Vec3& p0, Vec3& p1, Real margin) const {
+	p0 = mCenter - Vec3(mZ + mRadius + margin);
+	p1 = mCenter + Vec3(mZ + mRadius + margin);
+	return true;
+}
 void Cylinder::generateLevelset(Grid<Real>& phi) {
 	CylinderSDF(phi, mCenter, mRadius, mZDir, mZ);
 }
@@ -464,4 +727,66 @@ void Slope::generateLevelset(Grid<Real>& phi) {
 
 }
 
+//******************************************************************************
+// Shape groups
+
+void ShapeGroup::add(Shape* shape) {
+	assertMsg(shape && shape!=this, "ShapeGroup::add: invalid shape");
+	mShapes.push_back(shape);
+	clearCache();
+}
+
+bool ShapeGroup::isInside(const Vec3& pos) const {
+	for (size_t s=0; s<mShapes.size(); s++) {
+		if (mShapes[s]->isInside(pos)) return true;
+	}
+	return false;
+}
+
+bool ShapeGroup::getBounds(Vec3& p0, Vec3& p1, Real margin) const {
+	p0 = Vec3(std::numeric_limits<Real>::max());
+	p1 = Vec3(-std::numeric_limits<Real>::max());
+	for (size_t s=0; s<mShapes.size(); s++) {
+		Vec3 b0, b1;
+		if (!mShapes[s]->getBounds(b0, b1, margin)) return false;
+		for (int c=0; c<3; c++) {
+			p0[c] = std::min(p0[c], b0[c]);
+			p1[c] = std::max(p1[c], b1[c]);
+		}
+	}
+	return true;
+}
+
+Real ShapeGroup::getDistance(const Vec3& pos) const {
+	Real d = std::numeric_limits<Real>::max();
+	for (size_t s=0; s<mShapes.size(); s++) d = std::min(d, mShapes[s]->getDistance(pos));
+	return d;
+}
+
+void ShapeGroup::getPieces(std::vector<const Shape*>& pieces) const {
+	for (size_t s=0; s<mShapes.size(); s++) mShapes[s]->getPieces(pieces);
+}
+
+void ShapeGroup::generateMesh(Mesh* mesh) {
+	for (size_t s=0; s<mShapes.size(); s++) mShapes[s]->generateMesh(mesh);
+}
+
+//! Kernel: levelset union
+KERNEL(idx) void KnShapeUnion(Grid<Real>& phi, const Grid<Real>& other) {
+	phi[idx] = min(phi[idx], other[idx]);
+}
+
+void ShapeGroup::generateLevelset(Grid<Real>& phi) {
+	if (mShapes.empty()) {
+		gridSetConst<Real>(phi, 1000.0f);
+		return;
+	}
+	mShapes[0]->generateLevelset(phi);
+	Grid<Real> tmp(phi.getParent());
+	for (size_t s=1; s<mShapes.size(); s++) {
+		mShapes[s]->generateLevelset(tmp);
+		KnShapeUnion(phi, tmp);
+	}
+}
+
 } //namespace
@@ -22,13 +22,29 @@ namespace Manta {
 
 // forward declaration
 class Mesh;
+
+//! Rasterized cells of a shape, kept for static shapes
+struct ShapeRaster {
+	ShapeRaster() : valid(false), sigma(0), shift(0) {}
+	void clear() { valid = false; cells.clear(); faces.clear(); phi.clear(); }
+
+	bool valid;
+	Vec3i size;                       //!< grid size the cells refer to
+	std::vector<IndexInt> cells;      //!< cells inside (or within the smoothing band of) the shape
+	std::vector<unsigned char> faces; //!< MAC grids: bits of the x/y/z faces inside the shape, per cell
+	std::vector<Real> phi;            //!< smooth application: SDF value per cell
+	Real sigma, shift;                //!< smooth application: band parameters
+};
 	
 //! Base class for all shapes
+/*! Shapes with bounds (see getBounds) are only rasterized in their bounding box. Static shapes keep
+	the rasterized cells, and the levelset, until they are changed (setCenter etc.) or clearCache() is called. */
 PYTHON() class Shape : public PbClass {
 public:
-	enum GridType { TypeNone = 0, TypeBox = 1, TypeSphere = 2, TypeCylinder = 3, TypeSlope = 4 };
+	enum GridType { TypeNone = 0, TypeBox = 1, TypeSphere = 2, TypeCylinder = 3, TypeSlope = 4, TypeGroup = 5 };
 	
 	PYTHON() Shape(FluidSolver* parent);
+	virtual ~Shape();
 	
 	//! Get the type of grid
 	inline GridType getType() const { return mType; }
@@ -36,21 +52,41 @@ public:
 	//! Apply shape to flag grid, set inside cells to <value>
 	PYTHON() void applyToGrid(GridBase* grid, FlagGrid* respectFlags=0);
 	PYTHON() void applyToGridSmooth(GridBase* grid, Real sigma=1.0, Real shift=0, FlagGrid* respectFlags=0);
+	//! signed distances in the whole grid, not restricted to the bounding box (distances far from the shape
+	//! are used, e.g., by obstacle levelsets). Only static shapes cache it, others evaluate their SDF in every cell
 	PYTHON() LevelsetGrid computeLevelset();
 	PYTHON() void collideMesh(Mesh& mesh);
 	PYTHON() virtual Vec3 getCenter() const { return Vec3::Zero; }
 	PYTHON() virtual void setCenter(const Vec3& center) {}
 	PYTHON() virtual Vec3 getExtent() const { return Vec3::Zero; }
+
+	//! static shapes cache their rasterization and levelset
+	PYTHON() void setStatic(bool isStatic=true) { mStatic = isStatic; if(!isStatic) clearCache(); }
+	PYTHON() bool getStatic() const { return mStatic; }
+	PYTHON() void clearCache();
 	
 	//! Inside test of the shape
 	virtual bool isInside(const Vec3& pos) const;
 	inline bool isInsideGrid(int i, int j, int k) const { return isInside(Vec3(i+0.5,j+0.5,k+0.5)); };
+	//! Bounding box (grid coordinates) of the region with getDistance() below margin,
+	//! returns false for unbounded shapes and shapes without getDistance()
+	virtual bool getBounds(Vec3& p0, Vec3& p1, Real margin=0.) const { return false; }
+	//! Signed distance at a position, for shapes with bounds
+	virtual Real getDistance(const Vec3& pos) const { return 0.; }
+	//! Shapes to rasterize, groups add their members
+	virtual void getPieces(std::vector<const Shape*>& pieces) const { pieces.push_back(this); }
 	
 	virtual void generateMesh(Mesh* mesh) {} ;    
 	virtual void generateLevelset(Grid<Real>& phi) {};    
 	
 protected:
+	//! cells inside the shape, cached for static shapes; tmp is used otherwise
+	const ShapeRaster& getRaster(const GridBase& grid, bool mac, ShapeRaster& tmp);
+
 	GridType mType;
+	bool mStatic;
+	ShapeRaster mCellRaster, mFaceRaster, mSmoothRaster;
+	Grid<Real>* mLevelsetCache;
 };
 
 //! Dummy shape
@@ -73,10 +109,12 @@ public:
 	inline Vec3 getSize() const { return mP1-mP0; }
 	inline Vec3 getP0() const { return mP0; }
 	inline Vec3 getP1() const { return mP1; }
-	virtual void setCenter(const Vec3& center) { Vec3 dh=0.5*(mP1-mP0); mP0 = center-dh; mP1 = center+dh;}
+	virtual void setCenter(const Vec3& center) { Vec3 dh=0.5*(mP1-mP0); mP0 = center-dh; mP1 = center+dh; clearCache(); }
 	virtual Vec3 getCenter() const { return 0.5*(mP1+mP0); }
 	virtual Vec3 getExtent() const { return getSize(); }
 	virtual bool isInside(const Vec3& pos) const;
+	virtual bool getBounds(Vec3& p0, Vec3& p1, Real margin=0.) const { p0 = mP0-Vec3(margin); p1 = mP1+Vec3(margin); return true; }
+	virtual Real getDistance(const Vec3& pos) const;
 	virtual void generateMesh(Mesh* mesh);
 	virtual void generateLevelset(Grid<Real>& phi);
 	
@@ -89,11 +127,13 @@ PYTHON() class Sphere : public Shape {
 public:
 	PYTHON() Sphere (FluidSolver* parent, Vec3 center, Real radius, Vec3 scale=Vec3(1,1,1));
 	
-	virtual void setCenter(const Vec3& center) { mCenter = center; }
+	virtual void setCenter(const Vec3& center) { mCenter = center; clearCache(); }
 	virtual Vec3 getCenter() const { return mCenter; }
 	inline Real getRadius() const { return mRadius; }
 	virtual Vec3 getExtent() const { return Vec3(2.0*mRadius); }    
 	virtual bool isInside(const Vec3& pos) const;
+	virtual bool getBounds(Vec3& p0, Vec3& p1, Real margin=0.) const;
+	virtual Real getDistance(const Vec3& pos) const;
 	virtual void generateMesh(Mesh* mesh);
 	virtual void generateLevelset(Grid<Real>& phi);
 	
@@ -107,15 +147,17 @@ PYTHON() class Cylinder : public Shape {
 public:
 	PYTHON() Cylinder (FluidSolver* parent, Vec3 center, Real radius, Vec3 z);
 	
-	PYTHON() void setRadius(Real r) { mRadius = r; }
-	PYTHON() void setZ(Vec3 z) { mZDir=z; mZ=normalize(mZDir); }
+	PYTHON() void setRadius(Real r) { mRadius = r; clearCache(); }
+	PYTHON() void setZ(Vec3 z) { mZDir=z; mZ=normalize(mZDir); clearCache(); }
 	
-	virtual void setCenter(const Vec3& center) { mCenter=center; }
+	virtual void setCenter(const Vec3& center) { mCenter=center; clearCache(); }
 	virtual Vec3 getCenter() const { return mCenter; }
 	inline Real getRadius() const { return mRadius; }
 	inline Vec3 getZ() const { return mZ*mZDir; }
 	virtual Vec3 getExtent() const { return Vec3(2.0*sqrt(square(mZ)+square(mRadius))); }    
 	virtual bool isInside(const Vec3& pos) const;
+	virtual bool getBounds(Vec3& p0, Vec3& p1, Real margin=0.) const;
+	virtual Real getDistance(const Vec3& pos) const;
 	virtual void generateMesh(Mesh* mesh);
 	virtual void generateLevelset(Grid<Real>& phi);
 
@@ -133,9 +175,9 @@ PYTHON() class Slope : public Shape {
 public:
 	PYTHON() Slope (FluidSolver* parent, Real anglexy, Real angleyz, Real origin, Vec3 gs);
 
-	virtual void setOrigin (const Real& origin)  { mOrigin=origin; }
-	virtual void setAnglexy(const Real& anglexy) { mAnglexy=anglexy; }
-	virtual void setAngleyz(const Real& angleyz) { mAnglexy=angleyz; }
+	virtual void setOrigin (const Real& origin)  { mOrigin=origin; clearCache(); }
+	virtual void setAnglexy(const Real& anglexy) { mAnglexy=anglexy; clearCache(); }
+	virtual void setAngleyz(const Real& angleyz) { mAnglexy=angleyz; clearCache(); }
 
 	inline Real getOrigin()   const { return mOrigin; }
 	inline Real getmAnglexy() const { return mAnglexy; }
@@ -150,5 +192,27 @@ protected:
 	Vec3 mGs;
 };
 
+//! Group of shapes, rasterized together in one sweep over the union of their bounding boxes
+/*! The group only references its members, they have to be kept alive by the scene. Changes of the
+	members aren't tracked, call clearCache() of a static group after changing them. */
+PYTHON() class ShapeGroup : public Shape {
+public:
+	PYTHON() ShapeGroup(FluidSolver* parent) : Shape(parent) { mType = TypeGroup; }
+
+	PYTHON() void add(Shape* shape);
+	PYTHON() void clear() { mShapes.clear(); clearCache(); }
+	PYTHON() int size() const { return (int)mShapes.size(); }
+
+	virtual bool isInside(const Vec3& pos) const;
+	virtual bool getBounds(Vec3& p0, Vec3& p1, Real margin=0.) const;
+	virtual Real getDistance(const Vec3& pos) const;
+	virtual void getPieces(std::vector<const Shape*>& pieces) const;
+	virtual void generateMesh(Mesh* mesh);
+	virtual void generateLevelset(Grid<Real>& phi);
+
+protected:
+	std::vector<Shape*> mShapes;
+};
+
 } //namespace
 #endif
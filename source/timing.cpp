@@ -46,6 +46,20 @@ void TimingData::stop(FluidSolver* parent, const string& name) {
 	}
 }
 
+void TimingData::addStat(const string& name, Real value) {
+	StatSet& stat = mStats[name];
+	stat.cur += value;
+	stat.last = value;
+	stat.num++;
+}
+
+Real TimingData::getLastStat(const string& name) {
+	std::map<std::string, StatSet>::iterator it = mStats.find(name);
+	if (it == mStats.end())
+		errMsg("no solver statistic named '" + name + "' recorded");
+	return it->second.last;
+}
+
 void TimingData::step() {
 	if (updated)
 		num++;
@@ -60,6 +74,12 @@ void TimingData::step() {
 			it2->updated = false;
 		}
 	}
+	for (std::map<std::string, StatSet>::iterator it = mStats.begin(); it != mStats.end(); it++) {
+		it->second.total    += it->second.cur;
+		it->second.numTotal += it->second.num;
+		it->second.cur = 0;
+		it->second.num = 0;
+	}
 	updated = false;
 }
  
@@ -82,6 +102,10 @@ void TimingData::print() {
 										  name.c_str(), it2->cur.toString().c_str());
 		}
 	}
+	for (std::map<std::string, StatSet>::iterator it = mStats.begin(); it != mStats.end(); it++) {
+		if (it->second.num == 0) continue;
+		printf("  %s : sum %g, last %g (%d samples)\n", it->first.c_str(), it->second.cur, it->second.last, it->second.num);
+	}
 	step();
 		
 	printf("----------------------------------------\n");
@@ -107,6 +131,11 @@ void TimingData::saveMean(const string& filename) {
 			ofs << name << " " << (it2->total / it2->num) << endl;
 		}
 	 
+	for (std::map<std::string, StatSet>::iterator it = mStats.begin(); it != mStats.end(); it++) {
+		if (it->second.numTotal == 0) continue;
+		ofs << it->first << " : mean per step " << (it->second.total / num) << ", mean per sample " << (it->second.total / it->second.numTotal) << endl;
+	}
+	 
 	ofs << endl << "Total : " << total << " (mean " << total/num << ")" << endl;
 	ofs.close();
 }
@@ -29,8 +29,17 @@ public:
 	void saveMean(const std::string& filename);
 	void start(FluidSolver* parent, const std::string& name);
 	void stop(FluidSolver* parent, const std::string& name);
+	//! accumulate a solver statistic for the current step, e.g. CG iterations or residuals
+	void addStat(const std::string& name, Real value);
+	//! last sample of a solver statistic
+	Real getLastStat(const std::string& name);
 protected:
 	void step();
+	struct StatSet {
+		StatSet() : cur(0), total(0), last(0), num(0), numTotal(0) {}
+		Real cur, total, last;
+		int num, numTotal;
+	};
 	struct TimingSet {
 		TimingSet() : num(0),updated(false) { cur.clear(); total.clear(); }
 		MuTime cur, total;
@@ -44,6 +53,7 @@ protected:
 	MuTime mPluginTimer;
 	std::string mLastPlugin;
 	std::map<std::string, std::vector<TimingSet> > mData;
+	std::map<std::string, StatSet> mStats;
 };
 
 // Python interface
@@ -53,6 +63,7 @@ public:
 	
 	PYTHON() void display() { TimingData::instance().print(); }
 	PYTHON() void saveMean(std::string file) { TimingData::instance().saveMean(file); }
+	PYTHON() Real getLastStat(std::string name) { return TimingData::instance().getLastStat(name); }
 };
 
 }
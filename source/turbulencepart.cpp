@@ -55,7 +55,7 @@ inline Vec3 hsv2rgb(Real h, Real s, Real v){
 }
 
 void TurbulenceParticleSystem::seed(Shape* shape, int num) {
-	static RandomStream rand(34894231);
+	static RandomStream rand(34894231, "TurbulenceParticleSystem::seed");
 	Vec3 sz = shape->getExtent(), p0 = shape->getCenter() - sz*0.5;
 	for (int i=0; i<num; i++) {
 		Vec3 p;
@@ -0,0 +1,110 @@
+/******************************************************************************
+ *
+ * MantaFlow fluid solver framework
+ * Copyright 2011 Tobias Pfaff, Nils Thuerey
+ *
+ * This program is free software, distributed under the terms of the
+ * Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * 16 bit floating point storage type
+ *
+ ******************************************************************************/
+
+#ifndef _HALF_H
+#define _HALF_H
+
+#include <cstring>
+#include <stdint.h>
+#include "general.h"
+
+#if defined(__F16C__)
+#	include <immintrin.h>
+#endif
+
+namespace Manta {
+
+//! convert a float to IEEE 754 binary16, rounds to nearest even
+inline uint16_t floatToHalfBits(float f) {
+#	if defined(__F16C__)
+	return (uint16_t)_cvtss_sh(f, 0);
+#	else
+	uint32_t x;
+	memcpy(&x, &f, sizeof(float));
+	const uint16_t sign = (uint16_t)((x >> 16) & 0x8000);
+	x &= 0x7fffffff;
+	if (x >= 0x7f800000) return sign | 0x7c00 | (x > 0x7f800000 ? 0x200 : 0); // inf, nan
+	if (x >= 0x47800000) return sign | 0x7c00; // overflow
+	if (x < 0x38800000) {
+		// denormals, values below half the smallest denormal round to zero
+		if (x < 0x33000000) return sign;
+		const int shift = 126 - (int)(x >> 23);
+		const uint32_t m = (x & 0x7fffff) | 0x800000;
+		uint32_t h = m >> shift;
+		const uint32_t rem = m & ((1u << shift) - 1), halfway = 1u << (shift-1);
+		if (rem > halfway || (rem == halfway && (h & 1))) h++;
+		return sign | (uint16_t)h;
+	}
+	// rebias the exponent, a carry of the rounding moves on to the exponent (or inf)
+	uint32_t h = (x - 0x38000000) >> 13;
+	const uint32_t rem = x & 0x1fff;
+	if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) h++;
+	return sign | (uint16_t)h;
+#	endif
+}
+
+//! convert IEEE 754 binary16 to a float, exact
+inline float halfBitsToFloat(uint16_t h) {
+#	if defined(__F16C__)
+	return _cvtsh_ss(h);
+#	else
+	const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	const uint32_t e = (h >> 10) & 0x1f, m = h & 0x3ff;
+	uint32_t x;
+	if (e == 0x1f) {
+		x = sign | 0x7f800000 | (m << 13);
+	} else if (e) {
+		x = sign | ((e + 112) << 23) | (m << 13);
+	} else {
+		// zero or denormal, m * 2^-24
+		const float f = (float)m * 5.9604644775390625e-8f;
+		memcpy(&x, &f, sizeof(float));
+		x |= sign;
+	}
+	float f;
+	memcpy(&f, &x, sizeof(float));
+	return f;
+#	endif
+}
+
+//! 16 bit floating point storage type for grids of passive quantities, e.g. smoke density or heat.
+/*! Values are converted to float on every access, all computations are done with float / Real values.
+	The relative precision is ~1e-3 (11 bit mantissa), the range is +-65504, smaller values than 6e-5
+	are stored as denormals down to 6e-8. */
+class half {
+public:
+	inline half() : mBits(0) {}
+	inline half(float v)  : mBits(floatToHalfBits(v)) {}
+	inline half(double v) : mBits(floatToHalfBits((float)v)) {}
+	inline half(int v)    : mBits(floatToHalfBits((float)v)) {}
+
+	inline operator float() const { return halfBitsToFloat(mBits); }
+
+	inline half& operator+=(float v) { mBits = floatToHalfBits(halfBitsToFloat(mBits) + v); return *this; }
+	inline half& operator-=(float v) { mBits = floatToHalfBits(halfBitsToFloat(mBits) - v); return *this; }
+	inline half& operator*=(float v) { mBits = floatToHalfBits(halfBitsToFloat(mBits) * v); return *this; }
+	inline half& operator/=(float v) { mBits = floatToHalfBits(halfBitsToFloat(mBits) / v); return *this; }
+
+	//! raw access to the stored bits
+	inline uint16_t bits() const { return mBits; }
+	static inline half fromBits(uint16_t b) { half h; h.mBits = b; return h; }
+
+protected:
+	uint16_t mBits;
+};
+
+template<> inline half safeDivide<half>(const half& a, const half& b) { return (b != 0.f) ? half(float(a) / float(b)) : a; }
+
+} // namespace
+
+#endif
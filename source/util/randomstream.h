@@ -19,6 +19,9 @@
 #include <iostream>
 #include <stdio.h>
 #include <time.h>
+#include <map>
+#include <string>
+#include <vector>
 #include "vectorbase.h"
 
 namespace Manta {
@@ -345,7 +348,23 @@ class RandomStream
 {
 public:
 	inline RandomStream(long seed) : mtr(seed) {} ;
-	~RandomStream() {}
+	//! persistent stream, its state is part of solver checkpoints (use for static streams in plugins)
+	inline RandomStream(long seed, const std::string& name) : mtr(seed), mName(name) {
+		assertMsg(persistentStreams().count(mName)==0, "RandomStream: name '"<<mName<<"' is already in use");
+		persistentStreams()[mName] = this;
+		// a checkpoint may have been loaded before the stream was first used
+		std::map<std::string, std::vector<MTRand::uint32> >::iterator it = pendingStates().find(mName);
+		if(it != pendingStates().end()) { setState(it->second); pendingStates().erase(it); }
+	}
+	~RandomStream() { if(!mName.empty()) persistentStreams().erase(mName); }
+
+	//! generator state, for checkpoints
+	inline std::vector<MTRand::uint32> getState() const { std::vector<MTRand::uint32> s(MTRand::SAVE); mtr.save(&s[0]); return s; }
+	inline void setState(std::vector<MTRand::uint32> s) { assertMsg(s.size()==MTRand::SAVE, "RandomStream: invalid state size"); mtr.load(&s[0]); }
+
+	//! all persistent streams, and states of streams that were restored before their creation
+	static std::map<std::string, RandomStream*>& persistentStreams() { static std::map<std::string, RandomStream*> streams; return streams; }
+	static std::map<std::string, std::vector<MTRand::uint32> >& pendingStates() { static std::map<std::string, std::vector<MTRand::uint32> > states; return states; }
 
 	/*! get a random number from the stream */
 	inline double getDouble( void ) { return mtr.rand(); };
@@ -366,6 +385,7 @@ public:
 
 private: 
 	MTRand mtr; 
+	std::string mName;
 };
 
 
@@ -0,0 +1,89 @@
+#******************************************************************************
+#
+# MantaFlow fluid solver framework
+# Copyright 2018 Nils Thuerey
+#
+# This program is free software, distributed under the terms of the
+# Apache License, Version 2.0
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Random access to sharded training data written by mantaflow's ShardWriter
+#
+#******************************************************************************
+
+import struct
+import glob
+import numpy as np
+
+SHARD_MAGIC = b'MANTASHD'
+SHARD_INDEX_MAGIC = b'SHARDIDX'
+
+# read the index at the end of a shard file, list of dicts with name, frame, types, dims, offset and bytes
+def readShardIndex(filename):
+	with open(filename, 'rb') as f:
+		if f.read(8) != SHARD_MAGIC:
+			raise IOError("'%s' is not a shard file" % filename)
+		f.seek(-16, 2)
+		indexEnd = f.tell()
+		indexOffset, = struct.unpack('Q', f.read(8))
+		if f.read(8) != SHARD_INDEX_MAGIC:
+			raise IOError("'%s' has no index, was the ShardWriter closed?" % filename)
+		f.seek(indexOffset)
+		buf = f.read(indexEnd - indexOffset)
+
+	records = []
+	num, = struct.unpack_from('I', buf, 0)
+	pos = 4
+	for r in range(num):
+		length, = struct.unpack_from('I', buf, pos)
+		pos += 4
+		name = buf[pos:pos+length].decode('utf-8')
+		pos += length
+		frame, gridType, elementType, bytesPerElement, dimX, dimY, dimZ, dimT, offset, nbytes = struct.unpack_from('iiiiiiiiQQ', buf, pos)
+		pos += 48
+		records.append( { 'name':name, 'frame':frame, 'gridType':gridType, 'elementType':elementType, 'bytesPerElement':bytesPerElement,
+			'dimX':dimX, 'dimY':dimY, 'dimZ':dimZ, 'dimT':dimT, 'offset':offset, 'bytes':nbytes, 'file':filename } )
+	return records
+
+# all shards <basename>_XXXX.shard, records can be accessed by index or by grid name and frame
+class ShardReader(object):
+	def __init__(self, basename):
+		self.files = sorted(glob.glob(basename + "_[0-9][0-9][0-9][0-9].shard"))
+		if len(self.files)==0:
+			raise IOError("no shards found for '%s'" % basename)
+		self.records = []
+		for fn in self.files:
+			self.records.extend(readShardIndex(fn))
+		self.lookup = dict( ((rec['name'], rec['frame']), i) for i, rec in enumerate(self.records) )
+		self.handles = {}
+
+	def __len__(self):
+		return len(self.records)
+
+	def find(self, name, frame):
+		return self.lookup.get((name, frame), -1)
+
+	# content of a record, shaped like uniio: [z,y,x,channels], or [t,z,y,x,channels] for 4d grids
+	def read(self, record):
+		rec = self.records[record]
+		if rec['file'] not in self.handles:
+			self.handles[rec['file']] = open(rec['file'], 'rb')
+		f = self.handles[rec['file']]
+		f.seek(rec['offset'])
+		data = np.frombuffer(f.read(rec['bytes']), dtype="int32" if rec['elementType']==0 else "float32")
+		channels = [1, 1, 3, 4][rec['elementType']]
+		dimensions = [rec['dimT'], rec['dimZ'], rec['dimY'], rec['dimX'], channels]
+		if rec['dimT']<=1:
+			dimensions = dimensions[1:]
+		return data.reshape( *dimensions, order='C')
+
+	def readFrame(self, name, frame):
+		record = self.find(name, frame)
+		if record<0:
+			raise KeyError("no record '%s' for frame %d" % (name, frame))
+		return self.read(record)
+
+	def close(self):
+		for f in self.handles.values():
+			f.close()
+		self.handles = {}
@@ -194,6 +194,29 @@ def doTestGrid( file , name, parent , grid, threshold=0, thresholdStrict=0, inve
 		return checkResult( name, errVal , errValRel, threshold , thresholdStrict, invertResult )
 
 
+# ------------------------------------------------------------------------------------------
+# value checks, a mismatch prints an "Error" line, which runTests.py counts as a failure
+
+# value has to match expected within tol, scaled by max(1,|expected|) if relative; tol=0 requires
+# equal values (also for tuples)
+def check( name, value, expected, tol=1e-05, relative=True ):
+	if tol==0.:
+		ok = value == expected
+	else:
+		ok = abs(value-expected) <= tol * (max(1., abs(expected)) if relative else 1.)
+	if not ok:
+		print("Error - %s is %s, expected %s" % (name, str(value), str(expected)))
+
+def checkVec( name, value, expected, tol=1e-05 ):
+	check(name+".x", value.x, expected.x, tol)
+	check(name+".y", value.y, expected.y, tol)
+	check(name+".z", value.z, expected.z, tol)
+
+# grids (or particle data) a and b have to match, a is overwritten with the difference
+def checkSame( name, a, b, tol=1e-05 ):
+	a.sub(b)
+	check(name, a.getMaxAbs(), 0., tol)
+
 # ------------------------------------------------------------------------------------------
 # smaller helpers (directories, global settings)
 
@@ -0,0 +1,141 @@
+#
+# Checkpoint / restart of a 3d flip simulation, resuming from a checkpoint
+# has to give exactly the same result as continuing the simulation. The
+# restart uses a chain of a full and two delta checkpoints
+#
+import sys, os, shutil, tempfile
+from manta import *
+from helperInclude import *
+
+res   = 24
+steps = 12
+gs    = vec3(res,res,res)
+s = Solver(name='main', gridSize = gs, dim=3)
+s.frameLength = 1.0
+s.timestepMin = 0.2
+s.timestepMax = 1.0
+s.cfl         = 1.0
+s.timestep    = 0.5
+
+flags    = s.create(FlagGrid)
+vel      = s.create(MACGrid)
+velOld   = s.create(MACGrid)
+pressure = s.create(RealGrid)
+tmpVec3  = s.create(VecGrid)
+dens     = s.create(RealGrid)
+gradient = s.create(VecGrid)
+phiObs   = s.create(LevelsetGrid)
+
+pp       = s.create(BasicParticleSystem)
+pVel     = pp.create(PdataVec3)
+pDens    = pp.create(PdataReal)
+
+# results of the continued run, kept outside of the checkpointed solver
+sc       = Solver(name='continued', gridSize = gs, dim=3)
+densCont = sc.create(RealGrid)
+velCont  = sc.create(MACGrid)
+
+flags.initDomain(boundaryWidth=0)
+fluidbox = s.create(Box, p0=gs*vec3(0.1,0,0), p1=gs*vec3(0.4,0.6,1))
+phiInit = fluidbox.computeLevelset()
+flags.updateFromLevelset(phiInit)
+sampleFlagsWithParticles( flags=flags, parts=pp, discretization=3, randomness=0.2 )
+pDens.setConst( 0.5 )
+
+# static, only the full checkpoint has to store it
+obs = s.create(Sphere, center=gs*vec3(0.7,0.3,0.5), radius=res*0.15)
+phiObs.join( obs.computeLevelset() )
+
+def flipStep():
+	s.adaptTimestep(vel.getMax())
+	pp.advectInGrid(flags=flags, vel=vel, integrationMode=IntRK4, deleteInObstacle=False )
+	# jitters particles close to the walls with a persistent random stream
+	pp.projectOutside(gradient)
+	mapPartsToMAC(vel=vel, flags=flags, velOld=velOld, parts=pp, partVel=pVel, weight=tmpVec3 )
+	extrapolateMACFromWeight( vel=vel , distance=2, weight=tmpVec3 )
+	markFluidCells( parts=pp, flags=flags )
+	mapPartsToGrid(target=dens, flags=flags, parts=pp, source=pDens )
+
+	addGravity(flags=flags, vel=vel, gravity=(0,-0.003,0))
+	setWallBcs(flags=flags, vel=vel)
+	solvePressure(flags=flags, vel=vel, pressure=pressure)
+	setWallBcs(flags=flags, vel=vel)
+	extrapolateMACSimple( flags=flags, vel=vel )
+	flipVelocityUpdate(vel=vel, velOld=velOld, flags=flags, parts=pp, partVel=pVel, flipRatio=0.97 )
+	s.step()
+
+ckpBase  = "%s_ckp" % os.path.basename(sys.argv[0])
+ckpFiles = [ ckpBase+"_full.bin", ckpBase+"_delta1.bin", ckpBase+"_delta2.bin" ]
+
+for t in range(steps//3):
+	flipStep()
+saveCheckpoint(s, ckpFiles[0])
+for t in range(steps//3):
+	flipStep()
+saveCheckpoint(s, ckpFiles[1], base=ckpFiles[0])
+for t in range(steps//3):
+	flipStep()
+saveCheckpoint(s, ckpFiles[2], base=ckpFiles[1])
+saveCheckpoint(s, ckpBase+"_cmp.bin")
+if os.path.getsize(ckpFiles[2]) >= os.path.getsize(ckpBase+"_cmp.bin"):
+	print("Error - delta checkpoint is not smaller than the full one")
+os.remove(ckpBase+"_cmp.bin")
+
+for t in range(steps):
+	flipStep()
+densCont.copyFrom(dens)
+velCont.copyFrom(vel)
+frameCont = s.frame
+timeCont  = s.timeTotal
+numCont   = pp.pySize()
+
+# restart from another directory, bases are resolved relative to the delta
+ckpDir = tempfile.mkdtemp()
+for f in ckpFiles:
+	shutil.move(f, os.path.join(ckpDir, f))
+loadCheckpoint(s, os.path.join(ckpDir, ckpFiles[2]))
+for t in range(steps):
+	flipStep()
+
+diffDens = gridMaxDiff(dens, densCont)
+diffVel  = gridMaxDiffVec3(vel, velCont)
+print("Restart vs. continued run: density "+str(diffDens)+", vel "+str(diffVel)+", frame "+str(s.frame)+"/"+str(frameCont)+", particles "+str(pp.pySize())+"/"+str(numCont))
+if diffDens!=0. or diffVel!=0. or s.frame!=frameCont or s.timeTotal!=timeCont or pp.pySize()!=numCont:
+	print("Error - restarted simulation differs from the continued one")
+
+doTestGrid( sys.argv[0],"dens" , s, dens  , threshold=0.0001 , thresholdStrict=1e-10 )
+doTestGrid( sys.argv[0],"vel"  , s, vel   , threshold=0.001  , thresholdStrict=1e-10 )
+
+# a rewritten base has to be rejected
+saveCheckpoint(s, os.path.join(ckpDir, ckpFiles[0]))
+rejected = False
+setDebugLevel(0)
+try:
+	loadCheckpoint(s, os.path.join(ckpDir, ckpFiles[2]))
+except RuntimeError as e:
+	rejected = "rewritten" in str(e)
+setDebugLevel(1)
+if not rejected:
+	print("Error - delta checkpoint was loaded with a rewritten base")
+
+# files are replaced once they are complete, no temporary files are left behind
+full = os.path.join(ckpDir, ckpFiles[0])
+saveCheckpoint(s, full)
+if os.path.exists(full + ".tmp"):
+	print("Error - temporary checkpoint file was not moved")
+
+# objects without python names can't be matched, saving fails and keeps the previous file
+def addUnnamedGrid():
+	g = s.create(RealGrid)
+	saveCheckpoint(s, full)
+before = os.path.getsize(full)
+rejected = False
+setDebugLevel(0)
+try:
+	addUnnamedGrid()
+except RuntimeError as e:
+	rejected = "no name" in str(e)
+setDebugLevel(1)
+if not rejected or os.path.getsize(full) != before or os.path.exists(full + ".tmp"):
+	print("Error - checkpoint with an unnamed object was not rejected")
+shutil.rmtree(ckpDir)
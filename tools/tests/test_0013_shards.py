@@ -0,0 +1,75 @@
+#
+# Sharded training data: frames of several grids are appended to a few shard files,
+# and read back in random order
+#
+import sys, os, glob
+from manta import *
+from helperInclude import *
+
+res    = 48
+frames = 5
+gs     = vec3(res,res,res)
+s = Solver(name='main', gridSize = gs, dim=3)
+s.timestep = 1.0
+
+flags    = s.create(FlagGrid)
+vel      = s.create(MACGrid)
+density  = s.create(RealGrid)
+pressure = s.create(RealGrid)
+flags.initDomain()
+flags.fillGrid()
+source = s.create(Cylinder, center=gs*vec3(0.5,0.2,0.5), radius=res*0.15, z=gs*vec3(0, 0.05, 0))
+
+# tile batch, stored with the frames
+bs    = Solver(name='batch', gridSize = vec3(8,8,8), dim=3, fourthDim=27)
+tiles = bs.create(Grid4Vec4)
+
+# reference copies of all frames, in a separate solver
+sr = Solver(name='reference', gridSize = gs, dim=3)
+bsr = Solver(name='referenceBatch', gridSize = vec3(8,8,8), dim=3, fourthDim=27)
+densRef  = [ sr.create(RealGrid) for f in range(frames) ]
+velRef   = [ sr.create(MACGrid)  for f in range(frames) ]
+tilesRef = [ bsr.create(Grid4Vec4) for f in range(frames) ]
+flagsRef = sr.create(FlagGrid)
+flagsRef.copyFrom(flags)
+
+shardName = "%s_data" % os.path.basename(sys.argv[0])
+# every velocity grid has 1.3MB, so the frames are spread over several shards
+writer = s.create(ShardWriter, name=shardName, shardSize=2, bufferSize=1)
+for f in range(frames):
+	source.applyToGrid(grid=density, value=1.)
+	advectSemiLagrange(flags=flags, vel=vel, grid=density, order=2)
+	advectSemiLagrange(flags=flags, vel=vel, grid=vel    , order=2)
+	addBuoyancy(density=density, vel=vel, gravity=vec3(0,-4e-3,0), flags=flags)
+	solvePressure(flags=flags, vel=vel, pressure=pressure)
+	extractTiles(batch=tiles, density=density, vel=vel)
+
+	writer.add(grids=[density, vel, flags, tiles])
+	densRef[f].copyFrom(density)
+	velRef[f].copyFrom(vel)
+	tilesRef[f].copyFrom(tiles)
+	s.step()
+writer.close()
+
+if writer.getNumRecords()!=4*frames or writer.getNumShards()<2:
+	print("Error - writer has %d records in %d shards" % (writer.getNumRecords(), writer.getNumShards()))
+
+reader = s.create(ShardReader, name=shardName)
+if reader.getNumRecords()!=4*frames or reader.getNumShards()!=writer.getNumShards():
+	print("Error - reader found %d records in %d shards" % (reader.getNumRecords(), reader.getNumShards()))
+if reader.find("density", 3)<0 or reader.find("density", frames)>=0 or reader.getRecordName(reader.find("vel", 2))!="vel" or reader.getRecordFrame(reader.find("vel", 2))!=2:
+	print("Error - wrong record lookup")
+
+# random access, grids are matched by name
+flags.clear()
+for f in [3, 0, 4, 1, 2]:
+	reader.load(grids=[density, vel, flags, tiles], frame=f)
+	diffs = (gridMaxDiff(density, densRef[f]), gridMaxDiffVec3(vel, velRef[f]), grid4dMaxDiffVec4(tiles, tilesRef[f]), gridMaxDiffInt(flags, flagsRef))
+	if max(diffs) > 1e-06:
+		print("Error - frame %d differs after reading: %s" % (f, str(diffs)))
+
+reader = None
+for fn in glob.glob(shardName+"_*.shard"):
+	os.remove(fn)
+
+doTestGrid( sys.argv[0],"dens" , s, density, threshold=0.0001, thresholdStrict=1e-10 )
@@ -0,0 +1,46 @@
+#
+# Levelset booleans and hole filling, compared to analytic results
+#
+
+import sys
+from manta import *
+from helperInclude import *
+
+def runTest(gs, dim):
+	s = Solver(name='main', gridSize = gs, dim=dim)
+	z = lambda v: 0 if dim==2 else v
+
+	phi      = s.create(LevelsetGrid)
+	expected = s.create(RealGrid)
+
+	# inside everywhere, with cavities of 1, 4 (2d) / 8 (3d), and 9 / 27 cells, only the last one is too large
+	phi.setConst(-1.)
+	expected.setConst(-1.)
+	cavities = [ (vec3(5,5,z(5)), 1), (vec3(12,12,z(12)), 2), (vec3(20,20,z(20)), 3) ]
+	for p0, w in cavities:
+		box = s.create(Box, p0=p0, p1=p0+vec3(w,w,z(w) if dim==3 else 1))
+		box.applyToGrid(grid=phi, value=1.)
+		box.applyToGrid(grid=expected, value=(-0.5 if w<3 else 1.))
+	# the outside region along the domain boundary is a large component, and is kept
+	outer = s.create(Box, p0=vec3(0,0,0), p1=vec3(gs.x,1,gs.z))
+	outer.applyToGrid(grid=phi, value=1.)
+	outer.applyToGrid(grid=expected, value=1.)
+
+	phi.fillHoles(maxDepth=8, boundaryWidth=1)
+	expected.sub(phi)
+	check("fillHoles", expected.getMaxAbs(), 0.)
+
+	box = s.create(Box, p0=gs*vec3(0.2,0.2,z(0.2)), p1=gs*vec3(0.6,0.7,0.6 if dim==3 else 1))
+	sph = s.create(Sphere, center=gs*vec3(0.6,0.5,z(0.5)), radius=gs.x*0.2)
+	full = s.create(LevelsetGrid)
+	full.copyFrom(box.computeLevelset())
+	full.join(sph.computeLevelset())
+	flags = s.create(FlagGrid)
+	flags.initDomain()
+	flags.updateFromLevelset(full)
+	phi.initFromFlags(flags)
+	check("initFromFlags", phi.getMax(), 0.5)
+	check("initFromFlags", phi.getMin(), -0.5)
+
+runTest(vec3(31,29,1), 2)
+runTest(vec3(31,29,27), 3)
@@ -0,0 +1,123 @@
+#
+# Connected components of grids and particles, compared to analytic and brute force results
+#
+
+import sys, random
+from manta import *
+from helperInclude import *
+
+def runGridTest(gs, dim):
+	s = Solver(name='main', gridSize = gs, dim=dim)
+	zsize = gs.z if dim==3 else 1
+	flags  = s.create(FlagGrid)
+	labels = s.create(IntGrid)
+	flags.initDomain()
+	flags.fillGrid(TypeEmpty)
+
+	# a small box, and a column along the slab axis with a side branch at the top
+	box = s.create(Box, p0=vec3(3,3,0 if dim==2 else 3), p1=vec3(6,5,1 if dim==2 else 5))
+	box.applyToGrid(grid=flags, value=FlagFluid)
+	col = s.create(Box, p0=vec3(10,4,0 if dim==2 else 3), p1=vec3(12,gs.y-2,1 if dim==2 else gs.z-2))
+	col.applyToGrid(grid=flags, value=FlagFluid)
+	top = s.create(Box, p0=vec3(12,gs.y-3,0 if dim==2 else gs.z-3), p1=vec3(16,gs.y-2,1 if dim==2 else gs.z-2))
+	top.applyToGrid(grid=flags, value=FlagFluid)
+
+	cc = s.create(ConnectedComponents)
+	check("num", cc.labelFlags(labels, flags, FlagFluid), 2)
+	boxCells = 6 * (1 if dim==2 else 2)
+	colCells = 2*(gs.y-6) * (1 if dim==2 else gs.z-5)
+	topCells = 4 * (1 if dim==2 else 1)
+	check("size box", cc.getSize(1), boxCells)
+	check("size col", cc.getSize(2), colCells+topCells)
+	checkVec("bbox min", cc.getBBoxMin(1), vec3(3,3,0 if dim==2 else 3))
+	checkVec("bbox max", cc.getBBoxMax(1), vec3(6,5,1 if dim==2 else 5))
+	checkVec("centroid", cc.getCentroid(1), vec3(4.5,4,0.5 if dim==2 else 4))
+
+	# the same via threshold
+	density = s.create(RealGrid)
+	col.applyToGrid(grid=density, value=1.)
+	check("num threshold", cc.labelGrid(labels, density, 0.5, below=False), 1)
+	check("size threshold", cc.getSize(1), colCells)
+
+	cc.labelFlags(labels, flags, FlagFluid)
+	cc.labelsToSizes(labels)
+	check("sizes max", labels.getMax(), colCells+topCells)
+
+	# region helpers of the tensorflow plugins (only compiled with NUMPY=1), same engine
+	if 'getRegions' in globals():
+		regions = s.create(IntGrid)
+		check("regions num", getRegions(regions, flags, FlagFluid), 2)
+		cc.labelFlags(labels, flags, FlagFluid)
+		regions.sub(labels)
+		check("regions labels", regions.getMaxAbs(), 0)
+		getRegionalCounts(regions, flags, FlagFluid)
+		check("regional counts", regions.getMax(), colCells+topCells)
+		check("regional counts", regions.getMin(), 0)
+
+		# the small box is removed as a small region, the column stays
+		markSmallRegions(flags, regions, TypeEmpty, TypeObstacle, boxCells)
+		check("small regions", getRegions(regions, flags, FlagFluid), 1)
+
+		# extending a single cell by depth gives the L1 ball, obstacle cells block it
+		seed = s.create(Box, p0=vec3(6,6,0 if dim==2 else 6), p1=vec3(7,7,1 if dim==2 else 7))
+		wall = s.create(Box, p0=vec3(8,0,0), p1=vec3(9,gs.y,gs.z))
+		for blocked in [False, True]:
+			flags.fillGrid(TypeEmpty)
+			seed.applyToGrid(grid=flags, value=FlagFluid)
+			if blocked: wall.applyToGrid(grid=flags, value=FlagObstacle)
+			extendRegion(flags, FlagFluid, FlagObstacle, 3)
+			getRegionalCounts(regions, flags, FlagFluid)
+			ball = 25 if dim==2 else 63
+			# the wall at x=8 takes the cells with dx=2 and cuts off dx=3
+			if blocked: ball -= 4 if dim==2 else 6
+			check("extend region", regions.getMax(), ball)
+	else:
+		print("Note - getRegions not available (NUMPY=0), region helpers skipped")
+
+def runParticleTest(gs, dim):
+	s = Solver(name='main', gridSize = gs, dim=dim)
+	parts  = s.create(BasicParticleSystem)
+	labels = parts.create(PdataInt)
+
+	random.seed(5)
+	pos = []
+	for n in range(400):
+		p = [ random.uniform(1, gs.x-1), random.uniform(1, gs.y-1), random.uniform(1, gs.z-1) if dim==3 else 0.5 ]
+		pos.append(p)
+		parts.addParticle(vec3(p[0],p[1],p[2]))
+	# a chain through all slabs
+	for n in range(int(gs.z if dim==3 else gs.y)*2-4):
+		p = [ 2.1, 2.1+0.5*n, 0.5 ] if dim==2 else [ 2.1, 2.1, 2.1+0.5*n ]
+		pos.append(p)
+		parts.addParticle(vec3(p[0],p[1],p[2]))
+
+	radius = 1.3 if dim==3 else 0.9
+	parent = list(range(len(pos)))
+	def find(x):
+		while parent[x] != x: x = parent[x]
+		return x
+	for a in range(len(pos)):
+		for b in range(a):
+			d = sum((pos[a][c]-pos[b][c])**2 for c in range(3))
+			if d <= radius*radius:
+				ra, rb = find(a), find(b)
+				parent[max(ra,rb)] = min(ra,rb)
+	sizes = {}
+	for a in range(len(pos)):
+		r = find(a)
+		sizes[r] = sizes.get(r, 0) + 1
+	expected = sorted(sizes.values())
+
+	cc = s.create(ConnectedComponents)
+	num = cc.labelParticles(labels, parts, radius)
+	check("particle num", num, len(expected))
+	result = sorted([ cc.getSize(c) for c in range(1, num+1) ])
+	if result != expected:
+		print("Error - particle component sizes differ")
+	check("particle labels", labels.getMin(), 1)
+	check("particle labels", labels.getMax(), num)
+
+runGridTest(vec3(31,29,1), 2)
+runGridTest(vec3(31,29,27), 3)
+runParticleTest(vec3(31,29,1), 2)
+runParticleTest(vec3(31,29,27), 3)
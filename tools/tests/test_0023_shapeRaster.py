@@ -0,0 +1,89 @@
+#
+# Shapes rasterized in their bounding boxes, as static shapes and as groups
+#
+
+import sys
+from manta import *
+from helperInclude import *
+
+def runTest(gs, dim):
+	s = Solver(name='main', gridSize = gs, dim=dim)
+	z = lambda v: 0.5 if dim==2 else v
+	ref  = s.create(RealGrid)
+	res  = s.create(RealGrid)
+	vref = s.create(MACGrid)
+	vres = s.create(MACGrid)
+
+	sph = s.create(Sphere, center=vec3(8,9,z(10)), radius=4.3, scale=vec3(1.,0.7,1.))
+	box = s.create(Box, p0=vec3(20.5,3.2,z(4)), p1=vec3(27,11,z(12)))
+	cyl = s.create(Cylinder, center=vec3(14,20,z(15)), radius=3.5, z=vec3(0,0,4) if dim==3 else vec3(4,0,0))
+	group = s.create(ShapeGroup)
+	for shape in [sph, box, cyl]:
+		group.add(shape)
+
+	# group vs. applying the shapes one by one
+	ref.setConst(0.)
+	res.setConst(0.)
+	for shape in [sph, box, cyl]:
+		shape.applyToGrid(grid=ref, value=2.)
+	group.applyToGrid(grid=res, value=2.)
+	checkSame("group", res, ref)
+
+	vref.setConst(vec3(0.))
+	vres.setConst(vec3(0.))
+	for shape in [sph, box, cyl]:
+		shape.applyToGrid(grid=vref, value=vec3(1,2,3))
+	group.applyToGrid(grid=vres, value=vec3(1,2,3))
+	checkSame("group mac", vres, vref)
+
+	# smooth application, the shapes are far enough apart for the union to match
+	ref.setConst(0.)
+	res.setConst(0.)
+	for shape in [sph, box, cyl]:
+		shape.applyToGridSmooth(grid=ref, value=1., sigma=1.5, shift=0.5)
+	group.applyToGridSmooth(grid=res, value=1., sigma=1.5, shift=0.5)
+	checkSame("group smooth", res, ref)
+
+	# against the full sweep, a group with an unbounded shape isn't restricted
+	full = s.create(ShapeGroup)
+	null = s.create(NullShape)
+	full.add(null)
+	for shape in [sph, box, cyl]:
+		full.add(shape)
+	ref.setConst(0.)
+	res.setConst(0.)
+	full.applyToGridSmooth(grid=ref, value=1., sigma=1.5, shift=0.5)
+	group.applyToGridSmooth(grid=res, value=1., sigma=1.5, shift=0.5)
+	checkSame("full smooth", res, ref)
+	ref.setConst(0.)
+	res.setConst(0.)
+	full.applyToGrid(grid=ref, value=2.)
+	group.applyToGrid(grid=res, value=2.)
+	checkSame("full", res, ref)
+
+	# static shapes reuse the rasterization, and are updated when they change
+	for shape in [sph, box, cyl]:
+		shape.setStatic()
+		for it in range(2):
+			ref.setConst(0.)
+			res.setConst(0.)
+			shape.setStatic(False)
+			shape.applyToGrid(grid=ref, value=3.)
+			shape.applyToGridSmooth(grid=ref, value=1., sigma=2.)
+			shape.setStatic(True)
+			shape.applyToGrid(grid=res, value=3.)
+			shape.applyToGridSmooth(grid=res, value=1., sigma=2.)
+			checkSame("static", res, ref)
+			shape.setCenter(shape.getCenter() + vec3(1.,0.5,0))
+
+	ls = s.create(LevelsetGrid)
+	ls.copyFrom(sph.computeLevelset())
+	ls.join(box.computeLevelset())
+	ls.join(cyl.computeLevelset())
+	group.setStatic()
+	res.copyFrom(group.computeLevelset())
+	res.copyFrom(group.computeLevelset())
+	checkSame("levelset", res, ls)
+
+runTest(vec3(32,30,1), 2)
+runTest(vec3(32,30,28), 3)
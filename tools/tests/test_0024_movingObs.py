@@ -0,0 +1,110 @@
+#
+# Moving obstacles, particles are projected with the SDF sampled in the local frame of the obstacle (shapesOnly),
+# or out of all obstacle cells of the domain (default)
+#
+
+import sys
+from manta import *
+from helperInclude import *
+
+def runTest(gs, dim):
+	s = Solver(name='main', gridSize = gs, dim=dim)
+	zc = 0.5 if dim==2 else gs.z*0.5
+	flags = s.create(FlagGrid)
+	ref   = s.create(FlagGrid)
+	vel   = s.create(MACGrid)
+	labels = s.create(IntGrid)
+	cc    = s.create(ConnectedComponents)
+	pp    = s.create(BasicParticleSystem)
+	flags.initDomain()
+
+	radius = 4.5
+	p0 = vec3(9.3, gs.y*0.5, zc)
+	p1 = vec3(gs.x-9.6, gs.y*0.5+1.7, zc)
+	sph = s.create(Sphere, center=p0, radius=radius)
+	obs = MovingObstacle(parent=s)
+	obs.add(sph)
+
+	# two particles per axis and cell, and a second system with particles away from the path and the walls
+	far   = s.create(BasicParticleSystem)
+	pos   = pp.create(PdataVec3)
+	prev  = pp.create(PdataVec3)
+	box   = pp.create(PdataVec3)
+	fpos  = far.create(PdataVec3)
+	fprev = far.create(PdataVec3)
+	kmax = 1 if dim==2 else int(2*gs.z)-4
+	for k in range(kmax):
+		for j in range(int(2*gs.y)-4):
+			for i in range(int(2*gs.x)-4):
+				p = vec3(2+0.5*i+0.25, 2+0.5*j+0.25, zc if dim==2 else 2+0.5*k+0.25)
+				pp.addParticle(p)
+				inner = p.x < gs.x-1.2 and p.y < gs.y-1.2 and (dim==2 or p.z < gs.z-1.2)
+				if inner and (p.y < p0.y-radius-1. or p.y > p1.y+radius+1.):
+					far.addParticle(p)
+	far.getPosPdata(fprev)
+
+	steps = 6
+	for t in range(steps+1):
+		obs.moveLinear(t=t, t0=0, t1=steps, p0=p0, p1=p1, flags=flags, vel=vel)
+		c = sph.getCenter()
+		pp.getPosPdata(prev)
+		obs.projectOutside(flags, pp, shapesOnly=True)
+		obs.projectOutside(flags, far, shapesOnly=True)
+
+		# inside particles are pushed to the surface, all others stay where they are
+		pp.getPosPdata(pos)
+		pos.addConst(vec3(-c.x, -c.y, -c.z))
+		if pos.getMin() < radius - 0.1: # interpolation error of the unit spaced SDF samples
+			print("Error - particle at distance %f after projection, radius %f" % (pos.getMin(), radius))
+		# all particles are clamped to the domain [1,size-1] (with jitter), checked in the unit box
+		pp.getPosPdata(pos)
+		pos.addConst(vec3(-1, -1, -zc if dim==2 else -1))
+		pos.multConst(vec3(1./(gs.x-2), 1./(gs.y-2), 0 if dim==2 else 1./(gs.z-2)))
+		box.copyFrom(pos)
+		box.clamp(0., 1.)
+		box.sub(pos)
+		if box.getMaxAbs() > 0.:
+			print("Error - particle outside of the domain bounds")
+		pp.getPosPdata(pos)
+		pos.sub(prev)
+		if pos.getMaxAbs() > radius + 0.3:
+			print("Error - particle moved by %f" % pos.getMaxAbs())
+		far.getPosPdata(fpos)
+		fpos.sub(fprev)
+		if fpos.getMaxAbs() != 0.:
+			print("Error - particle outside the obstacle moved by %f" % fpos.getMaxAbs())
+
+		# obstacle cells match the sphere at its new position, without stale cells
+		ref.initDomain()
+		sph.applyToGrid(grid=ref, value=FlagObstacle)
+		nref = cc.labelFlags(labels, ref, FlagObstacle)
+		refSize = cc.getSize(nref)
+		nobs = cc.labelFlags(labels, flags, FlagObstacle)
+		if nobs != nref or cc.getSize(nobs) != refSize:
+			print("Error - obstacle has %d cells in %d components, expected %d in %d" % (cc.getSize(nobs), nobs, refSize, nref))
+		s.step()
+
+	# by default, particles are pushed out of static obstacle cells as well, but not with shapesOnly
+	sflags = s.create(FlagGrid)
+	sflags.initDomain()
+	static = s.create(Box, p0=vec3(4,1,0), p1=vec3(9,5,gs.z))
+	static.applyToGrid(grid=sflags, value=FlagObstacle)
+	single = s.create(BasicParticleSystem)
+	spos = single.create(PdataVec3)
+	inStatic = vec3(6.5, 4.6, zc) # 0.4 below the top of the box
+	single.addParticle(inStatic)
+	obs.projectOutside(sflags, single, shapesOnly=True)
+	single.getPosPdata(spos)
+	spos.addConst(vec3(-inStatic.x, -inStatic.y, -inStatic.z))
+	if spos.getMaxAbs() != 0.:
+		print("Error - shapesOnly projection moved a particle in a static obstacle by %f" % spos.getMaxAbs())
+	obs.projectOutside(sflags, single)
+	single.getPosPdata(spos)
+	spos.addConst(vec3(-inStatic.x, -inStatic.y, -inStatic.z))
+	if spos.getMaxAbs() < 0.4:
+		print("Error - particle was not pushed out of the static obstacle, moved by %f" % spos.getMaxAbs())
+
+runTest(vec3(32,28,1), 2)
+runTest(vec3(24,20,18), 3)
+
+print("Moving obstacle test done")
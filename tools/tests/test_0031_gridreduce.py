@@ -0,0 +1,45 @@
+#
+# Global reductions of grids (min, max, L1, L2, sums), compared to analytic values
+#
+
+import sys, math
+from manta import *
+from helperInclude import *
+
+def runTest(gs, dim):
+	s = Solver(name='main', gridSize = gs, dim=dim)
+	cells = int(gs.x*gs.y*gs.z)
+	inner = int((gs.x-2)*(gs.y-2)*((gs.z-2) if dim==3 else 1))
+
+	# background value 2, a single cell with -3 inside, and one on the boundary with 7
+	rg = s.create(RealGrid)
+	rg.setConst(2.)
+	single = s.create(Box, p0=vec3(3,4,0 if dim==2 else 5), p1=vec3(4,5,1 if dim==2 else 6))
+	single.applyToGrid(grid=rg, value=-3.)
+	corner = s.create(Box, p0=vec3(0,0,0), p1=vec3(1,1,1))
+	corner.applyToGrid(grid=rg, value=7.)
+
+	check("min", rg.getMin(), -3.)
+	check("max", rg.getMax(), 7.)
+	check("maxAbs", rg.getMaxAbs(), 7.)
+	check("L1", rg.getL1(), (cells-2)*2. + 3. + 7.)
+	check("L2", rg.getL2(), math.sqrt((cells-2)*4. + 9. + 49.))
+	check("L1 inner", rg.getL1(1), (inner-1)*2. + 3.)
+	check("L2 inner", rg.getL2(1), math.sqrt((inner-1)*4. + 9.))
+	check("totalSum", totalSum(rg), (inner-1)*2. - 3.)
+
+	vg = s.create(VecGrid)
+	vg.setConst(vec3(3,4,0))
+	single.applyToGrid(grid=vg, value=vec3(0,0,-1))
+	check("vec min", vg.getMin(), 1.)
+	check("vec max", vg.getMax(), 5.)
+	check("vec L1", vg.getL1(), (cells-1)*5. + 1.)
+	check("vec L2", vg.getL2(), math.sqrt((cells-1)*25. + 1.))
+
+	ig = s.create(IntGrid)
+	ig.setConst(-4)
+	check("int maxAbs", ig.getMaxAbs(), 4.)
+
+# sizes that aren't multiples of the vector width, 3d grid consists of several work items
+runTest(vec3(37,29,1), 2)
+runTest(vec3(43,41,39), 3)
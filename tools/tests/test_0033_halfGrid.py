@@ -0,0 +1,162 @@
+#
+# Half grids (16 bit storage): conversion, advection, fire functions and file io compared to real grids
+#
+
+import sys, os, tempfile
+from manta import *
+from helperInclude import *
+
+# max. difference of a half grid to a real grid
+def halfDiff(s, h, r):
+	tmp = s.create(RealGrid)
+	copyHalfToReal(h, tmp)
+	return gridMaxDiff(tmp, r)
+
+def runTest(gs, dim):
+	s = Solver(name='main', gridSize = gs, dim=dim)
+	s.timestep = 0.8
+	flags = s.create(FlagGrid)
+	vel   = s.create(MACGrid)
+	real  = s.create(RealGrid)
+	hgrid = s.create(HalfGrid)
+	back  = s.create(RealGrid)
+	flags.initDomain()
+	flags.fillGrid()
+
+	# conversion, relative rounding error of 2^-11
+	ball = s.create(Sphere, center=gs*0.5, radius=gs.x*0.3)
+	real.copyFrom(ball.computeLevelset())
+	copyRealToHalf(real, hgrid)
+	copyHalfToReal(hgrid, back)
+	check("max", hgrid.getMax(), real.getMax(), real.getMax()*2.**-11, relative=False)
+	check("min", hgrid.getMin(), real.getMin(), abs(real.getMin())*2.**-11, relative=False)
+	check("conversion", gridMaxDiff(back, real), 0., real.getMaxAbs()*2.**-11, relative=False)
+	hgrid.setConst(65504.)
+	check("largest value", hgrid.getMax(), 65504., 0., relative=False)
+	hgrid.setConst(1e-6)
+	check("denormal", hgrid.getMax(), 1e-6, 2.**-25, relative=False)
+	hgrid.setConst(0.1)
+	hgrid.addConst(0.2)
+	hgrid.multConst(2.)
+	check("grid ops", hgrid.getMax(), 0.6, 0.6*2.**-10, relative=False)
+
+	# advection of a smoke density, MacCormack steps in half and real precision
+	src = s.create(Box, p0=gs*vec3(0.2,0.2,0.2), p1=gs*vec3(0.5,0.5,0.5 if dim==3 else 1))
+	real.setConst(0.)
+	src.applyToGrid(grid=real, value=0.8)
+	hgrid.setConst(0.)
+	src.applyToGrid(grid=hgrid, value=0.8)
+	check("shape", halfDiff(s, hgrid, real), 0., 1e-3, relative=False)
+	vel.setConst(vec3(0.9, 0.6, 0.3 if dim==3 else 0))
+	for t in range(8):
+		advectSemiLagrange(flags=flags, vel=vel, grid=real, order=1)
+		advectSemiLagrange(flags=flags, vel=vel, grid=hgrid, order=1)
+	check("advection", halfDiff(s, hgrid, real), 0., 4e-3, relative=False)
+	for t in range(8):
+		advectSemiLagrange(flags=flags, vel=vel, grid=real, order=2)
+		advectSemiLagrange(flags=flags, vel=vel, grid=hgrid, order=2)
+	# the MacCormack clamping can switch to the first order value in single cells
+	check("advection maccormack", halfDiff(s, hgrid, real), 0., 5e-2, relative=False)
+	advectSemiLagrangeLocal(flags=flags, vel=vel, grid=real, order=1)
+	advectSemiLagrangeLocal(flags=flags, vel=vel, grid=hgrid, order=1)
+	check("advection local dt", halfDiff(s, hgrid, real), 0., 5e-3, relative=False)
+
+	# buoyancy, the same density in both grids
+	copyRealToHalf(real, hgrid)
+	velH = s.create(MACGrid)
+	vel.setConst(vec3(0,0,0))
+	addBuoyancy(flags=flags, density=real, vel=vel, gravity=vec3(0,-4e-3,0))
+	addBuoyancy(flags=flags, density=hgrid, vel=velH, gravity=vec3(0,-4e-3,0))
+	vel.sub(velH)
+	check("buoyancy", vel.getMaxAbs(), 0., 1e-4, relative=False)
+
+	# fire, all passive grids either real or half
+	names = ['fuel', 'density', 'react', 'heat', 'flame']
+	rg = dict((n, s.create(RealGrid)) for n in names)
+	hg = dict((n, s.create(HalfGrid)) for n in names)
+	for n in ['fuel', 'react']:
+		src.applyToGrid(grid=rg[n], value=1.)
+		src.applyToGrid(grid=hg[n], value=1.)
+	for t in range(4):
+		processBurn(fuel=rg['fuel'], density=rg['density'], react=rg['react'], heat=rg['heat'], burningRate=0.2)
+		processBurn(fuel=hg['fuel'], density=hg['density'], react=hg['react'], heat=hg['heat'], burningRate=0.2)
+		updateFlame(react=rg['react'], flame=rg['flame'])
+		updateFlame(react=hg['react'], flame=hg['flame'])
+	for n in names:
+		check("fire " + n, halfDiff(s, hg[n], rg[n]), 0., 2e-3 * max(1., rg[n].getMaxAbs()), relative=False)
+	if rg['fuel'].getMax() >= 1. or rg['flame'].getMax() <= 0.:
+		print("Error - no burning")
+
+	# file io, half values are stored as float values and read back exactly
+	d = tempfile.mkdtemp()
+	for ext in ['uni', 'raw']:
+		fname = os.path.join(d, 'half%d.%s' % (dim, ext))
+		hg['density'].save(fname)
+		loaded = s.create(HalfGrid)
+		loaded.load(fname)
+		loaded.sub(hg['density'])
+		check("load " + ext, loaded.getMaxAbs(), 0., 0., relative=False)
+		os.remove(fname)
+	fname = os.path.join(d, 'half%d.uni' % dim)
+	hg['density'].save(fname)
+	real.load(fname)
+	check("load as real grid", halfDiff(s, hg['density'], real), 0., 0., relative=False)
+	os.remove(fname)
+
+	# checkpoints keep the half values bit for bit
+	# (objects are matched by name, so they are created with one in their own solver)
+	fname = os.path.join(d, 'half%d.ckp' % dim)
+	sc = Solver(name='checkpointed', gridSize = gs, dim=dim)
+	ckpGrid = sc.create(HalfGrid, name='halfCkp')
+	ckpGrid.copyFrom(hg['density'])
+	saveCheckpoint(sc, fname)
+	ckpGrid.setConst(0.)
+	loadCheckpoint(sc, fname)
+	ref = s.create(HalfGrid)
+	ref.copyFrom(hg['density'])
+	ref.sub(ckpGrid)
+	check("checkpoint", ref.getMaxAbs(), 0., 0., relative=False)
+	os.remove(fname)
+
+	# shards store half grids as floats
+	shardName = os.path.join(d, 'half%d' % dim)
+	shardGrid = s.create(HalfGrid, name='halfShard')
+	shardGrid.copyFrom(hg['density'])
+	writer = s.create(ShardWriter, name=shardName)
+	writer.add(grids=[shardGrid], frame=0)
+	writer.close()
+	sr = Solver(name='reader', gridSize = gs, dim=dim)
+	loaded = sr.create(HalfGrid, name='halfShard')
+	reader = sr.create(ShardReader, name=shardName)
+	reader.load(grids=[loaded], frame=0)
+	loaded.sub(hg['density'])
+	check("shards", loaded.getMaxAbs(), 0., 0., relative=False)
+	reader = None
+	os.remove(shardName + '_0000.shard')
+	os.rmdir(d)
+
+# halo exchange, scatter and gather of half grids on two ranks
+def runDecompositionTest(gs):
+	sg = Solver(name='global', gridSize = gs, dim=3)
+	glob = sg.create(HalfGrid)
+	back = sg.create(HalfGrid)
+	ball = sg.create(Sphere, center=gs*0.5, radius=gs.x*0.3)
+	copyRealToHalf(ball.computeLevelset(), glob)
+
+	dd = DomainDecomposition(gridSize=gs, dim=3, numRanks=2, ghostWidth=2)
+	sl = Solver(name='local', gridSize=dd.getLocalSize(), dim=3)
+	local = sl.create(HalfGrid)
+	dd.scatter(local, glob)
+	dd.exchange(local)
+	dd.gather(local, back)
+	if dd.getRank()==0:
+		back.sub(glob)
+		check("decomposition", back.getMaxAbs(), 0., 0., relative=False)
+	dd.finish()
+	return dd.getRank()
+
+runTest(vec3(32,30,1), 2)
+runTest(vec3(20,22,18), 3)
+
+if runDecompositionTest(vec3(16,18,20))==0:
+	print("Half grid test done")
@@ -0,0 +1,74 @@
+#
+# Deterministic reductions: fixed blocks joined pairwise, compared to the same summation order in python
+#
+
+import sys, os, random, struct, gzip, tempfile
+from manta import *
+from helperInclude import *
+
+# cells per block, REDUCE_BLOCK_CELLS in kernel.h
+blockCells = 1<<14
+
+def f32(v):
+	return struct.unpack('f', struct.pack('f', v))[0]
+
+# sequential sums per block, blocks joined pairwise
+def blockSum(values, add):
+	parts = []
+	for b in range(0, len(values), blockCells):
+		acc = 0.
+		for v in values[b:b+blockCells]:
+			acc = add(acc, v)
+		parts.append(acc)
+	w = 1
+	while w < len(parts):
+		for p in range(0, len(parts)-w, 2*w):
+			parts[p] = add(parts[p], parts[p+w])
+		w *= 2
+	return add(0., parts[0])
+
+def addDouble(a, b): return a + b
+def addFloat(a, b):  return f32(a + b)
+
+def runTest(gs, dim):
+	s = Solver(name='main', gridSize = gs, dim=dim)
+	random.seed(17)
+	cells = int(gs.x*gs.y*gs.z)
+
+	# grid sum (double accumulation per cell), the values are written as a raw file
+	values = [f32(random.uniform(-1., 3.)) for c in range(cells)]
+	d = tempfile.mkdtemp()
+	fname = os.path.join(d, 'values.raw')
+	with gzip.open(fname, 'wb') as f:
+		f.write(struct.pack('%df' % cells, *values))
+	rg = s.create(RealGrid)
+	rg.load(fname)
+	os.remove(fname)
+	os.rmdir(d)
+	avg = getGridAvg(rg)
+	check("grid average", avg, f32(blockSum(values, addDouble) * (1./cells)), tol=0.)
+	for t in range(3):
+		check("repeated grid average", getGridAvg(rg), avg, tol=0.)
+
+	# particle sum (accumulation in Real)
+	pp = s.create(BasicParticleSystem)
+	pos = []
+	for p in range(3*blockCells + 1234):
+		v = vec3(random.uniform(0, gs.x), random.uniform(0, gs.y), random.uniform(0, gs.z))
+		pp.addParticle(v)
+		pos.append(v)
+	pv = pp.create(PdataVec3)
+	pp.getPosPdata(pv)
+	sum = pv.sum()
+	check("particle sum x", sum.x, blockSum([f32(v.x) for v in pos], addFloat), tol=0.)
+	check("particle sum y", sum.y, blockSum([f32(v.y) for v in pos], addFloat), tol=0.)
+	check("particle sum z", sum.z, blockSum([f32(v.z) for v in pos], addFloat), tol=0.)
+
+setDeterministicReductions(True)
+if not getDeterministicReductions():
+	print("Error - deterministic reductions not enabled")
+runTest(vec3(37,29,1), 2)
+runTest(vec3(43,41,39), 3)
+setDeterministicReductions(False)
+
+print("Deterministic reduction test done")
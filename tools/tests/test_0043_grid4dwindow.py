@@ -0,0 +1,74 @@
+#
+# Out-of-core 4d grids: only a window of time slices is resident, results have to match
+# the fully loaded 4d grid
+#
+import sys, os
+from manta import *
+from helperInclude import *
+
+res = 20
+gs  = vec3(res,res,res)
+s   = Solver(name='main', gridSize = gs, dim=3, fourthDim=8)
+s2  = Solver(name='upres', gridSize = gs*2, dim=3)
+
+dens4d = s.create(Grid4Real)
+setRegion4d(dens4d, vec4(2,3,4,1), vec4(12,9,15,5), 1.)
+setRegion4d(dens4d, vec4(6,2,1,3), vec4(17,14,8,7), 0.5)
+# smooth it a bit with a 4d resampling roundtrip
+sm   = Solver(name='small', gridSize = gs*0.5, dim=3, fourthDim=4)
+sm4d = sm.create(Grid4Real)
+interpolateGrid4d(sm4d, dens4d)
+interpolateGrid4d(dens4d, sm4d)
+
+fileName = "%s_dens4d.uni" % os.path.basename(sys.argv[0])
+dens4d.save(fileName)
+
+window = s.create(Grid4RealWindow, filename=fileName, window=2)
+if window.getSizeT()!=8:
+	print("Error - wrong 4d size %d" % window.getSizeT())
+
+slice    = s.create(RealGrid)
+sliceRef = s.create(RealGrid)
+tmp      = s.create(RealGrid)
+for t in [0, 1, 2, 7, 3, 3, 2]:
+	window.getSlice(slice, t)
+	getSliceFrom4d(dens4d, t, sliceRef)
+	if gridMaxDiff(slice, sliceRef)!=0.:
+		print("Error - slice %d differs" % t)
+# only the first access to a slice outside of the window reads from the file
+if window.getNumLoads()!=6:
+	print("Error - %d slice loads with a window of 2" % window.getNumLoads())
+
+# interpolation in time, halfway between two slices
+window.interpolateSlice(slice, 4.5)
+getSliceFrom4d(dens4d, 4, sliceRef)
+getSliceFrom4d(dens4d, 5, tmp)
+sliceRef.add(tmp)
+sliceRef.multConst(0.5)
+if gridMaxDiff(slice, sliceRef)>1e-06:
+	print("Error - time interpolation differs by %f" % gridMaxDiff(slice, sliceRef))
+
+# spatial upsampling of a slice
+up    = s2.create(RealGrid)
+upRef = s2.create(RealGrid)
+window.interpolateSlice(up, 6.)
+getSliceFrom4d(dens4d, 6, sliceRef)
+interpolateGrid(upRef, sliceRef)
+if gridMaxDiff(up, upRef)>1e-06:
+	print("Error - upsampled slice differs by %f" % gridMaxDiff(up, upRef))
+
+# a window of one slice is extended to two, interpolation mustn't overwrite the first slice
+window = s.create(Grid4RealWindow, filename=fileName, window=1)
+window.interpolateSlice(slice, 4.5)
+getSliceFrom4d(dens4d, 4, sliceRef)
+getSliceFrom4d(dens4d, 5, tmp)
+sliceRef.add(tmp)
+sliceRef.multConst(0.5)
+if gridMaxDiff(slice, sliceRef)>1e-06:
+	print("Error - time interpolation with window 1 differs by %f" % gridMaxDiff(slice, sliceRef))
+
+window = None
+os.remove(fileName)
+
+doTestGrid( sys.argv[0], "dens", s, dens4d, threshold=1e-05, thresholdStrict=1e-10 )
+doTestGrid( sys.argv[0], "up"  , s2, up   , threshold=1e-05, thresholdStrict=1e-10 )
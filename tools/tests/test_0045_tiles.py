@@ -0,0 +1,88 @@
+#
+# Tile extraction for training data: strided tiles, density rejection, rotations and flips
+#
+
+import sys
+from manta import *
+from helperInclude import *
+
+res = 32
+tile = 8
+s  = Solver(name='main', gridSize = vec3(res,res,1), dim=2)
+sh = Solver(name='high', gridSize = vec3(2*res,2*res,1), dim=2)
+# batch solvers, x,y,z are the tile size, the fourth dimension holds the tiles (7x7 overlapping ones)
+bs  = Solver(name='batch', gridSize = vec3(tile,tile,1), dim=3, fourthDim=49)
+bsh = Solver(name='batchHigh', gridSize = vec3(2*tile,2*tile,1), dim=3, fourthDim=49)
+
+density = s.create(RealGrid)
+vel     = s.create(MACGrid)
+densHi  = sh.create(RealGrid)
+
+# asymmetric content in the lower left quarter
+boxA = s.create(Box, p0=vec3(2,3,0), p1=vec3(12,9,1))
+boxB = s.create(Box, p0=vec3(5,7,0), p1=vec3(9,15,1))
+boxA.applyToGrid(grid=density, value=1.)
+boxB.applyToGrid(grid=density, value=0.5)
+vel.setConst(vec3(1,2,0))
+boxB.applyToGrid(grid=vel, value=vec3(-0.5,3,0))
+interpolateGrid(target=densHi, source=density)
+
+batch  = bs.create(Grid4Vec4)
+batch2 = bs.create(Grid4Vec4)
+comp   = bs.create(Grid4Real)
+
+# regular and overlapping patterns, without rejection all tiles are written
+check("tiles", extractTiles(batch=batch, density=density, vel=vel), 16, tol=0.)
+check("overlapping tiles", extractTiles(batch=batch, density=density, vel=vel, strides=vec3(4,4,1)), 49, tol=0.)
+
+# only tiles with enough density remain
+numLow = extractTiles(batch=batch, density=density, vel=vel, strides=vec3(4,4,1), densityMinimum=0.1)
+check("selected tiles", numLow, 9, tol=0.)
+# high-res tiles are selected with the low-res density, so that both batches correspond
+batchHi = bsh.create(Grid4Real)
+check("high-res tiles", extractTiles(batch=batchHi, density=densHi, strides=vec3(8,8,1), densityMinimum=0.1, selectDensity=density), numLow, tol=0.)
+
+# rotating by 180 degrees equals flipping both axes, 360 degrees is the identity
+extractTiles(batch=batch , density=density, vel=vel, strides=vec3(4,4,1), rotation=vec3(0,0,180))
+extractTiles(batch=batch2, density=density, vel=vel, strides=vec3(4,4,1), flip=vec3(1,1,0))
+check("rotate 180 vs flip", grid4dMaxDiffVec4(batch, batch2), 0., tol=0.)
+extractTiles(batch=batch , density=density, vel=vel, strides=vec3(4,4,1), rotation=vec3(0,0,360))
+extractTiles(batch=batch2, density=density, vel=vel, strides=vec3(4,4,1))
+check("rotate 360", grid4dMaxDiffVec4(batch, batch2), 0., tol=0.)
+
+# velocity components follow the transformation
+uniform = s.create(MACGrid)
+uniform.setConst(vec3(1,2,0))
+extractTiles(batch=batch, density=density, vel=uniform, strides=vec3(4,4,1), flip=vec3(1,0,0))
+getComp4d(batch, comp, 1)
+check("flipped vel x", (comp.getMin(), comp.getMax()), (-1.,-1.), tol=0.)
+extractTiles(batch=batch, density=density, vel=uniform, strides=vec3(4,4,1), rotation=vec3(0,0,90))
+getComp4d(batch, comp, 1)
+check("rotated vel x", (comp.getMin(), comp.getMax()), (-2.,-2.), tol=0.)
+getComp4d(batch, comp, 2)
+check("rotated vel y", (comp.getMin(), comp.getMax()), (1.,1.), tol=0.)
+
+# arbitrary rotation of the augmented batch
+batch.clear()
+extractTiles(batch=batch, density=density, vel=vel, strides=vec3(4,4,1), densityMinimum=0.1, rotation=vec3(0,0,30), flip=vec3(0,1,0))
+doTestGrid( sys.argv[0], "batch", bs, batch, threshold=1e-05, thresholdStrict=1e-10 )
+
+# numpy entry point (only compiled with NUMPY=1), writes the same [tile][z][y][x][channel] layout
+if 'extractTilesNumpy' in globals():
+	import numpy as np
+	npBatch = np.zeros([49, 1, tile, tile, 4], dtype=np.float32)
+	batch.clear()
+	num = extractTiles(batch=batch, density=density, vel=vel, strides=vec3(4,4,1), densityMinimum=0.1, rotation=vec3(0,0,30), flip=vec3(0,1,0))
+	check("numpy tiles", extractTilesNumpy(batch=npBatch, density=density, vel=vel, strides=vec3(4,4,1), densityMinimum=0.1, rotation=vec3(0,0,30), flip=vec3(0,1,0)), num, tol=0.)
+	for c in range(4):
+		getComp4d(batch, comp, c)
+		check("numpy channel %d min" % c, float(npBatch[...,c].min()), comp.getMin(), tol=1e-06, relative=False)
+		check("numpy channel %d max" % c, float(npBatch[...,c].max()), comp.getMax(), tol=1e-06, relative=False)
+
+	# velocity only, rotated, behind a start offset that keeps the first tiles
+	npVel = np.full([20, 1, tile, tile, 2], 7., dtype=np.float32)
+	check("numpy vel tiles", extractTilesNumpy(batch=npVel, vel=uniform, strides=vec3(8,8,1), rotation=vec3(0,0,90), startTile=4), 16, tol=0.)
+	check("numpy start tile", float(np.abs(npVel[:4]-7.).max()), 0., tol=0.)
+	check("numpy rotated vel", (float(npVel[4:,...,0].min()), float(npVel[4:,...,0].max()), float(npVel[4:,...,1].min()), float(npVel[4:,...,1].max())), (-2.,-2.,1.,1.), tol=0.)
+else:
+	print("Note - extractTilesNumpy not available (NUMPY=0), numpy tiles skipped")
@@ -0,0 +1,55 @@
+#
+# Cached curl noise: trilinear lookups in a precomputed curl tile instead of evaluating the
+# wavelet noise, has to stay close to the exact noise while the field is animated
+#
+import sys
+from manta import *
+from helperInclude import *
+
+res = 32
+gs  = vec3(res,res,res)
+s   = Solver(name='main', gridSize = gs, dim=3)
+s.timestep = 0.7
+
+flags = s.create(FlagGrid)
+flags.initDomain()
+flags.fillGrid()
+
+noise = s.create(NoiseField, loadFromFile=True)
+noise.posScale  = vec3(16)
+noise.timeAnim  = 0.3
+noise.valScale  = 1.5
+noise.valOffset = 0.2
+
+exact  = s.create(VecGrid)
+cached = s.create(VecGrid)
+for t in range(3):
+	s.step()
+	noise.posOffset = noise.posOffset + vec3(0.3, 0.1, -0.2)
+
+	noise.disableCurlCache()
+	exact.clear()
+	applySimpleNoiseVec3(flags=flags, target=exact, noise=noise)
+	noise.cacheCurl()
+	cached.clear()
+	applySimpleNoiseVec3(flags=flags, target=cached, noise=noise)
+
+	l2 = exact.getL2()
+	cached.sub(exact)
+	if cached.getL2() > 0.15*l2:
+		print("Error - cached curl noise differs, relative L2 error %f" % (cached.getL2()/l2))
+	cached.add(exact)
+
+# clamped noise always uses the exact evaluation
+clamped = s.create(VecGrid)
+noise.clamp = True
+noise.clampNeg = -0.5
+noise.clampPos = 0.5
+applySimpleNoiseVec3(flags=flags, target=clamped, noise=noise)
+noise.disableCurlCache()
+exact.clear()
+applySimpleNoiseVec3(flags=flags, target=exact, noise=noise)
+if gridMaxDiffVec3(clamped, exact) != 0.:
+	print("Error - clamped noise used the cache")
+
+doTestGrid( sys.argv[0], "cached", s, cached, threshold=1e-04, thresholdStrict=1e-10 )
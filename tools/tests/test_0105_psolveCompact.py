@@ -0,0 +1,55 @@
+#
+# 3d pressure solve for a liquid, compact system with only fluid cells
+# 
+
+import sys
+from manta import *
+from helperInclude import *
+
+# solver params
+res = 52
+gs = vec3(res,res,res)
+s = Solver(name='main', gridSize = gs, dim=3)
+s.timestep = 1.0
+
+# prepare grids
+flags    = s.create(FlagGrid)
+vel      = s.create(MACGrid)
+pressure = s.create(RealGrid)
+phi      = s.create(LevelsetGrid)
+
+flags.initDomain()
+
+# basin and drop
+basin = s.create(Box, p0=gs*vec3(0,0,0), p1=gs*vec3(1,0.2,1))
+drop  = s.create(Sphere, center=gs*vec3(0.5,0.5,0.5), radius=res*0.125)
+phi.copyFrom( basin.computeLevelset() )
+phi.join( drop.computeLevelset() )
+flags.updateFromLevelset(phi)
+
+velSource = s.create(Box, p0=gs*vec3(0.3,0.1,0.3), p1=gs*vec3(0.7,0.6,0.7) )
+
+# ============================
+
+# MIC preconditioned solve
+vel.setConst( vec3(0,0,0) )
+velSource.applyToGrid(grid=vel, value=vec3(0.15, -0.3, 0.21) )    
+setWallBcs(flags=flags, vel=vel) 
+solvePressure(flags=flags, vel=vel, pressure=pressure, cgMaxIterFac=99, cgAccuracy=1e-04, compactSystem=True)
+s.step()
+
+doTestGrid( sys.argv[0], "pressure0" , s, pressure , threshold=1e-04, thresholdStrict=1e-10)
+doTestGrid( sys.argv[0], "vel0"      , s, vel      , threshold=1e-04, thresholdStrict=1e-10)
+
+# ============================
+
+# second solve, with ghost fluid boundary conditions
+vel.setConst( vec3(0,0,0) )
+velSource.applyToGrid(grid=vel, value=vec3(1.5, -3, 2.1) )
+setWallBcs(flags=flags, vel=vel) 
+solvePressure(flags=flags, vel=vel, pressure=pressure, phi=phi, cgMaxIterFac=99, cgAccuracy=1e-04, compactSystem=True)
+s.step()
+
+doTestGrid( sys.argv[0], "pressure" , s, pressure , threshold=1e-04, thresholdStrict=1e-10)
+doTestGrid( sys.argv[0], "vel"      , s, vel      , threshold=1e-04, thresholdStrict=1e-10)
+
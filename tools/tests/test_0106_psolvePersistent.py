@@ -0,0 +1,52 @@
+#
+# 3d smoke pressure solves with a persistent solver object, static obstacle
+# 
+
+import sys
+from manta import *
+from helperInclude import *
+
+# solver params
+res = 40
+gs = vec3(res,res,res)
+s = Solver(name='main', gridSize = gs, dim=3)
+s.timestep = 1.0
+
+# prepare grids
+flags    = s.create(FlagGrid)
+vel      = s.create(MACGrid)
+density  = s.create(RealGrid)
+pressure = s.create(RealGrid)
+psolver  = s.create(PressureSolver)
+
+flags.initDomain()
+obs = s.create(Sphere, center=gs*vec3(0.5,0.6,0.5), radius=res*0.15)
+obs.applyToGrid(grid=flags, value=FlagObstacle)
+flags.fillGrid()
+
+source = s.create(Cylinder, center=gs*vec3(0.5,0.1,0.5), radius=res*0.14, z=gs*vec3(0, 0.02, 0))
+
+# the system is only assembled in the first step, later steps reuse matrix and MIC factors
+for t in range(6):
+	source.applyToGrid(grid=density, value=1)
+	advectSemiLagrange(flags=flags, vel=vel, grid=density, order=2)
+	advectSemiLagrange(flags=flags, vel=vel, grid=vel,     order=2)
+	setWallBcs(flags=flags, vel=vel)
+	addBuoyancy(density=density, vel=vel, gravity=vec3(0,-6e-4,0), flags=flags)
+	psolver.solve(flags=flags, vel=vel, pressure=pressure)
+	if psolver.getNumRebuilds() != 1:
+		print("Error - system was rebuilt with static flags, %d rebuilds in step %d" % (psolver.getNumRebuilds(), t))
+	s.step()
+
+doTestGrid( sys.argv[0], "pressure" , s, pressure , threshold=1e-04, thresholdStrict=1e-10)
+doTestGrid( sys.argv[0], "vel"      , s, vel      , threshold=1e-04, thresholdStrict=1e-10)
+doTestGrid( sys.argv[0], "dens"     , s, density  , threshold=1e-04, thresholdStrict=1e-10)
+
+# changed flags have to trigger exactly one rebuild
+obs2 = s.create(Box, p0=gs*vec3(0.2,0.7,0.2), p1=gs*vec3(0.3,0.8,0.3))
+obs2.applyToGrid(grid=flags, value=FlagObstacle)
+for t in range(2):
+	setWallBcs(flags=flags, vel=vel)
+	psolver.solve(flags=flags, vel=vel, pressure=pressure)
+	if psolver.getNumRebuilds() != 2:
+		print("Error - expected a single rebuild after the flag change, got %d rebuilds" % (psolver.getNumRebuilds()-1))
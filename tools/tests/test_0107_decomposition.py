@@ -0,0 +1,92 @@
+#
+# Smoke plume on a domain decomposed onto two local processes,
+# compared to the same simulation on the full domain
+#
+import sys
+from manta import *
+from helperInclude import *
+
+res      = 32
+steps    = 12
+ranks    = 2
+accuracy = 1e-05
+
+gs = vec3(res,res,res)
+
+# the domain is split along z, the plume rises along z through the slabs
+# forks the other ranks, all of them continue from here
+dd = DomainDecomposition(gridSize=gs, dim=3, numRanks=ranks, ghostWidth=4)
+
+def runPlume(s, offset, dd=None):
+	flags    = s.create(FlagGrid)
+	vel      = s.create(MACGrid)
+	density  = s.create(RealGrid)
+	pressure = s.create(RealGrid)
+	parts    = s.create(BasicParticleSystem)
+	pHeight  = parts.create(PdataReal)
+
+	if dd:
+		dd.initDomain(flags)
+	else:
+		flags.initDomain()
+	flags.fillGrid()
+
+	# shapes are placed in global coordinates
+	source = s.create(Cylinder, center=gs*vec3(0.5,0.5,0.35)-offset, radius=res*0.2, z=gs*vec3(0, 0, 0.05))
+	obs    = s.create(Sphere, center=gs*vec3(0.6,0.45,0.65)-offset, radius=res*0.12)
+	obs.applyToGrid(grid=flags, value=FlagObstacle)
+
+	sampleShapeWithParticles(shape=source, flags=flags, parts=parts, discretization=2, randomness=0)
+	pHeight.setConst(1.)
+	if dd:
+		dd.removeGhostParticles(parts)
+
+	for t in range(steps):
+		source.applyToGrid(grid=density, value=1)
+
+		advectSemiLagrange(flags=flags, vel=vel, grid=density, order=2)
+		advectSemiLagrange(flags=flags, vel=vel, grid=vel,     order=2)
+		if dd:
+			dd.exchange(density)
+			dd.exchange(vel)
+
+		setWallBcs(flags=flags, vel=vel)
+		addBuoyancy(density=density, vel=vel, gravity=vec3(0,0,-2e-2), flags=flags)
+		if dd:
+			solvePressure(flags=flags, vel=vel, pressure=pressure, cgAccuracy=accuracy, decomposition=dd)
+		else:
+			solvePressure(flags=flags, vel=vel, pressure=pressure, cgAccuracy=accuracy)
+
+		parts.advectInGrid(flags=flags, vel=vel, integrationMode=IntRK2, deleteInObstacle=False)
+		num = dd.migrateParticles(parts) if dd else parts.pySize()
+
+		s.step()
+	return (density, vel, num)
+
+# decomposed run, collect result on rank 0
+sd = Solver(name='decomposed', gridSize=dd.getLocalSize(), dim=3)
+(densD, velD, numD) = runPlume(sd, dd.getOffset(), dd)
+numD = int(dd.sum(numD))
+
+sg = Solver(name='gathered', gridSize=gs, dim=3)
+densG = sg.create(RealGrid)
+velG  = sg.create(MACGrid)
+dd.gather(densD, densG)
+dd.gather(velD,  velG)
+
+if dd.getRank()==0:
+	# reference on the full domain
+	sf = Solver(name='full', gridSize=gs, dim=3)
+	(densF, velF, numF) = runPlume(sf, vec3(0,0,0))
+
+	diffDens = gridMaxDiff(densG, densF)
+	diffVel  = gridMaxDiffVec3(velG, velF)
+	print("Decomposed vs. full domain: density "+str(diffDens)+", vel "+str(diffVel)+", particles "+str(numD)+" / "+str(numF))
+	if diffDens>1e-03 or diffVel>1e-03 or numD!=numF:
+		print("Error - decomposed result differs from the full domain simulation")
+
+	# the reference doesn't depend on the number of ranks, builds without MULTIPROCESS run a single one
+	doTestGrid( sys.argv[0], "dens", sf, densF, threshold=1e-04, thresholdStrict=1e-08 )
+	doTestGrid( sys.argv[0], "vel" , sf, velF , threshold=1e-04, thresholdStrict=1e-08 )
+
+dd.finish()
@@ -0,0 +1,87 @@
+#
+# Implicit diffusion with reusable systems and preconditioners, has to match the plain CG solve
+#
+import sys
+from manta import *
+from helperInclude import *
+
+res = 32
+gs  = vec3(res,res,res)
+s   = Solver(name='main', gridSize = gs, dim=3)
+
+flags = s.create(FlagGrid)
+flags.initDomain()
+obs = s.create(Sphere, center=gs*0.5, radius=res*0.2)
+obs.applyToGrid(grid=flags, value=FlagObstacle)
+flags.fillGrid()
+setOpenBound(flags, 1, 'yY', FlagOutflow|FlagEmpty)
+
+noise = s.create(NoiseField, loadFromFile=True)
+noise.posScale = vec3(4)
+density = s.create(RealGrid)
+densityInflow(flags=flags, density=density, noise=noise, shape=s.create(Box, p0=vec3(0), p1=gs), scale=1, sigma=1)
+density.addConst(0.5)
+vel = s.create(MACGrid)
+vortex = s.create(Sphere, center=gs*vec3(0.3,0.6,0.5), radius=res*0.2)
+vortex.applyToGrid(grid=vel, value=vec3(0.3, 0.6, -0.2))
+
+alpha = 2.
+# reference: plain CG, new system every call
+dRef = s.create(RealGrid)
+dRef.copyFrom(density)
+cgSolveDiffusion(flags, dRef, alpha=alpha, cgAccuracy=1e-6, cgMaxIterFac=5.)
+vRef = s.create(MACGrid)
+vRef.copyFrom(vel)
+cgSolveDiffusion(flags, vRef, alpha=alpha, cgAccuracy=1e-6, cgMaxIterFac=5.)
+
+# the kept system has to match the former solve that assembled the full system every call
+dPlain = s.create(RealGrid)
+dPlain.copyFrom(density)
+cgSolveDiffusionReference(flags, dPlain, alpha=alpha, cgAccuracy=1e-6, cgMaxIterFac=5.)
+vPlain = s.create(MACGrid)
+vPlain.copyFrom(vel)
+cgSolveDiffusionReference(flags, vPlain, alpha=alpha, cgAccuracy=1e-6, cgMaxIterFac=5.)
+if gridMaxDiff(dRef, dPlain) > 1e-04 or gridMaxDiffVec3(vRef, vPlain) > 1e-04:
+	print("Error - kept system differs from the plain solve by %f %f" % (gridMaxDiff(dRef, dPlain), gridMaxDiffVec3(vRef, vPlain)))
+
+for pc in [PcMIC, PcMGStatic, PcMGStatic, PcMGDynamic]:
+	d = s.create(RealGrid)
+	d.copyFrom(density)
+	cgSolveDiffusion(flags, d, alpha=alpha, cgAccuracy=1e-6, cgMaxIterFac=5., preconditioner=pc)
+	if gridMaxDiff(d, dRef) > 1e-04:
+		print("Error - preconditioner %d differs by %f" % (pc, gridMaxDiff(d, dRef)))
+
+# batch: one operator for the density and all velocity components
+dBatch = s.create(RealGrid)
+dBatch.copyFrom(density)
+vBatch = s.create(MACGrid)
+vBatch.copyFrom(vel)
+cgSolveDiffusionBatch(flags, [dBatch, vBatch], alpha=alpha, cgAccuracy=1e-6, cgMaxIterFac=5.)
+if gridMaxDiff(dBatch, dRef) > 1e-04 or gridMaxDiffVec3(vBatch, vRef) > 1e-04:
+	print("Error - batch solve differs by %f %f" % (gridMaxDiff(dBatch, dRef), gridMaxDiffVec3(vBatch, vRef)))
+releaseDiffusionSystems()
+
+# systems are released with their solver, a new solver of another size must not pick them up;
+# the same size gives the same result again, with and without preconditioner
+results = {}
+for r in [24, 16, 24]:
+	sn = Solver(name='resized', gridSize = vec3(r,r+2,r+4), dim=3)
+	fn = sn.create(FlagGrid)
+	fn.initDomain()
+	fn.fillGrid()
+	dn = sn.create(RealGrid)
+	dMic = sn.create(RealGrid)
+	dn.setConst(1.)
+	dMic.setConst(1.)
+	cgSolveDiffusion(fn, dn, alpha=alpha, cgAccuracy=1e-6, cgMaxIterFac=5.)
+	cgSolveDiffusion(fn, dMic, alpha=alpha, cgAccuracy=1e-6, cgMaxIterFac=5., preconditioner=PcMIC)
+	if gridMaxDiff(dn, dMic) > 1e-04:
+		print("Error - preconditioned solve on a new solver of size %d differs by %f" % (r, gridMaxDiff(dn, dMic)))
+	stats = (dn.getMin(), dn.getMax(), dn.getL1())
+	if r in results and max(abs(a-b) for (a,b) in zip(stats, results[r])) > 1e-04 * dn.getL1():
+		print("Error - solve on a new solver of size %d differs from the first one" % r)
+	results[r] = stats
+	sn = fn = dn = dMic = None
+
+doTestGrid( sys.argv[0], "dens", s, dBatch, threshold=1e-04, thresholdStrict=1e-10 )
+doTestGrid( sys.argv[0], "vel" , s, vBatch, threshold=1e-04, thresholdStrict=1e-10 )
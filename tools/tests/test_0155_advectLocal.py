@@ -0,0 +1,70 @@
+#
+# Advection with local time steps, fast blocks are substepped while slow ones take a single step
+#
+
+import sys
+from manta import *
+from helperInclude import *
+
+res = 64
+gs  = vec3(res,res,1)
+s   = Solver(name='main', gridSize = gs, dim=2)
+s.timestep = 1.0
+
+flags    = s.create(FlagGrid)
+vel      = s.create(MACGrid)
+velRef   = s.create(MACGrid)
+velInit  = s.create(MACGrid)
+pressure = s.create(RealGrid)
+density  = s.create(RealGrid)
+densRef  = s.create(RealGrid)
+
+flags.initDomain()
+flags.fillGrid()
+
+# slow background flow with a fast, localized jet
+jet     = s.create(Box, p0=gs*vec3(0.2,0.2,0), p1=gs*vec3(0.35,0.5,1))
+dSource = s.create(Box, p0=gs*vec3(0.15,0.1,0), p1=gs*vec3(0.8,0.6,1))
+vel.setConst( vec3(0.2,0.1,0) )
+jet.applyToGrid(grid=vel, value=vec3(0.5,4.,0) )
+setWallBcs(flags=flags, vel=vel)
+solvePressure(flags=flags, vel=vel, pressure=pressure, cgAccuracy=1e-05)
+velInit.copyFrom(vel)
+
+def initGrids():
+	density.setConst(0.)
+	dSource.applyToGrid(grid=density, value=1.)
+	densRef.copyFrom(density)
+	vel.copyFrom(velInit)
+	velRef.copyFrom(velInit)
+
+# a single substep everywhere has to match the regular advection exactly
+for order in [1,2]:
+	initGrids()
+	for t in range(3):
+		advectSemiLagrange(flags=flags, vel=velRef, grid=densRef, order=order)
+		advectSemiLagrange(flags=flags, vel=velRef, grid=velRef , order=order)
+		advectSemiLagrangeLocal(flags=flags, vel=vel, grid=density, order=order, cfl=100.)
+		advectSemiLagrangeLocal(flags=flags, vel=vel, grid=vel    , order=order, cfl=100.)
+	if gridMaxDiff(density, densRef)!=0. or gridMaxDiffVec3(vel, velRef)!=0.:
+		print("Error - local advection with a single substep differs from advectSemiLagrange, order %d" % order)
+
+# local substeps, compared to uniformly substepping the whole domain
+initGrids()
+substeps = advectSemiLagrangeLocal(flags=flags, vel=vel, grid=density, order=2, cfl=1.)
+advectSemiLagrangeLocal(flags=flags, vel=vel, grid=vel, order=2, cfl=1.)
+if substeps < 4:
+	print("Error - jet was not substepped, %d substeps" % substeps)
+
+s.timestep = 1.0/substeps
+for t in range(substeps):
+	advectSemiLagrange(flags=flags, vel=velInit, grid=densRef, order=2)
+s.timestep = 1.0
+
+diffDens = gridMaxDiff(density, densRef)
+print("Local vs. global substepping: %d substeps, density difference %f" % (substeps, diffDens))
+if diffDens > 0.05:
+	print("Error - local substepping differs too much from global substepping")
+
+doTestGrid( sys.argv[0], "dens" , s, density , threshold=1e-04, thresholdStrict=1e-10)
+doTestGrid( sys.argv[0], "vel"  , s, vel     , threshold=1e-04, thresholdStrict=1e-10)
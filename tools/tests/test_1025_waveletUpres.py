@@ -0,0 +1,78 @@
+#
+# Fused wavelet turbulence upres, has to match the separate interpolation and noise passes
+#
+import sys
+from manta import *
+from helperInclude import *
+
+res   = 16
+upres = 2
+gs    = vec3(res,res,res)
+sm = Solver(name='main', gridSize = gs, dim=3)
+xl = Solver(name='larger', gridSize = gs*upres, dim=3)
+
+flags   = sm.create(FlagGrid)
+vel     = sm.create(MACGrid)
+density = sm.create(RealGrid)
+energy  = sm.create(RealGrid)
+flags.initDomain()
+flags.fillGrid()
+
+# some swirling low-res flow, density only in the lower part
+vortex = sm.create(Sphere, center=gs*0.5, radius=res*0.3)
+vortex.applyToGrid(grid=vel, value=vec3(0.3, 0.6, -0.2))
+vel.multConst(vec3(1.0, 0.5, 1.5))
+source = sm.create(Box, p0=gs*vec3(0.2,0.1,0.2), p1=gs*vec3(0.6,0.35,0.6))
+source.applyToGrid(grid=density, value=1.)
+computeEnergy(flags=flags, vel=vel, energy=energy)
+computeWaveletCoeffs(energy)
+
+xl_flags  = xl.create(FlagGrid)
+xl_vel    = xl.create(MACGrid)
+xl_ref    = xl.create(MACGrid)
+xl_plain  = xl.create(MACGrid)
+xl_weight = xl.create(RealGrid)
+xl_flags.initDomain()
+xl_flags.fillGrid()
+
+strength = 0.4
+octaves  = []
+for o in range(3):
+	n = xl.create(NoiseField, loadFromFile=True)
+	n.posScale = vec3(res*0.5) * pow(2., o)
+	n.timeAnim = 0.1
+	octaves.append(n)
+
+# separate passes
+interpolateGrid( target=xl_weight, source=energy )
+interpolateMACGrid( target=xl_ref, source=vel )
+interpolateMACGrid( target=xl_plain, source=vel )
+for o in range(3):
+	applyNoiseVec3( flags=xl_flags, target=xl_ref, noise=octaves[o], scale=strength*pow(0.6,o), weight=xl_weight )
+
+applyWaveletUpres( flags=xl_flags, target=xl_vel, source=vel, energy=energy, noises=octaves, scale=strength, octaveScale=0.6 )
+if gridMaxDiffVec3(xl_vel, xl_ref) > 1e-05:
+	print("Error - fused upres differs by %f" % gridMaxDiffVec3(xl_vel, xl_ref))
+
+# restricted to tiles with density: noise in the lower part, plain interpolation above
+masked = xl.create(MACGrid)
+applyWaveletUpres( flags=xl_flags, target=masked, source=vel, energy=energy, noises=octaves, scale=strength, octaveScale=0.6, density=density, tileSize=4 )
+def maskedDiff(a, b, box):
+	keep = xl.create(VecGrid)
+	box.applyToGrid(grid=keep, value=vec3(1))
+	ma = xl.create(VecGrid)
+	mb = xl.create(VecGrid)
+	ma.copyFrom(a)
+	mb.copyFrom(b)
+	ma.mult(keep)
+	mb.mult(keep)
+	return gridMaxDiffVec3(ma, mb)
+upperBox = xl.create(Box, p0=gs*upres*vec3(0,0.75,0), p1=gs*upres)
+lowerBox = xl.create(Box, p0=gs*upres*vec3(0.25,0.1,0.25), p1=gs*upres*vec3(0.55,0.3,0.55))
+if maskedDiff(masked, xl_plain, upperBox) != 0. or maskedDiff(masked, xl_ref, lowerBox) > 1e-05:
+	print("Error - density mask differs: %f %f" % (maskedDiff(masked, xl_plain, upperBox), maskedDiff(masked, xl_ref, lowerBox)))
+if gridMaxDiffVec3(masked, xl_ref) < 1e-04:
+	print("Error - density mask has no effect")
+
+doTestGrid( sys.argv[0], "vel" , xl, xl_vel , threshold=1e-04, thresholdStrict=1e-10 )
+doTestGrid( sys.argv[0], "mask", xl, masked , threshold=1e-04, thresholdStrict=1e-10 )
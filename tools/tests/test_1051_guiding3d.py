@@ -0,0 +1,65 @@
+#
+# Test of 3d guiding, in line with the 2d guiding test
+#
+
+import math
+import sys
+from manta import *
+from helperInclude import *
+
+# solver params
+res = 24
+gs = vec3(res,res,res)
+s = Solver(name='main', gridSize = gs, dim=3)
+s.timestep = 1.0
+
+# params
+wScalar = 2
+beta = 2
+tau = 0.58/wScalar
+sigma = 2.44/tau
+theta = 0.3
+
+# prepare grids
+flags = s.create(FlagGrid)
+vel = s.create(MACGrid)
+velT = s.create(MACGrid)
+density = s.create(RealGrid)
+pressure = s.create(RealGrid)
+W = s.create(RealGrid)
+
+bWidth=0
+flags.initDomain(boundaryWidth=bWidth) 
+flags.fillGrid()
+setOpenBound(flags, bWidth, 'xXyYzZ', FlagOutflow|FlagEmpty)
+
+source = s.create(Cylinder, center=gs*vec3(0.5,0.3,0.5), radius=gs.y*0.14, z=gs*vec3(0, 0.04, 0))
+getSpiralVelocity(flags=flags, vel=velT, strength=0.5, with3D=True)
+W.setConst(wScalar)
+
+#main loop
+for t in range(4):
+	resetOutflow(flags=flags,real=density)
+
+	source.applyToGrid(grid=density, value=1)
+	
+	advectSemiLagrange(flags=flags, vel=vel, grid=density, order=2, clampMode=1)    
+	advectSemiLagrange(flags=flags, vel=vel, grid=vel,     order=2, clampMode=1)
+	
+	setWallBcs(flags=flags, vel=vel)
+	addBuoyancy(density=density, vel=vel, gravity=vec3(0,-2e-3,0), flags=flags)
+
+	# MIC preconditioned inner solves
+	PD_fluid_guiding(vel=vel, velT=velT, flags=flags, weight=W, blurRadius=beta, pressure=pressure, \
+		tau = tau, sigma = sigma, theta = theta, preconditioner = 1 )
+
+	setWallBcs(flags=flags, vel=vel)
+
+	# the iterations converge, a diverging preconditioned inner solve blows up the velocity
+	if vel.getMaxAbs() > 1.:
+		print("Error - guided velocity %f" % vel.getMaxAbs())
+	s.step()
+
+# check final state
+doTestGrid( sys.argv[0],"dens" , s, density , threshold=0.0001 , thresholdStrict=1e-10 )
+doTestGrid( sys.argv[0],"vel"  , s, vel     , threshold=0.0001 , thresholdStrict=1e-10 )
@@ -0,0 +1,68 @@
+#
+# Fluid guiding in a closed 2D domain with the MIC preconditioned inner pressure solves,
+# has to converge like the unpreconditioned solves (the closed pressure system is singular)
+#
+
+import sys
+from manta import *
+from helperInclude import *
+
+# solver params
+res = 60
+gs = vec3(res,res,1)
+s = Solver(name='main', gridSize = gs, dim=2)
+s.timestep = 2.0
+maxIters = 200
+
+# prepare grids
+flags = s.create(FlagGrid)
+vel = s.create(MACGrid)
+velNone = s.create(MACGrid)
+velDiff = s.create(MACGrid)
+velT = s.create(MACGrid)
+density = s.create(RealGrid)
+pressure = s.create(RealGrid)
+pressureNone = s.create(RealGrid)
+W = s.create(RealGrid)
+timings = Timings()
+
+# closed domain, no outflow
+flags.initDomain(boundaryWidth=1)
+flags.fillGrid()
+
+source = s.create(Cylinder, center=gs*vec3(0.5,0.3,0.5), radius=res*0.14, z=gs*vec3(0, 0.06, 0))
+getSpiralVelocity(flags=flags, vel=velT, strength=3.0)
+setGradientYWeight(W=W, minY=0,     maxY=res/2, valAtMin=1, valAtMax=1)
+setGradientYWeight(W=W, minY=res/2, maxY=res,   valAtMin=5, valAtMax=5)
+
+iters = []
+itersNone = []
+maxDiff = 0.
+for t in range(4):
+	source.applyToGrid(grid=density, value=1)
+	advectSemiLagrange(flags=flags, vel=vel, grid=density, order=2)
+	advectSemiLagrange(flags=flags, vel=vel, grid=vel,     order=2)
+	setWallBcs(flags=flags, vel=vel)
+	addBuoyancy(density=density, vel=vel, gravity=vec3(0,-5e-3,0), flags=flags)
+
+	velNone.copyFrom(vel)
+	PD_fluid_guiding(vel=vel, velT=velT, flags=flags, weight=W, blurRadius=2, pressure=pressure, maxIters=maxIters, preconditioner=PcMIC)
+	iters.append(timings.getLastStat('PD_fluid_guiding ADMM iterations'))
+	PD_fluid_guiding(vel=velNone, velT=velT, flags=flags, weight=W, blurRadius=2, pressure=pressureNone, maxIters=maxIters, preconditioner=PcNone)
+	itersNone.append(timings.getLastStat('PD_fluid_guiding ADMM iterations'))
+	if max(iters[-1], itersNone[-1]) >= maxIters-1:
+		print("FAIL! Guiding did not converge in the closed domain, ADMM iterations MIC %d, no preconditioner %d" % (iters[-1], itersNone[-1]))
+		exit(1)
+
+	velDiff.copyFrom(vel)
+	velDiff.sub(velNone)
+	maxDiff = max(maxDiff, velDiff.getMaxAbs() / max(velNone.getMaxAbs(), 1e-10))
+
+	setWallBcs(flags=flags, vel=vel)
+	s.step()
+
+print("ADMM iterations MIC %s, no preconditioner %s, max. relative velocity difference %g" % (iters, itersNone, maxDiff))
+if maxDiff > 0.05:
+	print("FAIL! MIC and unpreconditioned guiding differ by %g" % maxDiff)
+else:
+	print("OK! Closed domain guiding converges with MIC")
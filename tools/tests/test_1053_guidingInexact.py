@@ -0,0 +1,56 @@
+#
+# Fluid guiding with inexact inner pressure solves (cgAccuracyFac), has to converge to the
+# result of the exact solves with fewer CG iterations; the default keeps the exact solves
+#
+
+import sys
+from manta import *
+from helperInclude import *
+
+res = 48
+gs = vec3(res,res,1)
+s = Solver(name='main', gridSize = gs, dim=2)
+s.timestep = 1.0
+maxIters = 200
+
+flags = s.create(FlagGrid)
+velInit = s.create(MACGrid)
+velT = s.create(MACGrid)
+pressure = s.create(RealGrid)
+W = s.create(RealGrid)
+timings = Timings()
+
+flags.initDomain(boundaryWidth=1)
+flags.fillGrid()
+
+getSpiralVelocity(flags=flags, vel=velT, strength=1.5)
+setGradientYWeight(W=W, minY=0, maxY=res, valAtMin=1, valAtMax=5)
+jet = s.create(Box, p0=gs*vec3(0.4,0.1,0), p1=gs*vec3(0.6,0.4,1))
+jet.applyToGrid(grid=velInit, value=vec3(0,1.,0))
+setWallBcs(flags=flags, vel=velInit)
+
+# returns guided velocity, ADMM and CG iterations
+def guide(name, **kw):
+	vel = s.create(MACGrid, name=name)
+	vel.copyFrom(velInit)
+	pressure.setConst(0.)
+	PD_fluid_guiding(vel=vel, velT=velT, flags=flags, weight=W, blurRadius=2, pressure=pressure, maxIters=maxIters, **kw)
+	return vel, timings.getLastStat('PD_fluid_guiding ADMM iterations'), timings.getLastStat('PD_fluid_guiding CG iterations')
+
+velDef, itDef, cgDef = guide('velDefault')
+velEx,  itEx,  cgEx  = guide('velExact', cgAccuracyFac=0.)
+velIn,  itIn,  cgIn  = guide('velInexact', cgAccuracyFac=0.1)
+print("ADMM / CG iterations: default %d / %d, exact %d / %d, inexact %d / %d" % (itDef, cgDef, itEx, cgEx, itIn, cgIn))
+
+velDef.sub(velEx)
+if velDef.getMaxAbs() != 0. or itDef != itEx or cgDef != cgEx:
+	print("Error - default guiding differs from exact inner solves")
+if max(itEx, itIn) >= maxIters-1:
+	print("Error - guiding did not converge")
+if cgIn >= cgEx:
+	print("Error - inexact inner solves need %d CG iterations, exact ones %d" % (cgIn, cgEx))
+velIn.sub(velEx)
+diff = velIn.getMaxAbs() / velEx.getMaxAbs()
+if diff > 0.02:
+	print("Error - inexact guiding differs by %g (relative)" % diff)
+print("Inexact guiding test done, relative difference %g" % diff)
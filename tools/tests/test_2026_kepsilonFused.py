@@ -0,0 +1,73 @@
+#
+# Fused k-epsilon step, has to match the separate KEpsilon plugins. Only in 3d,
+# in 2d KEpsilonComputeProduction reads outside of the grid (k-1, k+1), while
+# the fused step uses uz=0, so the results aren't comparable there
+#
+import sys
+from manta import *
+from helperInclude import *
+
+res = 32
+gs  = vec3(res,res,res)
+s   = Solver(name='main', gridSize = gs, dim=3)
+s.timestep = 0.5
+
+flags    = s.create(FlagGrid)
+vel      = s.create(MACGrid)
+pressure = s.create(RealGrid)
+flags.initDomain()
+obs = s.create(Sphere, center=gs*vec3(0.4,0.5,0.5), radius=res*0.15)
+obs.applyToGrid(grid=flags, value=FlagObstacle)
+flags.fillGrid()
+
+velInflow = vec3(0.6, 0.05, 0)
+intensity = 0.1
+nu        = 0.1
+prodMult  = 2.5
+
+# separate passes, and the fused model with its own copies of the fields
+k      = s.create(RealGrid)
+eps    = s.create(RealGrid)
+prod   = s.create(RealGrid)
+nuT    = s.create(RealGrid)
+strain = s.create(RealGrid)
+velF    = s.create(MACGrid)
+kF      = s.create(RealGrid)
+epsF    = s.create(RealGrid)
+prodF   = s.create(RealGrid)
+nuTF    = s.create(RealGrid)
+strainF = s.create(RealGrid)
+model   = s.create(KEpsilonModel)
+
+KEpsilonBcs(flags=flags,k=k,eps=eps,intensity=intensity,nu=nu,fillArea=True)
+KEpsilonBcs(flags=flags,k=kF,eps=epsF,intensity=intensity,nu=nu,fillArea=True)
+
+for t in range(6):
+	# shared base flow
+	advectSemiLagrange(flags=flags, vel=vel, grid=vel, order=2, clampMode=1)
+	setWallBcs(flags=flags, vel=vel)
+	setInflowBcs(vel=vel,dir='xXyYzZ',value=velInflow)
+	solvePressure(flags=flags, vel=vel, pressure=pressure, cgMaxIterFac=0.5)
+	setWallBcs(flags=flags, vel=vel)
+	setInflowBcs(vel=vel,dir='xXyYzZ',value=velInflow)
+	velF.copyFrom(vel)
+
+	for (kk, ee) in [(k, eps), (kF, epsF)]:
+		advectSemiLagrange(flags=flags, vel=vel, grid=kk, order=1)
+		advectSemiLagrange(flags=flags, vel=vel, grid=ee, order=1)
+
+	KEpsilonBcs(flags=flags,k=k,eps=eps,intensity=intensity,nu=nu,fillArea=False)
+	KEpsilonComputeProduction(vel=vel, k=k, eps=eps, prod=prod, nuT=nuT, strain=strain, pscale=prodMult)
+	KEpsilonSources(k=k, eps=eps, prod=prod)
+	KEpsilonGradientDiffusion(k=k, eps=eps, vel=vel, nuT=nuT, sigmaU=10.0)
+
+	model.step(flags=flags, vel=velF, k=kF, eps=epsF, prod=prodF, nuT=nuTF, intensity=intensity, nu=nu, strain=strainF, pscale=prodMult, sigmaU=10.0)
+
+	diffs = (gridMaxDiff(k, kF), gridMaxDiff(eps, epsF), gridMaxDiff(prod, prodF), gridMaxDiff(nuT, nuTF), gridMaxDiff(strain, strainF), gridMaxDiffVec3(vel, velF))
+	if max(diffs) > 1e-05:
+		print("Error - fused k-epsilon step differs in step %d: %s" % (t, str(diffs)))
+	s.step()
+
+doTestGrid( sys.argv[0], "k"  , s, kF  , threshold=1e-04, thresholdStrict=1e-10 )
+doTestGrid( sys.argv[0], "eps", s, epsF, threshold=1e-04, thresholdStrict=1e-10 )
+doTestGrid( sys.argv[0], "vel", s, velF, threshold=1e-04, thresholdStrict=1e-10 )
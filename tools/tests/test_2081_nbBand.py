@@ -0,0 +1,115 @@
+#
+# Narrow band FLIP functions restricted to a band, compared to the full grid versions
+#
+
+import sys
+from manta import *
+from helperInclude import *
+
+def runTest(gs, dim):
+	s = Solver(name='main', gridSize = gs, dim=dim)
+	flags = s.create(FlagGrid)
+	phi   = s.create(LevelsetGrid)
+	shell = s.create(LevelsetGrid)
+	deep  = s.create(LevelsetGrid)
+	velA  = s.create(MACGrid)
+	velB  = s.create(MACGrid)
+	oldA  = s.create(MACGrid)
+	oldB  = s.create(MACGrid)
+	wA    = s.create(MACGrid)
+	wB    = s.create(MACGrid)
+	cA    = s.create(MACGrid)
+	cB    = s.create(MACGrid)
+	tmp   = s.create(MACGrid)
+	pp    = s.create(BasicParticleSystem)
+	pVel  = pp.create(PdataVec3)
+	band  = s.create(NarrowBand)
+	inner = 3.
+
+	# liquid ball away from the walls, particles only in a shell below the surface
+	flags.initDomain()
+	ball = s.create(Sphere, center=gs*0.5, radius=gs.x*0.35)
+	phi.copyFrom(ball.computeLevelset())
+	flags.updateFromLevelset(phi)
+	shell.copyFrom(phi)
+	deep.copyFrom(phi)
+	deep.addConst(inner)
+	shell.subtract(deep)
+	sampleLevelsetWithParticles(phi=shell, flags=flags, parts=pp, discretization=2, randomness=0.2)
+	pp.getPosPdata(pVel)
+
+	band.update(phi, inner=inner+2., outer=6.)
+	if band.getNumCells() >= gs.x*gs.y*gs.z:
+		print("Error - band has %d cells" % band.getNumCells())
+
+	# particle mapping
+	mapPartsToMAC(flags=flags, vel=velA, velOld=oldA, parts=pp, partVel=pVel, weight=wA)
+	mapPartsToMAC(flags=flags, vel=velB, velOld=oldB, parts=pp, partVel=pVel, weight=wB, band=band)
+	tmp.copyFrom(velB)
+	checkSame("mapped vel", tmp, velA)
+	checkSame("mapped velOld", oldB, oldA)
+	tmp.copyFrom(wB)
+	checkSame("mapped weight", tmp, wA)
+
+	# extrapolation from the weights, close to the particles
+	velB.copyFrom(velA)
+	wB.copyFrom(wA)
+	extrapolateMACFromWeight(vel=velA, weight=wA, distance=1)
+	extrapolateMACFromWeight(vel=velB, weight=wB, distance=1, band=band)
+	checkSame("weight extrapolated vel", velB, velA)
+	checkSame("extrapolated weight", wB, wA)
+
+	# combination, cells below the band are zero in both versions
+	cA.copyFrom(velA)
+	cB.copyFrom(velA)
+	tmp.copyFrom(velA)
+	velB.copyFrom(velA)
+	combineGridVel(vel=tmp, weight=wA, combineVel=cA, phi=phi, narrowBand=2, thresh=0)
+	combineGridVel(vel=velB, weight=wA, combineVel=cB, phi=phi, narrowBand=2, thresh=0, band=band)
+	checkSame("combined vel", velB, tmp)
+	checkSame("combineVel", cB, cA)
+
+	# extrapolation stays within the outer band width
+	velB.copyFrom(velA)
+	extrapolateMACSimple(flags=flags, vel=velA, distance=4)
+	extrapolateMACSimple(flags=flags, vel=velB, distance=4, band=band)
+	checkSame("extrapolated vel", velB, velA)
+
+	# cells deep inside the liquid aren't touched
+	velB.setConst(vec3(7,7,7))
+	mapPartsToMAC(flags=flags, vel=velB, velOld=oldB, parts=pp, partVel=pVel, weight=wB, band=band)
+	velB.sub(oldA)
+	check("deep cells", velB.getMaxAbs(), 7.*3.**0.5)
+
+# pool touching the domain sides, the sides are extrapolated everywhere as in the full version
+def runTestPool(gs, dim):
+	s = Solver(name='main', gridSize = gs, dim=dim)
+	flags = s.create(FlagGrid)
+	phi   = s.create(LevelsetGrid)
+	velA  = s.create(MACGrid)
+	velB  = s.create(MACGrid)
+	old   = s.create(MACGrid)
+	pp    = s.create(BasicParticleSystem)
+	pVel  = pp.create(PdataVec3)
+	band  = s.create(NarrowBand)
+
+	flags.initDomain(boundaryWidth=0)
+	pool = s.create(Box, p0=gs*vec3(0,0,0), p1=gs*vec3(1,0.6,1))
+	phi.copyFrom(pool.computeLevelset())
+	flags.updateFromLevelset(phi)
+	sampleLevelsetWithParticles(phi=phi, flags=flags, parts=pp, discretization=2, randomness=0.2)
+	pp.getPosPdata(pVel)
+	mapPartsToMAC(flags=flags, vel=velA, velOld=old, parts=pp, partVel=pVel)
+	velB.copyFrom(velA)
+
+	band.update(phi, inner=2., outer=5.)
+	extrapolateMACSimple(flags=flags, vel=velA, distance=3)
+	extrapolateMACSimple(flags=flags, vel=velB, distance=3, band=band)
+	checkSame("pool extrapolated vel", velB, velA)
+
+runTest(vec3(40,40,1), 2)
+runTest(vec3(26,24,28), 3)
+runTestPool(vec3(30,32,1), 2)
+runTestPool(vec3(20,22,18), 3)
+
+print("Narrow band test done")